@@ -22,10 +22,11 @@
 
 #pragma once
 
-#include <iosfwd>                   // std::istream, std::ostream return values.
-#include <memory>                   // std::unique_ptr return value.
+#include <iosfwd>                                   // std::istream, std::ostream return values.
+#include <memory>                                   // std::unique_ptr return value.
 
-#include "BitFunnel/IInterface.h"   // Base class.
+#include "BitFunnel/Configuration/IMappedFile.h"    // IMappedFile return value.
+#include "BitFunnel/IInterface.h"                   // Base class.
 
 #ifdef __clang__
 // Pure abstract classes "should" have a vtable in every translation unit.
@@ -45,6 +46,12 @@ namespace BitFunnel
             OpenForRead(char const * filename,
                         std::ios_base::openmode mode = std::ios::in) = 0;
 
+        // Returns a read-only view of the entire file. Unlike OpenForRead(),
+        // the contents need not be copied through a stream buffer. Throws
+        // RecoverableError if the file cannot be opened.
+        virtual std::unique_ptr<IMappedFile>
+            OpenForMappedRead(char const * filename) = 0;
+
         virtual bool Exists(char const * filename) = 0;
     };
 }
@@ -0,0 +1,51 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                 // size_t return value.
+
+#include "BitFunnel/IInterface.h"   // Base class.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // IMappedFile is a read-only view of the entire contents of a file,
+    // returned by IFileSystem::OpenForMappedRead(). Implementations backed by
+    // the operating system map the file into the address space of the process
+    // so that callers can parse it in place without copying it through a
+    // stream. The buffer remains valid for the lifetime of the IMappedFile.
+    //
+    //*************************************************************************
+    class IMappedFile : public IInterface
+    {
+    public:
+        // Returns the address of the first byte of the file. May be nullptr
+        // when the file is empty.
+        virtual char const * GetBuffer() const = 0;
+
+        // Returns the size of the file in bytes.
+        virtual size_t GetSize() const = 0;
+    };
+}
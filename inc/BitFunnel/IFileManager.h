@@ -29,7 +29,8 @@
 #include <stddef.h>                 // size_t parameter.
 #include <string>                   // std::string return value.
 
-#include "BitFunnel/IInterface.h"   // Base class.
+#include "BitFunnel/Configuration/IMappedFile.h"    // IMappedFile return value.
+#include "BitFunnel/IInterface.h"                   // Base class.
 
 #ifdef __clang__
 // Pure abstract classes "should" have a vtable in every translation unit.
@@ -131,6 +132,7 @@ namespace BitFunnel
 
         virtual std::string GetName() = 0;
         virtual std::unique_ptr<std::istream> OpenForRead() = 0;
+        virtual std::unique_ptr<IMappedFile> OpenForMappedRead() = 0;
         virtual std::unique_ptr<std::ostream> OpenForWrite() = 0;
         // virtual std::unique_ptr<std::ostream> OpenTempForWrite() = 0;
         // virtual void Commit() = 0;
@@ -146,6 +148,7 @@ namespace BitFunnel
 
         virtual std::string GetName(size_t p1) = 0;
         virtual std::unique_ptr<std::istream> OpenForRead(size_t p1) = 0;
+        virtual std::unique_ptr<IMappedFile> OpenForMappedRead(size_t p1) = 0;
         virtual std::unique_ptr<std::ostream> OpenForWrite(size_t p1) = 0;
         // virtual std::unique_ptr<std::ostream> OpenTempForWrite(size_t p1) = 0;
         // virtual void Commit(size_t p1) = 0;
@@ -161,6 +164,7 @@ namespace BitFunnel
 
         virtual std::string GetName(size_t p1, size_t p2) = 0;
         virtual std::unique_ptr<std::istream> OpenForRead(size_t p1, size_t p2) = 0;
+        virtual std::unique_ptr<IMappedFile> OpenForMappedRead(size_t p1, size_t p2) = 0;
         virtual std::unique_ptr<std::ostream> OpenForWrite(size_t p1, size_t p2) = 0;
         // virtual std::unique_ptr<std::ostream> OpenTempForWrite(size_t p1, size_t p2) = 0;
         // virtual void Commit(size_t p1, size_t p2) = 0;
@@ -181,6 +185,7 @@ namespace BitFunnel
 
         std::string GetName() { return m_file.GetName(); }
         std::unique_ptr<std::istream> OpenForRead() { return m_file.OpenForRead(); }
+        std::unique_ptr<IMappedFile> OpenForMappedRead() { return m_file.OpenForMappedRead(); }
         std::unique_ptr<std::ostream> OpenForWrite() { return m_file.OpenForWrite(); }
         // std::unique_ptr<std::ostream> OpenTempForWrite() { return m_file.OpenTempForWrite(); }
         // void Commit() { return m_file.Commit(); }
@@ -205,6 +210,7 @@ namespace BitFunnel
 
         std::string GetName() { return m_file.GetName(m_p1); }
         std::unique_ptr<std::istream> OpenForRead() { return m_file.OpenForRead(m_p1); }
+        std::unique_ptr<IMappedFile> OpenForMappedRead() { return m_file.OpenForMappedRead(m_p1); }
         std::unique_ptr<std::ostream> OpenForWrite() { return m_file.OpenForWrite(m_p1); }
         // std::unique_ptr<std::ostream> OpenTempForWrite() { return m_file.OpenTempForWrite(m_p1); }
         // void Commit() { return m_file.Commit(m_p1); }
@@ -231,6 +237,7 @@ namespace BitFunnel
 
         std::string GetName() { return m_file.GetName(m_p1, m_p2); }
         std::unique_ptr<std::istream> OpenForRead() { return m_file.OpenForRead(m_p1, m_p2); }
+        std::unique_ptr<IMappedFile> OpenForMappedRead() { return m_file.OpenForMappedRead(m_p1, m_p2); }
         std::unique_ptr<std::ostream> OpenForWrite() { return m_file.OpenForWrite(m_p1, m_p2); }
         // std::unique_ptr<std::ostream> OpenTempForWrite() { return m_file.OpenTempForWrite(m_p1, m_p2); }
         // void Commit() { return m_file.Commit(m_p1, m_p2); }
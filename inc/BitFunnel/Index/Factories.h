@@ -33,6 +33,7 @@
 
 namespace BitFunnel
 {
+    class ForwardIndex;
     class IChunkManifestIngestor;
     class IConfiguration;
     class IDocument;
@@ -44,6 +45,7 @@ namespace BitFunnel
     class IFileSystem;
     class IIndexedIdfTable;
     class IIngestor;
+    class IMappedFile;
     class IRecycler;
     class IShardCostFunction;
     class IShardDefinition;
@@ -57,6 +59,7 @@ namespace BitFunnel
     class ITermTreatment;
     class ITermTreatmentFactory;
     class Slice;
+    enum class PageSize;
 
     namespace Factories
     {
@@ -92,13 +95,18 @@ namespace BitFunnel
         std::unique_ptr<IIndexedIdfTable>
             CreateIndexedIdfTable(std::istream& input,
                                   Term::IdfX10 defaultIdf);
+        std::unique_ptr<IIndexedIdfTable>
+            CreateIndexedIdfTable(std::unique_ptr<IMappedFile> file,
+                                  Term::IdfX10 defaultIdf);
 
         std::unique_ptr<IIngestor>
             CreateIngestor(IDocumentDataSchema const & docDataSchema,
                            IRecycler& recycler,
                            ITermTableCollection const & termTables,
                            IShardDefinition const & shardDefinition,
-                           ISliceBufferAllocator& sliceBufferAllocator);
+                           ISliceBufferAllocator& sliceBufferAllocator,
+                           size_t statisticsBytes,
+                           ForwardIndex const * forwardIndex);
 
         std::unique_ptr<IRecycler> CreateRecycler();
 
@@ -111,10 +119,15 @@ namespace BitFunnel
         std::unique_ptr<ISimpleIndex> CreateSimpleIndex(IFileSystem& fileSystem);
 
         std::unique_ptr<ISliceBufferAllocator>
-            CreateSliceBufferAllocator(size_t blockSize, size_t blockCount);
+            CreateSliceBufferAllocator(size_t blockSize,
+                                       size_t maxBlockCount,
+                                       PageSize pageSize,
+                                       unsigned numaNodeCount);
 
         std::unique_ptr<ITermTable> CreateTermTable();
         std::unique_ptr<ITermTable> CreateTermTable(std::istream & input);
+        std::unique_ptr<ITermTable>
+            CreateTermTable(std::unique_ptr<IMappedFile> file);
 
         std::unique_ptr<ITermTableBuilder>
             CreateTermTableBuilder(double density,
@@ -0,0 +1,86 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <vector>                                   // std::vector parameter.
+
+#include "BitFunnel/Index/DocumentHandle.h"         // DocumentHandle parameter.
+#include "BitFunnel/Index/IDocumentDataSchema.h"    // VariableSizeBlobId member.
+#include "BitFunnel/NonCopyable.h"                  // Base class.
+#include "BitFunnel/Term.h"                         // Term::Hash parameter.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // ForwardIndex
+    //
+    // Stores the hashes of the terms posted for each document in a variable
+    // size blob of the document's DocTable entry. Matches reported by the
+    // bit sliced signatures can then be verified exactly against a single
+    // document, without access to the original document.
+    //
+    // Hashes are sorted and delta coded. Each document chooses the smallest
+    // number of bytes that holds its largest delta, and stores every delta
+    // in that many bytes, so decoding has no data dependent branches. The
+    // blob layout is
+    //
+    //    uint32_t count;
+    //    uint8_t width;
+    //    uint8_t deltas[count * width];
+    //    uint8_t padding[8 - width];
+    //
+    // where the padding allows each delta to be read as an unaligned
+    // uint64_t.
+    //
+    // Thread safety: Write() may be called concurrently for different
+    // documents. Read() may be called concurrently with Write() of other
+    // documents.
+    //
+    //*************************************************************************
+    class ForwardIndex : public NonCopyable
+    {
+    public:
+        // Registers the blob that holds the term hashes in schema. Must be
+        // called before the schema is used to lay out the DocTable.
+        ForwardIndex(IDocumentDataSchema & schema);
+
+        // Stores hashes in the DocTable entry of the document. Sorts and
+        // removes duplicates from hashes in place. May be called at most
+        // once per document.
+        void Write(DocumentHandle document,
+                   std::vector<Term::Hash> & hashes) const;
+
+        // Replaces the contents of hashes with the sorted term hashes of the
+        // document. Returns false, leaving hashes empty, if no hashes were
+        // written for the document.
+        bool Read(DocumentHandle document,
+                  std::vector<Term::Hash> & hashes) const;
+
+    private:
+        const VariableSizeBlobId m_blob;
+
+        static const size_t c_headerBytes = sizeof(uint32_t) + sizeof(uint8_t);
+    };
+}
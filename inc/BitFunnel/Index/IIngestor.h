@@ -24,7 +24,8 @@
 
 #include <iosfwd>                           // std::istream& parameter.
 #include <memory>                           // std::unique_ptr parameter.
-#include <vector>                           // std::vector return type.
+#include <utility>                          // std::pair parameter.
+#include <vector>                           // std::vector parameter and return type.
 
 #include "BitFunnel/IInterface.h"           // inherits from IInterface.
 #include "BitFunnel/Index/IFactSet.h"       // FactHandle parameter.
@@ -82,6 +83,17 @@ namespace BitFunnel
 
         virtual void TemporaryWriteAllSlices(IFileManager& fileManager) const = 0;
 
+        // Restores the slices previously written by TemporaryWriteAllSlices()
+        // and makes their active documents available to queries and to the
+        // DocId based methods below. When memoryMap is true, slice buffers
+        // are memory mapped from the files named by the IFileManager instead
+        // of being copied into buffers from the ISliceBufferAllocator. This
+        // requires the IFileManager to be backed by the operating system's
+        // file system. Throws if a slice is not compatible with the current
+        // schema and TermTables.
+        virtual void TemporaryReadAllSlices(IFileManager& fileManager,
+                                            bool memoryMap) = 0;
+
 
         // Returns a reference to the IDocument cache. This cache holds ingested
         // IDocuments for use in query verification diagnostics.
@@ -96,6 +108,17 @@ namespace BitFunnel
         // value.
         virtual void Add(DocId id, IDocument const & document) = 0;
 
+        // Adds a sequence of documents to the index. Equivalent to calling
+        // Add() for each document, except that the row bits of the entire
+        // batch are accumulated privately and then merged into the slices a
+        // quadword at a time, which reduces contention on rows shared by
+        // many documents. Documents become visible to queries only after
+        // all postings in the batch have been merged. Throws if a document
+        // has the same id as a document already in the index. The documents
+        // before it remain in the index, and it and the documents after it
+        // are removed.
+        virtual void AddBatch(std::vector<std::pair<DocId, IDocument const *>> const & documents) = 0;
+
         // Removes a document from serving. The document with the specified id
         // will no longer be returned from the queries. Returns true if the
         // document was successfully removed and false otherwise. False means
@@ -107,6 +130,20 @@ namespace BitFunnel
         // some of which may already have been deleted for other reasons.
         virtual bool Delete(DocId id) = 0;
 
+        // Reclaims the space held by expired documents. Finds the fully
+        // ingested slices in which at most maxLiveFraction of the columns
+        // hold unexpired documents, and moves their documents into newly
+        // created slices, after which the sparse slices are recycled. A
+        // shard is skipped unless its live documents fit in fewer slices
+        // than they currently occupy. Returns the number of documents moved.
+        //
+        // May run concurrently with ingestion, deletion and queries. A
+        // document moves by clearing its old column's active bit right
+        // after setting the new one, so a query running during the move
+        // may briefly observe it in both columns or, depending on scan
+        // order, in neither.
+        virtual size_t CompactSlices(double maxLiveFraction) = 0;
+
         // Sets or clears a fact about a document with the given DocId. The
         // FactHandle must have been previously registered in the IFactSet,
         // otherwise the function throws.
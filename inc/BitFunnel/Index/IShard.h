@@ -48,6 +48,10 @@ namespace BitFunnel
         // Return the size of the slice buffer in bytes.
         virtual size_t GetSliceBufferSize() const = 0;
 
+        // Returns the NUMA node holding the shard's slice buffers, or
+        // c_anyNumaNode if the shard is not bound to a node.
+        virtual unsigned GetNumaNode() const = 0;
+
         // Returns a vector of slice buffers for this shard.  The callers needs
         // to obtain a Token from ITokenManager to protect the pointer to the
         // list of slice buffers, as well as the buffers themselves.
@@ -56,6 +60,13 @@ namespace BitFunnel
         // Returns the offset of the row in the slice buffer in a shard.
         virtual ptrdiff_t GetRowOffset(RowId rowId) const = 0;
 
+        // Returns the position of the row's summary bit, in bits from the
+        // start of a slice buffer. The summary bit is clear only if the row
+        // has no bits set in the slice, so queries can skip slices where a
+        // required row's summary bit is clear. Returns -1 if the shard's
+        // slices have no summary bits.
+        virtual ptrdiff_t GetRowSummaryBit(RowId rowId) const = 0;
+
         virtual void TemporaryWriteDocumentFrequencyTable(
             std::ostream& out,
             ITermToText const * termToText) const = 0;
@@ -30,6 +30,7 @@
 
 namespace BitFunnel
 {
+    class ForwardIndex;
     class IConfiguration;
     class IDocumentDataSchema;
     class IFactSet;
@@ -42,6 +43,7 @@ namespace BitFunnel
     class ISliceBufferAllocator;
     class ITermTable;
     class ITermTableCollection;
+    enum class PageSize;
 
 
     //*************************************************************************
@@ -79,8 +81,10 @@ namespace BitFunnel
         //
         // There are three options for the BlockAllocator:
         //   1. Provide an ISliceBufferAllocator&.
-        //   2. Specify the amount of memory to use for Slice buffers and let
-        //      StartIndex() instantiate its own ISliceBufferAllocator.
+        //   2. Specify the expected amount of memory for Slice buffers and let
+        //      StartIndex() instantiate its own ISliceBufferAllocator. Memory
+        //      is committed as Slices are created, and the allocator may grow
+        //      beyond this size.
         //   3. Let StartIndex() choose sensible default values that ensure that unit
         //      tests can run under continuous integration with limited memory.
         //
@@ -88,9 +92,28 @@ namespace BitFunnel
         virtual void SetSliceBufferAllocator(
             std::unique_ptr<ISliceBufferAllocator> sliceAllocator) = 0;
 
+        // Controls the placement of Slice buffers when StartIndex()
+        // instantiates its own ISliceBufferAllocator. Buffers are backed by
+        // pages of pageSize where the system provides them. If numaNodeCount
+        // is greater than one, each NUMA node gets its own pool of buffers and
+        // shards are bound to the nodes round robin.
+        virtual void SetSliceBufferPlacement(PageSize pageSize,
+                                             unsigned numaNodeCount) = 0;
+
+        // Limits the memory used to count document frequencies to about
+        // bytes per shard by counting approximately. Zero, the default,
+        // counts exactly.
+        virtual void SetStatisticsMemory(size_t bytes) = 0;
+
         virtual void SetTermTableCollection(
             std::unique_ptr<ITermTableCollection> termTables) = 0;
 
+        // Records the term hashes of each ingested document in a
+        // ForwardIndex, so that query processing can remove the false
+        // positives reported by the probabilistic matcher. Costs a variable
+        // size blob of about eight bytes per posting.
+        virtual void EnableForwardIndex() = 0;
+
         virtual void ConfigureForStatistics(char const * directory,
                                             size_t gramSize,
                                             bool generateTermToText) = 0;
@@ -129,6 +152,9 @@ namespace BitFunnel
         virtual IIngestor & GetIngestor() const = 0;
         virtual IRecycler & GetRecycler() const = 0;
 
+        // Returns nullptr unless EnableForwardIndex() was called.
+        virtual ForwardIndex const * GetForwardIndex() const = 0;
+
         // TODO: return ITermTableCollection or take ShardId.
         // GetTermTable0() is a temporary method that makes it easy to spot
         // all of the places in the code that are not Shard-aware. Intention
@@ -43,6 +43,9 @@ namespace BitFunnel
     // the size of the block, or the allocator may allow allocating a fixed set
     // of buffer sizes, one for each for each shard.
     //
+    // Allocators may keep a separate pool for each NUMA node. Shards are bound
+    // to a node and allocate their Slice buffers from that node's pool.
+    //
     // DESIGN NOTE: When a buffer is returned to the pool, it is zero
     // initialized in order to speed up creation of Slice from this buffer.
     //
@@ -53,7 +56,9 @@ namespace BitFunnel
         // Allocates a buffer for a Slice and returns a pointer to it.
         // Implementors may restrict byteSize to a pre-defined set of values, or
         // even require a single value to be used for all slices in the Index.
-        virtual void* Allocate(size_t byteSize) = 0;
+        // The buffer is placed on numaNode if it is less than
+        // GetNumaNodeCount(). Otherwise placement is up to the allocator.
+        virtual void* Allocate(size_t byteSize, unsigned numaNode) = 0;
 
         // Returns the allocator when a Slice is being recycled back to the pool
         // for re-use. Buffer is zero initialized upon return.
@@ -67,5 +72,16 @@ namespace BitFunnel
         // one for each shard. At this point this method may not be applicable
         // and can be removed.
         virtual size_t GetSliceBufferSize() const = 0;
+
+        // Returns the number of buffers currently allocated to Slices.
+        virtual size_t GetInUseBufferCount() const = 0;
+
+        // Returns the number of buffers backed by committed memory, whether
+        // or not they are in use.
+        virtual size_t GetCommittedBufferCount() const = 0;
+
+        // Returns the number of NUMA nodes with their own pools. Allocators
+        // which do not place buffers on particular nodes return one.
+        virtual unsigned GetNumaNodeCount() const = 0;
     };
 }
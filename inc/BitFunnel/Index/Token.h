@@ -151,12 +151,10 @@ namespace BitFunnel
         virtual Token RequestToken() = 0;
 
         // Returns an std::shared_ptr to an ITokenTracker for the set of Tokens
-        // in existance at the time of the call. The ITokenManager retains a
-        // std::shared_ptr to the ITokenTracker, and the other copy is given
-        // out to a caller of this method. The copy that the manager has, will
-        // be automatically released when the ITokenTracker transitions to its
-        // complete state. The copy that the caller has, will still be valid
-        // and can be used to check for completion status of this tracker.
+        // in existance at the time of the call. The ITokenManager may retain
+        // a std::shared_ptr to the ITokenTracker until it completes. The copy
+        // that the caller has, will still be valid and can be used to check
+        // for completion status of this tracker.
         virtual const std::shared_ptr<ITokenTracker> StartTracker() = 0;
 
         // Performs shutdown of the TokenManager. This waits for all of the
@@ -38,11 +38,13 @@ namespace BitFunnel
     class IPlanRows;
     class IRowSet;
     class ISimpleIndex;
+    class QueryBatch;
     class QueryInstrumentation;
     class QueryResources;
     class ResultsBuffer;
     class SimpleResultsProcessor;
     class TermMatchNode;
+    class TopKResults;
 
     namespace Factories
     {
@@ -65,6 +67,9 @@ namespace BitFunnel
                              IDiagnosticStream & diagnosticStream,
                              QueryInstrumentation & instrumentation,
                              ResultsBuffer & resultsBuffer,
-                             bool useNativeCode);
+                             bool useNativeCode,
+                             TopKResults * topK = nullptr,
+                             size_t matchThreadCount = 1,
+                             QueryBatch * batch = nullptr);
     }
 }
@@ -40,11 +40,28 @@ namespace BitFunnel
     public:
         class Data;
 
+        // In top-k mode, matchCount is the number of matches scored before
+        // the query stopped, rather than the number of matches in the index.
         inline void SetMatchCount(size_t matchCount)
         {
             m_data.m_matchCount = matchCount;
         }
 
+        // Records the number of matches kept as results. Equal to the match
+        // count unless the query runs in top-k mode.
+        inline void SetRetainedCount(size_t retainedCount)
+        {
+            m_data.m_retainedCount = retainedCount;
+        }
+
+        // Records matches that the MatchFilter removed because their
+        // documents do not satisfy the query. These are not included in the
+        // match count.
+        inline void IncrementFalsePositiveCount(size_t amount)
+        {
+            m_data.m_falsePositiveCount += amount;
+        }
+
         inline void SetRowCount(size_t rowCount)
         {
             m_data.m_rowCount = rowCount;
@@ -65,6 +82,34 @@ namespace BitFunnel
             m_data.m_cacheLineCount += amount;
         }
 
+        inline void IncrementPrefetchCount(size_t amount)
+        {
+            m_data.m_prefetchCount += amount;
+        }
+
+        inline void IncrementPlanCacheHitCount()
+        {
+            ++m_data.m_planCacheHitCount;
+        }
+
+        inline void IncrementPlanCacheMissCount()
+        {
+            ++m_data.m_planCacheMissCount;
+        }
+
+        // Records that matching stopped at its deadline, leaving partial
+        // results.
+        inline void SetTimedOut()
+        {
+            m_data.m_timedOut = true;
+        }
+
+        // Returns the time in seconds since the query started.
+        inline double GetElapsedTime() const
+        {
+            return m_stopwatch.ElapsedTime();
+        }
+
         inline void FinishParsing()
         {
             m_data.m_parsingTime = m_stopwatch.ElapsedTime();
@@ -91,8 +136,14 @@ namespace BitFunnel
             inline Data()
               : m_rowCount(0ull),
                 m_matchCount(0ull),
+                m_retainedCount(0ull),
+                m_falsePositiveCount(0ull),
                 m_quadwordCount(0ull),
                 m_cacheLineCount(0ll),
+                m_prefetchCount(0ull),
+                m_planCacheHitCount(0ull),
+                m_planCacheMissCount(0ull),
+                m_timedOut(false),
                 m_parsingTime(0.0),
                 m_planningTime(0.0),
                 m_matchingTime(0.0)
@@ -103,8 +154,14 @@ namespace BitFunnel
             {
                 m_rowCount = other.m_rowCount;
                 m_matchCount = other.m_matchCount;
+                m_retainedCount = other.m_retainedCount;
+                m_falsePositiveCount = other.m_falsePositiveCount;
                 m_quadwordCount = other.m_quadwordCount;
                 m_cacheLineCount = other.m_cacheLineCount;
+                m_prefetchCount = other.m_prefetchCount;
+                m_planCacheHitCount = other.m_planCacheHitCount;
+                m_planCacheMissCount = other.m_planCacheMissCount;
+                m_timedOut = other.m_timedOut;
                 m_parsingTime = other.m_parsingTime;
                 m_planningTime = other.m_planningTime;
                 m_matchingTime = other.m_matchingTime;
@@ -116,11 +173,38 @@ namespace BitFunnel
                 return m_rowCount;
             }
 
+            // Number of matches the query found. In top-k mode, only the
+            // matches scored before the query stopped early are counted, so
+            // a query that stops early reports fewer matches than the index
+            // holds.
             inline size_t GetMatchCount()
             {
                 return m_matchCount;
             }
 
+            // Number of matches kept as results. In top-k mode, at most k.
+            inline size_t GetRetainedCount()
+            {
+                return m_retainedCount;
+            }
+
+            // Number of matches removed by the MatchFilter. Always zero when
+            // matches are not filtered.
+            inline size_t GetFalsePositiveCount()
+            {
+                return m_falsePositiveCount;
+            }
+
+            // Fraction of the matcher's matches that the MatchFilter
+            // removed.
+            inline double GetFalsePositiveRate()
+            {
+                const size_t total = m_matchCount + m_falsePositiveCount;
+                return (total == 0) ?
+                    0.0 :
+                    static_cast<double>(m_falsePositiveCount) / total;
+            }
+
             inline size_t GetQuadwordCount()
             {
                 return m_quadwordCount;
@@ -131,6 +215,31 @@ namespace BitFunnel
                 return m_cacheLineCount;
             }
 
+            // Number of cache lines of upcoming slices that the matcher
+            // prefetched ahead of use.
+            inline size_t GetPrefetchCount()
+            {
+                return m_prefetchCount;
+            }
+
+            inline size_t GetPlanCacheHitCount()
+            {
+                return m_planCacheHitCount;
+            }
+
+            inline size_t GetPlanCacheMissCount()
+            {
+                return m_planCacheMissCount;
+            }
+
+            // Returns true if matching stopped at its deadline. The match
+            // count and results then cover only the slices matched before
+            // the deadline.
+            inline bool GetTimedOut()
+            {
+                return m_timedOut;
+            }
+
             inline double GetParsingTime()
             {
                 return m_parsingTime;
@@ -154,8 +263,14 @@ namespace BitFunnel
 
             size_t m_rowCount;
             size_t m_matchCount;
+            size_t m_retainedCount;
+            size_t m_falsePositiveCount;
             size_t m_quadwordCount;
             size_t m_cacheLineCount;
+            size_t m_prefetchCount;
+            size_t m_planCacheHitCount;
+            size_t m_planCacheMissCount;
+            bool m_timedOut;
             double m_parsingTime;
             double m_planningTime;
             double m_matchingTime;
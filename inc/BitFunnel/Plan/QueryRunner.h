@@ -22,16 +22,68 @@
 
 #pragma once
 
+#include <limits>       // std::numeric_limits.
 #include <vector>       // std::vector parameter
 
+#include "BitFunnel/Index/IDocumentDataSchema.h"    // FixedSizeBlobId parameter.
+
 
 namespace BitFunnel
 {
     class ISimpleIndex;
 
+    // When topK is non-zero, each query retains only its topK best scoring
+    // matches, and per-thread result storage is sized for a single slice
+    // rather than for the entire corpus. When topK is zero, every match is
+    // retained.
+    //
+    // In top-k mode, each match is scored by the float in its document's
+    // fixed size blob scoreBlob, which the host registers in the index's
+    // IDocumentDataSchema and fills in during ingestion. Scores must not
+    // exceed maxScore. A query stops early once its k retained matches all
+    // score maxScore. When scoreBlob is c_noScoreBlob, maxScore is ignored
+    // and every match scores zero, so top-k mode keeps the first k matches
+    // and then stops.
+    //
+    // In top-k mode, the match count in the QueryInstrumentation covers
+    // only the matches scored before the query stopped. The retained count
+    // is the number of results kept.
+    //
+    // When matchThreadCount is greater than one, each query splits its
+    // slices across matchThreadCount threads, in addition to any parallelism
+    // across queries.
+    //
+    // While matching each slice, the matcher prefetches the rows of the
+    // slice prefetchDistance slices ahead. A prefetchDistance of zero
+    // disables prefetching.
+    //
+    // A query stops matching once it has run for timeBudget seconds or has
+    // scanned quadwordBudget quadwords at its plan's initial rank. Such a
+    // query reports the matches found so far and is flagged as timed out.
+    // Budgets of zero are unlimited.
+    //
+    // When batchSize is greater than one, each thread takes batchSize queries
+    // at a time and matches them in a single shared pass over the index,
+    // running every query against a slice while the slice's rows are in
+    // cache. This raises throughput at the cost of latency. Batches require
+    // the byte code interpreter, match each query on a single thread, and do
+    // not count cache lines.
+    //
+    // When orderByDensity is true, the planner intersects the rows of each
+    // rank from sparsest to densest, using bit density estimates that are
+    // shared by all of the queries in the run and refreshed as the index
+    // grows. The matches are the same either way.
+    //
+    // When the index has a ForwardIndex, each match is verified against the
+    // document's terms. Matches whose documents do not satisfy the query are
+    // false positives of the bit sliced signatures. They are removed before
+    // they are counted or scored and reported in the QueryInstrumentation.
     class QueryRunner
     {
     public:
+        static const FixedSizeBlobId c_noScoreBlob =
+            std::numeric_limits<FixedSizeBlobId>::max();
+
         class Statistics
         {
         public:
@@ -39,10 +91,15 @@ namespace BitFunnel
                        size_t uniqueQueryCount,
                        size_t processedCount,
                        size_t matchCount,
+                       size_t retainedCount,
                        double elapsedTime,
                        double parsingTime,
                        double planningTime,
-                       double matchingTime);
+                       double matchingTime,
+                       size_t planCacheHitCount,
+                       size_t planCacheMissCount,
+                       size_t timedOutCount,
+                       size_t falsePositiveCount);
 
             void Print(std::ostream& out) const;
 
@@ -51,10 +108,15 @@ namespace BitFunnel
             const size_t m_uniqueQueryCount;
             size_t m_processedCount;
             size_t m_matchCount;
+            size_t m_retainedCount;
             double m_elapsedTime;
             double m_parsingLatency;
             double m_planningLatency;
             double m_matchingLatency;
+            size_t m_planCacheHitCount;
+            size_t m_planCacheMissCount;
+            size_t m_timedOutCount;
+            size_t m_falsePositiveCount;
         };
 
 
@@ -62,7 +124,15 @@ namespace BitFunnel
             char const * query,
             ISimpleIndex const & index,
             bool useNativeCode,
-            bool countCacheLines);
+            bool countCacheLines,
+            size_t topK,
+            FixedSizeBlobId scoreBlob,
+            float maxScore,
+            size_t matchThreadCount,
+            size_t prefetchDistance,
+            double timeBudget,
+            size_t quadwordBudget,
+            bool orderByDensity);
 
         static Statistics Run(ISimpleIndex const & index,
                               char const * outputDir,
@@ -70,6 +140,15 @@ namespace BitFunnel
                               std::vector<std::string> const & queries,
                               size_t iterations,
                               bool useNativeCode,
-                              bool countCacheLines);
+                              bool countCacheLines,
+                              size_t topK,
+                              FixedSizeBlobId scoreBlob,
+                              float maxScore,
+                              size_t matchThreadCount,
+                              size_t prefetchDistance,
+                              double timeBudget,
+                              size_t quadwordBudget,
+                              size_t batchSize,
+                              bool orderByDensity);
     };
 }
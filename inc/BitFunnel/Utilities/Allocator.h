@@ -24,6 +24,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include "BitFunnel/Allocators/IAllocator.h"
 #include "BitFunnel/NonCopyable.h"
@@ -32,6 +33,18 @@
 namespace BitFunnel
 {
     // TODO: This should be a private header.
+    //*************************************************************************
+    //
+    // Allocator
+    //
+    // An arena which hands out 8-byte aligned blocks from a chain of buffers.
+    // The first buffer holds bufferSize bytes. When it runs out, the arena
+    // grows by chaining another buffer at least twice the size of the last.
+    // Reset() coalesces the chain into a single buffer of the total size, so
+    // a workload that repeats similar allocations between calls to Reset()
+    // stops touching the heap once it has warmed up.
+    //
+    //*************************************************************************
     class Allocator : public IAllocator
     {
     public:
@@ -45,18 +58,29 @@ namespace BitFunnel
         // Frees a block.
         virtual void Deallocate(void* block) override;
 
-        // Returns the maximum legal allocation size in bytes.
+        // Returns the maximum legal allocation size in bytes. The arena
+        // grows on demand, so any size is legal.
         virtual size_t MaxSize() const override;
 
         // Frees all blocks that have been allocated since construction or the
         // last call to Reset().
         virtual void Reset() override;
 
+        // Returns the total size of the buffers in the chain.
+        size_t GetCapacity() const;
+
     private:
-        void DebugInitialize();
+        void AddBuffer(size_t size);
+        void DebugInitialize(std::unique_ptr<char[]> const & buffer, size_t size);
+
+        struct Buffer
+        {
+            std::unique_ptr<char[]> m_data;
+            size_t m_size;
+        };
 
-        size_t m_bufferSize;
+        // Allocations are carved from the back of m_buffers.
+        std::vector<Buffer> m_buffers;
         size_t m_bytesAllocated;
-        std::unique_ptr<char[]> m_buffer;
     };
 }
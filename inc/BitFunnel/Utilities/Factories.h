@@ -34,6 +34,7 @@ namespace BitFunnel
 {
     class IAllocator;
     class IBlockAllocator;
+    enum class PageSize;
     class IDiagnosticStream;
     class IObjectFormatter;
     class ITaskProcessor;
@@ -45,7 +46,10 @@ namespace BitFunnel
             CreateAllocator(size_t bufferSize);
 
         std::unique_ptr<IBlockAllocator>
-            CreateBlockAllocator(size_t blockSize, size_t totalBlockCount);
+            CreateBlockAllocator(size_t blockSize,
+                                 size_t maxBlockCount,
+                                 PageSize pageSize,
+                                 unsigned numaNode);
 
         std::unique_ptr<IDiagnosticStream> CreateDiagnosticStream(std::ostream& stream);
 
@@ -25,12 +25,25 @@
 
 namespace BitFunnel
 {
+    // Size of the pages backing an allocator's pool. Huge pages reduce TLB
+    // misses when blocks are large. Allocators fall back to default pages
+    // when huge pages are not available.
+    enum class PageSize
+    {
+        Default,
+        Huge2MB,
+        Huge1GB
+    };
+
+
     //*************************************************************************
     //
     // IBlockAllocator is an abstract class or interface for classes that are
     // used to allocate blocks of memory of the same size out of a shared pool
-    // of memory of a fixed size. The size of the block and the number of
-    // blocks in the pool are immutable once the allocator is created.
+    // of memory with a fixed maximum size. The size of the block and the
+    // maximum number of blocks in the pool are immutable once the allocator
+    // is created. Implementations may commit memory for the pool as it is
+    // needed.
     // Allocated blocks are guaranteed to be byte aligned for use with the
     // matching engine. To achieve that, the size of the block will be rounded
     // up to the next aligned value.
@@ -56,5 +69,18 @@ namespace BitFunnel
 
         // Returns the size of the blocks in the pool.
         virtual size_t GetBlockSize() const = 0;
+
+        // Returns true if the address lies within the pool's memory.
+        virtual bool Contains(void const * address) const = 0;
+
+        // Returns the maximum number of blocks in the pool.
+        virtual size_t GetMaxBlockCount() const = 0;
+
+        // Returns the number of blocks backed by committed memory.
+        virtual size_t GetCommittedBlockCount() const = 0;
+
+        // Returns the number of blocks currently allocated. The count is
+        // approximate while other threads allocate and release blocks.
+        virtual size_t GetInUseBlockCount() const = 0;
     };
 }
@@ -0,0 +1,40 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+
+namespace BitFunnel
+{
+    // Identifies no NUMA node in particular. Memory and threads associated
+    // with c_anyNumaNode are placed by the operating system.
+    const unsigned c_anyNumaNode = ~0u;
+
+    // Returns the number of NUMA nodes in the system. Systems without NUMA,
+    // or platforms where the topology is not available, report one node.
+    unsigned GetNumaNodeCount();
+
+    // Restricts the calling thread to the processors of a NUMA node. Returns
+    // false if the thread could not be bound, in which case its affinity is
+    // unchanged.
+    bool BindCurrentThreadToNumaNode(unsigned node);
+}
@@ -90,12 +90,10 @@ namespace BitFunnel
                 writer.Write(*m_output);
             }
 
-            m_ingestor.Add(m_currentDocument->GetDocId(), *m_currentDocument);
-            if (m_cacheDocuments)
+            m_pendingDocuments.push_back(std::move(m_currentDocument));
+            if (m_pendingDocuments.size() >= c_maxBatchSize)
             {
-                DocId id = m_currentDocument->GetDocId();
-                m_ingestor.GetDocumentCache().Add(std::move(m_currentDocument),
-                                                  id);
+                IngestPendingDocuments();
             }
         }
 
@@ -105,9 +103,41 @@ namespace BitFunnel
 
     void ChunkIngestor::OnFileExit(IChunkWriter & writer)
     {
+        IngestPendingDocuments();
+
         if (m_output.get() != nullptr)
         {
             writer.Complete(*m_output);
         }
     }
+
+
+    void ChunkIngestor::IngestPendingDocuments()
+    {
+        if (m_pendingDocuments.empty())
+        {
+            return;
+        }
+
+        std::vector<std::pair<DocId, IDocument const *>> batch;
+        batch.reserve(m_pendingDocuments.size());
+        for (auto const & document : m_pendingDocuments)
+        {
+            batch.push_back(std::make_pair(document->GetDocId(),
+                                           document.get()));
+        }
+
+        m_ingestor.AddBatch(batch);
+
+        if (m_cacheDocuments)
+        {
+            for (auto & document : m_pendingDocuments)
+            {
+                DocId id = document->GetDocId();
+                m_ingestor.GetDocumentCache().Add(std::move(document), id);
+            }
+        }
+
+        m_pendingDocuments.clear();
+    }
 }
@@ -71,6 +71,19 @@ namespace BitFunnel
         //
         // Other members
         //
+        // Flushes the pending documents through IIngestor::AddBatch() and
+        // then hands them to the document cache if caching is enabled.
+        void IngestPendingDocuments();
+
+        // Number of documents accumulated before calling
+        // IIngestor::AddBatch(). Larger batches share more row quadwords
+        // but delay the visibility of their documents.
+        static const size_t c_maxBatchSize = 256;
+
         std::unique_ptr<Document> m_currentDocument;
+
+        // Documents which passed the filter but have not yet been added to
+        // the index.
+        std::vector<std::unique_ptr<Document>> m_pendingDocuments;
     };
 }
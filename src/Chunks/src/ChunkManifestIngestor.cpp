@@ -20,12 +20,12 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
-#include <fstream>
 #include <iostream>
 #include <sstream>
 
 #include "BitFunnel/Chunks/Factories.h"
 #include "BitFunnel/Configuration/IFileSystem.h"
+#include "BitFunnel/Configuration/IMappedFile.h"
 #include "BitFunnel/Exceptions.h"
 #include "BitFunnel/IFileManager.h"
 #include "ChunkIngestor.h"
@@ -92,10 +92,14 @@ namespace BitFunnel
 
         std::cout << "  " << m_filePaths[index] << std::endl;
 
-        auto input = m_fileSystem.OpenForRead(m_filePaths[index].c_str(),
-                                              std::ios::binary);
-
-        if (input->fail())
+        // Parse the chunk in place from a mapped view of the file, rather
+        // than copying it through a stream buffer into a second buffer.
+        std::unique_ptr<IMappedFile> chunk;
+        try
+        {
+            chunk = m_fileSystem.OpenForMappedRead(m_filePaths[index].c_str());
+        }
+        catch (RecoverableError const &)
         {
             std::stringstream message;
             message << "Failed to open chunk file '"
@@ -104,16 +108,6 @@ namespace BitFunnel
             throw FatalError(message.str());
         }
 
-        input->seekg(0, input->end);
-        auto length = input->tellg();
-        input->seekg(0, input->beg);
-
-        std::vector<char> chunkData;
-        chunkData.reserve(static_cast<size_t>(length) + 1ull);
-        chunkData.insert(chunkData.begin(),
-                         (std::istreambuf_iterator<char>(*input)),
-                          std::istreambuf_iterator<char>());
-
         {
             // Block scopes std::ostream.
             std::unique_ptr<std::ostream> output;
@@ -128,8 +122,8 @@ namespace BitFunnel
                                     m_filter,
                                     std::move(output));
 
-            ChunkReader(&chunkData[0],
-                        &chunkData[0] + chunkData.size(),
+            ChunkReader(chunk->GetBuffer(),
+                        chunk->GetBuffer() + chunk->GetSize(),
                         processor);
         }
     }
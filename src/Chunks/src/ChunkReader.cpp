@@ -20,12 +20,18 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <smmintrin.h>   // For SSE4.1 intrinsics.
 #include <sstream>
 
 #include "BitFunnel/Chunks/IChunkProcessor.h"
 #include "BitFunnel/Exceptions.h"
 #include "ChunkReader.h"
 
+#ifdef _MSC_VER
+#include <intrin.h>     // For _BitScanForward.
+#include <stdlib.h>     // For _byteswap_uint64.
+#endif
+
 
 namespace BitFunnel
 {
@@ -39,6 +45,94 @@ namespace BitFunnel
     static const uint64_t c_streamIdDigitCount = 2;
 
 
+    // Returns the position of the lowest set bit in a non-zero mask.
+    static inline unsigned LowestSetBit(unsigned mask)
+    {
+#ifdef _MSC_VER
+        unsigned long position;
+        _BitScanForward(&position, mask);
+        return static_cast<unsigned>(position);
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+
+
+    static inline uint64_t ByteSwap(uint64_t value)
+    {
+#ifdef _MSC_VER
+        return _byteswap_uint64(value);
+#else
+        return __builtin_bswap64(value);
+#endif
+    }
+
+
+    // Returns a pointer to the first '\0' in [start, end), or end if there
+    // is none. Compares 16 bytes at a time while at least 16 bytes remain.
+    static char const * FindTerminator(char const * start, char const * end)
+    {
+        const __m128i zero = _mm_setzero_si128();
+
+        char const * next = start;
+        while (end - next >= 16)
+        {
+            const __m128i chars =
+                _mm_loadu_si128(reinterpret_cast<__m128i const *>(next));
+            const unsigned mask =
+                static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chars, zero)));
+            if (mask != 0)
+            {
+                return next + LowestSetBit(mask);
+            }
+            next += 16;
+        }
+
+        while (next != end && *next != 0)
+        {
+            ++next;
+        }
+
+        return next;
+    }
+
+
+    // Decodes the 16 lower case hex digits at start into value. Returns
+    // false, leaving value unchanged, if any of the 16 bytes is not a hex
+    // digit.
+    static bool DecodeHex16(char const * start, uint64_t & value)
+    {
+        const __m128i chars =
+            _mm_loadu_si128(reinterpret_cast<__m128i const *>(start));
+
+        // Bytes above 0x7f compare as negative, so they fail both tests.
+        const __m128i digits =
+            _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+                          _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+        const __m128i letters =
+            _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('a' - 1)),
+                          _mm_cmplt_epi8(chars, _mm_set1_epi8('f' + 1)));
+        if (_mm_movemask_epi8(_mm_or_si128(digits, letters)) != 0xffff)
+        {
+            return false;
+        }
+
+        const __m128i nibbles =
+            _mm_blendv_epi8(_mm_sub_epi8(chars, _mm_set1_epi8('a' - 10)),
+                            _mm_sub_epi8(chars, _mm_set1_epi8('0')),
+                            digits);
+
+        // Each 16-bit lane becomes 16 * (first nibble) + (second nibble).
+        // Packing the lanes gives the eight bytes of the value, most
+        // significant byte first.
+        const __m128i pairs = _mm_maddubs_epi16(nibbles, _mm_set1_epi16(0x0110));
+        const __m128i bytes = _mm_packus_epi16(pairs, pairs);
+
+        value = ByteSwap(static_cast<uint64_t>(_mm_cvtsi128_si64(bytes)));
+        return true;
+    }
+
+
     ChunkReader::ChunkReader(char const * start,
                              char const * end,
                              IChunkProcessor& processor)
@@ -108,11 +202,7 @@ namespace BitFunnel
     {
         char const * begin = m_next;
 
-        while (PeekChar() != 0)
-        {
-            GetChar();
-        }
-
+        m_next = FindTerminator(m_next, m_end);
         Consume(0);
 
         return begin;
@@ -123,6 +213,19 @@ namespace BitFunnel
     {
         static_assert(sizeof(DocId) * 2 == c_docIdDigitCount,
                       "DocId type is not equivalent to 16 hex digits.");
+
+        // The fast path needs the digits and their terminator in the buffer.
+        // Malformed DocIds fall through to GetHexValue(), which reports the
+        // error.
+        uint64_t value;
+        if (static_cast<uint64_t>(m_end - m_next) > c_docIdDigitCount &&
+            DecodeHex16(m_next, value))
+        {
+            m_next += c_docIdDigitCount;
+            Consume('\0');
+            return static_cast<DocId>(value);
+        }
+
         return static_cast<DocId>(GetHexValue(c_docIdDigitCount));
     }
 
@@ -25,6 +25,8 @@
 #include <vector>
 
 #include "gtest/gtest.h"
+
+#include "BitFunnel/Exceptions.h"
 #include "ChunkEventTracer.h"
 
 
@@ -202,5 +204,62 @@ namespace BitFunnel
                 EXPECT_EQ(trace.str(), tracer.Trace());
             });
         }
+
+
+        // Parse a chunk with a full width DocId and terms that span several
+        // 16-byte blocks.
+        TEST(ChunkReader, LongTokens)
+        {
+            std::vector<char> const chunk = ToCharVector(
+                "fedcba9876543210\0"
+                "0a\0"
+                "abcdefghijklmnopqrstuvwxyz\0"
+                "0123456789abcdef\0"
+                "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ\0"
+                "\0"
+                "\0"
+                "\0");
+
+            RunEventTracerTest(chunk, [](Mocks::ChunkEventTracer & tracer)
+            {
+                std::stringstream trace;
+                trace
+                    << "OnFileEnter" << std::endl
+                    << "OnDocumentEnter;DocId: 18364758544493064720" << std::endl
+                    << "OnStreamEnter;streamId: 10" << std::endl
+                    << "OnTerm;term: 'abcdefghijklmnopqrstuvwxyz'" << std::endl
+                    << "OnTerm;term: '0123456789abcdef'" << std::endl
+                    << "OnTerm;term: '0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ'" << std::endl
+                    << "OnStreamExit" << std::endl
+                    << "OnDocumentExit" << std::endl
+                    << "OnFileExit" << std::endl;
+
+                EXPECT_EQ(trace.str(), tracer.Trace());
+            });
+        }
+
+
+        // Malformed DocIds and unterminated tokens are rejected.
+        TEST(ChunkReader, Malformed)
+        {
+            // Upper case hex digit.
+            EXPECT_THROW(Mocks::ChunkEventTracer(ToCharVector(
+                "000000000000000A\0"
+                "00\0Dogs\0\0"
+                "\0"
+                "\0")), FatalError);
+
+            // DocId with too few digits.
+            EXPECT_THROW(Mocks::ChunkEventTracer(ToCharVector(
+                "00000000000000a\0"
+                "00\0Dogs\0\0"
+                "\0"
+                "\0")), FatalError);
+
+            // Last term is missing its terminator.
+            EXPECT_THROW(Mocks::ChunkEventTracer(ToCharVector(
+                "000000000000000a\0"
+                "00\0Dogs\0abcdefghijklmnopqrstuvwxyz")), FatalError);
+        }
     }
 }
@@ -27,6 +27,7 @@
 #include "BitFunnel/Configuration/Factories.h"
 #include "BitFunnel/Exceptions.h"
 #include "FileSystem.h"
+#include "MemoryMappedFile.h"
 
 
 namespace BitFunnel
@@ -87,6 +88,62 @@ namespace BitFunnel
     }
 
 
+    //*************************************************************************
+    //
+    // MappedFile
+    //
+    // IMappedFile backed by a MemoryMappedFile. Empty files cannot be mapped,
+    // so they are represented by a null buffer.
+    //
+    //*************************************************************************
+    class MappedFile : public IMappedFile
+    {
+    public:
+        MappedFile(std::unique_ptr<MemoryMappedFile> file)
+          : m_file(std::move(file))
+        {
+        }
+
+        virtual char const * GetBuffer() const override
+        {
+            return (m_file == nullptr) ? nullptr : m_file->GetBuffer();
+        }
+
+        virtual size_t GetSize() const override
+        {
+            return (m_file == nullptr) ? 0 : m_file->GetSize();
+        }
+
+    private:
+        std::unique_ptr<MemoryMappedFile> m_file;
+    };
+
+
+    std::unique_ptr<IMappedFile>
+        FileSystem::OpenForMappedRead(char const * filename)
+    {
+        struct stat buffer;
+        if (stat(filename, &buffer) != 0)
+        {
+            std::stringstream message;
+            message
+                << "File "
+                << filename
+                << " failed to open for mapped read.";
+            RecoverableError error(message.str().c_str());
+            throw error;
+        }
+
+        std::unique_ptr<MemoryMappedFile> file;
+        if (buffer.st_size > 0)
+        {
+            file.reset(new MemoryMappedFile(filename));
+        }
+
+        return std::unique_ptr<IMappedFile>(new MappedFile(std::move(file)));
+    }
+
+
     bool FileSystem::Exists(char const * filename)
     {
         struct stat buffer;
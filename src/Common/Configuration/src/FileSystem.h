@@ -42,6 +42,9 @@ namespace BitFunnel
             OpenForRead(char const * filename,
                         std::ios_base::openmode mode = std::ios::in) override;
 
+        virtual std::unique_ptr<IMappedFile>
+            OpenForMappedRead(char const * filename) override;
+
         virtual bool Exists(char const * filename) override;
     };
 }
@@ -84,6 +84,12 @@ namespace BitFunnel
     }
 
 
+    std::unique_ptr<IMappedFile> ParameterizedFile::OpenForMappedRead(const std::string& filename)
+    {
+        return m_fileSystem.OpenForMappedRead(filename.c_str());
+    }
+
+
     std::string ParameterizedFile::GetTempName(const std::string& filename)
     {
         return filename + ".temp";
@@ -154,6 +160,12 @@ namespace BitFunnel
     }
 
 
+    std::unique_ptr<IMappedFile> ParameterizedFile0::OpenForMappedRead()
+    {
+        return ParameterizedFile::OpenForMappedRead(GetName());
+    }
+
+
     std::unique_ptr<std::ostream> ParameterizedFile0::OpenForWrite()
     {
         return ParameterizedFile::OpenForWrite(GetName());
@@ -214,6 +226,12 @@ namespace BitFunnel
      }
 
 
+     std::unique_ptr<IMappedFile> ParameterizedFile1::OpenForMappedRead(size_t p1)
+     {
+         return ParameterizedFile::OpenForMappedRead(GetName(p1));
+     }
+
+
      std::unique_ptr<std::ostream> ParameterizedFile1::OpenForWrite(size_t p1)
      {
          return ParameterizedFile::OpenForWrite(GetName(p1));
@@ -275,6 +293,12 @@ namespace BitFunnel
      }
 
 
+     std::unique_ptr<IMappedFile> ParameterizedFile2::OpenForMappedRead(size_t p1, size_t p2)
+     {
+         return ParameterizedFile::OpenForMappedRead(GetName(p1, p2));
+     }
+
+
      std::unique_ptr<std::ostream> ParameterizedFile2::OpenForWrite(size_t p1, size_t p2)
      {
          return ParameterizedFile::OpenForWrite(GetName(p1, p2));
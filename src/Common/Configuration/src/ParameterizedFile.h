@@ -47,6 +47,7 @@ namespace BitFunnel
                           const char* extension);
 
         std::unique_ptr<std::istream> OpenForRead(const std::string& filename);
+        std::unique_ptr<IMappedFile> OpenForMappedRead(const std::string& filename);
 
     protected:
         std::string GetTempName(const std::string& filename);
@@ -82,6 +83,7 @@ namespace BitFunnel
 
         std::string GetName();
         std::unique_ptr<std::istream> OpenForRead();
+        std::unique_ptr<IMappedFile> OpenForMappedRead();
         std::unique_ptr<std::ostream> OpenForWrite();
         // std::unique_ptr<std::ostream> OpenTempForWrite();
         // void Commit();
@@ -102,6 +104,7 @@ namespace BitFunnel
 
         std::string GetName(size_t p1);
         std::unique_ptr<std::istream> OpenForRead(size_t p1);
+        std::unique_ptr<IMappedFile> OpenForMappedRead(size_t p1);
         std::unique_ptr<std::ostream> OpenForWrite(size_t p1);
         // std::unique_ptr<std::ostream> OpenTempForWrite(size_t p1);
         // void Commit(size_t p1);
@@ -121,6 +124,7 @@ namespace BitFunnel
 
         std::string GetName(size_t p1, size_t p2);
         std::unique_ptr<std::istream> OpenForRead(size_t p1, size_t p2);
+        std::unique_ptr<IMappedFile> OpenForMappedRead(size_t p1, size_t p2);
         std::unique_ptr<std::ostream> OpenForWrite(size_t p1, size_t p2);
         // std::unique_ptr<std::ostream> OpenTempForWrite(size_t p1, size_t p2);
         // void Commit(size_t p1, size_t p2);
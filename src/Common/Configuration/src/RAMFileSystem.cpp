@@ -21,8 +21,10 @@
 // THE SOFTWARE.
 
 #include <iostream>
+#include <string>
 
 #include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Exceptions.h"
 #include "RAMFileSystem.h"
 
 
@@ -60,6 +62,58 @@ namespace BitFunnel
     }
 
 
+    //*************************************************************************
+    //
+    // RAMMappedFile
+    //
+    // IMappedFile holding a snapshot of a RAMFileSystem file. The contents of
+    // a std::stringstream are not contiguous in general, so they are copied
+    // once when the file is opened.
+    //
+    //*************************************************************************
+    class RAMMappedFile : public IMappedFile
+    {
+    public:
+        RAMMappedFile(std::string const & contents)
+          : m_contents(contents)
+        {
+        }
+
+        virtual char const * GetBuffer() const override
+        {
+            return m_contents.data();
+        }
+
+        virtual size_t GetSize() const override
+        {
+            return m_contents.size();
+        }
+
+    private:
+        std::string m_contents;
+    };
+
+
+    std::unique_ptr<IMappedFile>
+        RAMFileSystem::OpenForMappedRead(char const * filename)
+    {
+        std::cout << "OpeningForMappedRead: " << filename << std::endl;
+        auto it = m_files.find(filename);
+        if (it == m_files.end())
+        {
+            std::stringstream message;
+            message
+                << "File "
+                << filename
+                << " failed to open for mapped read.";
+            RecoverableError error(message.str().c_str());
+            throw error;
+        }
+
+        return std::unique_ptr<IMappedFile>(new RAMMappedFile(it->second->str()));
+    }
+
+
     bool RAMFileSystem::Exists(char const * filename)
     {
         return m_files.find(filename) != m_files.end();
@@ -21,9 +21,11 @@
 // THE SOFTWARE.
 
 #include <iostream>
+#include <string>
 
 #include "gtest/gtest.h"
 
+#include "BitFunnel/Exceptions.h"
 #include "RAMFileSystem.h"
 
 
@@ -116,4 +118,31 @@ namespace BitFunnel
             EXPECT_STREQ(expected2, observed.c_str());
         }
     }
+
+
+    TEST(RAMFileSystem, MappedRead)
+    {
+        RAMFileSystem files;
+
+        char const * name = "name1";
+        std::string expected("Contents\0with\0nulls.", 20);
+
+        {
+            auto output = files.OpenForWrite(name, std::ios::binary);
+            output->write(expected.data(), static_cast<std::streamsize>(expected.size()));
+        }
+
+        auto mapped = files.OpenForMappedRead(name);
+        ASSERT_EQ(expected.size(), mapped->GetSize());
+        EXPECT_EQ(expected, std::string(mapped->GetBuffer(), mapped->GetSize()));
+
+        // The view is a snapshot, unaffected by subsequent writes.
+        {
+            auto output = files.OpenForWrite(name);
+            *output << "Totally different.";
+        }
+        EXPECT_EQ(expected, std::string(mapped->GetBuffer(), mapped->GetSize()));
+
+        EXPECT_THROW(files.OpenForMappedRead("missing"), RecoverableError);
+    }
 }
@@ -21,12 +21,15 @@
 // THE SOFTWARE.
 
 
+#include <algorithm>
 #include <cstring>
+#include <limits>
 #include <memory>
 
 #include "BitFunnel/Utilities/Allocator.h"
 #include "BitFunnel/Utilities/Factories.h"
 #include "LoggerInterfaces/Logging.h"
+#include "Rounding.h"
 
 
 namespace BitFunnel
@@ -43,14 +46,13 @@ namespace BitFunnel
     // Allocator
     //
     //*************************************************************************
+    static const size_t c_alignment = 8;
+
+
     Allocator::Allocator(size_t bufferSize)
-      : m_bufferSize(bufferSize),
-        m_bytesAllocated(0),
-        m_buffer(new char[bufferSize])
+      : m_bytesAllocated(0)
     {
-#ifdef DEBUG
-        DebugInitialize();
-#endif
+        AddBuffer(bufferSize);
     }
 
 
@@ -61,9 +63,16 @@ namespace BitFunnel
 
     void* Allocator::Allocate(size_t size)
     {
-        LogAssertB(m_bytesAllocated + size <= m_bufferSize, "Out of memory");
+        size = RoundUp(size, c_alignment);
+
+        if (m_bytesAllocated + size > m_buffers.back().m_size)
+        {
+            // Grow geometrically so that a long query adds few buffers.
+            AddBuffer((std::max)(2 * m_buffers.back().m_size, size));
+        }
 
-        void* result = static_cast<void*>(m_buffer.get() + m_bytesAllocated);
+        void* result =
+            static_cast<void*>(m_buffers.back().m_data.get() + m_bytesAllocated);
         m_bytesAllocated += size;
 
         return result;
@@ -72,9 +81,18 @@ namespace BitFunnel
 
     void Allocator::Deallocate(void* block)
     {
-        LogAssertB(static_cast<char*>(block) >= m_buffer.get() &&
-                       static_cast<char*>(block) < m_buffer.get() + m_bytesAllocated,
-                       "Attempting to deallocate memory not owned by this allocator.");
+        // Only the last buffer is partially allocated.
+        bool isOwned = false;
+        for (size_t i = 0; i < m_buffers.size() && !isOwned; ++i)
+        {
+            char const * start = m_buffers[i].m_data.get();
+            char const * end = start +
+                ((i + 1 == m_buffers.size()) ? m_bytesAllocated : m_buffers[i].m_size);
+            isOwned = (static_cast<char*>(block) >= start &&
+                       static_cast<char*>(block) < end);
+        }
+        LogAssertB(isOwned,
+                   "Attempting to deallocate memory not owned by this allocator.");
 
         // Intentional NOP
     }
@@ -82,21 +100,57 @@ namespace BitFunnel
 
     size_t Allocator::MaxSize() const
     {
-        return m_bufferSize;
+        return (std::numeric_limits<size_t>::max)();
     }
 
 
     void Allocator::Reset()
     {
+        if (m_buffers.size() > 1)
+        {
+            // Replace the chain with a single buffer that holds everything
+            // the chain held, so the next round fits without growing.
+            const size_t capacity = GetCapacity();
+            m_buffers.clear();
+            AddBuffer(capacity);
+        }
+#ifdef DEBUG
+        else
+        {
+            DebugInitialize(m_buffers.back().m_data, m_buffers.back().m_size);
+        }
+#endif
+
+        m_bytesAllocated = 0;
+    }
+
+
+    size_t Allocator::GetCapacity() const
+    {
+        size_t capacity = 0;
+        for (auto const & buffer : m_buffers)
+        {
+            capacity += buffer.m_size;
+        }
+        return capacity;
+    }
+
+
+    void Allocator::AddBuffer(size_t size)
+    {
+        size = RoundUp((std::max)(size, c_alignment), c_alignment);
+        m_buffers.push_back({ std::unique_ptr<char[]>(new char[size]), size });
         m_bytesAllocated = 0;
+
 #ifdef DEBUG
-        DebugInitialize();
+        DebugInitialize(m_buffers.back().m_data, size);
 #endif
     }
 
 
-    void Allocator::DebugInitialize()
+    void Allocator::DebugInitialize(std::unique_ptr<char[]> const & buffer,
+                                    size_t size)
     {
-        memset(m_buffer.get(), 0xcc, m_bufferSize);
+        memset(buffer.get(), 0xcc, size);
     }
 }
@@ -20,14 +20,18 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
-
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "BitFunnel/Exceptions.h"
 #include "BitFunnel/Utilities/Factories.h"
 #include "BitFunnel/Utilities/IBlockAllocator.h"
 #include "BlockAllocator.h"
 #include "LoggerInterfaces/Logging.h"
+#include "ReservedBuffer.h"
 #include "Rounding.h"
 
 
@@ -36,97 +40,570 @@ namespace BitFunnel
 
     std::unique_ptr<IBlockAllocator>
         Factories::
-        CreateBlockAllocator(size_t blockSize, size_t totalBlockCount)
+        CreateBlockAllocator(size_t blockSize,
+                             size_t maxBlockCount,
+                             PageSize pageSize,
+                             unsigned numaNode)
     {
         return std::unique_ptr<IBlockAllocator>(
-            new BlockAllocator(blockSize, totalBlockCount));
+            new BlockAllocator(blockSize, maxBlockCount, pageSize, numaNode));
     }
 
 
+    //*************************************************************************
+    //
+    // Magazine
+    //
+    // A small stack of free blocks owned by one thread. Other threads only
+    // touch it to reclaim its blocks when the Pool runs out of memory.
+    //
+    //*************************************************************************
+    class Magazine : NonCopyable
+    {
+    public:
+        static const size_t c_capacity = 4;
+
+        Magazine()
+            : m_count(0),
+              m_isOwned(false)
+        {
+        }
+
+        // Held by the owning thread while it uses the magazine, and by a
+        // thread reclaiming its blocks. It is almost never contended.
+        std::mutex m_lock;
+
+        // Protected by m_lock. Atomic so that occupancy counters can be
+        // computed on other threads without it.
+        std::atomic<size_t> m_count;
+        uint64_t* m_blocks[c_capacity];
+
+        // Protected by the Pool's magazine lock.
+        bool m_isOwned;
+    };
+
 
-    BlockAllocator::BlockAllocator(size_t blockSize, size_t totalBlockCount)
-        : m_blockSize(RoundUp<size_t>(blockSize, c_byteAlignment)),
-          m_totalPoolSize(m_blockSize * totalBlockCount),
-          m_pool(m_totalPoolSize, c_log2ByteAlignment)
+    //*************************************************************************
+    //
+    // BlockAllocator::Pool
+    //
+    //*************************************************************************
+    class BlockAllocator::Pool : NonCopyable
     {
-        // DESIGN NOTE: technically, one can create an allocator with a size = 0
-        // which would simply throw on the first allocation. This would allow
-        // not having any special handling on the client side where allocation
-        // is not needed. However, given that this is not a public class and we
-        // know exactly its usage, let's not support this scenario now and
-        // re-visit it in future if needed.
-        LogAssertB(m_blockSize > 0, "m_blockSize of 0.");
-        LogAssertB(totalBlockCount > 0, "totalBlockCount of 0.");
+    public:
+        Pool(size_t blockSize,
+             size_t maxBlockCount,
+             size_t hugePageSize,
+             unsigned numaNode);
+
+        uint64_t GetId() const;
+        size_t GetBlockSize() const;
+        bool Contains(void const * address) const;
+        size_t GetMaxBlockCount() const;
+        size_t GetCommittedBlockCount() const;
+        size_t GetInUseBlockCount() const;
+
+        // Assigns a magazine to the calling thread.
+        Magazine& AcquireMagazine();
+
+        // Empties a magazine into the free list when its thread exits.
+        void ReleaseMagazine(Magazine& magazine);
+
+        uint64_t* Allocate(Magazine& magazine);
+        void Release(Magazine& magazine, uint64_t* block);
+
+    private:
+        size_t GetIndex(uint64_t const * block) const;
+        uint64_t* GetBlock(size_t index) const;
+
+        void Push(uint64_t* block);
+        uint64_t* Pop();
+
+        // Returns nullptr once every block of the reserved range has been
+        // handed out.
+        uint64_t* Carve();
+
+        // Moves the blocks held in every thread's magazine to the free list.
+        void DrainMagazines();
+
+        // Memory is committed in steps of at least this size.
+        static const size_t c_commitByteSize = 1 << 20;
+
+        static const uint64_t c_indexMask = 0xffffffff;
+        static const unsigned c_tagShift = 32;
+
+        const uint64_t m_id;
+        const size_t m_blockSize;
+        const size_t m_maxBlockCount;
+
+        ReservedBuffer m_buffer;
+
+        // The free list. The low 32 bits hold the index plus one of the block
+        // on top of the stack, or zero if the stack is empty. The high 32 bits
+        // hold a tag that changes with every push and pop, so that a pop
+        // cannot succeed with a stale link (the ABA problem).
+        std::atomic<uint64_t> m_freeList;
+        std::atomic<int64_t> m_freeCount;
+
+        // Blocks handed out for the first time come from the front of the
+        // reserved range.
+        std::atomic<size_t> m_carvedCount;
+        std::atomic<size_t> m_committedCount;
+        std::mutex m_commitLock;
+
+        std::mutex m_magazineLock;
+        std::vector<std::unique_ptr<Magazine>> m_magazines;
+    };
+
+
+    // Source of Pool ids.
+    static std::atomic<uint64_t> g_nextPoolId(0);
+
+
+    BlockAllocator::Pool::Pool(size_t blockSize,
+                               size_t maxBlockCount,
+                               size_t hugePageSize,
+                               unsigned numaNode)
+        : m_id(g_nextPoolId++),
+          m_blockSize(blockSize),
+          m_maxBlockCount(maxBlockCount),
+          m_buffer(blockSize * maxBlockCount, hugePageSize, numaNode),
+          m_freeList(0),
+          m_freeCount(0),
+          m_carvedCount(0),
+          m_committedCount(0)
+    {
+        LogAssertB(maxBlockCount < c_indexMask, "maxBlockCount too large.");
+    }
+
+
+    uint64_t BlockAllocator::Pool::GetId() const
+    {
+        return m_id;
+    }
 
-        char * currentBlock = static_cast<char *>(m_pool.GetBuffer());
 
-        for (size_t block = 0; block < totalBlockCount; ++block)
+    size_t BlockAllocator::Pool::GetBlockSize() const
+    {
+        return m_blockSize;
+    }
+
+
+    bool BlockAllocator::Pool::Contains(void const * address) const
+    {
+        char const * start = static_cast<char const *>(m_buffer.GetBuffer());
+        char const * end = start + m_blockSize * m_maxBlockCount;
+        char const * position = static_cast<char const *>(address);
+        return position >= start && position < end;
+    }
+
+
+    size_t BlockAllocator::Pool::GetMaxBlockCount() const
+    {
+        return m_maxBlockCount;
+    }
+
+
+    size_t BlockAllocator::Pool::GetCommittedBlockCount() const
+    {
+        return m_committedCount.load(std::memory_order_acquire);
+    }
+
+
+    size_t BlockAllocator::Pool::GetInUseBlockCount() const
+    {
+        // The counts are read without synchronizing with allocating threads,
+        // so the result is approximate while blocks are moving.
+        int64_t count = static_cast<int64_t>(m_carvedCount.load())
+            - m_freeCount.load();
         {
-            char** nextBlockPtr = reinterpret_cast<char**>(currentBlock);
-            currentBlock += m_blockSize;
+            std::lock_guard<std::mutex> lock(const_cast<Pool*>(this)->m_magazineLock);
+            for (auto const & magazine : m_magazines)
+            {
+                count -= static_cast<int64_t>(
+                    magazine->m_count.load(std::memory_order_relaxed));
+            }
+        }
+        return static_cast<size_t>((std::max)(count, static_cast<int64_t>(0)));
+    }
+
 
-            if (block != totalBlockCount - 1)
+    Magazine& BlockAllocator::Pool::AcquireMagazine()
+    {
+        std::lock_guard<std::mutex> lock(m_magazineLock);
+
+        for (auto & magazine : m_magazines)
+        {
+            if (!magazine->m_isOwned)
             {
-                *nextBlockPtr = currentBlock;
+                magazine->m_isOwned = true;
+                return *magazine;
             }
-            else
+        }
+
+        m_magazines.push_back(std::unique_ptr<Magazine>(new Magazine()));
+        m_magazines.back()->m_isOwned = true;
+        return *m_magazines.back();
+    }
+
+
+    void BlockAllocator::Pool::ReleaseMagazine(Magazine& magazine)
+    {
+        {
+            std::lock_guard<std::mutex> lock(magazine.m_lock);
+            const size_t count = magazine.m_count.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < count; ++i)
             {
-                *nextBlockPtr = nullptr;
+                Push(magazine.m_blocks[i]);
             }
+            magazine.m_count.store(0, std::memory_order_relaxed);
         }
 
-        m_freeListHead = static_cast<uint64_t*>(m_pool.GetBuffer());
+        std::lock_guard<std::mutex> lock(m_magazineLock);
+        magazine.m_isOwned = false;
     }
 
 
-    uint64_t * BlockAllocator::AllocateBlock()
+    void BlockAllocator::Pool::DrainMagazines()
     {
-        std::lock_guard<std::mutex> lock(m_lock);
+        std::lock_guard<std::mutex> lock(m_magazineLock);
+        for (auto & magazine : m_magazines)
+        {
+            std::lock_guard<std::mutex> magazineLock(magazine->m_lock);
+            const size_t count = magazine->m_count.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < count; ++i)
+            {
+                Push(magazine->m_blocks[i]);
+            }
+            magazine->m_count.store(0, std::memory_order_relaxed);
+        }
+    }
+
 
-        if (m_freeListHead == nullptr)
+    uint64_t* BlockAllocator::Pool::Allocate(Magazine& magazine)
+    {
+        {
+            std::lock_guard<std::mutex> lock(magazine.m_lock);
+            const size_t count = magazine.m_count.load(std::memory_order_relaxed);
+            if (count > 0)
+            {
+                magazine.m_count.store(count - 1, std::memory_order_relaxed);
+                return magazine.m_blocks[count - 1];
+            }
+        }
+
+        uint64_t* block = Pop();
+        if (block == nullptr)
+        {
+            block = Carve();
+        }
+        if (block == nullptr)
+        {
+            // The remaining free blocks, if any, sit in other threads'
+            // magazines.
+            DrainMagazines();
+            block = Pop();
+        }
+        if (block == nullptr)
         {
             throw FatalError("Out of memory");
         }
+        return block;
+    }
 
-        uint64_t * block = m_freeListHead;
-        m_freeListHead = reinterpret_cast<uint64_t*>(*m_freeListHead);
 
-        return block;
+    void BlockAllocator::Pool::Release(Magazine& magazine, uint64_t* block)
+    {
+        // Validates the block.
+        GetIndex(block);
+
+        std::lock_guard<std::mutex> lock(magazine.m_lock);
+        size_t count = magazine.m_count.load(std::memory_order_relaxed);
+        if (count == Magazine::c_capacity)
+        {
+            // Return the older half of the magazine to the free list and keep
+            // the recently used blocks, which are more likely to be cached.
+            const size_t half = Magazine::c_capacity / 2;
+            for (size_t i = 0; i < half; ++i)
+            {
+                Push(magazine.m_blocks[i]);
+            }
+            std::copy(magazine.m_blocks + half,
+                      magazine.m_blocks + count,
+                      magazine.m_blocks);
+            count -= half;
+        }
+
+        magazine.m_blocks[count] = block;
+        magazine.m_count.store(count + 1, std::memory_order_relaxed);
     }
 
 
-    void BlockAllocator::ReleaseBlock(uint64_t * block)
+    size_t BlockAllocator::Pool::GetIndex(uint64_t const * block) const
     {
         // Casting to char * for pointer arithmetic.
         char const * blockReturned = reinterpret_cast<char const *>(block);
 
         // Checking that the returned block belongs to our range.
-        char const * bufferStart = static_cast<char const *>(m_pool.GetBuffer());
+        char const * bufferStart = static_cast<char const *>(m_buffer.GetBuffer());
         LogAssertB(blockReturned >= bufferStart,
                    "ReleaseBlock out of range (< bufferStart).");
-        LogAssertB(blockReturned < bufferStart + m_totalPoolSize,
+        LogAssertB(blockReturned < bufferStart + m_blockSize * m_maxBlockCount,
                    "ReleaseBlock out of range (past end)).");
 
-        // The case of m_blockSize is to prevent clang from complaining with a
-        // sign change warning. On our platform, this should only be a problem
-        // if the block size uses up all bits of a size_t, which should never
-        // happen.
-        LogAssertB(((blockReturned - bufferStart) % static_cast<long>(m_blockSize)) == 0,
+        const size_t offset = static_cast<size_t>(blockReturned - bufferStart);
+        LogAssertB((offset % m_blockSize) == 0,
                    "Block offset (relative to begining of pool not a multiple of blockSize");
 
-        // Add the block to the head of the free list
-        uint64_t** blockPtr = reinterpret_cast<uint64_t**>(block);
+        return offset / m_blockSize;
+    }
+
+
+    uint64_t* BlockAllocator::Pool::GetBlock(size_t index) const
+    {
+        char* buffer = static_cast<char*>(m_buffer.GetBuffer());
+        return reinterpret_cast<uint64_t*>(buffer + index * m_blockSize);
+    }
 
-        std::lock_guard<std::mutex> lock(m_lock);
 
-        *blockPtr = m_freeListHead;
+    void BlockAllocator::Pool::Push(uint64_t* block)
+    {
+        const uint64_t index = GetIndex(block);
 
-        m_freeListHead = block;
+        uint64_t head = m_freeList.load(std::memory_order_relaxed);
+        uint64_t newHead;
+        do
+        {
+            // The link to the next free block is stored in the block itself.
+            *block = head & c_indexMask;
+            newHead = ((((head >> c_tagShift) + 1) & c_indexMask) << c_tagShift)
+                | (index + 1);
+        }
+        while (!m_freeList.compare_exchange_weak(head,
+                                                 newHead,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed));
+
+        ++m_freeCount;
+    }
+
+
+    uint64_t* BlockAllocator::Pool::Pop()
+    {
+        uint64_t head = m_freeList.load(std::memory_order_acquire);
+        while ((head & c_indexMask) != 0)
+        {
+            uint64_t* block = GetBlock((head & c_indexMask) - 1);
+
+            // If another thread pops this block first, the link read here may
+            // be stale, but the tag will have changed and the exchange below
+            // fails. Blocks are never decommitted, so the read is safe.
+            const uint64_t next = *block;
+            const uint64_t newHead =
+                ((((head >> c_tagShift) + 1) & c_indexMask) << c_tagShift) | next;
+
+            if (m_freeList.compare_exchange_weak(head,
+                                                 newHead,
+                                                 std::memory_order_acquire,
+                                                 std::memory_order_acquire))
+            {
+                --m_freeCount;
+                return block;
+            }
+        }
+
+        return nullptr;
+    }
+
+
+    uint64_t* BlockAllocator::Pool::Carve()
+    {
+        size_t index = m_carvedCount.load();
+        do
+        {
+            if (index >= m_maxBlockCount)
+            {
+                return nullptr;
+            }
+        }
+        while (!m_carvedCount.compare_exchange_weak(index, index + 1));
+
+        if (index >= m_committedCount.load(std::memory_order_acquire))
+        {
+            std::lock_guard<std::mutex> lock(m_commitLock);
+
+            if (index >= m_committedCount.load(std::memory_order_relaxed))
+            {
+                const size_t stepBlockCount =
+                    (std::max)(c_commitByteSize / m_blockSize, static_cast<size_t>(1));
+                const size_t blockCount =
+                    (std::min)(index + stepBlockCount, m_maxBlockCount);
+                m_buffer.Commit(blockCount * m_blockSize);
+
+                // Commit() rounds up to whole pages, which may cover more
+                // blocks.
+                m_committedCount.store(
+                    (std::min)(m_buffer.GetCommittedSize() / m_blockSize,
+                               m_maxBlockCount),
+                    std::memory_order_release);
+            }
+        }
+
+        return GetBlock(index);
+    }
+
+
+    //*************************************************************************
+    //
+    // ThreadMagazines
+    //
+    // The magazines that the current thread owns in each Pool it has used.
+    // The magazines are emptied and returned to their Pools when the thread
+    // exits.
+    //
+    //*************************************************************************
+    class ThreadMagazines : private NonCopyable
+    {
+    public:
+        typedef BlockAllocator::Pool Pool;
+
+        ThreadMagazines()
+        {
+        }
+
+
+        ~ThreadMagazines()
+        {
+            for (auto & entry : m_entries)
+            {
+                auto pool = entry.m_pool.lock();
+                if (pool.get() != nullptr)
+                {
+                    pool->ReleaseMagazine(*entry.m_magazine);
+                }
+            }
+        }
+
+
+        Magazine& GetMagazine(std::shared_ptr<Pool> const & pool)
+        {
+            const uint64_t id = pool->GetId();
+            for (auto & entry : m_entries)
+            {
+                if (entry.m_poolId == id)
+                {
+                    return *entry.m_magazine;
+                }
+            }
+
+            // Forget the pools that no longer exist before adding this one.
+            for (size_t i = 0; i < m_entries.size(); )
+            {
+                if (m_entries[i].m_pool.expired())
+                {
+                    m_entries[i] = m_entries.back();
+                    m_entries.pop_back();
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+
+            Magazine& magazine = pool->AcquireMagazine();
+            m_entries.push_back(Entry { id, &magazine, pool });
+            return magazine;
+        }
+
+    private:
+        struct Entry
+        {
+            uint64_t m_poolId;
+            Magazine* m_magazine;
+            std::weak_ptr<Pool> m_pool;
+        };
+
+        std::vector<Entry> m_entries;
+    };
+
+
+    static thread_local ThreadMagazines g_threadMagazines;
+
+
+    //*************************************************************************
+    //
+    // BlockAllocator
+    //
+    //*************************************************************************
+    BlockAllocator::BlockAllocator(size_t blockSize,
+                                   size_t maxBlockCount,
+                                   PageSize pageSize,
+                                   unsigned numaNode)
+    {
+        // DESIGN NOTE: technically, one can create an allocator with a size = 0
+        // which would simply throw on the first allocation. This would allow
+        // not having any special handling on the client side where allocation
+        // is not needed. However, given that this is not a public class and we
+        // know exactly its usage, let's not support this scenario now and
+        // re-visit it in future if needed.
+        LogAssertB(blockSize > 0, "m_blockSize of 0.");
+        LogAssertB(maxBlockCount > 0, "maxBlockCount of 0.");
+
+        size_t hugePageSize = 0;
+        if (pageSize == PageSize::Huge2MB)
+        {
+            hugePageSize = static_cast<size_t>(1) << 21;
+        }
+        else if (pageSize == PageSize::Huge1GB)
+        {
+            hugePageSize = static_cast<size_t>(1) << 30;
+        }
+
+        m_pool.reset(new Pool(RoundUp<size_t>(blockSize, c_byteAlignment),
+                              maxBlockCount,
+                              hugePageSize,
+                              numaNode));
+    }
+
+
+    uint64_t * BlockAllocator::AllocateBlock()
+    {
+        return m_pool->Allocate(g_threadMagazines.GetMagazine(m_pool));
+    }
+
+
+    void BlockAllocator::ReleaseBlock(uint64_t * block)
+    {
+        m_pool->Release(g_threadMagazines.GetMagazine(m_pool), block);
     }
 
 
     size_t BlockAllocator::GetBlockSize() const
     {
-        return m_blockSize;
+        return m_pool->GetBlockSize();
+    }
+
+
+    bool BlockAllocator::Contains(void const * address) const
+    {
+        return m_pool->Contains(address);
+    }
+
+
+    size_t BlockAllocator::GetMaxBlockCount() const
+    {
+        return m_pool->GetMaxBlockCount();
+    }
+
+
+    size_t BlockAllocator::GetCommittedBlockCount() const
+    {
+        return m_pool->GetCommittedBlockCount();
+    }
+
+
+    size_t BlockAllocator::GetInUseBlockCount() const
+    {
+        return m_pool->GetInUseBlockCount();
     }
 }
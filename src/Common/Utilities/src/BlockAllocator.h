@@ -20,28 +20,39 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
-
 #pragma once
 
 
-#include <mutex>  // For std::mutex.
+#include <memory>                                   // std::shared_ptr member.
+#include <stddef.h>                                 // size_t parameter.
 
-#include "BitFunnel/Utilities/IBlockAllocator.h"
-#include "AlignedBuffer.h"
+#include "BitFunnel/NonCopyable.h"                  // Base class.
+#include "BitFunnel/Utilities/IBlockAllocator.h"    // Base class.
 
 namespace BitFunnel
 {
     //*************************************************************************
     //
     // BlockAllocator is an implementation of the IBlockAllocator that
-    // allocates the entire pool of the requested number of blocks at
-    // construction and never releases it until destruction. Internally the
-    // pool is aligned to c_byteAlignment. The list of available blocks is
-    // stored as a linked list where the pointer to the next item is stored in
-    // the beginning of the block itself. If this value is nullptr, this is the
-    // last block. m_freeListHead points to the first available block, or
-    // nullptr if there are no available blocks.
-    // Requesting a block when there are none available results in an exception.
+    // reserves address space for the maximum number of blocks at
+    // construction, but only commits memory as blocks are first handed out.
+    // The pool can therefore be sized generously without paying for the
+    // blocks that are never used. Internally the pool is aligned to
+    // c_byteAlignment.
+    //
+    // Each thread keeps a small magazine of free blocks. Allocations and
+    // releases are served from the calling thread's magazine when possible,
+    // under a lock that only that thread normally takes. Otherwise free
+    // blocks move to and from a shared free list, which is a lock free stack
+    // whose links are stored in the blocks themselves. Blocks that have never
+    // been used are carved from the reserved range, and committing more of
+    // the range takes a shared lock. Once the range is exhausted, the blocks
+    // held in every thread's magazine are returned to the free list before
+    // the allocation fails.
+    //
+    // Blocks may be released by a thread other than the one that allocated
+    // them. Requesting a block when all blocks are in use results in an
+    // exception.
     //
     // DESIGN NOTE: The main usage of this allocator is for the RowTable rows
     // which operate on quadwords. Therefore the allocator's pointers are
@@ -49,14 +60,19 @@ namespace BitFunnel
     // aligned to use for matcher.
     //
     //*************************************************************************
-    class BlockAllocator : public IBlockAllocator
+    class BlockAllocator : public IBlockAllocator, NonCopyable
     {
     public:
-        // Constructs an allocator with given block size and the total number
-        // of blocks in the pool.
+        // Constructs an allocator with given block size and the maximum
+        // number of blocks in the pool.
         // Requested blockSize will be rounded up to the next multiple of
         // c_byteAlignment.
-        BlockAllocator(size_t blockSize, size_t totalBlockCount);
+        // The pool is backed by pages of the requested size where the system
+        // provides them, and placed on numaNode unless it is c_anyNumaNode.
+        BlockAllocator(size_t blockSize,
+                       size_t maxBlockCount,
+                       PageSize pageSize,
+                       unsigned numaNode);
 
         //
         // IBlockAllocator API.
@@ -64,22 +80,23 @@ namespace BitFunnel
         virtual uint64_t* AllocateBlock() override;
         virtual void ReleaseBlock(uint64_t*) override;
         virtual size_t GetBlockSize() const override;
+        virtual bool Contains(void const * address) const override;
+        virtual size_t GetMaxBlockCount() const override;
+        virtual size_t GetCommittedBlockCount() const override;
+        virtual size_t GetInUseBlockCount() const override;
 
     private:
         // Byte alignment of the allocated blocks.
         static const unsigned c_log2ByteAlignment = 3;
         static const unsigned c_byteAlignment = 1U << c_log2ByteAlignment;
 
-        const size_t m_blockSize;
-        const size_t m_totalPoolSize;
-
-        // Lock protecting operations on the pool.
-        std::mutex m_lock;
+        class Pool;
 
-        // Underlying pool of memory blocks.
-        AlignedBuffer m_pool;
+        // Caches the calling thread's magazine for each Pool.
+        friend class ThreadMagazines;
 
-        // A pointer to the first available block.
-        uint64_t * m_freeListHead;
+        // The pool is shared with the threads' magazine caches, which return
+        // their blocks when the threads exit.
+        std::shared_ptr<Pool> m_pool;
     };
 }
@@ -0,0 +1,165 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "BitFunnel/Exceptions.h"
+#include "EpochTable.h"
+#include "LoggerInterfaces/Logging.h"
+
+
+namespace BitFunnel
+{
+    // Source of EpochTable ids.
+    static std::atomic<uint64_t> g_nextTableId(0);
+
+
+    EpochTable::EpochTable()
+        : m_id(g_nextTableId++),
+          m_epoch(0),
+          m_slotCount(0)
+    {
+    }
+
+
+    uint64_t EpochTable::GetId() const
+    {
+        return m_id;
+    }
+
+
+    EpochTable::Slot& EpochTable::AcquireSlot()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (!m_freeSlots.empty())
+        {
+            const size_t index = m_freeSlots.back();
+            m_freeSlots.pop_back();
+            return GetSlot(index);
+        }
+
+        const size_t index = m_slotCount.load(std::memory_order_relaxed);
+        if (index == c_maxSlotCount)
+        {
+            RecoverableError error("EpochTable: too many threads holding tokens.");
+            throw error;
+        }
+
+        if (index % c_blockSlotCount == 0)
+        {
+            std::unique_ptr<Slot[]> block(new Slot[c_blockSlotCount]);
+            for (size_t i = 0; i < c_blockSlotCount; ++i)
+            {
+                block[i].m_epoch = c_idleEpoch;
+                block[i].m_depth = 0;
+                block[i].m_issuedCount = 0;
+                block[i].m_index = index + i;
+            }
+            m_blocks[index / c_blockSlotCount] = std::move(block);
+        }
+
+        m_slotCount.store(index + 1, std::memory_order_release);
+        return GetSlot(index);
+    }
+
+
+    void EpochTable::ReleaseSlot(Slot& slot)
+    {
+        LogAssertB(slot.m_depth == 0, "Releasing a slot that holds tokens.");
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_freeSlots.push_back(slot.m_index);
+    }
+
+
+    SerialNumber EpochTable::Enter(Slot& slot)
+    {
+        if (slot.m_depth++ == 0)
+        {
+            // The fence orders the published epoch before the caller's
+            // subsequent reads of shared data. It pairs with the fence in
+            // AdvanceEpoch(): either the tracker sees this slot's epoch, or
+            // the caller sees the data published before the tracker started.
+            slot.m_epoch.store(m_epoch.load(std::memory_order_relaxed),
+                               std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        const SerialNumber mask = (1ll << c_slotIndexShift) - 1;
+        const SerialNumber serialNumber =
+            (static_cast<SerialNumber>(slot.m_index) << c_slotIndexShift) |
+            (slot.m_issuedCount++ & mask);
+        return serialNumber;
+    }
+
+
+    void EpochTable::Exit(Slot& slot)
+    {
+        LogAssertB(slot.m_depth > 0, "Token released from idle slot.");
+
+        if (--slot.m_depth == 0)
+        {
+            // Release ordering makes the caller's reads of shared data happen
+            // before a tracker that observes the idle slot completes.
+            slot.m_epoch.store(c_idleEpoch, std::memory_order_release);
+        }
+    }
+
+
+    size_t EpochTable::GetSlotIndex(SerialNumber serialNumber)
+    {
+        return static_cast<size_t>(serialNumber >> c_slotIndexShift);
+    }
+
+
+    SerialNumber EpochTable::AdvanceEpoch()
+    {
+        const SerialNumber epoch = m_epoch++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return epoch;
+    }
+
+
+    bool EpochTable::IsQuiescent(SerialNumber cutoffEpoch) const
+    {
+        const size_t slotCount = m_slotCount.load(std::memory_order_acquire);
+        for (size_t i = 0; i < slotCount; ++i)
+        {
+            if (GetSlot(i).m_epoch.load(std::memory_order_acquire) <= cutoffEpoch)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+
+    bool EpochTable::IsIdle() const
+    {
+        return IsQuiescent(c_idleEpoch - 1);
+    }
+
+
+    EpochTable::Slot& EpochTable::GetSlot(size_t index) const
+    {
+        return m_blocks[index / c_blockSlotCount][index % c_blockSlotCount];
+    }
+}
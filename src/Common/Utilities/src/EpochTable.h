@@ -0,0 +1,146 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <atomic>                   // std::atomic embedded.
+#include <memory>                   // std::unique_ptr member.
+#include <mutex>                    // std::mutex embedded.
+#include <stddef.h>                 // size_t member.
+#include <stdint.h>                 // uint64_t member.
+#include <vector>                   // std::vector member.
+
+#include "BitFunnel/Index/Token.h"  // SerialNumber member.
+#include "BitFunnel/NonCopyable.h"  // Base class.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // EpochTable
+    //
+    // The shared state of an epoch based TokenManager. Each thread that holds
+    // tokens is assigned a Slot in which it publishes the global epoch that
+    // was current when it requested its outermost token. Entering and leaving
+    // a Slot only write to that Slot, so threads requesting and releasing
+    // tokens never contend with one another.
+    //
+    // A tracker advances the global epoch and then waits until no Slot
+    // publishes an epoch at or below the old epoch. At that point every token
+    // that existed when the tracker started has been released. Tokens that
+    // are nested within an older token on the same thread keep the Slot at
+    // the older epoch, so a tracker may wait for a thread to release all of
+    // its tokens, not just the ones that existed when it started.
+    //
+    // Thread safety: all public methods are thread safe. A Slot must only be
+    // entered and exited by the thread that acquired it.
+    //
+    //*************************************************************************
+    class EpochTable : private NonCopyable
+    {
+    public:
+        class Slot
+        {
+        public:
+            // The epoch of the outermost token held, or c_idleEpoch.
+            std::atomic<SerialNumber> m_epoch;
+
+            // The following members are only used by the owning thread.
+            SerialNumber m_depth;
+            SerialNumber m_issuedCount;
+            size_t m_index;
+
+        private:
+            // Pads Slots to two cache lines so that the members written by
+            // different threads never share a cache line, whatever the
+            // alignment of the array.
+            char m_padding[128 - 3 * sizeof(SerialNumber) - sizeof(size_t)];
+        };
+
+        // Slots are allocated in blocks as threads arrive. Blocks are never
+        // moved, so a Slot stays at the same address for the table's life.
+        static const size_t c_blockSlotCount = 64;
+        static const size_t c_maxBlockCount = 1024;
+
+        // Maximum number of threads that can hold tokens at the same time.
+        static const size_t c_maxSlotCount = c_blockSlotCount * c_maxBlockCount;
+
+        EpochTable();
+
+        // Returns an identifier that is unique across all EpochTables created
+        // by the process. Unlike the table's address, it is never reused.
+        uint64_t GetId() const;
+
+        // Reserves a Slot for the calling thread. Throws a RecoverableError
+        // if c_maxSlotCount threads already hold Slots.
+        Slot& AcquireSlot();
+
+        // Returns an idle Slot to the pool when its thread exits.
+        void ReleaseSlot(Slot& slot);
+
+        // Records a token request on the slot and returns the token's serial
+        // number. Only the outermost token of a slot publishes an epoch.
+        SerialNumber Enter(Slot& slot);
+
+        // Records the release of a token requested from slot.
+        void Exit(Slot& slot);
+
+        // Returns the index of the Slot that issued serialNumber.
+        static size_t GetSlotIndex(SerialNumber serialNumber);
+
+        // Advances the global epoch and returns the epoch before the advance.
+        SerialNumber AdvanceEpoch();
+
+        // Returns true if no Slot publishes an epoch at or below cutoffEpoch.
+        bool IsQuiescent(SerialNumber cutoffEpoch) const;
+
+        // Returns true if no Slot holds a token.
+        bool IsIdle() const;
+
+    private:
+        static const SerialNumber c_idleEpoch = INT64_MAX;
+        static const unsigned c_slotIndexShift = 40;
+
+        const uint64_t m_id;
+
+        std::atomic<SerialNumber> m_epoch;
+
+        Slot& GetSlot(size_t index) const;
+
+        // Blocks below m_slotCount / c_blockSlotCount, rounded up, are
+        // allocated. A block is written once, under m_lock, before
+        // m_slotCount publishes it.
+        std::unique_ptr<Slot[]> m_blocks[c_maxBlockCount];
+
+        // Number of Slots ever acquired. Slots at and beyond this index are
+        // idle and are not scanned.
+        std::atomic<size_t> m_slotCount;
+
+        // Protects m_freeSlots and block allocation.
+        std::mutex m_lock;
+
+        // Indices of released Slots, which are reused before new Slots are
+        // added.
+        std::vector<size_t> m_freeSlots;
+    };
+}
@@ -0,0 +1,167 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include <sstream>
+
+#include "BitFunnel/Exceptions.h"
+#include "MemoryMappedFile.h"
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+#include <Windows.h>    // For CreateFileMapping/MapViewOfFile.
+#else
+#include <cerrno>       // For errno.
+#include <cstring>      // For std::strerror.
+#include <fcntl.h>      // For open.
+#include <sys/mman.h>   // For mmap/munmap.
+#include <sys/stat.h>   // For fstat.
+#include <unistd.h>     // For close.
+#endif
+
+
+namespace BitFunnel
+{
+    static void ThrowMappingError(char const * fileName, char const * operation)
+    {
+        std::stringstream message;
+        message << "MemoryMappedFile: " << operation
+                << " failed for \"" << fileName << "\"";
+#ifndef BITFUNNEL_PLATFORM_WINDOWS
+        message << ": " << std::strerror(errno);
+#endif
+        throw RecoverableError(message.str());
+    }
+
+
+    MemoryMappedFile::MemoryMappedFile(char const * fileName)
+        : m_buffer(nullptr),
+          m_size(0)
+    {
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        HANDLE file = CreateFileA(fileName,
+                                  GENERIC_READ,
+                                  FILE_SHARE_READ,
+                                  nullptr,
+                                  OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL,
+                                  nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            ThrowMappingError(fileName, "CreateFile");
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size))
+        {
+            CloseHandle(file);
+            ThrowMappingError(fileName, "GetFileSizeEx");
+        }
+        m_size = static_cast<size_t>(size.QuadPart);
+
+        // PAGE_WRITECOPY and FILE_MAP_COPY give a private copy-on-write view.
+        HANDLE mapping = CreateFileMapping(file,
+                                           nullptr,
+                                           PAGE_WRITECOPY,
+                                           0,
+                                           0,
+                                           nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr)
+        {
+            ThrowMappingError(fileName, "CreateFileMapping");
+        }
+
+        m_buffer = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+
+        // The view holds a reference to the mapping object.
+        CloseHandle(mapping);
+        if (m_buffer == nullptr)
+        {
+            ThrowMappingError(fileName, "MapViewOfFile");
+        }
+#else
+        const int file = open(fileName, O_RDONLY);
+        if (file == -1)
+        {
+            ThrowMappingError(fileName, "open");
+        }
+
+        struct stat status;
+        if (fstat(file, &status) != 0)
+        {
+            close(file);
+            ThrowMappingError(fileName, "fstat");
+        }
+        m_size = static_cast<size_t>(status.st_size);
+
+        if (m_size == 0)
+        {
+            close(file);
+            ThrowMappingError(fileName, "mmap of empty file");
+        }
+
+        // MAP_PRIVATE gives a copy-on-write mapping of a file opened
+        // read-only.
+        void* buffer = mmap(nullptr,
+                            m_size,
+                            PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE,
+                            file,
+                            0);
+
+        // The mapping holds its own reference to the file.
+        close(file);
+
+        // `MAP_FAILED` is implemented as an old-style cast on some old
+        // Unix-derived platforms. See #233.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+        if (buffer == MAP_FAILED)
+#pragma GCC diagnostic pop
+        {
+            ThrowMappingError(fileName, "mmap");
+        }
+        m_buffer = buffer;
+#endif
+    }
+
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        UnmapViewOfFile(m_buffer);
+#else
+        // TODO: munmap == -1 indicates failure. Consider logging this error.
+        munmap(m_buffer, m_size);
+#endif
+    }
+
+
+    char* MemoryMappedFile::GetBuffer() const
+    {
+        return static_cast<char*>(m_buffer);
+    }
+
+
+    size_t MemoryMappedFile::GetSize() const
+    {
+        return m_size;
+    }
+}
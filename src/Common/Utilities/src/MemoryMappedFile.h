@@ -0,0 +1,61 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#pragma once
+
+#include <stddef.h>                 // size_t return value.
+
+#include "BitFunnel/NonCopyable.h"  // Base class.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // MemoryMappedFile maps the entire contents of an existing file into the
+    // address space of the process. The mapping is private and copy-on-write:
+    // pages may be modified in memory, but modifications are never written
+    // back to the file and only the pages that are actually written consume
+    // private memory. The mapping is released when the object is destroyed.
+    //
+    // The base address of the mapping is page aligned, so data placed at a
+    // page aligned offset within the file is page aligned in memory.
+    //
+    //*************************************************************************
+    class MemoryMappedFile : private NonCopyable
+    {
+    public:
+        // Maps the file with the given name. Throws RecoverableError if the
+        // file cannot be opened or mapped.
+        MemoryMappedFile(char const * fileName);
+        ~MemoryMappedFile();
+
+        // Returns the address of the first byte of the file.
+        char* GetBuffer() const;
+
+        // Returns the size of the file in bytes.
+        size_t GetSize() const;
+
+    private:
+        void* m_buffer;
+        size_t m_size;
+    };
+}
@@ -0,0 +1,145 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+#include <Windows.h>    // For GetNumaHighestNodeNumber, SetThreadGroupAffinity.
+#elif defined(__linux__)
+#include <fstream>
+#include <sched.h>      // For sched_setaffinity.
+#include <string>
+#include <vector>
+#endif
+
+#include "BitFunnel/Utilities/Numa.h"
+
+
+namespace BitFunnel
+{
+#if !defined(BITFUNNEL_PLATFORM_WINDOWS) && defined(__linux__)
+    // Parses a sysfs list such as "0-3,8-11" into the values it contains.
+    static bool ReadSysfsList(char const * path, std::vector<unsigned>& values)
+    {
+        std::ifstream input(path);
+        std::string text;
+        if (!input.is_open() || !std::getline(input, text))
+        {
+            return false;
+        }
+
+        size_t position = 0;
+        while (position < text.size())
+        {
+            size_t end = text.find(',', position);
+            if (end == std::string::npos)
+            {
+                end = text.size();
+            }
+
+            const std::string item = text.substr(position, end - position);
+            const size_t dash = item.find('-');
+            try
+            {
+                const unsigned first = static_cast<unsigned>(std::stoul(item));
+                const unsigned last = (dash == std::string::npos) ?
+                    first :
+                    static_cast<unsigned>(std::stoul(item.substr(dash + 1)));
+                for (unsigned value = first; value <= last; ++value)
+                {
+                    values.push_back(value);
+                }
+            }
+            catch (...)
+            {
+                return false;
+            }
+
+            position = end + 1;
+        }
+
+        return !values.empty();
+    }
+#endif
+
+
+    unsigned GetNumaNodeCount()
+    {
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        ULONG highestNode = 0;
+        if (!GetNumaHighestNodeNumber(&highestNode))
+        {
+            return 1;
+        }
+        return static_cast<unsigned>(highestNode) + 1;
+#elif defined(__linux__)
+        std::vector<unsigned> nodes;
+        if (!ReadSysfsList("/sys/devices/system/node/online", nodes))
+        {
+            return 1;
+        }
+        return nodes.back() + 1;
+#else
+        return 1;
+#endif
+    }
+
+
+    bool BindCurrentThreadToNumaNode(unsigned node)
+    {
+        if (node >= GetNumaNodeCount())
+        {
+            return false;
+        }
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        GROUP_AFFINITY affinity;
+        if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity) ||
+            affinity.Mask == 0)
+        {
+            return false;
+        }
+        return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#elif defined(__linux__)
+        const std::string path =
+            "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+        std::vector<unsigned> processors;
+        if (!ReadSysfsList(path.c_str(), processors))
+        {
+            return false;
+        }
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (auto processor : processors)
+        {
+            if (processor < CPU_SETSIZE)
+            {
+                CPU_SET(processor, &set);
+            }
+        }
+
+        // A pid of zero refers to the calling thread.
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        return false;
+#endif
+    }
+}
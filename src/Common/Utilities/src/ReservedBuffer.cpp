@@ -0,0 +1,293 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <cstring>
+
+#include "BitFunnel/Exceptions.h"
+#include "LoggerInterfaces/Check.h"
+#include "ReservedBuffer.h"
+#include "Rounding.h"
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+#include <Windows.h>        // For VirtualAlloc/VirtualAllocExNuma/VirtualFree.
+#else
+#include <sys/mman.h>       // For mmap/mprotect/madvise/munmap.
+#include <unistd.h>         // For sysconf.
+#ifdef __linux__
+#include <sys/syscall.h>    // For SYS_mbind.
+#endif
+#endif
+
+
+namespace BitFunnel
+{
+#if !defined(BITFUNNEL_PLATFORM_WINDOWS)
+    // See AlignedBuffer.cpp regarding MAP_FAILED.
+    static bool IsMapFailed(void* buffer)
+    {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+        return buffer == MAP_FAILED;
+#pragma GCC diagnostic pop
+    }
+
+
+    // Sets a preferred NUMA node for a range of pages that have not yet been
+    // touched. Placement is a hint, so failures are ignored.
+    static void PreferNumaNode(void* start, size_t byteCount, unsigned node)
+    {
+#if defined(__linux__) && defined(SYS_mbind)
+        // MPOL_PREFERRED from <linux/mempolicy.h>. Unlike MPOL_BIND, it falls
+        // back to other nodes when the preferred node is out of memory.
+        const int c_mpolPreferred = 1;
+        const unsigned c_bitsPerWord = 8 * sizeof(unsigned long);
+        const unsigned c_maxNodeCount = 256;
+
+        if (node < c_maxNodeCount)
+        {
+            unsigned long mask[c_maxNodeCount / c_bitsPerWord] = { 0 };
+            mask[node / c_bitsPerWord] = 1ul << (node % c_bitsPerWord);
+            syscall(SYS_mbind,
+                    start,
+                    byteCount,
+                    c_mpolPreferred,
+                    mask,
+                    static_cast<unsigned long>(c_maxNodeCount),
+                    0);
+        }
+#else
+        (void)start;
+        (void)byteCount;
+        (void)node;
+#endif
+    }
+#endif
+
+
+    ReservedBuffer::ReservedBuffer(size_t size,
+                                   size_t hugePageSize,
+                                   unsigned numaNode)
+        : m_pageSize((std::max)(GetSystemPageSize(), hugePageSize)),
+          m_hugePageSize(hugePageSize),
+          m_numaNode(numaNode),
+          m_hugePagesUnavailable(false),
+          m_hugePageCommittedSize(0),
+          m_size(RoundUp(size, m_pageSize)),
+          m_committedSize(0),
+          m_buffer(nullptr)
+    {
+        CHECK_GT(m_size, 0u) << "ReservedBuffer of size 0.";
+        CHECK_EQ(m_pageSize & (m_pageSize - 1), 0u)
+            << "Page size must be a power of two.";
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        m_buffer = VirtualAlloc(nullptr, m_size, MEM_RESERVE, PAGE_NOACCESS);
+        CHECK_NE(m_buffer, nullptr) << "VirtualAlloc() failed.";
+#else
+        // Huge pages must be aligned to their size, so reserve extra space
+        // and trim the range to an aligned start.
+        const size_t slack = m_pageSize - GetSystemPageSize();
+
+        // Inaccessible, unreserved pages cost no memory or swap until they
+        // are committed.
+        void* buffer = mmap(nullptr, m_size + slack,
+                            PROT_NONE,
+                            MAP_ANON | MAP_PRIVATE | MAP_NORESERVE,
+                            -1,  // No file descriptor.
+                            0);
+
+        if (IsMapFailed(buffer))
+        {
+            CHECK_FAIL << "ReservedBuffer failed to mmap: "
+                       << std::strerror(errno)
+                       << std::endl;
+        }
+
+        char* start = static_cast<char*>(buffer);
+        char* alignedStart = reinterpret_cast<char*>(
+            RoundUp(reinterpret_cast<size_t>(start), m_pageSize));
+        if (alignedStart != start)
+        {
+            munmap(start, static_cast<size_t>(alignedStart - start));
+        }
+        char* end = alignedStart + m_size;
+        if (end != start + m_size + slack)
+        {
+            munmap(end, static_cast<size_t>(start + m_size + slack - end));
+        }
+        m_buffer = alignedStart;
+
+        if (m_numaNode != c_anyNumaNode)
+        {
+            PreferNumaNode(m_buffer, m_size, m_numaNode);
+        }
+#endif
+    }
+
+
+    ReservedBuffer::~ReservedBuffer()
+    {
+        if (m_buffer != nullptr)
+        {
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+            VirtualFree(m_buffer, 0, MEM_RELEASE);
+#else
+            munmap(m_buffer, m_size);
+#endif
+        }
+    }
+
+
+    void* ReservedBuffer::GetBuffer() const
+    {
+        return m_buffer;
+    }
+
+
+    size_t ReservedBuffer::GetSize() const
+    {
+        return m_size;
+    }
+
+
+    void ReservedBuffer::Commit(size_t size)
+    {
+        const size_t committedSize = (std::min)(RoundUp(size, m_pageSize), m_size);
+        if (committedSize <= m_committedSize)
+        {
+            return;
+        }
+
+        CommitRange(static_cast<char*>(m_buffer) + m_committedSize,
+                    committedSize - m_committedSize);
+
+        m_committedSize = committedSize;
+    }
+
+
+    size_t ReservedBuffer::GetCommittedSize() const
+    {
+        return m_committedSize;
+    }
+
+
+    size_t ReservedBuffer::GetHugePageCommittedSize() const
+    {
+        return m_hugePageCommittedSize;
+    }
+
+
+    void ReservedBuffer::CommitRange(char* start, size_t byteCount)
+    {
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        void* result = (m_numaNode == c_anyNumaNode) ?
+            VirtualAlloc(start, byteCount, MEM_COMMIT, PAGE_READWRITE) :
+            VirtualAllocExNuma(GetCurrentProcess(),
+                               start,
+                               byteCount,
+                               MEM_COMMIT,
+                               PAGE_READWRITE,
+                               m_numaNode);
+        if (result == nullptr)
+        {
+            throw FatalError("Out of memory");
+        }
+#else
+#ifdef MAP_HUGETLB
+        if (m_hugePageSize != 0 && !m_hugePagesUnavailable)
+        {
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+            int log2PageSize = 0;
+            while ((static_cast<size_t>(1) << log2PageSize) < m_hugePageSize)
+            {
+                ++log2PageSize;
+            }
+
+            // Replace the reserved pages with huge pages. The kernel reserves
+            // the huge pages here, so a shortage is reported now rather than
+            // as a fault when the memory is first touched.
+            void* buffer = mmap(start, byteCount,
+                                PROT_READ | PROT_WRITE,
+                                MAP_ANON | MAP_PRIVATE | MAP_FIXED | MAP_HUGETLB |
+                                    (log2PageSize << MAP_HUGE_SHIFT),
+                                -1,  // No file descriptor.
+                                0);
+            if (!IsMapFailed(buffer))
+            {
+                if (m_numaNode != c_anyNumaNode)
+                {
+                    PreferNumaNode(start, byteCount, m_numaNode);
+                }
+                m_hugePageCommittedSize += byteCount;
+                return;
+            }
+            m_hugePagesUnavailable = true;
+
+            // A failed MAP_FIXED may have released the reservation, so
+            // restore it for the rest of the range.
+            char* end = static_cast<char*>(m_buffer) + m_size;
+            buffer = mmap(start, static_cast<size_t>(end - start),
+                          PROT_NONE,
+                          MAP_ANON | MAP_PRIVATE | MAP_FIXED | MAP_NORESERVE,
+                          -1,  // No file descriptor.
+                          0);
+            if (IsMapFailed(buffer))
+            {
+                throw FatalError("Out of memory");
+            }
+            if (m_numaNode != c_anyNumaNode)
+            {
+                PreferNumaNode(start, static_cast<size_t>(end - start), m_numaNode);
+            }
+        }
+#endif
+
+        if (mprotect(start, byteCount, PROT_READ | PROT_WRITE) != 0)
+        {
+            throw FatalError("Out of memory");
+        }
+
+#ifdef MADV_HUGEPAGE
+        if (m_hugePageSize != 0)
+        {
+            // Fall back to transparent huge pages. This is only advice.
+            madvise(start, byteCount, MADV_HUGEPAGE);
+        }
+#endif
+#endif
+    }
+
+
+    size_t ReservedBuffer::GetSystemPageSize()
+    {
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    }
+}
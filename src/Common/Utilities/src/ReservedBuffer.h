@@ -0,0 +1,99 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                         // size_t member.
+
+#include "BitFunnel/NonCopyable.h"          // Base class.
+#include "BitFunnel/Utilities/Numa.h"       // c_anyNumaNode default.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // ReservedBuffer reserves a page aligned range of virtual address space
+    // without committing memory to it. Memory is committed in increasing
+    // prefixes of the range by Commit(), so a large range can be reserved up
+    // front and backed only as it is used. Committed memory is zero
+    // initialized.
+    //
+    // The buffer may request huge pages, in which case memory is committed in
+    // multiples of the huge page size. If the system has no huge pages to
+    // spare, the buffer falls back to default pages (advising the kernel to
+    // use transparent huge pages where available). Huge pages are not used on
+    // Windows, where they cannot be committed incrementally.
+    //
+    // The buffer may also prefer a NUMA node, in which case committed memory
+    // is placed on that node when it has memory available.
+    //
+    // Thread safety: calls to Commit() and GetCommittedSize() must be
+    // serialized by the caller. The other methods are thread safe.
+    //
+    //*************************************************************************
+    class ReservedBuffer : private NonCopyable
+    {
+    public:
+        // Reserves at least size bytes. A hugePageSize of zero selects
+        // default pages. A numaNode of c_anyNumaNode leaves placement to the
+        // operating system.
+        ReservedBuffer(size_t size,
+                       size_t hugePageSize = 0,
+                       unsigned numaNode = c_anyNumaNode);
+        ~ReservedBuffer();
+
+        void* GetBuffer() const;
+
+        // Returns the number of bytes reserved.
+        size_t GetSize() const;
+
+        // Ensures that at least the first size bytes are committed. The
+        // committed size is rounded up to a whole number of pages.
+        void Commit(size_t size);
+
+        // Returns the number of bytes committed.
+        size_t GetCommittedSize() const;
+
+        // Returns the number of committed bytes backed by huge pages.
+        size_t GetHugePageCommittedSize() const;
+
+    private:
+        static size_t GetSystemPageSize();
+
+        void CommitRange(char* start, size_t byteCount);
+
+        // Commit granularity: the huge page size if one was requested,
+        // otherwise the system page size.
+        size_t m_pageSize;
+        size_t m_hugePageSize;
+        unsigned m_numaNode;
+
+        // Set once the system has failed to provide huge pages, after which
+        // default pages are used.
+        bool m_hugePagesUnavailable;
+        size_t m_hugePageCommittedSize;
+        size_t m_size;
+        size_t m_committedSize;
+        void* m_buffer;
+    };
+}
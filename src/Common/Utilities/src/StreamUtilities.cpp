@@ -37,7 +37,8 @@ namespace BitFunnel
     void StreamUtilities::ReadBytes(IInputStream &stream, void* buffer,
                                     size_t byteCount)
     {
-        LogAssertB(buffer != nullptr, "buffer == nullptr");
+        // Empty std::vectors may legitimately pass nullptr with no bytes.
+        LogAssertB(buffer != nullptr || byteCount == 0, "buffer == nullptr");
         size_t offset = 0;  // number of bytes read.
         while (byteCount > 0)
         {
@@ -64,7 +65,8 @@ namespace BitFunnel
     void StreamUtilities::WriteBytes(std::ostream &stream, const char* buffer,
                                      size_t byteCount)
     {
-        LogAssertB(buffer != nullptr, "buffer == nullptr");
+        // Empty std::vectors may legitimately pass nullptr with no bytes.
+        LogAssertB(buffer != nullptr || byteCount == 0, "buffer == nullptr");
         size_t offset = 0;  // number of bytes written.
         while (byteCount > 0)
         {
@@ -20,8 +20,9 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
-
-#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
 
 #include "BitFunnel/Utilities/Factories.h"
 #include "LoggerInterfaces/Logging.h"
@@ -30,6 +31,81 @@
 
 namespace BitFunnel
 {
+    //*************************************************************************
+    //
+    // ThreadSlots
+    //
+    // The slots that the current thread owns in each EpochTable it has
+    // requested tokens from. The slots are returned to their tables when the
+    // thread exits.
+    //
+    //*************************************************************************
+    class ThreadSlots : private NonCopyable
+    {
+    public:
+        ThreadSlots()
+        {
+        }
+
+
+        ~ThreadSlots()
+        {
+            for (auto & entry : m_entries)
+            {
+                auto table = entry.m_table.lock();
+                if (table.get() != nullptr)
+                {
+                    table->ReleaseSlot(*entry.m_slot);
+                }
+            }
+        }
+
+
+        EpochTable::Slot& GetSlot(std::shared_ptr<EpochTable> const & table)
+        {
+            const uint64_t id = table->GetId();
+            for (auto & entry : m_entries)
+            {
+                if (entry.m_tableId == id)
+                {
+                    return *entry.m_slot;
+                }
+            }
+
+            // Forget the tables that no longer exist before adding this one.
+            for (size_t i = 0; i < m_entries.size(); )
+            {
+                if (m_entries[i].m_table.expired())
+                {
+                    m_entries[i] = m_entries.back();
+                    m_entries.pop_back();
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+
+            EpochTable::Slot& slot = table->AcquireSlot();
+            m_entries.push_back(Entry { id, &slot, table });
+            return slot;
+        }
+
+    private:
+        struct Entry
+        {
+            uint64_t m_tableId;
+            EpochTable::Slot* m_slot;
+            std::weak_ptr<EpochTable> m_table;
+        };
+
+        std::vector<Entry> m_entries;
+    };
+
+
+    static thread_local ThreadSlots g_threadSlots;
+
+
     std::unique_ptr<ITokenManager> Factories::CreateTokenManager()
     {
         return std::unique_ptr<ITokenManager>(new TokenManager());
@@ -37,8 +113,7 @@ namespace BitFunnel
 
 
     TokenManager::TokenManager()
-        : m_nextSerialNumber(0),
-          m_tokensInFlight(0),
+        : m_epochs(new EpochTable()),
           m_isShuttingDown(false)
     {
     }
@@ -54,30 +129,14 @@ namespace BitFunnel
     {
         LogAssertB(!m_isShuttingDown, "Requested Token while shutting down");
 
-        std::lock_guard<std::mutex> lock(m_lock);
-        const SerialNumber serialNumber = m_nextSerialNumber++;
-        ++m_tokensInFlight;
-        return Token(*this, serialNumber);
+        return Token(*this, m_epochs->Enter(GetSlot()));
     }
 
 
     const std::shared_ptr<ITokenTracker> TokenManager::StartTracker()
     {
-        std::lock_guard<std::mutex> lock(m_lock);
-        std::shared_ptr<TokenTracker> tracker(
-            new TokenTracker(m_nextSerialNumber, m_tokensInFlight));
-
-        // If there are no tokens in flight, then the tracker is already
-        // complete. There is no point in adding it to the list of active
-        // trackers. Returns it to the client so that they can check its
-        // completion status, but from the TokenManager's perspective, this
-        // tracker is not of interest.
-        if (!(tracker->IsComplete()))
-        {
-            m_trackers.push_back(tracker);
-        }
-
-        return tracker;
+        return std::shared_ptr<ITokenTracker>(
+            new TokenTracker(m_epochs, m_epochs->AdvanceEpoch()));
     }
 
 
@@ -88,47 +147,25 @@ namespace BitFunnel
 
         // Wait for existing tokens to be returned.
         // TODO: consider if we want to timeout and log an error.
-        while (m_tokensInFlight > 0)
+        while (!m_epochs->IsIdle())
         {
-            std::unique_lock<std::mutex> lock(m_lock);
-            m_shutdownCondition.wait(lock);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
         }
     }
 
 
     void TokenManager::OnTokenComplete(SerialNumber serialNumber)
     {
-        LogAssertB(m_tokensInFlight > 0,
-                   "Token completed with <= 0 tokens in flight.");
-
-        {
-            std::lock_guard<std::mutex> lock(m_lock);
-            --m_tokensInFlight;
+        EpochTable::Slot& slot = GetSlot();
+        LogAssertB(EpochTable::GetSlotIndex(serialNumber) == slot.m_index,
+                   "Token released by a thread other than its owner.");
 
-            // m_trackers consists of a sequence of zero or more complete trackers,
-            // followed by a sequence of trackers that have not completed.
-
-            // First notify and remove the completed trackers at the head of m_trackers.
-            while (!m_trackers.empty() &&
-                   m_trackers.front()->OnTokenComplete(serialNumber))
-            {
-                m_trackers.pop_front();
-            }
+        m_epochs->Exit(slot);
+    }
 
-            // Then notify the remaining trackers, starting with index 1, since we
-            // have already notified the first one in the while loop above.
-            for (unsigned i = 1; i < m_trackers.size(); ++i)
-            {
-                // All older trackers must be complete for a tracker to
-                // complete.
-                LogAssertB(!m_trackers[i]->OnTokenComplete(serialNumber),
-                           "Tracker completed out of order.");
-            }
-        }
 
-        if (m_tokensInFlight == 0 && m_isShuttingDown)
-        {
-            m_shutdownCondition.notify_all();
-        }
+    EpochTable::Slot& TokenManager::GetSlot()
+    {
+        return g_threadSlots.GetSlot(m_epochs);
     }
 }
@@ -20,21 +20,16 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
-
 #pragma once
 
 #include <atomic>                   // std::atomic embedded.
-#include <condition_variable>       // std::contiion_variable embedded.
-#include <deque>                    // std::deque embedded.
-#include <memory>                   // std::shared_ptr template parameter.
-#include <mutex>                    // std::mutex embedded.
+#include <memory>                   // std::shared_ptr member.
 
 #include "BitFunnel/Index/Token.h"  // Inherits from ITokenManager and ITokenListener
+#include "EpochTable.h"             // EpochTable::Slot return value.
 
 namespace BitFunnel
 {
-    class TokenTracker;
-
     //*************************************************************************
     //
     // TokenManager provides an implementation of ITokenManager which assists
@@ -42,10 +37,16 @@ namespace BitFunnel
     // well as to stop and resume distributing new tokens.
     // This class is thread-safe.
     //
-    // DESIGN NOTE: To make it easier to track old tokens, all tokens are
-    // assigned a monotonically increasing serial numbers. With this scheme
-    // ITokenTracker needs only store the most recently issued SerialNumber and
-    // the number of Tokens currently in existence.
+    // DESIGN NOTE: TokenManager uses epoch based reclamation. Each thread
+    // that requests tokens owns a slot in an EpochTable where it publishes
+    // the epoch of its outermost token. Requesting and releasing a token
+    // only writes the calling thread's slot, so there is no lock or shared
+    // counter on the token path. StartTracker() advances the epoch and the
+    // returned tracker scans the slots to detect completion.
+    //
+    // A Token must be released by the thread that requested it. A Token's
+    // serial number identifies the slot that issued it, and is increasing
+    // for the tokens issued to one thread.
     //
     //*************************************************************************
     class TokenManager : public ITokenManager,
@@ -71,37 +72,13 @@ namespace BitFunnel
         //
         virtual void OnTokenComplete(SerialNumber serialNumber) override;
 
-        // Serial number for the next issued token.
-        std::atomic<int64_t> m_nextSerialNumber;
+        // Returns the calling thread's slot, acquiring one on first use.
+        EpochTable::Slot& GetSlot();
 
-        // Number of tokens currently in-flight.
-        std::atomic<int64_t> m_tokensInFlight;
+        // Shared with the trackers, which may outlive the TokenManager.
+        std::shared_ptr<EpochTable> m_epochs;
 
         // Flag indicating that TokenManager is shutting down.
         std::atomic<bool> m_isShuttingDown;
-
-        // A list of registered token trackers.
-        // DESIGN NOTE: std::deque is chosen since we always want to add new
-        // trackers at the back and remove the completed ones off the front.
-        // The trackers in front will always complete faster than the ones
-        // at the back - since they were started earlier - and we need to
-        // be able to pop the trackers off the list as soon as they complete.
-        std::deque<std::shared_ptr<TokenTracker>> m_trackers;
-
-        // This lock is required to protect two things. First, it's used
-        // to protect the m_trackers deque, which isn't thread safe.
-        // Second, it's used to protect the tuple (m_nextSerialNumber,
-        // m_tokensInFlight), which must be updated in tandem.
-        // Making each of those atomic isn't sufficient. because a new tracker
-        // instantiated when only one of the two variables has been updated will
-        // have an inconsistent state.
-        // This mutex is also used to protect the condition variable, although,
-        // strictly speaking, a finer grained mutex could be used that only
-        // protects the condition variable and m_tokensInFlight.
-        std::mutex m_lock;
-
-        // Signal that all tokens have been destroyed. This allows Shutdown()
-        // to proceed.
-        std::condition_variable m_shutdownCondition;
     };
 }
@@ -20,18 +20,19 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <chrono>
+#include <thread>
 
-#include <limits>
-
-#include "LoggerInterfaces/Logging.h"
+#include "EpochTable.h"
 #include "TokenTracker.h"
 
 namespace BitFunnel
 {
-    TokenTracker::TokenTracker(SerialNumber cutoffSerialNumber,
-                               int64_t remainingTokenCount)
-        : m_cutoffSerialNumber(cutoffSerialNumber),
-          m_remainingTokenCount(remainingTokenCount)
+    TokenTracker::TokenTracker(std::shared_ptr<EpochTable const> epochs,
+                               SerialNumber cutoffEpoch)
+        : m_epochs(epochs),
+          m_cutoffEpoch(cutoffEpoch),
+          m_isComplete(false)
     {
     }
 
@@ -41,59 +42,26 @@ namespace BitFunnel
     }
 
 
-    bool TokenTracker::OnTokenComplete(SerialNumber serialNumber)
+    bool TokenTracker::IsComplete() const
     {
-        // Until a tracker declares itself "complete" by returning true from
-        // this method, it will be continuously called even for serial numbers
-        // greater or equal to the cutoff value. This is because tokens issued
-        // later (with greater serial number) may be returned earlier than the
-        // "older" ones. TokenManager does not sort out returned tokens, and
-        // simply calls all of its registered trackers. Therefore it is
-        // important to compare the serial number with the cutoff value.
-        if (serialNumber < m_cutoffSerialNumber)
+        if (!m_isComplete.load(std::memory_order_acquire) &&
+            m_epochs->IsQuiescent(m_cutoffEpoch))
         {
-
-            int64_t newValue;
-            // This lock is to prevent a race between notification on the
-            // condition variable and waiting on the condition varaible.
-            {
-                std::lock_guard<std::mutex> lock(m_conditionLock);
-                newValue = --m_remainingTokenCount;
-            }
-
-            LogAssertB(newValue >= 0, "token count underflow");
-
-            if (newValue == 0)
-            {
-                m_condition.notify_all();
-                return true;
-            }
-            else
-            {
-                return false;
-            }
+            m_isComplete.store(true, std::memory_order_release);
         }
-
-        // A token which is not of our interest cannot make tracking complete.
-        return false;
-    }
-
-
-    bool TokenTracker::IsComplete() const
-    {
-        return m_remainingTokenCount.load() == 0;
+        return m_isComplete.load(std::memory_order_acquire);
     }
 
 
-    // TODO: does this need a timeout? It would be easy to add since we're
-    // using a std::condition_variable, which has a method with a built-in
-    // timeout
+    // TODO: does this need a timeout?
     void TokenTracker::WaitForCompletion()
     {
-        std::unique_lock<std::mutex> lock(m_conditionLock);
+        // Trackers are waited on by background threads, such as the Recycler,
+        // so a short sleep between scans is preferable to notifications on
+        // the token release path.
         while (!IsComplete())
         {
-            m_condition.wait(lock);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
         }
     }
 }
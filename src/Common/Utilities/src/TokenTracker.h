@@ -20,27 +20,25 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
-
 #pragma once
 
 #include <atomic>                   // std::atomic embedded.
-#include <condition_variable>       // std::condition_variable embedded.
+#include <memory>                   // std::shared_ptr member.
 
 #include "BitFunnel/Index/Token.h"  // Inherits from ITokenTracker.
+#include "BitFunnel/NonCopyable.h"  // Base class.
 
 namespace BitFunnel
 {
+    class EpochTable;
+
     //*************************************************************************
     //
     // TokenTracker implements ITokenTracker and provides a way to track
-    // tokens issued before a particular cutoff serial number.
-    // TokenTracker gets the cutoff serial number and the number of tokens
-    // currently in-flight at construction. Whenever it receives a callback
-    // from a token with serial number less than the cutoff value, it
-    // decrements the remaining token count. When remaining token count reaches
-    // zero, tracker has finished tracking the tokens of interest.
-    // Consumers will consult this class whether the tracking is complete via
-    // IsComplete(non blocking) or WaitForCompletion(blocking).
+    // tokens issued before a particular cutoff epoch. Tracking is complete
+    // once no thread publishes an epoch at or below the cutoff in the
+    // EpochTable. Tokens do not notify the tracker, so completion is detected
+    // by scanning the EpochTable from IsComplete() and WaitForCompletion().
     //
     // Potentially there can be multiple trackers which track an overlapping
     // set of tokens. Even though the tokens can be returned in a different
@@ -53,20 +51,14 @@ namespace BitFunnel
     {
     public:
 
-        // Constructs a tracker to track tokens issued before a cut off serial
-        // number
-        TokenTracker(SerialNumber cutoffSerialNumber, int64_t remainingTokenCount);
+        // Constructs a tracker to track tokens that published an epoch at or
+        // below cutoffEpoch. The tracker shares ownership of the table so that
+        // it remains usable after its TokenManager has been destroyed.
+        TokenTracker(std::shared_ptr<EpochTable const> epochs,
+                     SerialNumber cutoffEpoch);
 
         ~TokenTracker();
 
-        // Token manager calls OnTokenComplete each time a token goes out of
-        // scope. This method returns true if it has collected enough
-        // notifications and is no longer interested in being notified. This
-        // means the tracker has fulfilled its job and all of the tokens in
-        // flight need no tracking from it.
-        // This method is thread safe.
-        bool OnTokenComplete(SerialNumber serialNumber);
-
         //
         // ITokenTracker API
         //
@@ -74,15 +66,13 @@ namespace BitFunnel
         virtual void WaitForCompletion() override;
 
     private:
+        std::shared_ptr<EpochTable const> m_epochs;
 
-        // Cutoff serial number of the tokens of interest. This is
-        // a non-inclusive range.
-        const SerialNumber m_cutoffSerialNumber;
-
-        // Number of tokens of interest which are still in flight.
-        std::atomic<int64_t> m_remainingTokenCount;
+        // Cutoff epoch of the tokens of interest. This is an inclusive bound.
+        const SerialNumber m_cutoffEpoch;
 
-        std::condition_variable m_condition;
-        std::mutex m_conditionLock;
+        // Completion is permanent, so once observed the table is no longer
+        // scanned.
+        mutable std::atomic<bool> m_isComplete;
     };
 }
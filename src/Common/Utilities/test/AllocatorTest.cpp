@@ -0,0 +1,99 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Utilities/Allocator.h"
+#include "LoggerInterfaces/Logging.h"
+#include "ThrowingLogger.h"
+
+
+namespace BitFunnel
+{
+    namespace AllocatorTest
+    {
+        TEST(Allocator, Alignment)
+        {
+            Allocator allocator(1024);
+
+            for (size_t size = 1; size < 20; ++size)
+            {
+                void* block = allocator.Allocate(size);
+                EXPECT_EQ(reinterpret_cast<uintptr_t>(block) % 8, 0u);
+            }
+        }
+
+
+        TEST(Allocator, GrowAndCoalesce)
+        {
+            const size_t c_bufferSize = 64;
+            Allocator allocator(c_bufferSize);
+            EXPECT_EQ(allocator.GetCapacity(), c_bufferSize);
+
+            // Overflow the first buffer several times.
+            std::vector<char*> blocks;
+            for (size_t i = 0; i < 40; ++i)
+            {
+                char* block = static_cast<char*>(allocator.Allocate(16));
+                memset(block, static_cast<int>(i), 16);
+                blocks.push_back(block);
+            }
+            const size_t capacity = allocator.GetCapacity();
+            EXPECT_GE(capacity, 40u * 16u);
+
+            // Blocks in earlier buffers are untouched by growth.
+            for (size_t i = 0; i < blocks.size(); ++i)
+            {
+                EXPECT_EQ(blocks[i][0], static_cast<char>(i));
+                allocator.Deallocate(blocks[i]);
+            }
+
+            // An allocation larger than the doubled buffer gets its own.
+            allocator.Allocate(4 * capacity);
+            const size_t grownCapacity = allocator.GetCapacity();
+            EXPECT_GE(grownCapacity, 5 * capacity);
+
+            // Reset() keeps the capacity in one buffer, so the same
+            // allocations no longer grow the arena.
+            allocator.Reset();
+            EXPECT_EQ(allocator.GetCapacity(), grownCapacity);
+            for (size_t i = 0; i < 40; ++i)
+            {
+                allocator.Allocate(16);
+            }
+            allocator.Allocate(4 * capacity);
+            EXPECT_EQ(allocator.GetCapacity(), grownCapacity);
+
+            ThrowingLogger logger;
+            Logging::RegisterLogger(&logger);
+
+            int local = 0;
+            EXPECT_ANY_THROW(allocator.Deallocate(&local));
+
+            Logging::RegisterLogger(nullptr);
+        }
+    }
+}
@@ -21,12 +21,16 @@
 // THE SOFTWARE.
 
 
+#include <future>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 
 #include "BitFunnel/Utilities/Factories.h"
 #include "BitFunnel/Utilities/IBlockAllocator.h"
+#include "BitFunnel/Utilities/Numa.h"
 #include "LoggerInterfaces/Logging.h"
 #include "ThrowingLogger.h"
 
@@ -42,7 +46,9 @@ namespace BitFunnel
 
             std::unique_ptr<IBlockAllocator> allocator(
                 Factories::CreateBlockAllocator(c_blockSize,
-                                                c_totalBlockCount));
+                                                c_totalBlockCount,
+                                                PageSize::Default,
+                                                c_anyNumaNode));
 
             EXPECT_EQ(c_blockSize, allocator->GetBlockSize());
 
@@ -100,7 +106,9 @@ namespace BitFunnel
 
             std::unique_ptr<IBlockAllocator> allocator(
                 Factories::CreateBlockAllocator(c_blockSize,
-                                                c_totalBlockCount));
+                                                c_totalBlockCount,
+                                                PageSize::Default,
+                                                c_anyNumaNode));
 
             // Requested block size should be rounded up to 8.
             EXPECT_EQ(8u, allocator->GetBlockSize());
@@ -123,7 +131,9 @@ namespace BitFunnel
 
             std::unique_ptr<IBlockAllocator> allocator(
                 Factories::CreateBlockAllocator(c_blockSize,
-                                                c_totalBlockCount));
+                                                c_totalBlockCount,
+                                                PageSize::Default,
+                                                c_anyNumaNode));
 
             uint64_t * block = allocator->AllocateBlock();
 
@@ -143,5 +153,200 @@ namespace BitFunnel
             allocator->ReleaseBlock(block + 2);
             allocator->ReleaseBlock(block + 4);
         }
+
+
+        TEST(BlockAllocator, Occupancy)
+        {
+            static const size_t c_blockSize = 64;
+            static const size_t c_maxBlockCount = 1 << 20;
+
+            std::unique_ptr<IBlockAllocator> allocator(
+                Factories::CreateBlockAllocator(c_blockSize,
+                                                c_maxBlockCount,
+                                                PageSize::Default,
+                                                c_anyNumaNode));
+
+            EXPECT_EQ(c_maxBlockCount, allocator->GetMaxBlockCount());
+
+            // Memory is not committed until blocks are used.
+            EXPECT_EQ(0u, allocator->GetCommittedBlockCount());
+            EXPECT_EQ(0u, allocator->GetInUseBlockCount());
+
+            std::vector<uint64_t*> blocks;
+            for (size_t i = 0; i < 10; ++i)
+            {
+                blocks.push_back(allocator->AllocateBlock());
+                *blocks.back() = i;
+            }
+
+            EXPECT_EQ(10u, allocator->GetInUseBlockCount());
+            EXPECT_GE(allocator->GetCommittedBlockCount(), 10u);
+            EXPECT_LT(allocator->GetCommittedBlockCount(), c_maxBlockCount);
+
+            for (size_t i = 0; i < 5; ++i)
+            {
+                allocator->ReleaseBlock(blocks.back());
+                blocks.pop_back();
+            }
+            EXPECT_EQ(5u, allocator->GetInUseBlockCount());
+
+            for (auto block : blocks)
+            {
+                allocator->ReleaseBlock(block);
+            }
+            EXPECT_EQ(0u, allocator->GetInUseBlockCount());
+        }
+
+
+        TEST(BlockAllocator, ReclaimMagazines)
+        {
+            static const size_t c_blockSize = 8;
+            static const size_t c_totalBlockCount = 4;
+
+            std::unique_ptr<IBlockAllocator> allocator(
+                Factories::CreateBlockAllocator(c_blockSize,
+                                                c_totalBlockCount,
+                                                PageSize::Default,
+                                                c_anyNumaNode));
+
+            std::vector<uint64_t*> blocks;
+            for (size_t i = 0; i < c_totalBlockCount; ++i)
+            {
+                blocks.push_back(allocator->AllocateBlock());
+            }
+
+            // Another thread releases the blocks into its own magazine and
+            // stays alive, so they are not returned to the free list.
+            std::promise<void> released;
+            std::promise<void> done;
+            std::thread thread([&]()
+            {
+                for (auto block : blocks)
+                {
+                    allocator->ReleaseBlock(block);
+                }
+                released.set_value();
+                done.get_future().wait();
+            });
+            released.get_future().wait();
+
+            for (size_t i = 0; i < c_totalBlockCount; ++i)
+            {
+                EXPECT_NE(allocator->AllocateBlock(), nullptr);
+            }
+            EXPECT_ANY_THROW(allocator->AllocateBlock());
+
+            done.set_value();
+            thread.join();
+        }
+
+
+        TEST(BlockAllocator, Multithreaded)
+        {
+            static const size_t c_blockSize = 32;
+            static const size_t c_threadCount = 4;
+            static const size_t c_heldBlockCount = 20;
+            static const size_t c_iterationCount = 1000;
+            static const size_t c_maxBlockCount =
+                c_threadCount * c_heldBlockCount + 1;
+
+            std::unique_ptr<IBlockAllocator> allocator(
+                Factories::CreateBlockAllocator(c_blockSize,
+                                                c_maxBlockCount,
+                                                PageSize::Default,
+                                                c_anyNumaNode));
+
+            // One block is allocated here and released on another thread.
+            uint64_t* const orphan = allocator->AllocateBlock();
+
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < c_threadCount; ++t)
+            {
+                threads.emplace_back([&allocator, orphan, t]()
+                {
+                    if (t == 0)
+                    {
+                        allocator->ReleaseBlock(orphan);
+                    }
+
+                    std::vector<uint64_t*> blocks;
+                    for (size_t i = 0; i < c_iterationCount; ++i)
+                    {
+                        // Each thread holds up to c_heldBlockCount blocks and
+                        // verifies that no other thread wrote to them.
+                        if (blocks.size() < c_heldBlockCount && (i % 3) != 2)
+                        {
+                            blocks.push_back(allocator->AllocateBlock());
+                            blocks.back()[0] = t;
+                            blocks.back()[3] = i;
+                        }
+                        else if (!blocks.empty())
+                        {
+                            uint64_t* block = blocks[i % blocks.size()];
+                            blocks[i % blocks.size()] = blocks.back();
+                            blocks.pop_back();
+                            EXPECT_EQ(t, block[0]);
+                            allocator->ReleaseBlock(block);
+                        }
+
+                        if ((i % 100) == 0)
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+
+                    for (auto block : blocks)
+                    {
+                        EXPECT_EQ(t, block[0]);
+                        allocator->ReleaseBlock(block);
+                    }
+                });
+            }
+
+            for (auto & thread : threads)
+            {
+                thread.join();
+            }
+
+            // Blocks cached by the exited threads are returned to the pool.
+            EXPECT_EQ(0u, allocator->GetInUseBlockCount());
+
+            std::vector<uint64_t*> blocks;
+            for (size_t i = 0; i < c_maxBlockCount; ++i)
+            {
+                blocks.push_back(allocator->AllocateBlock());
+            }
+            EXPECT_ANY_THROW(allocator->AllocateBlock());
+            EXPECT_EQ(c_maxBlockCount, allocator->GetInUseBlockCount());
+        }
+
+
+        TEST(BlockAllocator, HugePages)
+        {
+            static const size_t c_blockSize = 64;
+            static const size_t c_maxBlockCount = 1 << 16;
+
+            // Huge pages are used if the system has them, otherwise the
+            // allocator falls back to default pages. Either way, memory is
+            // committed in huge page multiples.
+            std::unique_ptr<IBlockAllocator> allocator(
+                Factories::CreateBlockAllocator(c_blockSize,
+                                                c_maxBlockCount,
+                                                PageSize::Huge2MB,
+                                                0));
+
+            EXPECT_EQ(0u, allocator->GetCommittedBlockCount());
+
+            uint64_t* block = allocator->AllocateBlock();
+            block[c_blockSize / sizeof(uint64_t) - 1] = 1;
+            EXPECT_EQ((1u << 21) / c_blockSize,
+                      allocator->GetCommittedBlockCount());
+
+            // Blocks are aligned to the huge page size from the start of the
+            // pool.
+            EXPECT_EQ(0u, reinterpret_cast<size_t>(block) % (1u << 21));
+
+            allocator->ReleaseBlock(block);
+        }
     }
 }
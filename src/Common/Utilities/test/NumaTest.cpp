@@ -0,0 +1,56 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Utilities/Numa.h"
+
+
+namespace BitFunnel
+{
+    namespace NumaTest
+    {
+        TEST(Numa, NodeCount)
+        {
+            EXPECT_GE(GetNumaNodeCount(), 1u);
+        }
+
+
+        TEST(Numa, BindThread)
+        {
+            // Binding happens on a separate thread so that the test runner's
+            // affinity is not changed.
+            std::thread thread([]()
+            {
+                EXPECT_FALSE(BindCurrentThreadToNumaNode(GetNumaNodeCount()));
+                EXPECT_FALSE(BindCurrentThreadToNumaNode(c_anyNumaNode));
+
+                // Binding to an existing node succeeds where the platform
+                // supports it, and must not fail in any other way.
+                BindCurrentThreadToNumaNode(0);
+            });
+            thread.join();
+        }
+    }
+}
@@ -30,7 +30,6 @@
 #include "LoggerInterfaces/ConsoleLogger.h"
 #include "LoggerInterfaces/Logging.h"
 #include "TokenManager.h"
-#include "TokenTracker.h"
 
 namespace BitFunnel
 {
@@ -107,69 +106,70 @@ namespace BitFunnel
         }
 
 
-        //*********************************************************************
-        //
-        // Test implementation of ITokenTracker that knows when it is supposed
-        // to receive token confirmations and when not.
-        //
-        //*********************************************************************
-        class TestTokenTracker : public ITokenTracker
+        TEST(TokenManager, NestedTokens)
         {
-        public:
-            TestTokenTracker(SerialNumber cutoffSerialNumber, unsigned remainingTokenCount);
-
-            bool OnTokenComplete(SerialNumber serialNumber);
-
-            //
-            // ITokenTracker API.
-            //
-            virtual bool IsComplete() const override;
-            virtual void WaitForCompletion() override;
-
-        private:
-            TokenTracker m_tracker;
-            const SerialNumber m_cutoffSerialNumber;
-            std::atomic<bool> m_isExpectingTokens;
-        };
-
+            TokenManager tokenManager;
 
-        TestTokenTracker::TestTokenTracker(SerialNumber cutoffSerialNumber, unsigned remainingTokenCount)
-            : m_tracker(cutoffSerialNumber, remainingTokenCount),
-              m_cutoffSerialNumber(cutoffSerialNumber),
-              m_isExpectingTokens(true)
-        {
+            std::shared_ptr<ITokenTracker> tracker;
+            {
+                const Token outer = tokenManager.RequestToken();
+                tracker = tokenManager.StartTracker();
+                {
+                    // A token nested in an older token on the same thread
+                    // keeps the thread at the older epoch.
+                    const Token inner = tokenManager.RequestToken();
+                    EXPECT_GT(inner.GetSerialNumber(), outer.GetSerialNumber());
+                }
+                EXPECT_FALSE(tracker->IsComplete());
+            }
+            EXPECT_TRUE(tracker->IsComplete());
         }
 
 
-        bool TestTokenTracker::OnTokenComplete(SerialNumber serialNumber)
+        TEST(TokenManager, TokensOnOtherThreads)
         {
-            // DESIGN NOTE: we can't ASSERT_TRUE here because that causes a void
-            // return, which conflicts with this function's type.
-            const bool isExpectingCallbacks = m_isExpectingTokens.load() != 0;
-            EXPECT_TRUE(isExpectingCallbacks)
-                << serialNumber
-                << "was not expected. Cutoff: "
-                << m_cutoffSerialNumber;
-
-            const bool hasTrackingComplete = m_tracker.OnTokenComplete(serialNumber);
-            if (hasTrackingComplete)
+            std::shared_ptr<ITokenTracker> tracker;
             {
-                m_isExpectingTokens = false;
-            }
+                TokenManager tokenManager;
 
-            return hasTrackingComplete;
-        }
+                std::atomic<bool> hasRequested(false);
+                std::atomic<bool> mayRelease(false);
+                std::thread holder([&]()
+                {
+                    const Token token = tokenManager.RequestToken();
+                    hasRequested = true;
+                    while (!mayRelease) {}
+                });
 
+                while (!hasRequested) {}
+                tracker = tokenManager.StartTracker();
 
-        bool TestTokenTracker::IsComplete() const
-        {
-            return m_tracker.IsComplete();
-        }
-
+                // Tokens requested after the tracker started don't delay it.
+                std::thread other([&]()
+                {
+                    const Token token = tokenManager.RequestToken();
+                    EXPECT_FALSE(tracker->IsComplete());
+                });
+                other.join();
+
+                EXPECT_FALSE(tracker->IsComplete());
+                mayRelease = true;
+                holder.join();
+                tracker->WaitForCompletion();
+                EXPECT_TRUE(tracker->IsComplete());
+
+                // Slots of exited threads are reused, so the next thread gets
+                // the first slot again.
+                std::thread third([&]()
+                {
+                    const Token token = tokenManager.RequestToken();
+                    EXPECT_LT(token.GetSerialNumber(), 1ll << 40);
+                });
+                third.join();
+            }
 
-        void TestTokenTracker::WaitForCompletion()
-        {
-            return m_tracker.WaitForCompletion();
+            // The tracker remains usable after its manager is destroyed.
+            EXPECT_TRUE(tracker->IsComplete());
         }
 
 
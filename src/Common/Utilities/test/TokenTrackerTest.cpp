@@ -21,13 +21,15 @@
 // THE SOFTWARE.
 
 
+#include <atomic>
 #include <memory>
+#include <thread>
 #include <vector>
 
 #include "gtest/gtest.h"
 
-#include "BitFunnel/Utilities/ITaskDistributor.h"
-#include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Exceptions.h"
+#include "EpochTable.h"
 #include "TokenTracker.h"
 
 namespace BitFunnel
@@ -36,159 +38,116 @@ namespace BitFunnel
     {
         TEST(TokenTracker, Basic)
         {
-            static const SerialNumber c_anyCutoffSerialNumber = 10;
-            static_assert(c_anyCutoffSerialNumber > 1,
-            "For test purposes c_anyCutoffSerialNumber must be greater than 1");
+            std::shared_ptr<EpochTable> epochs(new EpochTable());
+            EpochTable::Slot& slot0 = epochs->AcquireSlot();
+            EpochTable::Slot& slot1 = epochs->AcquireSlot();
+            EXPECT_NE(slot0.m_index, slot1.m_index);
 
-            static const unsigned c_anyInFlightTokenCount = 5;
-            static_assert(c_anyInFlightTokenCount > 1,
-            "For test purposes c_anyInFlightTokenCount must be greater than 1");
+            // Nothing in flight, so the tracker is already complete.
+            TokenTracker noTokensTracker(epochs, epochs->AdvanceEpoch());
+            EXPECT_TRUE(noTokensTracker.IsComplete());
 
-            TokenTracker tracker(c_anyCutoffSerialNumber,
-                                 c_anyInFlightTokenCount);
+            const SerialNumber serialNumber = epochs->Enter(slot0);
+            EXPECT_EQ(EpochTable::GetSlotIndex(serialNumber), slot0.m_index);
 
+            TokenTracker tracker(epochs, epochs->AdvanceEpoch());
             ASSERT_FALSE(tracker.IsComplete());
 
-            // Returning c_anyInFlightTokenCount - 1 tokens.
-            for (unsigned i = 0; i < c_anyInFlightTokenCount - 1; ++i)
-            {
-                // This should decrement the number of in flight tokens.
-                tracker.OnTokenComplete(c_anyCutoffSerialNumber - 1);
-            }
-
-            // One token is still in flight.
+            // A slot that entered after the tracker started is not of its
+            // interest.
+            epochs->Enter(slot1);
             ASSERT_FALSE(tracker.IsComplete());
 
-            // This is a token outside of our tracking interest, it will not
-            // affect tracking.
-            tracker.OnTokenComplete(c_anyCutoffSerialNumber + 1);
+            // Nested entries keep the slot at its original epoch.
+            epochs->Enter(slot0);
+            epochs->Exit(slot0);
             ASSERT_FALSE(tracker.IsComplete());
 
-            // Returning the last token, tracking should be complete.
-            tracker.OnTokenComplete(c_anyCutoffSerialNumber - 1);
+            epochs->Exit(slot0);
             ASSERT_TRUE(tracker.IsComplete());
-        }
-
 
-        // A wrapper class which is responsible of issuing multiple calls to
-        // the passed in's ITracker::OnTokenComplete.
-        class TokenDistributor : private NonCopyable
-        {
-        public:
-            // Creates tokenCount tasks for treadCount task processors and
-            // waits for all tasks to finish.
-            TokenDistributor(TokenTracker& tracker,
-                             unsigned threadCount,
-                             unsigned tokenCount);
-
-            ~TokenDistributor();
-
-            void WaitForCompletion();
-
-        private:
-
-            class TokenProcessor : public ITaskProcessor,
-                                   private NonCopyable
-            {
-            public:
+            epochs->Exit(slot1);
+            EXPECT_TRUE(epochs->IsIdle());
 
-                TokenProcessor(TokenTracker& tracker);
-
-                //
-                // ITaskProcessor API
-                //
-                virtual void ProcessTask(size_t taskId) override;
-                virtual void Finished() override;
-
-            private:
-                TokenTracker& m_tracker;
-
-            };
-
-            std::vector<std::unique_ptr<ITaskProcessor>> m_taskProcessors;
-            std::unique_ptr<ITaskDistributor> m_taskDistributor;
-        };
-
-
-        //*********************************************************************
-        //
-        // TokenProcessor.
-        //
-        //*********************************************************************
-        TokenDistributor::TokenProcessor::TokenProcessor(TokenTracker& tracker)
-            : m_tracker(tracker)
-        {
+            epochs->ReleaseSlot(slot1);
+            EXPECT_EQ(&epochs->AcquireSlot(), &slot1);
         }
 
 
-        void TokenDistributor::TokenProcessor::ProcessTask(size_t taskId)
-        {
-            const SerialNumber serialNumber = static_cast<SerialNumber>(taskId);
-            m_tracker.OnTokenComplete(serialNumber);
-        }
-
-
-        void TokenDistributor::TokenProcessor::Finished()
+        TEST(TokenTracker, MultithreadedTest)
         {
-            // No-op.
-        }
+            static const unsigned c_anyThreadCount = 8;
+            static const unsigned c_anyIterationCount = 100;
 
+            std::shared_ptr<EpochTable> epochs(new EpochTable());
 
-        //*********************************************************************
-        //
-        // TokenDistributor.
-        //
-        //*********************************************************************
-        TokenDistributor::TokenDistributor(TokenTracker& tracker,
-                                           unsigned threadCount,
-                                           unsigned tokenCount)
-        {
-            for (unsigned i = 0; i < threadCount; ++i)
+            // Each thread repeatedly enters and exits its slot while trackers
+            // are started from this thread. Every tracker must complete.
+            std::atomic<bool> isRunning(true);
+            std::atomic<unsigned> readyCount(0);
+            std::vector<std::thread> threads;
+            for (unsigned i = 0; i < c_anyThreadCount; ++i)
             {
-                m_taskProcessors.push_back(
-                    std::unique_ptr<ITaskProcessor>(new TokenProcessor(tracker)));
+                threads.push_back(std::thread([&]()
+                {
+                    EpochTable::Slot& slot = epochs->AcquireSlot();
+                    epochs->Enter(slot);
+                    ++readyCount;
+                    while (isRunning)
+                    {
+                        epochs->Exit(slot);
+                        std::this_thread::yield();
+                        epochs->Enter(slot);
+                    }
+                    epochs->Exit(slot);
+                    epochs->ReleaseSlot(slot);
+                }));
             }
 
-            m_taskDistributor =
-                Factories::CreateTaskDistributor(m_taskProcessors, tokenCount);
-        }
-
+            while (readyCount < c_anyThreadCount) {}
 
-        TokenDistributor::~TokenDistributor()
-        {
-        }
+            for (unsigned i = 0; i < c_anyIterationCount; ++i)
+            {
+                TokenTracker tracker(epochs, epochs->AdvanceEpoch());
+                tracker.WaitForCompletion();
+                ASSERT_TRUE(tracker.IsComplete());
+            }
 
+            isRunning = false;
+            for (auto & thread : threads)
+            {
+                thread.join();
+            }
 
-        void TokenDistributor::WaitForCompletion()
-        {
-            m_taskDistributor->WaitForCompletion();
+            EXPECT_TRUE(epochs->IsIdle());
         }
 
 
-        TEST(TokenTracker, MultithreadedTest)
+        TEST(TokenTracker, ManySlots)
         {
-            // We will create c_anyTotalTokenCount with serial numbers monotonically
-            // increasing starting from 0. Out of all of them, we are interested in
-            // tracking tokens with serial number cutoff of c_anyCutoffSerialNumber.
-            // There will be c_anyCutoffSerialNumber such tokens.
-            static const unsigned c_anyTotalTokenCount = 50;
-            static const SerialNumber c_anyCutoffSerialNumber = 10;
-
-            static const unsigned c_anyThreadCount = 20;
-
-            // Since serial numbers are monotonically increasing starting from 1,
-            // the number of tokens in flight is the same as the cutoff serial
-            // number.
-            TokenTracker tracker(c_anyCutoffSerialNumber,  c_anyCutoffSerialNumber);
-            ASSERT_FALSE(tracker.IsComplete());
+            std::shared_ptr<EpochTable> epochs(new EpochTable());
 
-            TokenDistributor distributor(tracker, c_anyThreadCount, c_anyTotalTokenCount);
-            distributor.WaitForCompletion();
-
-            ASSERT_TRUE(tracker.IsComplete());
+            // Slots are added block by block until the table is full.
+            std::vector<EpochTable::Slot*> slots;
+            for (size_t i = 0; i < EpochTable::c_maxSlotCount; ++i)
+            {
+                slots.push_back(&epochs->AcquireSlot());
+                ASSERT_EQ(slots.back()->m_index, i);
+            }
+            EXPECT_THROW(epochs->AcquireSlot(), RecoverableError);
+
+            // A slot in the last block still holds up trackers.
+            EpochTable::Slot& last = *slots.back();
+            epochs->Enter(last);
+            TokenTracker tracker(epochs, epochs->AdvanceEpoch());
+            EXPECT_FALSE(tracker.IsComplete());
+            epochs->Exit(last);
+            EXPECT_TRUE(tracker.IsComplete());
+
+            // Released slots are reused before the table grows.
+            epochs->ReleaseSlot(*slots[EpochTable::c_blockSlotCount]);
+            EXPECT_EQ(&epochs->AcquireSlot(),
+                      slots[EpochTable::c_blockSlotCount]);
         }
-
-        // TODO: create a test that actually calls .IsComplete, etc., from
-        // other threads
-   }
+    }
 }
@@ -136,6 +136,38 @@ namespace BitFunnel
     }
 
 
+    DocTableDescriptor::DocTableDescriptor(std::istream& input)
+        : m_bufferOffset(StreamUtilities::ReadField<ptrdiff_t>(input)),
+          m_capacity(StreamUtilities::ReadField<DocIndex>(input)),
+          m_variableSizeBlobCount(StreamUtilities::ReadField<unsigned>(input)),
+          m_fixedSizeBlobOffsets(StreamUtilities::ReadVector<unsigned>(input)),
+          m_bytesPerItem(StreamUtilities::ReadField<size_t>(input))
+    {
+    }
+
+
+    void DocTableDescriptor::Write(std::ostream& output) const
+    {
+        // WARNING: Field write order must be consistent with the order the
+        // fields are read in the std::istream constructor.
+        StreamUtilities::WriteField<ptrdiff_t>(output, m_bufferOffset);
+        StreamUtilities::WriteField<DocIndex>(output, m_capacity);
+        StreamUtilities::WriteField<unsigned>(output, m_variableSizeBlobCount);
+        StreamUtilities::WriteVector<unsigned>(output, m_fixedSizeBlobOffsets);
+        StreamUtilities::WriteField<size_t>(output, m_bytesPerItem);
+    }
+
+
+    bool DocTableDescriptor::IsCompatibleWith(DocTableDescriptor const & other) const
+    {
+        return m_bufferOffset == other.m_bufferOffset
+            && m_capacity == other.m_capacity
+            && m_variableSizeBlobCount == other.m_variableSizeBlobCount
+            && m_fixedSizeBlobOffsets == other.m_fixedSizeBlobOffsets
+            && m_bytesPerItem == other.m_bytesPerItem;
+    }
+
+
     void DocTableDescriptor::Initialize(void* sliceBuffer) const
     {
         char* const buffer = reinterpret_cast<char*>(sliceBuffer) +
@@ -232,6 +264,25 @@ namespace BitFunnel
     }
 
 
+    void DocTableDescriptor::MoveItem(void* fromBuffer,
+                                      DocIndex fromIndex,
+                                      void* toBuffer,
+                                      DocIndex toIndex) const
+    {
+        memcpy(GetItem(toBuffer, toIndex),
+               GetItem(fromBuffer, fromIndex),
+               m_bytesPerItem);
+
+        for (unsigned blob = 0; blob < m_variableSizeBlobCount; ++blob)
+        {
+            VariableSizeBlob& blobData =
+                GetVariableBlobRef(fromBuffer, fromIndex, blob);
+            blobData.m_data = nullptr;
+            blobData.m_size = 0;
+        }
+    }
+
+
     void DocTableDescriptor::SetDocId(void* sliceBuffer,
                                       DocIndex index,
                                       DocId id) const
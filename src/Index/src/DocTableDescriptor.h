@@ -88,6 +88,11 @@ namespace BitFunnel
         // Slice can create a cached copy of the DocTableDescriptor from Shard.
         DocTableDescriptor(DocTableDescriptor const & other);
 
+        // Constructs a DocTableDescriptor from the compatibility information
+        // previously persisted with Write(). Used when loading Slices to
+        // verify that the stream's layout matches the current one.
+        DocTableDescriptor(std::istream& input);
+
         // Initializes the DocTable in the block of memory at sliceBuffer +
         // bufferOffset, where bufferOffset was the value passed to the
         // constructor. This block must be large enough to hold the DocTable, as
@@ -104,6 +109,11 @@ namespace BitFunnel
         // written out along with the whole slice buffer.
         void WriteVariableSizeBlobs(void* sliceBuffer, std::ostream& output) const;
 
+        // Writes the layout of the DocTable to the stream. The result can be
+        // read back with the std::istream constructor and compared with
+        // IsCompatibleWith().
+        void Write(std::ostream& output) const;
+
         // Releases memory held by the variable sized blobs.
         void Cleanup(void* sliceBuffer) const;
 
@@ -125,6 +135,15 @@ namespace BitFunnel
                                DocIndex index,
                                FixedSizeBlobId blob) const;
 
+        // Moves the item at fromIndex in fromBuffer to toIndex in toBuffer.
+        // Ownership of the variable sized blobs passes to the destination
+        // item, and the source item is left without blobs so that Cleanup()
+        // on fromBuffer does not release them. Used when compacting slices.
+        void MoveItem(void* fromBuffer,
+                      DocIndex fromIndex,
+                      void* toBuffer,
+                      DocIndex toIndex) const;
+
         // Returns the document's unique identifier.
         DocId GetDocId(void* sliceBuffer, DocIndex index) const;
 
@@ -145,8 +164,9 @@ namespace BitFunnel
                                 FixedSizeBlobId blob);
 
         // Returns true if the given DocTableDescriptor is data-compatible with
-        // this instance. Used when loading Slices from the stream.
-        // TODO: confirm our compatibility policy.
+        // this instance. Used when loading Slices from the stream. Two
+        // descriptors are compatible when they describe exactly the same
+        // layout within the slice buffer.
         bool IsCompatibleWith(DocTableDescriptor const & other) const;
 
         // Represents a descriptor for a variable size blob which contains the
@@ -27,21 +27,94 @@
 #include "DocumentFrequencyTable.h"
 #include "DocumentFrequencyTableBuilder.h"
 #include "IndexedIdfTable.h"
+#include "TermCountBuffer.h"
 
 
 namespace BitFunnel
 {
+    DocumentFrequencyTableBuilder::DocumentFrequencyTableBuilder(size_t maxBytes)
+    {
+        if (maxBytes != 0)
+        {
+            m_sketch.reset(new TermCountSketch(maxBytes));
+        }
+    }
+
+
     void DocumentFrequencyTableBuilder::OnDocumentEnter()
     {
+        TermCountBuffer* buffer = TermCountBuffer::GetAttached();
+        if (buffer != nullptr)
+        {
+            buffer->OnDocumentEnter(*this);
+            return;
+        }
+
         std::lock_guard<std::mutex> lock(m_lock);
-        m_cumulativeTermCounts.push_back(m_termCounts.size());
+        m_cumulativeTermCounts.push_back(GetUniqueTermCount());
     }
 
 
     void DocumentFrequencyTableBuilder::OnTerm(Term t)
     {
+        TermCountBuffer* buffer = TermCountBuffer::GetAttached();
+        if (buffer != nullptr)
+        {
+            buffer->OnTerm(*this, t);
+            return;
+        }
+
         std::lock_guard<std::mutex> lock(m_lock);
-        ++m_termCounts[t];
+        if (m_sketch.get() != nullptr)
+        {
+            m_sketch->Add(t, 1);
+        }
+        else
+        {
+            ++m_termCounts[t];
+        }
+    }
+
+
+    void DocumentFrequencyTableBuilder::Merge(size_t documentCount,
+                                              TermCounts const & termCounts)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        for (auto const & entry : termCounts)
+        {
+            if (m_sketch.get() != nullptr)
+            {
+                m_sketch->Add(entry.first, entry.second);
+            }
+            else
+            {
+                m_termCounts[entry.first] += entry.second;
+            }
+        }
+
+        const size_t uniqueTermCount = GetUniqueTermCount();
+        m_cumulativeTermCounts.insert(m_cumulativeTermCounts.end(),
+                                      documentCount,
+                                      uniqueTermCount);
+    }
+
+
+    size_t DocumentFrequencyTableBuilder::GetDocumentCount() const
+    {
+        return m_cumulativeTermCounts.size();
+    }
+
+
+    size_t DocumentFrequencyTableBuilder::GetTermCount(Term const & term) const
+    {
+        if (m_sketch.get() != nullptr)
+        {
+            return m_sketch->GetEstimate(term);
+        }
+
+        auto it = m_termCounts.find(term);
+        return (it == m_termCounts.end()) ? 0 : it->second;
     }
 
 
@@ -54,9 +127,11 @@ namespace BitFunnel
 
         // For each term count record, compute the document frequency then
         // add to entries if frequency is above threshold.
-        for (auto const & entry : m_termCounts)
+        for (auto const & entry : GetTermCounts())
         {
-            double frequency = static_cast<double>(entry.second) / m_cumulativeTermCounts.size();
+            // Approximate counts may exceed the document count.
+            const size_t count = (std::min)(entry.second, GetDocumentCount());
+            double frequency = static_cast<double>(count) / m_cumulativeTermCounts.size();
             if (frequency >= truncateBelowFrequency)
             {
                 table.AddEntry(DocumentFrequencyTable::Entry(entry.first, frequency));
@@ -66,7 +141,7 @@ namespace BitFunnel
         table.Write(output, termToText);
 
         std::cout << "Raw DocumentFrequencyTable count: "
-                  << m_termCounts.size()
+                  << GetUniqueTermCount()
                   << std::endl
                   << "Saved DocumentFrequencyTable count: "
                   << table.size()
@@ -78,29 +153,26 @@ namespace BitFunnel
         std::ostream& output,
         double truncateBelowFrequency) const
     {
-        typedef std::pair<Term::Hash, Term::IdfX10> Entry;
-        std::vector<Entry> entries;
+        std::vector<IndexedIdfTable::Entry> entries;
 
         // For each term count record, compute the document frequency then
         // add to entries if frequency is above threshold.
-        for (auto const & entry : m_termCounts)
+        for (auto const & entry : GetTermCounts())
         {
-            double frequency = static_cast<double>(entry.second) / m_cumulativeTermCounts.size();
+            // Approximate counts may exceed the document count.
+            const size_t count = (std::min)(entry.second, GetDocumentCount());
+            double frequency = static_cast<double>(count) / m_cumulativeTermCounts.size();
             if (frequency >= truncateBelowFrequency)
             {
                 const Term::Hash hash = entry.first.GetRawHash();
                 const Term::IdfX10 idf =
                     Term::ComputeIdfX10(frequency, Term::c_maxIdfX10Value);
 
-                entries.push_back(std::make_pair(hash, idf));
+                entries.push_back({ hash, idf });
             }
         }
 
-        IndexedIdfTable::WriteHeader(output, entries.size());
-        for (auto entry : entries)
-        {
-            IndexedIdfTable::WriteEntry(output, entry.first, entry.second);
-        }
+        IndexedIdfTable::Write(output, entries);
 
         std::cout << "IndexedIdfTable count: "
                   << entries.size()
@@ -115,4 +187,25 @@ namespace BitFunnel
             output << i << "," << m_cumulativeTermCounts[i] << std::endl;
         }
     }
+
+
+    DocumentFrequencyTableBuilder::TermCounts const &
+        DocumentFrequencyTableBuilder::GetTermCounts() const
+    {
+        if (m_sketch.get() != nullptr)
+        {
+            return m_sketch->GetHeavyHitters();
+        }
+        return m_termCounts;
+    }
+
+
+    size_t DocumentFrequencyTableBuilder::GetUniqueTermCount() const
+    {
+        if (m_sketch.get() != nullptr)
+        {
+            return m_sketch->GetDistinctCount();
+        }
+        return m_termCounts.size();
+    }
 }
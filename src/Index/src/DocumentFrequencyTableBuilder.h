@@ -22,12 +22,14 @@
 
 #pragma once
 
-#include <iosfwd>           // std::ostream parameter.
-#include <mutex>            // std::mutex embedded.
-#include <unordered_map>    // std::unordered_map member.
-#include <vector>           // std::vector member.
+#include <iosfwd>               // std::ostream parameter.
+#include <memory>               // std::unique_ptr member.
+#include <mutex>                // std::mutex embedded.
+#include <unordered_map>        // std::unordered_map member.
+#include <vector>               // std::vector member.
 
-#include "BitFunnel/Term.h" // Term and Term::Hasher template parameters.
+#include "BitFunnel/Term.h"     // Term and Term::Hasher template parameters.
+#include "TermCountSketch.h"    // std::unique_ptr template parameter.
 
 
 namespace BitFunnel
@@ -57,10 +59,27 @@ namespace BitFunnel
     // should not be called again until all terms in the current document have
     // been recorded via calls to OnTerm().
     //
+    // When the calling thread has a TermCountBuffer attached, OnDocumentEnter()
+    // and OnTerm() are recorded in the buffer and reach the builder through
+    // Merge() without contending for the builder's lock. The Cumulative Term
+    // Count table then advances once per merged batch, so every document in
+    // a batch is reported with the unique term count at the end of the batch.
+    //
+    // In approximate mode the counts are kept in a TermCountSketch of bounded
+    // size. Only the sketch's heavy hitters are written to the Document
+    // Frequency Table, their frequencies may be overestimated, and the unique
+    // term counts are estimates.
+    //
     //*************************************************************************
     class DocumentFrequencyTableBuilder
     {
     public:
+        typedef std::unordered_map<Term, size_t, Term::Hasher> TermCounts;
+
+        // Counts terms exactly when maxBytes is zero. Otherwise counts terms
+        // approximately in about maxBytes of memory.
+        explicit DocumentFrequencyTableBuilder(size_t maxBytes);
+
         // This method is threadsafe in the presense of multiple writers
         // (ie. callers to OnDocumentEnter() and OnTerm()).
         void OnDocumentEnter();
@@ -69,6 +88,17 @@ namespace BitFunnel
         // (ie. callers to OnDocumentEnter() and OnTerm()).
         void OnTerm(Term t);
 
+        // Adds the counts for documentCount documents, gathered by a
+        // TermCountBuffer. This method is threadsafe in the presense of
+        // multiple writers.
+        void Merge(size_t documentCount, TermCounts const & termCounts);
+
+        // Returns the number of documents recorded.
+        size_t GetDocumentCount() const;
+
+        // Returns the exact or estimated number of documents containing term.
+        size_t GetTermCount(Term const & term) const;
+
         // Writes the Document Frequency Table to a stream. The file format is
         // a sequence of entries, one per line. Each entry consists of the
         // following comma-separated fields:
@@ -107,8 +137,17 @@ namespace BitFunnel
         void WriteCumulativeTermCounts(std::ostream& output) const;
 
     private:
+        // Returns the terms that can be written with their counts.
+        TermCounts const & GetTermCounts() const;
+
+        // Returns the exact or estimated number of unique terms.
+        size_t GetUniqueTermCount() const;
+
         std::mutex m_lock;
         std::vector<size_t> m_cumulativeTermCounts;
-        std::unordered_map<Term, size_t, Term::Hasher> m_termCounts;
+        TermCounts m_termCounts;
+
+        // Non-null in approximate mode, in which m_termCounts is unused.
+        std::unique_ptr<TermCountSketch> m_sketch;
     };
 }
@@ -25,6 +25,7 @@
 #include "DocumentHandleInternal.h"
 #include "DocTableDescriptor.h"
 #include "Shard.h"
+#include "TermHashBuffer.h"
 
 
 namespace BitFunnel
@@ -101,6 +102,13 @@ namespace BitFunnel
 
     void DocumentHandle::AddPosting(Term const & term)
     {
+        // Documents ingested for a ForwardIndex also record their term hashes.
+        TermHashBuffer* hashes = TermHashBuffer::GetAttached();
+        if (hashes != nullptr)
+        {
+            hashes->OnTerm(term);
+        }
+
         m_slice->GetShard().AddPosting(term, m_index, m_slice->GetSliceBuffer());
     }
 
@@ -210,6 +218,13 @@ namespace BitFunnel
 
 
     void DocumentHandleInternal::Activate()
+    {
+        ActivateMoved();
+        m_slice->GetShard().TemporaryRecordDocument();
+    }
+
+
+    void DocumentHandleInternal::ActivateMoved()
     {
         const RowId documentActiveRow =
             m_slice->GetShard().GetDocumentActiveRowId();
@@ -218,7 +233,5 @@ namespace BitFunnel
         rowTable.SetBit(m_slice->GetSliceBuffer(),
                         documentActiveRow.GetIndex(),
                         m_index);
-
-        m_slice->GetShard().TemporaryRecordDocument();
     }
 }
@@ -73,6 +73,10 @@ namespace BitFunnel
         // document's content is fully ingested.
         void Activate();
 
+        // Like Activate(), for a document that moved here from another
+        // column. The document is not recorded as a new one.
+        void ActivateMoved();
+
         // Represent the value that the default constructor assigns to the instances
         // of DocumentHandle.
         static const DocIndex c_invalidDocIndex =
@@ -21,22 +21,37 @@
 // THE SOFTWARE.
 
 
+#include <map>
+
 #include "CsvTsv/Csv.h"
 #include "DocumentHistogramBuilder.h"
 
 namespace BitFunnel
 {
+    // Assigns each thread a bin the first time it adds a document.
+    static std::atomic<size_t> g_nextThreadIndex(0);
+    static thread_local size_t g_threadIndex = g_nextThreadIndex++;
+
+
     DocumentHistogramBuilder::DocumentHistogramBuilder()
-        : m_totalCount(0)
+        : m_bins(c_binCount),
+          m_totalCount(0)
+    {
+    }
+
+
+    DocumentHistogramBuilder::Bin& DocumentHistogramBuilder::GetBin()
     {
+        return m_bins[g_threadIndex % c_binCount];
     }
 
 
     void DocumentHistogramBuilder::AddDocument(size_t postingCount)
     {
+        Bin& bin = GetBin();
         {
-            const std::lock_guard<std::mutex> lock(m_lock);
-            ++m_hist[postingCount];
+            const std::lock_guard<std::mutex> lock(bin.m_lock);
+            ++bin.m_hist[postingCount];
         }
         m_totalCount += postingCount;
     }
@@ -50,22 +65,34 @@ namespace BitFunnel
 
     size_t DocumentHistogramBuilder::GetValue(size_t postingCount) const
     {
-        const std::lock_guard<std::mutex> lock(m_lock);
-
-        const auto kvPair = m_hist.find(postingCount);
-        if (kvPair != m_hist.end())
+        size_t count = 0;
+        for (auto const & bin : m_bins)
         {
-            return kvPair->second;
-        }
-        else
-        {
-            return 0;
+            const std::lock_guard<std::mutex> lock(bin.m_lock);
+
+            const auto kvPair = bin.m_hist.find(postingCount);
+            if (kvPair != bin.m_hist.end())
+            {
+                count += kvPair->second;
+            }
         }
+
+        return count;
     }
 
 
     void DocumentHistogramBuilder::Write(std::ostream& output) const
     {
+        // Merge the bins in order of posting count.
+        std::map<size_t, size_t> hist;
+        for (auto const & bin : m_bins)
+        {
+            for (auto const & kvPair : bin.m_hist)
+            {
+                hist[kvPair.first] += kvPair.second;
+            }
+        }
+
         CsvTsv::CsvTableFormatter formatter(output);
         CsvTsv::TableWriter writer(formatter);
 
@@ -83,7 +110,7 @@ namespace BitFunnel
         writer.DefineColumn(numDocs);
         writer.WritePrologue();
 
-        for (const auto & kvPairs : m_hist)
+        for (const auto & kvPairs : hist)
         {
             postingCount = kvPairs.first;
             numDocs = kvPairs.second;
@@ -24,8 +24,9 @@
 
 #include <atomic>   // std::atomic member
 #include <iosfwd>   // std::ostream parameter
-#include <map>      // std::map member
 #include <mutex>    // std::mutex member
+#include <unordered_map>    // std::unordered_map member
+#include <vector>   // std::vector member
 
 #include "BitFunnel/NonCopyable.h"
 
@@ -36,6 +37,16 @@
 
 namespace BitFunnel
 {
+    //*************************************************************************
+    //
+    // DocumentHistogramBuilder
+    //
+    // Counts the documents with each posting count. Each ingestion thread
+    // counts into a bin of its own, and the bins are merged when the
+    // histogram is read. Threads beyond c_binCount share bins, so their
+    // counts remain correct, but they may contend for the bin's lock.
+    //
+    //*************************************************************************
     class DocumentHistogramBuilder : public NonCopyable
     {
     public:
@@ -54,8 +65,23 @@ namespace BitFunnel
 
 
     private:
-        std::map<size_t, size_t> m_hist;
-        mutable std::mutex m_lock;
+        class Bin
+        {
+        public:
+            // Only contended when more than c_binCount threads add
+            // documents. Made mutable to allow using it from const
+            // functions.
+            mutable std::mutex m_lock;
+
+            std::unordered_map<size_t, size_t> m_hist;
+        };
+
+        // Returns the bin of the calling thread.
+        Bin& GetBin();
+
+        static const size_t c_binCount = 64;
+
+        std::vector<Bin> m_bins;
 
         std::atomic<size_t> m_totalCount;
     };
@@ -24,38 +24,95 @@
 
 #include "BitFunnel/Exceptions.h"
 #include "DocumentMap.h"
+#include "FibonacciHash.h"
 
 
 namespace BitFunnel
 {
-    void DocumentMap::Add(DocumentHandleInternal handle)
+    DocumentMap::DocumentMap()
+      : m_stripes(c_stripeCount)
     {
-        std::lock_guard<std::mutex> lock(m_lock);
+    }
+
 
+    size_t DocumentMap::GetStripeIndex(DocId id)
+    {
+        // DocIds are often sequential, so the stripe comes from the high
+        // bits of the mixed DocId.
+        return static_cast<size_t>(FibonacciMix(id) >> (64 - c_stripeBits));
+    }
+
+
+    void DocumentMap::Add(DocumentHandleInternal handle)
+    {
         DocId id = handle.GetDocId();
+        Stripe & stripe = m_stripes[GetStripeIndex(id)];
+
+        std::lock_guard<std::mutex> lock(stripe.m_lock);
 
         // Verify that this DocId hasn't been added previously.
-        auto it = m_docIdToDocHandle.find(id);
-        if (it != m_docIdToDocHandle.end())
+        auto it = stripe.m_docIdToDocHandle.find(id);
+        if (it != stripe.m_docIdToDocHandle.end())
         {
             std::stringstream message;
             message << "Ingestor::Add(): DocId " << id << " has already been added.";
 
             RecoverableError error(message.str());
+            throw error;
         }
 
-        m_docIdToDocHandle.insert(std::make_pair(id, handle));
+        stripe.m_docIdToDocHandle.insert(std::make_pair(id, handle));
+    }
+
+
+    void DocumentMap::AddRange(std::vector<DocumentHandleInternal> const & handles)
+    {
+        std::vector<std::vector<DocumentHandleInternal>> byStripe(c_stripeCount);
+        for (auto const & handle : handles)
+        {
+            byStripe[GetStripeIndex(handle.GetDocId())].push_back(handle);
+        }
+
+        for (size_t i = 0; i < c_stripeCount; ++i)
+        {
+            if (byStripe[i].empty())
+            {
+                continue;
+            }
+
+            Stripe & stripe = m_stripes[i];
+            std::lock_guard<std::mutex> lock(stripe.m_lock);
+
+            stripe.m_docIdToDocHandle.reserve(stripe.m_docIdToDocHandle.size() +
+                                              byStripe[i].size());
+            for (auto const & handle : byStripe[i])
+            {
+                if (!stripe.m_docIdToDocHandle.insert(
+                        std::make_pair(handle.GetDocId(), handle)).second)
+                {
+                    std::stringstream message;
+                    message << "DocumentMap::AddRange(): DocId "
+                            << handle.GetDocId()
+                            << " has already been added.";
+
+                    RecoverableError error(message.str());
+                    throw error;
+                }
+            }
+        }
     }
 
 
     DocumentHandleInternal DocumentMap::Find(DocId id, bool& isFound) const
     {
-        std::lock_guard<std::mutex> lock(m_lock);
+        Stripe const & stripe = m_stripes[GetStripeIndex(id)];
+
+        std::lock_guard<std::mutex> lock(stripe.m_lock);
 
         DocumentHandleInternal handle;
 
-        auto it = m_docIdToDocHandle.find(id);
-        if (it == m_docIdToDocHandle.end())
+        auto it = stripe.m_docIdToDocHandle.find(id);
+        if (it == stripe.m_docIdToDocHandle.end())
         {
             isFound = false;
         }
@@ -69,25 +126,58 @@ namespace BitFunnel
     }
 
 
-    bool DocumentMap::Delete(DocId id)
+    bool DocumentMap::Replace(DocumentHandleInternal oldHandle,
+                              DocumentHandleInternal newHandle)
     {
-        std::lock_guard<std::mutex> lock(m_lock);
+        DocId id = oldHandle.GetDocId();
+        Stripe & stripe = m_stripes[GetStripeIndex(id)];
+
+        std::lock_guard<std::mutex> lock(stripe.m_lock);
 
-        auto it = m_docIdToDocHandle.find(id);
-        bool found = (it != m_docIdToDocHandle.end());
+        auto it = stripe.m_docIdToDocHandle.find(id);
+        bool found = (it != stripe.m_docIdToDocHandle.end()) &&
+                     (&it->second.GetSlice() == &oldHandle.GetSlice()) &&
+                     (it->second.GetIndex() == oldHandle.GetIndex());
         if (found)
         {
-            m_docIdToDocHandle.erase(it);
+            oldHandle.Expire();
+            newHandle.ActivateMoved();
+            it->second = newHandle;
         }
 
         return found;
     }
 
 
+    DocumentHandleInternal DocumentMap::Delete(DocId id, bool& isFound)
+    {
+        Stripe & stripe = m_stripes[GetStripeIndex(id)];
+
+        std::lock_guard<std::mutex> lock(stripe.m_lock);
+
+        DocumentHandleInternal handle;
+
+        auto it = stripe.m_docIdToDocHandle.find(id);
+        isFound = (it != stripe.m_docIdToDocHandle.end());
+        if (isFound)
+        {
+            handle = it->second;
+            stripe.m_docIdToDocHandle.erase(it);
+        }
+
+        return handle;
+    }
+
+
     size_t DocumentMap::size() const
     {
-        std::lock_guard<std::mutex> lock(m_lock);
+        size_t count = 0;
+        for (auto const & stripe : m_stripes)
+        {
+            std::lock_guard<std::mutex> lock(stripe.m_lock);
+            count += stripe.m_docIdToDocHandle.size();
+        }
 
-        return m_docIdToDocHandle.size();
+        return count;
     }
 }
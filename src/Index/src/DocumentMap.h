@@ -24,6 +24,7 @@
 
 #include <mutex>                        // std::mutex member.
 #include <unordered_map>                // std::unordered_map member.
+#include <vector>                       // std::vector parameter.
 
 #include "BitFunnel/BitFunnelTypes.h"   // For DocId parameter.
 #include "BitFunnel/NonCopyable.h"      // Base class.
@@ -32,14 +33,33 @@
 
 namespace BitFunnel
 {
+    //*************************************************************************
+    //
+    // DocumentMap
+    //
+    // Maps DocIds to the DocumentHandleInternals of the columns holding them.
+    // The map is split into c_stripeCount stripes selected by a hash of the
+    // DocId. Each stripe has its own lock, so operations on different DocIds
+    // rarely contend with each other. All methods are thread safe.
+    //
+    //*************************************************************************
     class DocumentMap : NonCopyable
     {
     public:
+        DocumentMap();
+
         // Adds a new (DocId, DocumentHandleInternal) pair to the map. DocId is
         // obtained from DocumentHandleInternal::GetDocId(). Throws if the map
         // already contains an entry for a given DocId.
         void Add(DocumentHandleInternal value);
 
+        // Adds a (DocId, DocumentHandleInternal) pair for each handle, taking
+        // each stripe's lock once. Intended for rebuilding the map when
+        // slices are restored. Throws if a DocId is already in the map or
+        // appears twice in handles, in which case some of the other handles
+        // may already have been added.
+        void AddRange(std::vector<DocumentHandleInternal> const & handles);
+
         // Attempts to find the DocumentHandleInternal corresponding to the
         // specified DocId value. If such a DocumentHandleInternal exists, a
         // copy will be returned after setting isFound to true. Otherwise
@@ -51,19 +71,43 @@ namespace BitFunnel
         // reference.
         DocumentHandleInternal Find(DocId id, bool& isFound) const;
 
-        // Deletes an entry which corresponds to the given DocId. If no such entry
-        // exists, the request is ignored and the function returns false.
-        // Returns true otherwise.
-        bool Delete(DocId id);
+        // Moves a document from the column of oldHandle to the inactive
+        // column of newHandle, but only if the entry for its DocId still
+        // refers to oldHandle. Under the stripe lock, expires oldHandle,
+        // activates newHandle and updates the entry. A concurrent query may
+        // miss the document but never sees it in both columns, and a
+        // concurrent Delete() expires whichever column the entry holds.
+        // Returns false, leaving the map and both columns unchanged, if the
+        // entry was deleted or refers to some other column.
+        bool Replace(DocumentHandleInternal oldHandle,
+                     DocumentHandleInternal newHandle);
+
+        // Deletes the entry which corresponds to the given DocId and returns
+        // the handle it held after setting isFound to true. If no such entry
+        // exists, isFound is set to false and the return value is undefined.
+        // When several threads delete the same DocId, exactly one of them
+        // finds it.
+        DocumentHandleInternal Delete(DocId id, bool& isFound);
 
         // Returns the number of DocIds in the map.
         size_t size() const;
 
     private:
-        // Lock protecting operations on m_docIdToHandle.
-        // Made mutable to allow using it from const functions.
-        mutable std::mutex m_lock;
+        class Stripe
+        {
+        public:
+            // Lock protecting operations on m_docIdToDocHandle.
+            // Made mutable to allow using it from const functions.
+            mutable std::mutex m_lock;
+
+            std::unordered_map<DocId, DocumentHandleInternal> m_docIdToDocHandle;
+        };
+
+        static size_t GetStripeIndex(DocId id);
+
+        static const size_t c_stripeBits = 6;
+        static const size_t c_stripeCount = 1ull << c_stripeBits;
 
-        std::unordered_map<DocId, DocumentHandleInternal> m_docIdToDocHandle;
+        std::vector<Stripe> m_stripes;
     };
 }
@@ -0,0 +1,43 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include <stdint.h>     // uint64_t parameter.
+
+
+namespace BitFunnel
+{
+    // 2^64 divided by the golden ratio, rounded to an odd number. Because it
+    // is odd, multiplying by it is a bijection on 64-bit values. Because its
+    // bits are close to random, the multiplication moves the entropy of the
+    // low order bits into the high order bits.
+    static const uint64_t c_fibonacciMultiplier = 0x9e3779b97f4a7c15ull;
+
+    // Spreads value so that its high order bits can select a bucket, a
+    // stripe, or a row. Sequential values map to well separated results.
+    inline uint64_t FibonacciMix(uint64_t value)
+    {
+        return value * c_fibonacciMultiplier;
+    }
+}
@@ -0,0 +1,384 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#pragma once
+
+#include <algorithm>                    // std::sort used in template.
+#include <cstring>                      // std::memcmp used in template.
+#include <istream>                      // std::istream parameter.
+#include <ostream>                      // std::ostream parameter.
+#include <stdint.h>                     // uint32_t, uint64_t members.
+#include <type_traits>                  // std::is_trivially_copyable.
+#include <vector>                       // std::vector member.
+
+#include "BitFunnel/Exceptions.h"       // RecoverableError thrown.
+#include "BitFunnel/NonCopyable.h"      // Base class.
+#include "BitFunnel/Term.h"             // Term::Hash key.
+#include "BitFunnel/Utilities/StreamUtilities.h"  // ReadBytes/WriteBytes.
+#include "FibonacciHash.h"             // FibonacciMix used in template.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // FlatHashTable
+    //
+    // A read-only map from Term::Hash to a small, trivially copyable VALUE,
+    // stored as a single position independent image:
+    //
+    //   Header     entry count and directory size.
+    //   Directory  (2^bits + 1) uint32_t offsets into the entry array, one
+    //              bucket per value of the top bits of the mixed hash.
+    //   Entries    (hash, value) pairs grouped by bucket.
+    //
+    // The number of buckets is the smallest power of two no smaller than the
+    // number of entries, so a lookup reads one directory slot and scans a
+    // bucket that holds about one entry on average. Because the image has no
+    // pointers, it can be written to a stream as is and later used in place
+    // from a memory mapped file via Attach().
+    //
+    //*************************************************************************
+    template <typename VALUE>
+    class FlatHashTable : NonCopyable
+    {
+    public:
+        static_assert(std::is_trivially_copyable<VALUE>::value,
+                      "FlatHashTable: VALUE must be trivially copyable.");
+
+        struct Entry
+        {
+            Term::Hash m_hash;
+            VALUE m_value;
+        };
+
+        // Constructs an empty table.
+        FlatHashTable();
+
+        // Replaces the contents of the table with the supplied entries, which
+        // may be in any order. Throws RecoverableError if two entries have
+        // the same hash.
+        void Build(std::vector<Entry> const & entries);
+
+        // Replaces the contents of the table with an image previously written
+        // by Write().
+        void Read(std::istream& input);
+
+        // Replaces the contents of the table with the image at the start of
+        // buffer, without copying it when buffer is suitably aligned. The
+        // buffer must outlive the table. Returns the size of the image in
+        // bytes.
+        size_t Attach(char const * buffer, size_t size);
+
+        void Write(std::ostream& output) const;
+
+        // Returns a pointer to the value associated with hash or nullptr if
+        // hash is not in the table.
+        VALUE const * Find(Term::Hash hash) const;
+
+        size_t size() const;
+
+        bool operator==(FlatHashTable const & other) const;
+
+    private:
+        struct Header
+        {
+            uint64_t m_entryCount;
+            uint64_t m_bucketBits;
+        };
+
+        // Spreads low order hash bits into the high order bits used to select
+        // a bucket. Distinct hashes remain distinct.
+        static uint64_t Mix(Term::Hash hash);
+
+        static size_t GetImageSize(Header const & header);
+        static size_t GetDirectoryOffset();
+        static size_t GetEntriesOffset(Header const & header);
+
+        // Validates the header at the start of buffer and returns the size of
+        // the image it describes.
+        static size_t CheckHeader(char const * buffer, size_t size);
+
+        // Points m_directory, m_entries, etc. into image after verifying
+        // that the directory offsets are in range.
+        void Bind(char const * image);
+
+        // Backing store for images that are built, read from a stream or
+        // copied from an unaligned buffer.
+        std::vector<uint64_t> m_storage;
+
+        char const * m_image;
+        uint64_t m_entryCount;
+        unsigned m_shift;
+        uint32_t const * m_directory;
+        Entry const * m_entries;
+    };
+
+
+    template <typename VALUE>
+    FlatHashTable<VALUE>::FlatHashTable()
+    {
+        Build(std::vector<Entry>());
+    }
+
+
+    template <typename VALUE>
+    void FlatHashTable<VALUE>::Build(std::vector<Entry> const & entries)
+    {
+        Header header;
+        header.m_entryCount = entries.size();
+        header.m_bucketBits = 1;
+        while ((1ull << header.m_bucketBits) < entries.size())
+        {
+            ++header.m_bucketBits;
+        }
+        const unsigned shift = 64u - static_cast<unsigned>(header.m_bucketBits);
+
+        std::vector<Entry> sorted(entries);
+        std::sort(sorted.begin(),
+                  sorted.end(),
+                  [](Entry const & a, Entry const & b)
+                  {
+                      return Mix(a.m_hash) < Mix(b.m_hash);
+                  });
+        for (size_t i = 1; i < sorted.size(); ++i)
+        {
+            if (sorted[i].m_hash == sorted[i - 1].m_hash)
+            {
+                RecoverableError error("FlatHashTable::Build(): duplicate hash.");
+                throw error;
+            }
+        }
+
+        // Zero filled so that padding within Entry is deterministic.
+        const size_t imageSize = GetImageSize(header);
+        std::vector<uint64_t> storage((imageSize + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+        char* image = reinterpret_cast<char*>(storage.data());
+
+        *reinterpret_cast<Header*>(image) = header;
+
+        uint32_t* directory =
+            reinterpret_cast<uint32_t*>(image + GetDirectoryOffset());
+        Entry* destination =
+            reinterpret_cast<Entry*>(image + GetEntriesOffset(header));
+
+        const size_t bucketCount = 1ull << header.m_bucketBits;
+        size_t entry = 0;
+        for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+        {
+            directory[bucket] = static_cast<uint32_t>(entry);
+            while (entry < sorted.size() &&
+                   (Mix(sorted[entry].m_hash) >> shift) == bucket)
+            {
+                destination[entry].m_hash = sorted[entry].m_hash;
+                destination[entry].m_value = sorted[entry].m_value;
+                ++entry;
+            }
+        }
+        directory[bucketCount] = static_cast<uint32_t>(entry);
+
+        // Swapping vectors does not move their buffers.
+        Bind(reinterpret_cast<char const *>(storage.data()));
+        m_storage.swap(storage);
+    }
+
+
+    template <typename VALUE>
+    void FlatHashTable<VALUE>::Read(std::istream& input)
+    {
+        Header header = StreamUtilities::ReadField<Header>(input);
+        const size_t imageSize =
+            CheckHeader(reinterpret_cast<char const *>(&header), ~0ull);
+
+        std::vector<uint64_t> storage((imageSize + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+        char* image = reinterpret_cast<char*>(storage.data());
+        *reinterpret_cast<Header*>(image) = header;
+        StreamUtilities::ReadBytes(input,
+                                   image + sizeof(Header),
+                                   imageSize - sizeof(Header));
+
+        Bind(reinterpret_cast<char const *>(storage.data()));
+        m_storage.swap(storage);
+    }
+
+
+    template <typename VALUE>
+    size_t FlatHashTable<VALUE>::Attach(char const * buffer, size_t size)
+    {
+        const size_t imageSize = CheckHeader(buffer, size);
+
+        if (reinterpret_cast<uintptr_t>(buffer) % alignof(Entry) == 0)
+        {
+            Bind(buffer);
+            m_storage.clear();
+            m_storage.shrink_to_fit();
+        }
+        else
+        {
+            std::vector<uint64_t> storage((imageSize + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+            std::memcpy(storage.data(), buffer, imageSize);
+            Bind(reinterpret_cast<char const *>(storage.data()));
+            m_storage.swap(storage);
+        }
+
+        return imageSize;
+    }
+
+
+    template <typename VALUE>
+    void FlatHashTable<VALUE>::Write(std::ostream& output) const
+    {
+        StreamUtilities::WriteBytes(output,
+                                    m_image,
+                                    GetImageSize(*reinterpret_cast<Header const *>(m_image)));
+    }
+
+
+    template <typename VALUE>
+    VALUE const * FlatHashTable<VALUE>::Find(Term::Hash hash) const
+    {
+        const uint64_t bucket = Mix(hash) >> m_shift;
+        const uint32_t end = m_directory[bucket + 1];
+        for (uint32_t i = m_directory[bucket]; i < end; ++i)
+        {
+            if (m_entries[i].m_hash == hash)
+            {
+                return &m_entries[i].m_value;
+            }
+        }
+        return nullptr;
+    }
+
+
+    template <typename VALUE>
+    size_t FlatHashTable<VALUE>::size() const
+    {
+        return m_entryCount;
+    }
+
+
+    template <typename VALUE>
+    bool FlatHashTable<VALUE>::operator==(FlatHashTable const & other) const
+    {
+        const size_t imageSize =
+            GetImageSize(*reinterpret_cast<Header const *>(m_image));
+        const size_t otherSize =
+            GetImageSize(*reinterpret_cast<Header const *>(other.m_image));
+
+        return (imageSize == otherSize) &&
+            (std::memcmp(m_image, other.m_image, imageSize) == 0);
+    }
+
+
+    template <typename VALUE>
+    uint64_t FlatHashTable<VALUE>::Mix(Term::Hash hash)
+    {
+        return FibonacciMix(hash);
+    }
+
+
+    template <typename VALUE>
+    size_t FlatHashTable<VALUE>::GetImageSize(Header const & header)
+    {
+        return GetEntriesOffset(header) + header.m_entryCount * sizeof(Entry);
+    }
+
+
+    template <typename VALUE>
+    size_t FlatHashTable<VALUE>::GetDirectoryOffset()
+    {
+        return sizeof(Header);
+    }
+
+
+    template <typename VALUE>
+    size_t FlatHashTable<VALUE>::GetEntriesOffset(Header const & header)
+    {
+        const size_t directoryBytes =
+            ((1ull << header.m_bucketBits) + 1) * sizeof(uint32_t);
+        const size_t alignment = alignof(Entry);
+        return (GetDirectoryOffset() + directoryBytes + alignment - 1)
+            / alignment * alignment;
+    }
+
+
+    template <typename VALUE>
+    size_t FlatHashTable<VALUE>::CheckHeader(char const * buffer, size_t size)
+    {
+        if (buffer == nullptr || size < sizeof(Header))
+        {
+            RecoverableError error("FlatHashTable: truncated header.");
+            throw error;
+        }
+
+        Header header;
+        std::memcpy(&header, buffer, sizeof(Header));
+
+        // The directory uses 32-bit offsets.
+        if (header.m_bucketBits < 1 ||
+            header.m_bucketBits > 32 ||
+            header.m_entryCount > (1ull << header.m_bucketBits))
+        {
+            RecoverableError error("FlatHashTable: bad header.");
+            throw error;
+        }
+
+        const size_t imageSize = GetImageSize(header);
+        if (imageSize > size)
+        {
+            RecoverableError error("FlatHashTable: truncated image.");
+            throw error;
+        }
+
+        return imageSize;
+    }
+
+
+    template <typename VALUE>
+    void FlatHashTable<VALUE>::Bind(char const * image)
+    {
+        Header const & header = *reinterpret_cast<Header const *>(image);
+        uint32_t const * directory =
+            reinterpret_cast<uint32_t const *>(image + GetDirectoryOffset());
+
+        const size_t bucketCount = 1ull << header.m_bucketBits;
+        for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+        {
+            if (directory[bucket] > directory[bucket + 1])
+            {
+                RecoverableError error("FlatHashTable: bad directory.");
+                throw error;
+            }
+        }
+        if (directory[bucketCount] != header.m_entryCount)
+        {
+            RecoverableError error("FlatHashTable: bad directory.");
+            throw error;
+        }
+
+        m_image = image;
+        m_entryCount = header.m_entryCount;
+        m_shift = 64u - static_cast<unsigned>(header.m_bucketBits);
+        m_directory = directory;
+        m_entries =
+            reinterpret_cast<Entry const *>(image + GetEntriesOffset(header));
+    }
+}
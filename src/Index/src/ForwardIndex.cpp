@@ -0,0 +1,119 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+#include "BitFunnel/Index/ForwardIndex.h"
+#include "LoggerInterfaces/Logging.h"
+
+
+namespace BitFunnel
+{
+    ForwardIndex::ForwardIndex(IDocumentDataSchema & schema)
+      : m_blob(schema.RegisterVariableSizeBlob())
+    {
+    }
+
+
+    void ForwardIndex::Write(DocumentHandle document,
+                             std::vector<Term::Hash> & hashes) const
+    {
+        std::sort(hashes.begin(), hashes.end());
+        hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+        LogAssertB(hashes.size() <= (std::numeric_limits<uint32_t>::max)(),
+                   "Too many terms for forward index.");
+
+        Term::Hash previous = 0;
+        Term::Hash maxDelta = 0;
+        for (auto hash : hashes)
+        {
+            maxDelta = (std::max)(maxDelta, hash - previous);
+            previous = hash;
+        }
+
+        size_t width = 1;
+        while (width < sizeof(Term::Hash) && (maxDelta >> (8 * width)) != 0)
+        {
+            ++width;
+        }
+
+        const size_t byteCount =
+            c_headerBytes + hashes.size() * width + sizeof(Term::Hash) - width;
+        char * blob = static_cast<char *>(
+            document.AllocateVariableSizeBlob(m_blob, byteCount));
+
+        const uint32_t count = static_cast<uint32_t>(hashes.size());
+        memcpy(blob, &count, sizeof(count));
+        blob[sizeof(count)] = static_cast<char>(width);
+
+        // Deltas are stored little endian, so the low order bytes of each
+        // delta are copied.
+        char * deltas = blob + c_headerBytes;
+        previous = 0;
+        for (auto hash : hashes)
+        {
+            const Term::Hash delta = hash - previous;
+            memcpy(deltas, &delta, width);
+            deltas += width;
+            previous = hash;
+        }
+        memset(deltas, 0, sizeof(Term::Hash) - width);
+    }
+
+
+    bool ForwardIndex::Read(DocumentHandle document,
+                            std::vector<Term::Hash> & hashes) const
+    {
+        hashes.clear();
+
+        char const * blob =
+            static_cast<char const *>(document.GetVariableSizeBlob(m_blob));
+        if (blob == nullptr)
+        {
+            return false;
+        }
+
+        uint32_t count;
+        memcpy(&count, blob, sizeof(count));
+        const size_t width = static_cast<uint8_t>(blob[sizeof(count)]);
+        const Term::Hash mask = (width == sizeof(Term::Hash)) ?
+            (std::numeric_limits<Term::Hash>::max)() :
+            (1ull << (8 * width)) - 1;
+
+        hashes.resize(count);
+        char const * deltas = blob + c_headerBytes;
+        Term::Hash hash = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            Term::Hash delta;
+            memcpy(&delta, deltas, sizeof(delta));
+            hash += delta & mask;
+            hashes[i] = hash;
+            deltas += width;
+        }
+
+        return true;
+    }
+}
@@ -21,7 +21,6 @@
 // THE SOFTWARE.
 
 #include "BitFunnel/Index/Factories.h"
-#include "BitFunnel/Utilities/StreamUtilities.h"
 #include "IndexedIdfTable.h"
 
 
@@ -49,6 +48,15 @@ namespace BitFunnel
     }
 
 
+    std::unique_ptr<IIndexedIdfTable>
+        Factories::CreateIndexedIdfTable(std::unique_ptr<IMappedFile> file,
+                                         Term::IdfX10 defaultIdf)
+    {
+        return std::unique_ptr<IIndexedIdfTable>(
+            new IndexedIdfTable(std::move(file), defaultIdf));
+    }
+
+
     //*************************************************************************
     //
     // IndexedIdfTable
@@ -67,38 +75,35 @@ namespace BitFunnel
         : m_defaultIdf(defaultIdf)
     {
         // TODO: Should defaultIdf be part of the file?
-
-        size_t count = StreamUtilities::ReadField<size_t>(input);
-
-        for (size_t i = 0; i < count; ++i)
-        {
-            const Term::Hash hash(StreamUtilities::ReadField<Term::Hash>(input));
-            const Term::IdfX10 idf(StreamUtilities::ReadField<Term::IdfX10>(input));
-            m_terms.insert(std::make_pair(hash, idf));
-        }
+        m_terms.Read(input);
     }
 
 
-    void IndexedIdfTable::WriteHeader(std::ostream& output, size_t entryCount)
+    IndexedIdfTable::IndexedIdfTable(std::unique_ptr<IMappedFile> file,
+                                     Term::IdfX10 defaultIdf)
+        : m_defaultIdf(defaultIdf),
+          m_file(std::move(file))
     {
-        // TODO: Use FileHeader and version.
-        StreamUtilities::WriteField<size_t>(output, entryCount);
+        m_terms.Attach(m_file->GetBuffer(), m_file->GetSize());
     }
 
 
-    void IndexedIdfTable::WriteEntry(std::ostream& output, Term::Hash hash, Term::IdfX10 idf)
+    void IndexedIdfTable::Write(std::ostream& output,
+                                std::vector<Entry> const & entries)
     {
-        StreamUtilities::WriteField<Term::Hash>(output, hash);
-        StreamUtilities::WriteField<Term::IdfX10>(output, idf);
+        // TODO: Use FileHeader and version.
+        FlatHashTable<Term::IdfX10> table;
+        table.Build(entries);
+        table.Write(output);
     }
 
 
     Term::IdfX10 IndexedIdfTable::GetIdf(Term::Hash hash) const
     {
-        auto it = m_terms.find(hash);
-        if (it != m_terms.end())
+        Term::IdfX10 const * idf = m_terms.Find(hash);
+        if (idf != nullptr)
         {
-            return (*it).second;
+            return *idf;
         }
         else
         {
@@ -23,9 +23,12 @@
 #pragma once
 
 #include <iosfwd>                               // std::istream parameter.
-#include <unordered_map>                        // Embedded.
+#include <memory>                               // std::unique_ptr member.
+#include <vector>                               // std::vector parameter.
 
+#include "BitFunnel/Configuration/IMappedFile.h"    // std::unique_ptr template parameter.
 #include "BitFunnel/Index/IIndexedIdfTable.h"   // Base class.
+#include "FlatHashTable.h"                      // FlatHashTable member.
 
 
 namespace BitFunnel
@@ -38,9 +41,15 @@ namespace BitFunnel
 
         IndexedIdfTable(std::istream& input, Term::IdfX10 defaultIdf);
 
-        static void WriteHeader(std::ostream& output, size_t entryCount);
-        static void WriteEntry(std::ostream& output,
-                               Term::Hash hash, Term::IdfX10 idf);
+        // Uses the contents of a file previously written by Write() in place.
+        IndexedIdfTable(std::unique_ptr<IMappedFile> file,
+                        Term::IdfX10 defaultIdf);
+
+        typedef FlatHashTable<Term::IdfX10>::Entry Entry;
+
+        // Writes a table containing entries, which may be in any order.
+        static void Write(std::ostream& output,
+                          std::vector<Entry> const & entries);
 
         //
         // IIndexedIdfTable methods.
@@ -50,6 +59,9 @@ namespace BitFunnel
     private:
         Term::IdfX10 m_defaultIdf;
 
-        std::unordered_map<Term::Hash, Term::IdfX10> m_terms;
+        // When the table is loaded from a mapped file, m_terms refers to
+        // memory owned by m_file.
+        std::unique_ptr<IMappedFile> m_file;
+        FlatHashTable<Term::IdfX10> m_terms;
     };
 }
@@ -26,14 +26,19 @@
 #include "BitFunnel/Exceptions.h"
 #include "BitFunnel/IFileManager.h"
 #include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/ForwardIndex.h"
 #include "BitFunnel/Index/IDocument.h"
 #include "BitFunnel/Index/IRecycler.h"
 #include "BitFunnel/Index/ISliceBufferAllocator.h"
 #include "BitFunnel/Index/ITermTableCollection.h"
 #include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/Numa.h"
 #include "DocumentHandleInternal.h"
 #include "Ingestor.h"
 #include "LoggerInterfaces/Logging.h"
+#include "RowBitBuffer.h"
+#include "TermCountBuffer.h"
+#include "TermHashBuffer.h"
 #include "TermToText.h"
 
 
@@ -44,13 +49,17 @@ namespace BitFunnel
                               IRecycler& recycler,
                               ITermTableCollection const & termTables,
                               IShardDefinition const & shardDefinition,
-                              ISliceBufferAllocator& sliceBufferAllocator)
+                              ISliceBufferAllocator& sliceBufferAllocator,
+                              size_t statisticsBytes,
+                              ForwardIndex const * forwardIndex)
     {
         return std::unique_ptr<IIngestor>(new Ingestor(docDataSchema,
                                                        recycler,
                                                        termTables,
                                                        shardDefinition,
-                                                       sliceBufferAllocator));
+                                                       sliceBufferAllocator,
+                                                       statisticsBytes,
+                                                       forwardIndex));
     }
 
 
@@ -58,20 +67,30 @@ namespace BitFunnel
                        IRecycler& recycler,
                        ITermTableCollection const & termTables,
                        IShardDefinition const & shardDefinition,
-                       ISliceBufferAllocator& sliceBufferAllocator)
+                       ISliceBufferAllocator& sliceBufferAllocator,
+                       size_t statisticsBytes,
+                       ForwardIndex const * forwardIndex)
         : m_recycler(recycler),
           m_shardDefinition(shardDefinition),
+          m_forwardIndex(forwardIndex),
           // TODO: This member is now redundant (with m_documentMap).
           // But see issue 389. Because of that issue, m_documentCount is not
           // always equal to m_documentMap.size().
           m_documentCount(0),
           m_totalSourceByteSize(0),
           m_documentMap(new DocumentMap()),
+          m_groups(new GroupList()),
+          m_openGroupDocuments(nullptr),
+          m_openGroup(0),
           m_documentCache(new DocumentCache()),
           m_tokenManager(Factories::CreateTokenManager()),
           m_sliceBufferAllocator(sliceBufferAllocator)
     {
         // Create shards based on shard definition in m_shardDefinition..
+        // Shards are bound round robin to the NUMA nodes that have their own
+        // slice buffer pools.
+        const unsigned numaNodeCount = m_sliceBufferAllocator.GetNumaNodeCount();
+
         for (ShardId shardId = 0; shardId < m_shardDefinition.GetShardCount(); ++shardId)
         {
             std::cout
@@ -93,7 +112,11 @@ namespace BitFunnel
                               termTables.GetTermTable(shardId),
                               docDataSchema,
                               m_sliceBufferAllocator,
-                              m_sliceBufferAllocator.GetSliceBufferSize())));
+                              m_sliceBufferAllocator.GetSliceBufferSize(),
+                              statisticsBytes,
+                              (numaNodeCount > 1) ?
+                                  shardId % numaNodeCount :
+                                  c_anyNumaNode)));
         }
     }
 
@@ -113,7 +136,11 @@ namespace BitFunnel
             << static_cast<double>(m_totalSourceByteSize) / m_documentCount
             << std::endl
             << "Total bytes read: " << m_totalSourceByteSize << std::endl
-            << "Posting count: " << m_histogram.GetPostingCount() << std::endl;
+            << "Posting count: " << m_histogram.GetPostingCount() << std::endl
+            << "Slice buffers in use: "
+            << m_sliceBufferAllocator.GetInUseBufferCount() << std::endl
+            << "Slice buffers committed: "
+            << m_sliceBufferAllocator.GetCommittedBufferCount() << std::endl;
 
         if (time > 0)
         {
@@ -168,6 +195,43 @@ namespace BitFunnel
     }
 
 
+    void Ingestor::TemporaryReadAllSlices(IFileManager& fileManager,
+                                          bool memoryMap)
+    {
+        for (size_t shard = 0; shard < m_shards.size(); ++shard)
+        {
+            for (size_t i = 0; fileManager.IndexSlice(shard, i).Exists(); ++i)
+            {
+                Slice* slice = nullptr;
+                if (memoryMap)
+                {
+                    auto name = fileManager.IndexSlice(shard, i).GetName();
+                    slice = m_shards[shard]->MapSlice(name.c_str());
+                }
+                else
+                {
+                    auto input = fileManager.IndexSlice(shard, i).OpenForRead();
+                    slice = m_shards[shard]->LoadSlice(*input);
+                }
+
+                // Register the documents that were serving when the slice
+                // was written.
+                std::vector<DocumentHandleInternal> handles;
+                for (DocIndex index = 0; index < m_shards[shard]->GetSliceCapacity(); ++index)
+                {
+                    DocumentHandleInternal handle(slice, index);
+                    if (handle.IsActive())
+                    {
+                        handles.push_back(handle);
+                    }
+                }
+                m_documentMap->AddRange(handles);
+                m_documentCount += handles.size();
+            }
+        }
+    }
+
+
     IDocumentCache & Ingestor::GetDocumentCache() const
     {
         return *m_documentCache;
@@ -175,6 +239,155 @@ namespace BitFunnel
 
 
     void Ingestor::Add(DocId id, IDocument const & document)
+    {
+        const ShardId shardId = RecordDocument(document);
+        DocumentHandleInternal handle = m_shards[shardId]->AllocateDocument(id);
+
+        IngestDocument(handle, document);
+
+        handle.Activate();
+        handle.GetSlice().CommitDocument();
+        AddToDocumentMap(handle);
+    }
+
+
+    void Ingestor::AddBatch(std::vector<std::pair<DocId, IDocument const *>> const & documents)
+    {
+        std::vector<DocumentHandleInternal> handles(documents.size());
+
+        // Group the documents by shard, so that each shard can reserve
+        // columns for its documents in runs of consecutive DocIndexes.
+        std::vector<std::vector<size_t>> documentsByShard(m_shards.size());
+        for (size_t i = 0; i < documents.size(); ++i)
+        {
+            const ShardId shardId = RecordDocument(*documents[i].second);
+            documentsByShard[shardId].push_back(i);
+        }
+
+        try
+        {
+            for (ShardId shardId = 0; shardId < m_shards.size(); ++shardId)
+            {
+                auto const & positions = documentsByShard[shardId];
+                for (size_t i = 0; i < positions.size(); )
+                {
+                    DocIndex first;
+                    DocIndex count;
+                    Slice* slice =
+                        m_shards[shardId]->AllocateDocuments(positions.size() - i,
+                                                             first,
+                                                             count);
+                    for (DocIndex index = first;
+                         index < first + count;
+                         ++index, ++i)
+                    {
+                        handles[positions[i]] =
+                            DocumentHandleInternal(slice,
+                                                   index,
+                                                   documents[positions[i]].first);
+                    }
+                }
+            }
+
+            {
+                // Postings from the entire batch are accumulated in the
+                // buffer and reach the slices when it is merged. The buffer
+                // is detached by its destructor if ingestion throws.
+                // Statistics are buffered the same way so that ingestion
+                // threads don't contend for the DocumentFrequencyTableBuilder.
+                RowBitBuffer buffer;
+                buffer.Attach();
+                TermCountBuffer termCounts;
+                termCounts.Attach();
+
+                for (size_t i = 0; i < documents.size(); ++i)
+                {
+                    IngestDocument(handles[i], *documents[i].second);
+                }
+
+                termCounts.Detach();
+                termCounts.Merge();
+                buffer.Detach();
+                buffer.Merge();
+            }
+        }
+        catch (...)
+        {
+            // The columns reserved so far would stay pending commit, which
+            // keeps their slices from ever being fully expired or recycled.
+            // Commit them while they are still inactive and expire them.
+            for (auto & handle : handles)
+            {
+                if (handle.GetIndex() == DocumentHandleInternal::c_invalidDocIndex)
+                {
+                    continue;
+                }
+
+                try
+                {
+                    handle.GetSlice().CommitDocument();
+                    handle.Expire();
+                }
+                catch (...)
+                {
+                    LogB(Logging::Error,
+                         "Ingestor::AddBatch",
+                         "Error while cleaning up after AddBatch operation failed.",
+                         "");
+                }
+            }
+
+            throw;
+        }
+
+        // Commit each run of documents that share a slice with a single
+        // atomic operation.
+        for (size_t i = 0; i < handles.size(); )
+        {
+            Slice& slice = handles[i].GetSlice();
+            DocIndex count = 0;
+            for (; i < handles.size() && &handles[i].GetSlice() == &slice; ++i)
+            {
+                handles[i].Activate();
+                ++count;
+            }
+            slice.CommitDocuments(count);
+        }
+
+        for (size_t i = 0; i < handles.size(); ++i)
+        {
+            try
+            {
+                AddToDocumentMap(handles[i]);
+            }
+            catch (...)
+            {
+                // AddToDocumentMap() expired handles[i]. The documents after
+                // it are already active but can never be found in the
+                // DocumentMap, so expire them too rather than leave them to
+                // be returned by queries and never deleted.
+                for (size_t j = i + 1; j < handles.size(); ++j)
+                {
+                    try
+                    {
+                        handles[j].Expire();
+                    }
+                    catch (...)
+                    {
+                        LogB(Logging::Error,
+                             "Ingestor::AddBatch",
+                             "Error while cleaning up after AddBatch operation failed.",
+                             "");
+                    }
+                }
+
+                throw;
+            }
+        }
+    }
+
+
+    ShardId Ingestor::RecordDocument(IDocument const & document)
     {
         ++m_documentCount;
         m_totalSourceByteSize += document.GetSourceByteSize();
@@ -182,30 +395,47 @@ namespace BitFunnel
         // Add postingCount to the DocumentHistogramBuilder
         m_histogram.AddDocument(document.GetPostingCount());
 
-        // Choose correct shard and then allocate handle.
-        ShardId shardId = m_shardDefinition.GetShard(document.GetPostingCount());
-        DocumentHandleInternal handle = m_shards[shardId]->AllocateDocument(id);
-
         // std::cout
-        //    << "IIngestor::Add("
-        //    << id << "):"
+        //    << "IIngestor::Add():"
         //    << " postingCount: " << document.GetPostingCount()
-        //    << " shardId: " << shardId
+        //    << " shardId: " << m_shardDefinition.GetShard(document.GetPostingCount())
         //    << std::endl;
 
-        document.Ingest(handle);
+        return m_shardDefinition.GetShard(document.GetPostingCount());
+    }
 
 
-        // TODO: REVIEW: Why are Activate() and CommitDocument() separate operations?
-        handle.Activate();
-        handle.GetSlice().CommitDocument();
+    void Ingestor::IngestDocument(DocumentHandleInternal handle,
+                                  IDocument const & document)
+    {
+        if (m_forwardIndex == nullptr)
+        {
+            document.Ingest(handle);
+        }
+        else
+        {
+            TermHashBuffer hashes;
+            hashes.Attach();
+            document.Ingest(handle);
+            hashes.Detach();
+
+            // The hashes are written before the document is committed, so
+            // every active document has its forward index entry.
+            m_forwardIndex->Write(handle, hashes.GetHashes());
+        }
+    }
+
 
+    void Ingestor::AddToDocumentMap(DocumentHandleInternal handle)
+    {
         // TODO: schedule for backup if Slice is full.
         // Consider if Slice::CommitDocument itself may schedule a backup when full.
 
         try
         {
-            m_documentMap->Add(handle);
+            DocumentMap& documents = (m_openGroupDocuments != nullptr) ?
+                *m_openGroupDocuments : *m_documentMap;
+            documents.Add(handle);
             // TODO: Remove this debugging code. Related to issue 389.
             //if (m_documentMap->size() != m_documentCount)
             //{
@@ -264,18 +494,13 @@ namespace BitFunnel
     {
         const Token token = m_tokenManager->RequestToken();
 
-        // Protecting from concurrent Delete operations. Even though individual
-        // function calls here are thread-safe, Delete on the same value of DocId
-        // is not, since it modifies the counters of the expired documents in the
-        // Slice.
-        std::lock_guard<std::mutex> lock(m_deleteDocumentLock);
-
+        // DocumentMap::Delete() removes the entry atomically, so concurrent
+        // Delete operations on the same DocId expire the document only once.
         bool isFound;
-        DocumentHandleInternal location = m_documentMap->Find(id, isFound);
+        DocumentHandleInternal location = Remove(id, isFound);
 
         if (isFound)
         {
-            m_documentMap->Delete(id);
             location.Expire();
         }
 
@@ -288,6 +513,104 @@ namespace BitFunnel
     }
 
 
+    size_t Ingestor::CompactSlices(double maxLiveFraction)
+    {
+        std::lock_guard<std::mutex> compactionLock(m_compactionLock);
+
+        size_t movedCount = 0;
+        for (auto & shard : m_shards)
+        {
+            const Token token = m_tokenManager->RequestToken();
+
+            std::vector<Slice*> sources =
+                shard->AcquireSparseSlices(maxLiveFraction);
+
+            // Compaction only pays off if the live documents fit in fewer
+            // slices than they occupy now.
+            const DocIndex capacity = shard->GetSliceCapacity();
+            size_t liveCount = 0;
+            for (auto source : sources)
+            {
+                liveCount += capacity - source->GetExpiredCount();
+            }
+
+            if ((liveCount + capacity - 1) / capacity < sources.size())
+            {
+                Slice* destination = nullptr;
+                for (auto source : sources)
+                {
+                    for (DocIndex from = 0; from < capacity; ++from)
+                    {
+                        DocumentHandleInternal oldHandle(source, from);
+                        if (!oldHandle.IsActive())
+                        {
+                            continue;
+                        }
+
+                        DocIndex to;
+                        if (destination == nullptr ||
+                            !destination->TryAllocateDocument(to))
+                        {
+                            if (destination != nullptr)
+                            {
+                                Slice::DecrementRefCount(destination);
+                            }
+                            destination = shard->CreateCompactionSlice();
+                            LogAssertB(destination->TryAllocateDocument(to),
+                                       "Newly allocated slice has no space.");
+                        }
+
+                        // Copy and commit the column while the new column is
+                        // still inactive. Then DocumentMap::Replace() expires
+                        // the old column, activates the new one and hands the
+                        // DocId over to it under its stripe lock. If that
+                        // fails, typically because a concurrent Delete()
+                        // removed the entry and expired the old column, the
+                        // DocTable item goes back to the old column and the
+                        // new column is expired instead.
+                        shard->CopyColumnRows(*source, from, *destination, to);
+                        shard->GetDocTable().MoveItem(source->GetSliceBuffer(),
+                                                      from,
+                                                      destination->GetSliceBuffer(),
+                                                      to);
+                        destination->CommitDocument();
+
+                        DocumentHandleInternal newHandle(destination, to);
+                        const bool isMoved =
+                            m_documentMap->Replace(oldHandle, newHandle);
+                        if (isMoved)
+                        {
+                            ++movedCount;
+                        }
+                        else
+                        {
+                            shard->GetDocTable().MoveItem(destination->GetSliceBuffer(),
+                                                          to,
+                                                          source->GetSliceBuffer(),
+                                                          from);
+                            newHandle.Expire();
+                        }
+                    }
+                }
+
+                if (destination != nullptr)
+                {
+                    shard->ExpireUnusedColumns(*destination);
+                    Slice::DecrementRefCount(destination);
+                }
+            }
+
+            // Sources whose documents were all moved are recycled here.
+            for (auto source : sources)
+            {
+                Slice::DecrementRefCount(source);
+            }
+        }
+
+        return movedCount;
+    }
+
+
     void Ingestor::AssertFact(DocId /*id*/, FactHandle /*fact*/, bool /*value*/)
     {
         throw NotImplemented();
@@ -297,7 +620,7 @@ namespace BitFunnel
     bool Ingestor::Contains(DocId id) const
     {
         bool isFound;
-        m_documentMap->Find(id, isFound);
+        Find(id, isFound);
 
         return isFound;
     }
@@ -306,7 +629,7 @@ namespace BitFunnel
     DocumentHandle Ingestor::GetHandle(DocId id) const
     {
         bool isFound;
-        auto handle = m_documentMap->Find(id, isFound);
+        auto handle = Find(id, isFound);
 
         if (!isFound)
         {
@@ -349,20 +672,128 @@ namespace BitFunnel
     }
 
 
-    void Ingestor::OpenGroup(GroupId /*groupId*/)
+    DocumentHandleInternal Ingestor::Find(DocId id, bool& isFound) const
     {
-        throw NotImplemented();
+        DocumentHandleInternal handle = m_documentMap->Find(id, isFound);
+        if (!isFound)
+        {
+            auto groups = std::atomic_load(&m_groups);
+            for (auto const & group : *groups)
+            {
+                handle = group.second->Find(id, isFound);
+                if (isFound)
+                {
+                    break;
+                }
+            }
+        }
+
+        return handle;
+    }
+
+
+    DocumentHandleInternal Ingestor::Remove(DocId id, bool& isFound)
+    {
+        DocumentHandleInternal handle = m_documentMap->Delete(id, isFound);
+        if (!isFound)
+        {
+            auto groups = std::atomic_load(&m_groups);
+            for (auto const & group : *groups)
+            {
+                handle = group.second->Delete(id, isFound);
+                if (isFound)
+                {
+                    break;
+                }
+            }
+        }
+
+        return handle;
+    }
+
+
+    void Ingestor::OpenGroup(GroupId groupId)
+    {
+        std::lock_guard<std::mutex> lock(m_groupsLock);
+
+        if (!m_usedGroupIds.insert(groupId).second)
+        {
+            RecoverableError error("Ingestor::OpenGroup(): GroupId already used.");
+            throw error;
+        }
+
+        CloseGroupInternal();
+
+        std::shared_ptr<DocumentMap> documents(new DocumentMap());
+        std::shared_ptr<GroupList> groups(new GroupList(*m_groups));
+        groups->push_back(std::make_pair(groupId, documents));
+        std::atomic_store(&m_groups,
+                          std::shared_ptr<GroupList const>(groups));
+
+        for (auto & shard : m_shards)
+        {
+            shard->OpenGroup(groupId);
+        }
+
+        m_openGroupDocuments = documents.get();
+        m_openGroup = groupId;
     }
 
 
     void Ingestor::CloseGroup()
     {
-        throw NotImplemented();
+        std::lock_guard<std::mutex> lock(m_groupsLock);
+        CloseGroupInternal();
     }
 
 
-    void Ingestor::ExpireGroup(GroupId /*groupId*/)
+    void Ingestor::CloseGroupInternal()
     {
-        throw NotImplemented();
+        if (m_openGroupDocuments != nullptr)
+        {
+            for (auto & shard : m_shards)
+            {
+                shard->CloseGroup();
+            }
+            m_openGroupDocuments = nullptr;
+        }
+    }
+
+
+    void Ingestor::ExpireGroup(GroupId groupId)
+    {
+        std::lock_guard<std::mutex> lock(m_groupsLock);
+
+        if (m_openGroupDocuments != nullptr && m_openGroup == groupId)
+        {
+            CloseGroupInternal();
+        }
+
+        std::shared_ptr<GroupList> groups(new GroupList());
+        for (auto const & group : *m_groups)
+        {
+            if (group.first != groupId)
+            {
+                groups->push_back(group);
+            }
+        }
+
+        if (groups->size() == m_groups->size())
+        {
+            RecoverableError error("Ingestor::ExpireGroup(): GroupId not found.");
+            throw error;
+        }
+
+        // Once the group's DocumentMap is gone, its documents can no longer
+        // be found. Lookups that started earlier keep the map alive, and
+        // their handles are protected by their Tokens.
+        std::atomic_store(&m_groups,
+                          std::shared_ptr<GroupList const>(groups));
+
+        const Token token = m_tokenManager->RequestToken();
+        for (auto & shard : m_shards)
+        {
+            shard->ExpireGroup(groupId);
+        }
     }
 }
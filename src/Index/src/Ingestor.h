@@ -26,6 +26,8 @@
 #include <memory>                           // std::unique_ptr embedded.
 #include <mutex>                            // std::mutex member.
 #include <stddef.h>                         // size_t template parameter.
+#include <unordered_set>                    // std::unordered_set member.
+#include <utility>                          // std::pair parameter.
 #include <vector>                           // std::vector embedded.
 
 #include "BitFunnel/BitFunnelTypes.h"       // DocId parameter.
@@ -40,6 +42,7 @@
 
 namespace BitFunnel
 {
+    class ForwardIndex;
     class IDocumentDataSchema;
     class IShardDefinition;
     class ISliceBufferAllocator;
@@ -53,7 +56,9 @@ namespace BitFunnel
                  IRecycler& recycle,
                  ITermTableCollection const & termTables,
                  IShardDefinition const & shardDefinition,
-                 ISliceBufferAllocator& sliceBufferAllocator);
+                 ISliceBufferAllocator& sliceBufferAllocator,
+                 size_t statisticsBytes,
+                 ForwardIndex const * forwardIndex);
 
         virtual ~Ingestor();
 
@@ -75,6 +80,9 @@ namespace BitFunnel
 
         virtual void TemporaryWriteAllSlices(IFileManager& fileManager) const override;
 
+        virtual void TemporaryReadAllSlices(IFileManager& fileManager,
+                                            bool memoryMap) override;
+
         // Returns a reference to the IDocument cache. This cache holds ingested
         // IDocuments for use in query verification diagnostics.
         virtual IDocumentCache & GetDocumentCache() const override;
@@ -88,6 +96,10 @@ namespace BitFunnel
         // value.
         virtual void Add(DocId id, IDocument const & document) override;
 
+        // Adds a sequence of documents, merging the row bits of the entire
+        // batch into the slices a quadword at a time.
+        virtual void AddBatch(std::vector<std::pair<DocId, IDocument const *>> const & documents) override;
+
         // Removes a document from serving. The document with the specified id
         // will no longer be returned from the queries. Returns true if the
         // document was successfully removed and false otherwise. False means
@@ -99,6 +111,10 @@ namespace BitFunnel
         // some of which may already have been deleted for other reasons.
         virtual bool Delete(DocId id) override;
 
+        // Moves the documents of sparse slices into newly created slices so
+        // that the sparse slices can be recycled.
+        virtual size_t CompactSlices(double maxLiveFraction) override;
+
         // Sets or clears a fact about a document with the given DocId. The
         // FactHandle must have been previously registered in the IFactSet,
         // otherwise the function throws.
@@ -149,22 +165,64 @@ namespace BitFunnel
         // that were part of this group will be deleted.
         //
 
+        // The documents of each group are placed in Slices of their own, and
+        // are recorded in a DocumentMap of their own. Expiring a group
+        // therefore retires its Slices and drops its DocumentMap as a whole,
+        // without per document work. Group functions must not be called
+        // concurrently with Add() or AddBatch().
+        //
+        // DESIGN NOTE: DocIds are only checked for uniqueness within a
+        // group, and within the documents that belong to no group.
+        //
+
         // Opens a new group and assigns it the given group id.
         //    - All future addition operations are done in this new group.
         //    - The previous group is closed. A closed group cannot be reopened or
         //      modified.
+        // Throws if a group with this id was opened before.
         virtual void OpenGroup(GroupId groupId) override;
 
         // Closes the current group, if any.
         virtual void CloseGroup() override;
 
-        // Expires the group with the given id.
+        // Expires the group with the given id, closing it first if it is
+        // open. Throws if no unexpired group has this id.
         virtual void ExpireGroup(GroupId groupId) override;
 
     private:
+        // Updates ingestion statistics for the document and returns the
+        // shard that will hold it.
+        ShardId RecordDocument(IDocument const & document);
+
+        // Posts the document's terms to its column. When the index has a
+        // ForwardIndex, also writes the document's term hashes to it.
+        void IngestDocument(DocumentHandleInternal handle,
+                            IDocument const & document);
+
+        // Adds an activated and committed document to the DocumentMap of
+        // the open group, or to m_documentMap if no group is open. Expires
+        // the document if this fails.
+        //
+        // DESIGN NOTE: Activation and the slice commit are left to the
+        // caller, so that a batch can commit each slice's documents at
+        // once.
+        void AddToDocumentMap(DocumentHandleInternal handle);
+
+        // Looks up and removes DocIds in m_documentMap and in the
+        // DocumentMaps of the unexpired groups, with the semantics of
+        // DocumentMap::Find() and DocumentMap::Delete().
+        DocumentHandleInternal Find(DocId id, bool& isFound) const;
+        DocumentHandleInternal Remove(DocId id, bool& isFound);
+
+        // Closes the open group. Must be called with m_groupsLock held.
+        void CloseGroupInternal();
+
         IRecycler& m_recycler;
         IShardDefinition const & m_shardDefinition;
 
+        // Null unless documents record their terms for verification.
+        ForwardIndex const * m_forwardIndex;
+
         // TODO: Replace these tempoary statistics variables with document
         // length hash table and term frequency tables.
         // TODO: This member is now redundant (with DocumentMap).
@@ -174,8 +232,25 @@ namespace BitFunnel
         std::atomic<size_t> m_documentCount;
         std::atomic<size_t> m_totalSourceByteSize;
 
+        // DocIds of the documents that belong to no group.
         std::unique_ptr<DocumentMap> m_documentMap;
 
+        // DocumentMaps of the unexpired groups in the order in which they
+        // were opened. The list is replaced as a whole when a group is
+        // opened or expired, so that lookups can proceed without a lock on
+        // the list. Replacements are serialized by m_groupsLock.
+        typedef std::vector<std::pair<GroupId, std::shared_ptr<DocumentMap>>>
+            GroupList;
+        std::shared_ptr<GroupList const> m_groups;
+        std::mutex m_groupsLock;
+
+        // DocumentMap of the open group, or nullptr if no group is open.
+        DocumentMap* m_openGroupDocuments;
+        GroupId m_openGroup;
+
+        // Ids of all groups ever opened, since groups cannot be reopened.
+        std::unordered_set<GroupId> m_usedGroupIds;
+
         std::unique_ptr<DocumentCache> m_documentCache;
 
         std::vector<std::unique_ptr<Shard>> m_shards;
@@ -183,8 +258,8 @@ namespace BitFunnel
         // TokenManager which distributes tokens for thread synchronization.
         std::unique_ptr<ITokenManager> m_tokenManager;
 
-        // Lock protecting concurrent DeleteDocument operations.
-        std::mutex m_deleteDocumentLock;
+        // Serializes calls to CompactSlices().
+        std::mutex m_compactionLock;
 
 
         DocumentHistogramBuilder m_histogram;
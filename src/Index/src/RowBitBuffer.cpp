@@ -0,0 +1,126 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <functional>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "BitFunnel/Exceptions.h"
+#include "RowBitBuffer.h"
+
+
+namespace BitFunnel
+{
+    // The buffer attached to each thread, if any.
+    static thread_local RowBitBuffer* g_attachedBuffer = nullptr;
+
+
+    static inline void AtomicOr(uint64_t* quadword, uint64_t bits)
+    {
+#ifdef _MSC_VER
+        _InterlockedOr64(reinterpret_cast<long long volatile *>(quadword),
+                         static_cast<long long>(bits));
+#else
+        __sync_fetch_and_or(quadword, bits);
+#endif
+    }
+
+
+    RowBitBuffer::RowBitBuffer()
+      : m_isAttached(false)
+    {
+    }
+
+
+    RowBitBuffer::~RowBitBuffer()
+    {
+        if (m_isAttached)
+        {
+            Detach();
+        }
+    }
+
+
+    void RowBitBuffer::Attach()
+    {
+        if (g_attachedBuffer != nullptr)
+        {
+            RecoverableError error("RowBitBuffer::Attach: thread already has a buffer attached.");
+            throw error;
+        }
+        g_attachedBuffer = this;
+        m_isAttached = true;
+    }
+
+
+    void RowBitBuffer::Detach()
+    {
+        if (g_attachedBuffer == this)
+        {
+            g_attachedBuffer = nullptr;
+        }
+        m_isAttached = false;
+    }
+
+
+    RowBitBuffer* RowBitBuffer::GetAttached()
+    {
+        return g_attachedBuffer;
+    }
+
+
+    void RowBitBuffer::Add(uint64_t* quadword, uint64_t bits)
+    {
+        m_entries.push_back(std::make_pair(quadword, bits));
+    }
+
+
+    void RowBitBuffer::Merge()
+    {
+        // Sorting brings together the bits for each quadword and also visits
+        // the Slice buffers in address order.
+        std::less<uint64_t*> less;
+        std::sort(m_entries.begin(),
+                  m_entries.end(),
+                  [&less](Entry const & a, Entry const & b)
+                  {
+                      return less(a.first, b.first);
+                  });
+
+        auto it = m_entries.begin();
+        while (it != m_entries.end())
+        {
+            uint64_t* const quadword = it->first;
+            uint64_t bits = 0;
+            for (; it != m_entries.end() && it->first == quadword; ++it)
+            {
+                bits |= it->second;
+            }
+            AtomicOr(quadword, bits);
+        }
+
+        m_entries.clear();
+    }
+}
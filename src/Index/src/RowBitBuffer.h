@@ -0,0 +1,91 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stdint.h>                     // uint64_t member.
+#include <utility>                      // std::pair member.
+#include <vector>                       // std::vector member.
+
+#include "BitFunnel/NonCopyable.h"      // Base class.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // RowBitBuffer
+    //
+    // Accumulates the row bits of documents that are still being ingested so
+    // that they can be merged into their Slices a quadword at a time. Each
+    // RowTableDescriptor::SetBit() is a locked read-modify-write, and
+    // quadwords of higher rank rows are shared by many documents, so
+    // ingestion threads otherwise contend for the same cache lines on every
+    // posting.
+    //
+    // While a RowBitBuffer is attached to a thread, Shard::AddPosting() on
+    // that thread records bits in the buffer instead of the Slice. Merge()
+    // then ORs each distinct quadword into its Slice once. Bits may be
+    // buffered for documents in any number of Slices and Shards.
+    //
+    // The documents whose bits are buffered must not be activated or
+    // committed until Merge() returns. Until then their Slices cannot be
+    // recycled, so the buffered quadword addresses remain valid.
+    //
+    // Thread safety: a RowBitBuffer must only be used by the thread that
+    // attached it.
+    //
+    //*************************************************************************
+    class RowBitBuffer : public NonCopyable
+    {
+    public:
+        RowBitBuffer();
+
+        // Detaches the buffer if it is still attached. Bits that were not
+        // merged are discarded.
+        ~RowBitBuffer();
+
+        // Directs the calling thread's Shard::AddPosting() calls to this
+        // buffer. Throws if the thread already has a buffer attached.
+        void Attach();
+
+        // Restores direct writes to the Slices for the calling thread.
+        void Detach();
+
+        // Returns the buffer attached to the calling thread or nullptr if
+        // there is none.
+        static RowBitBuffer* GetAttached();
+
+        // Records bits to be ORed into the quadword at the given address.
+        void Add(uint64_t* quadword, uint64_t bits);
+
+        // ORs the accumulated bits into their quadwords, using one atomic
+        // operation per distinct quadword, and empties the buffer.
+        void Merge();
+
+    private:
+        typedef std::pair<uint64_t*, uint64_t> Entry;
+
+        std::vector<Entry> m_entries;
+        bool m_isAttached;
+    };
+}
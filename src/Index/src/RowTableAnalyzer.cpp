@@ -21,8 +21,11 @@
 // THE SOFTWARE.
 
 
+#include <algorithm>
 #include <ostream>
 #include <stack>
+#include <thread>
+#include <unordered_map>
 
 #include "BitFunnel/Configuration/Factories.h"
 #include "BitFunnel/Configuration/IFileSystem.h"
@@ -34,6 +37,8 @@
 #include "BitFunnel/Index/IIngestor.h"
 #include "BitFunnel/Index/ISimpleIndex.h"
 #include "BitFunnel/Index/RowIdSequence.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/ITaskProcessor.h"
 #include "CsvTsv/Csv.h"
 #include "DocumentHandleInternal.h"
 #include "LoggerInterfaces/Check.h"
@@ -149,6 +154,64 @@ namespace BitFunnel
     }
 
 
+    //*************************************************************************
+    //
+    // ColumnBitCountProcessor
+    //
+    // ITaskProcessor which computes, for every column of one slice per task,
+    // the number of bits set at each rank.
+    //
+    //*************************************************************************
+    typedef std::array<std::vector<uint32_t>, c_maxRankValue + 1> ColumnBitCounts;
+
+    class ColumnBitCountProcessor : public ITaskProcessor
+    {
+    public:
+        ColumnBitCountProcessor(std::vector<Slice const *> const & slices,
+                                std::vector<ColumnBitCounts>& counts);
+
+        //
+        // ITaskProcessor methods
+        //
+
+        virtual void ProcessTask(size_t taskId) override;
+        virtual void Finished() override;
+
+    private:
+        std::vector<Slice const *> const & m_slices;
+        std::vector<ColumnBitCounts>& m_counts;
+    };
+
+
+    ColumnBitCountProcessor::ColumnBitCountProcessor(
+        std::vector<Slice const *> const & slices,
+        std::vector<ColumnBitCounts>& counts)
+      : m_slices(slices),
+        m_counts(counts)
+    {
+    }
+
+
+    void ColumnBitCountProcessor::ProcessTask(size_t taskId)
+    {
+        Slice const & slice = *m_slices[taskId];
+        const DocIndex capacity = slice.GetShard().GetSliceCapacity();
+
+        for (Rank rank = 0; rank <= c_maxRankValue; ++rank)
+        {
+            std::vector<uint32_t>& counts = m_counts[taskId][rank];
+            counts.assign(capacity, 0);
+            slice.GetRowTable(rank).AddColumnBitCounts(slice.GetSliceBuffer(),
+                                                       counts);
+        }
+    }
+
+
+    void ColumnBitCountProcessor::Finished()
+    {
+    }
+
+
     //*************************************************************************
     //
     // Analyze columns
@@ -161,6 +224,12 @@ namespace BitFunnel
 
         std::vector<Column> columns;
 
+        // Slices holding cached documents, and the position of each column's
+        // slice in this vector.
+        std::vector<Slice const *> slices;
+        std::unordered_map<Slice const *, size_t> sliceIndices;
+        std::vector<std::pair<size_t, DocIndex>> locations;
+
         for (auto doc : cache)
         {
             const DocumentHandleInternal
@@ -173,28 +242,51 @@ namespace BitFunnel
                                  shard,
                                  doc.first.GetPostingCount());
 
-            void const * buffer = slice.GetSliceBuffer();
-            const DocIndex column = handle.GetIndex();
+            auto it = sliceIndices.find(&slice);
+            if (it == sliceIndices.end())
+            {
+                it = sliceIndices.insert(std::make_pair(&slice, slices.size())).first;
+                slices.push_back(&slice);
+            }
+            locations.push_back(std::make_pair(it->second, handle.GetIndex()));
+        }
+
+        // Count the bits in every column of each slice, one slice per task.
+        std::vector<ColumnBitCounts> counts(slices.size());
+        if (!slices.empty())
+        {
+            const size_t threadCount =
+                std::min(slices.size(),
+                         std::max(static_cast<size_t>(std::thread::hardware_concurrency()),
+                                  static_cast<size_t>(1)));
 
-            for (Rank rank = 0; rank <= c_maxRankValue; ++rank)
+            std::vector<std::unique_ptr<ITaskProcessor>> processors;
+            for (size_t i = 0; i < threadCount; ++i)
             {
-                RowTableDescriptor rowTable = slice.GetRowTable(rank);
+                processors.push_back(
+                    std::unique_ptr<ITaskProcessor>(
+                        new ColumnBitCountProcessor(slices, counts)));
+            }
 
-                size_t bitCount = 0;
-                const size_t rowCount = rowTable.GetRowCount();
-                for (RowIndex row = 0; row < rowCount; ++row)
-                {
-                    if (rowTable.GetBit(buffer, row, column) != 0)
-                    {
-                        ++bitCount;
-                    }
-                }
+            auto distributor =
+                Factories::CreateTaskDistributor(processors, slices.size());
+            distributor->WaitForCompletion();
+        }
+
+        for (size_t i = 0; i < columns.size(); ++i)
+        {
+            Slice const & slice = *slices[locations[i].first];
+            const DocIndex column = locations[i].second;
 
-                columns.back().SetCount(rank, bitCount);
+            for (Rank rank = 0; rank <= c_maxRankValue; ++rank)
+            {
+                const size_t bitCount = counts[locations[i].first][rank][column];
+                columns[i].SetCount(rank, bitCount);
 
+                const size_t rowCount = slice.GetRowTable(rank).GetRowCount();
                 double density =
                     (rowCount == 0) ? 0.0 : static_cast<double>(bitCount) / rowCount;
-                columns.back().SetDensity(rank, density);
+                columns[i].SetDensity(rank, density);
             }
         }
 
@@ -25,28 +25,57 @@
 #include "BitFunnel/Index/ITermTable.h"
 #include "BitFunnel/Index/Row.h"
 #include "BitFunnel/Index/RowIdSequence.h"
+#include "BitFunnel/Utilities/StreamUtilities.h"
 #include "LoggerInterfaces/Check.h"
 #include "LoggerInterfaces/Logging.h"
+#include "RowBitBuffer.h"
 #include "RowTableDescriptor.h"
 
 #ifdef _MSC_VER
-#include <intrin.h>  // For _interlockedbittestandreset64, etc.
+#include <intrin.h>  // For _interlockedbittestandreset64, __popcnt64, etc.
 #endif
 
 
 namespace BitFunnel
 {
+    // Returns the number of bits set in a quadword. The build targets
+    // SSE4.2, so this compiles to the POPCNT instruction.
+    static inline size_t PopCount(uint64_t value)
+    {
+#ifdef _MSC_VER
+        return static_cast<size_t>(__popcnt64(value));
+#else
+        return static_cast<size_t>(__builtin_popcountll(value));
+#endif
+    }
+
+
+    // Returns the position of the lowest set bit in a non-zero quadword.
+    static inline size_t LowestSetBit(uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long position;
+        _BitScanForward64(&position, value);
+        return static_cast<size_t>(position);
+#else
+        return static_cast<size_t>(__builtin_ctzll(value));
+#endif
+    }
+
+
     RowTableDescriptor::RowTableDescriptor(DocIndex capacity,
                                            RowIndex rowCount,
                                            Rank rank,
                                            Rank maxRank,
-                                           ptrdiff_t rowTableBufferOffset)
+                                           ptrdiff_t rowTableBufferOffset,
+                                           ptrdiff_t summaryBitOffset)
         : m_capacity(capacity),
           m_rowCount(rowCount),
           m_rank(rank),
           m_maxRank(maxRank),
           m_bufferOffset(rowTableBufferOffset),
-          m_bytesPerRow(Row::BytesInRow(capacity, rank, maxRank))
+          m_bytesPerRow(Row::BytesInRow(capacity, rank, maxRank)),
+          m_summaryBitOffset(summaryBitOffset)
     {
         // Make sure capacity is properly rounded already.
         // TODO: fix.
@@ -65,8 +94,47 @@ namespace BitFunnel
           m_rank(other.m_rank),
           m_maxRank(other.m_maxRank),
           m_bufferOffset(other.m_bufferOffset),
-          m_bytesPerRow(other.m_bytesPerRow)
+          m_bytesPerRow(other.m_bytesPerRow),
+          m_summaryBitOffset(other.m_summaryBitOffset)
+    {
+    }
+
+
+    RowTableDescriptor::RowTableDescriptor(std::istream& input)
+        : m_capacity(StreamUtilities::ReadField<DocIndex>(input)),
+          m_rowCount(StreamUtilities::ReadField<RowIndex>(input)),
+          m_rank(StreamUtilities::ReadField<Rank>(input)),
+          m_maxRank(StreamUtilities::ReadField<Rank>(input)),
+          m_bufferOffset(StreamUtilities::ReadField<ptrdiff_t>(input)),
+          m_bytesPerRow(StreamUtilities::ReadField<size_t>(input)),
+          m_summaryBitOffset(StreamUtilities::ReadField<ptrdiff_t>(input))
+    {
+    }
+
+
+    void RowTableDescriptor::Write(std::ostream& output) const
     {
+        // WARNING: Field write order must be consistent with the order the
+        // fields are read in the std::istream constructor.
+        StreamUtilities::WriteField<DocIndex>(output, m_capacity);
+        StreamUtilities::WriteField<RowIndex>(output, m_rowCount);
+        StreamUtilities::WriteField<Rank>(output, m_rank);
+        StreamUtilities::WriteField<Rank>(output, m_maxRank);
+        StreamUtilities::WriteField<ptrdiff_t>(output, m_bufferOffset);
+        StreamUtilities::WriteField<size_t>(output, m_bytesPerRow);
+        StreamUtilities::WriteField<ptrdiff_t>(output, m_summaryBitOffset);
+    }
+
+
+    bool RowTableDescriptor::IsCompatibleWith(RowTableDescriptor const & other) const
+    {
+        return m_capacity == other.m_capacity
+            && m_rowCount == other.m_rowCount
+            && m_rank == other.m_rank
+            && m_maxRank == other.m_maxRank
+            && m_bufferOffset == other.m_bufferOffset
+            && m_bytesPerRow == other.m_bytesPerRow
+            && m_summaryBitOffset == other.m_summaryBitOffset;
     }
 
 
@@ -79,6 +147,18 @@ namespace BitFunnel
                0,
                GetBufferSize(m_capacity, m_rowCount, m_rank, m_maxRank));
 
+        if (m_summaryBitOffset != c_noSummary)
+        {
+            // The summary bits of adjacent RowTables may share quadwords, so
+            // clear them one at a time.
+            uint64_t* const summary = reinterpret_cast<uint64_t*>(sliceBuffer);
+            for (RowIndex rowIndex = 0; rowIndex < m_rowCount; ++rowIndex)
+            {
+                const size_t bit = static_cast<size_t>(GetSummaryBit(rowIndex));
+                summary[bit >> 6] &= ~(1ull << (bit & 0x3F));
+            }
+        }
+
         // The "match-all" row needs to be initialized differently.
         RowIdSequence rows(termTable.GetMatchAllTerm(), termTable);
 
@@ -105,6 +185,7 @@ namespace BitFunnel
             // Fill up the match-all row with all ones.
             uint64_t * rowData = GetRowData(sliceBuffer, row.GetIndex());
             memset(rowData, 0xFF, m_bytesPerRow);
+            SetSummaryBit(sliceBuffer, row.GetIndex());
         }
     }
 
@@ -154,6 +235,27 @@ namespace BitFunnel
         // uint64_t newVal = *(row + offset) | bitMask;
         // *(row + offset) = newVal;
 #endif
+
+        SetSummaryBit(sliceBuffer, rowIndex);
+    }
+
+
+    void RowTableDescriptor::BufferBit(RowBitBuffer& buffer,
+                                       void* sliceBuffer,
+                                       RowIndex rowIndex,
+                                       DocIndex docIndex) const
+    {
+        CHECK_LT(rowIndex, m_rowCount)
+            << "rowIndex out of range.";
+        uint64_t* const row = GetRowData(sliceBuffer, rowIndex);
+        const size_t offset = QwordPositionFromDocIndex(docIndex);
+        uint64_t bitPos = docIndex & 0x3F;
+
+        buffer.Add(row + offset, 1ull << bitPos);
+
+        // The summary bit is set right away, rather than when the buffer is
+        // merged, since setting it early only costs a wasted slice visit.
+        SetSummaryBit(sliceBuffer, rowIndex);
     }
 
 
@@ -177,6 +279,123 @@ namespace BitFunnel
     }
 
 
+    void RowTableDescriptor::CopyColumn(void const * sourceBuffer,
+                                        DocIndex from,
+                                        void* destinationBuffer,
+                                        DocIndex to,
+                                        RowIndex excludedRowIndex) const
+    {
+        if (m_rowCount == 0)
+        {
+            return;
+        }
+
+        const size_t quadwordsPerRow = m_bytesPerRow / sizeof(uint64_t);
+        const size_t fromOffset = QwordPositionFromDocIndex(from);
+        const uint64_t fromMask = 1ull << (from & 0x3F);
+        const size_t toOffset = QwordPositionFromDocIndex(to);
+        const uint64_t toMask = 1ull << (to & 0x3F);
+
+        uint64_t const * sourceRow = GetRowData(sourceBuffer, 0);
+        uint64_t* destinationRow = GetRowData(destinationBuffer, 0);
+        for (RowIndex row = 0; row < m_rowCount; ++row)
+        {
+            if ((sourceRow[fromOffset] & fromMask) != 0 &&
+                row != excludedRowIndex)
+            {
+                destinationRow[toOffset] |= toMask;
+                SetSummaryBit(destinationBuffer, row);
+            }
+
+            sourceRow += quadwordsPerRow;
+            destinationRow += quadwordsPerRow;
+        }
+    }
+
+
+    size_t RowTableDescriptor::GetBitCount(void const * sliceBuffer,
+                                           RowIndex rowIndex) const
+    {
+        uint64_t const * row = GetRowData(sliceBuffer, rowIndex);
+        const size_t quadwordCount = m_bytesPerRow / sizeof(uint64_t);
+
+        size_t count = 0;
+        for (size_t i = 0; i < quadwordCount; ++i)
+        {
+            count += PopCount(row[i]);
+        }
+
+        return count;
+    }
+
+
+    size_t RowTableDescriptor::GetBitCount(void const * sliceBuffer,
+                                           RowIndex rowIndex,
+                                           RowTableDescriptor const & rank0Table,
+                                           RowIndex filterRowIndex) const
+    {
+        CHECK_EQ(rank0Table.m_rank, 0u)
+            << "filter row must be rank 0.";
+
+        uint64_t const * row = GetRowData(sliceBuffer, rowIndex);
+        uint64_t const * filter =
+            rank0Table.GetRowData(sliceBuffer, filterRowIndex);
+
+        // The rank 0 document at bit b of quadword q corresponds to bit b of
+        // quadword (q >> m_rank) in a row of this rank.
+        const size_t quadwordCount = m_capacity >> 6;
+
+        size_t count = 0;
+        for (size_t i = 0; i < quadwordCount; ++i)
+        {
+            count += PopCount(filter[i] & row[i >> m_rank]);
+        }
+
+        return count;
+    }
+
+
+    void RowTableDescriptor::AddColumnBitCounts(
+        void const * sliceBuffer,
+        std::vector<uint32_t>& columnBitCounts) const
+    {
+        CHECK_GE(columnBitCounts.size(), m_capacity)
+            << "columnBitCounts too small.";
+
+        if (m_rowCount == 0)
+        {
+            return;
+        }
+
+        // Accumulate counts for the bit positions of a row of this rank by
+        // visiting only the set bits, then expand to one count per document.
+        const size_t quadwordCount = m_bytesPerRow / sizeof(uint64_t);
+        std::vector<uint32_t> positionCounts(quadwordCount * 64, 0);
+
+        for (RowIndex rowIndex = 0; rowIndex < m_rowCount; ++rowIndex)
+        {
+            uint64_t const * row = GetRowData(sliceBuffer, rowIndex);
+            for (size_t i = 0; i < quadwordCount; ++i)
+            {
+                uint64_t bits = row[i];
+                while (bits != 0)
+                {
+                    ++positionCounts[i * 64 + LowestSetBit(bits)];
+
+                    // Clear the lowest set bit.
+                    bits &= bits - 1;
+                }
+            }
+        }
+
+        for (DocIndex doc = 0; doc < m_capacity; ++doc)
+        {
+            const size_t position = ((doc >> (6 + m_rank)) << 6) | (doc & 0x3F);
+            columnBitCounts[doc] += positionCounts[position];
+        }
+    }
+
+
     ptrdiff_t RowTableDescriptor::GetRowOffset(RowIndex rowIndex) const
     {
         // TODO: consider checking for overflow.
@@ -184,6 +403,38 @@ namespace BitFunnel
     }
 
 
+    ptrdiff_t RowTableDescriptor::GetSummaryBit(RowIndex rowIndex) const
+    {
+        if (m_summaryBitOffset == c_noSummary)
+        {
+            return c_noSummary;
+        }
+        return m_summaryBitOffset + static_cast<ptrdiff_t>(rowIndex);
+    }
+
+
+    bool RowTableDescriptor::MayHaveBits(void const * sliceBuffer,
+                                         RowIndex rowIndex) const
+    {
+        if (m_summaryBitOffset == c_noSummary)
+        {
+            return true;
+        }
+
+        const size_t bit = static_cast<size_t>(GetSummaryBit(rowIndex));
+        uint64_t const * summary =
+            reinterpret_cast<uint64_t const *>(sliceBuffer);
+        return (summary[bit >> 6] & (1ull << (bit & 0x3F))) != 0;
+    }
+
+
+    /* static */
+    size_t RowTableDescriptor::GetSummaryBufferSize(size_t rowCount)
+    {
+        return ((rowCount + 63) >> 6) * sizeof(uint64_t);
+    }
+
+
     /* static */
     size_t RowTableDescriptor::GetBufferSize(DocIndex capacity,
                                              RowIndex rowCount,
@@ -221,6 +472,33 @@ namespace BitFunnel
     }
 
 
+    void RowTableDescriptor::SetSummaryBit(void* sliceBuffer,
+                                           RowIndex rowIndex) const
+    {
+        if (m_summaryBitOffset == c_noSummary)
+        {
+            return;
+        }
+
+        const size_t bit = static_cast<size_t>(GetSummaryBit(rowIndex));
+        uint64_t* const word = reinterpret_cast<uint64_t*>(sliceBuffer) + (bit >> 6);
+        const uint64_t bitPos = bit & 0x3F;
+
+        // Most postings go to rows whose summary bit is already set, so test
+        // first to avoid a locked write to a shared cache line.
+        if ((*word & (1ull << bitPos)) != 0)
+        {
+            return;
+        }
+
+#ifdef _MSC_VER
+        _interlockedbittestandset64(reinterpret_cast<long long *>(word), bitPos);
+#else
+        asm("lock btsq %1, %0" : "+m" (*word) : "r" (bitPos));
+#endif
+    }
+
+
     size_t RowTableDescriptor::QwordPositionFromDocIndex(DocIndex docIndex) const
     {
         LogAssertB(docIndex < m_capacity, "docIndex out of range");
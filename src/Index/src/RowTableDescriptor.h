@@ -24,6 +24,8 @@
 #pragma once
 
 #include <cstddef>                      // size_t embedded.
+#include <iosfwd>                       // std::istream, std::ostream parameters.
+#include <vector>                       // std::vector parameter.
 
 #include "BitFunnel/BitFunnelTypes.h"   // DocIndex parameter.
 #include "BitFunnel/Index/RowId.h"      // RowIndex parameter.
@@ -32,6 +34,7 @@
 namespace BitFunnel
 {
     class ITermTable;
+    class RowBitBuffer;
 
     //*************************************************************************
     //
@@ -42,6 +45,12 @@ namespace BitFunnel
     // and is able to perform bit operations over that data.
     // See Slice.h for more info about the layout of the data buffer.
     //
+    // The slice buffer may also hold a summary bitmap with one bit for each
+    // row of the RowTable. SetBit() and BufferBit() set the row's summary
+    // bit, so a clear summary bit guarantees that the row has no bits set in
+    // the slice. Summary bits are never cleared after Initialize(), so a set
+    // summary bit only means that the row may have bits set.
+    //
     // All methods except Initialize are thread safe. Initialize method is not
     // thread-safe with respect to calling *Bit methods at the same time.
     //
@@ -52,23 +61,32 @@ namespace BitFunnel
         // Constructs a RowTableDescriptor with given dimensions.
         // rowTableBufferOffset represents the offset where this RowTable's
         // data starts within a larger slice buffer which is passed to other
-        // methods.
+        // methods. summaryBitOffset is the position, in bits from the start
+        // of the slice buffer, of the summary bit for row 0. The summary
+        // bits of the other rows follow. When summaryBitOffset is
+        // c_noSummary, the RowTable has no summary bitmap.
         RowTableDescriptor(DocIndex capacity,
                            RowIndex rowCount,
                            Rank rank,
                            Rank maxRank,
-                           ptrdiff_t bufferOffset);
+                           ptrdiff_t bufferOffset,
+                           ptrdiff_t summaryBitOffset = c_noSummary);
 
         // Copy constructor from another RowTableDescriptor. Required so that
         // RowTableDescriptor can be used in std::vector and that a Slice can
         // create a cached copy of the RowTableDescriptor from Shard.
         RowTableDescriptor(RowTableDescriptor const & other);
 
+        // Constructs a RowTableDescriptor from the compatibility information
+        // previously persisted with Write(). Used when loading Slices to
+        // verify that the stream's layout matches the current one.
+        RowTableDescriptor(std::istream& input);
+
         // Zero out row buffer. May not be required if buffers come out of
         // allocator zero initialized. Expected to be called one per
         // sliceBuffer. All rows are initialized with zero in all bits except
         // for the "match-all" row. ITermTable determines where this row is
-        // located.
+        // located. Summary bits are initialized the same way.
         // Not thread safe with respect to calling *Bit methods at the same
         // time.
         void Initialize(void* sliceBuffer, ITermTable const & termTable) const;
@@ -85,19 +103,73 @@ namespace BitFunnel
                     RowIndex rowIndex,
                     DocIndex docIndex) const;
 
+        // Records the bit for the given row and column in buffer, rather than
+        // setting it in the sliceBuffer. The bit is set when the buffer is
+        // merged.
+        void BufferBit(RowBitBuffer& buffer,
+                       void* sliceBuffer,
+                       RowIndex rowIndex,
+                       DocIndex docIndex) const;
+
         // Clears a bit in the given row and column.
         void ClearBit(void* sliceBuffer,
                       RowIndex rowIndex,
                       DocIndex docIndex) const;
 
+        // Sets the bit of column to in destinationBuffer for each row whose
+        // bit of column from is set in sourceBuffer, other than
+        // excludedRowIndex. Pass GetRowCount() to copy every row. Writes the
+        // destination with plain stores, so no other thread may set bits in
+        // the destination rows at the same time.
+        void CopyColumn(void const * sourceBuffer,
+                        DocIndex from,
+                        void* destinationBuffer,
+                        DocIndex to,
+                        RowIndex excludedRowIndex) const;
+
+        // Returns the number of bits set in the given row.
+        size_t GetBitCount(void const * sliceBuffer,
+                           RowIndex rowIndex) const;
+
+        // Returns the number of documents whose bits are set both in the
+        // given row and in the rank 0 row filterRowIndex described by
+        // rank0Table. Typically the filter row is the document active row,
+        // so the result counts only bits of documents that are serving.
+        // Processes a quadword of rank 0 documents at a time instead of
+        // calling GetBit() for each document.
+        size_t GetBitCount(void const * sliceBuffer,
+                           RowIndex rowIndex,
+                           RowTableDescriptor const & rank0Table,
+                           RowIndex filterRowIndex) const;
+
+        // For each document in the slice, adds to columnBitCounts[docIndex]
+        // the number of rows in this RowTable that have the document's bit
+        // set. columnBitCounts must have an entry for each DocIndex in the
+        // slice.
+        void AddColumnBitCounts(void const * sliceBuffer,
+                                std::vector<uint32_t>& columnBitCounts) const;
+
         // Returns the offset of a row with the given index, relative to the
         // start of the sliceBuffer.
         ptrdiff_t GetRowOffset(RowIndex rowIndex) const;
 
+        // Returns the position of the row's summary bit, in bits from the
+        // start of the sliceBuffer, or c_noSummary if the RowTable has no
+        // summary bitmap.
+        ptrdiff_t GetSummaryBit(RowIndex rowIndex) const;
+
+        // Returns true if the row's summary bit is set, or if the RowTable
+        // has no summary bitmap. A return value of false guarantees that
+        // the row has no bits set in the slice.
+        bool MayHaveBits(void const * sliceBuffer, RowIndex rowIndex) const;
+
         // Returns true if the given RowTableDescriptor is data-compatible with
         // this instance. Used when loading Slices from the stream.
         bool IsCompatibleWith(RowTableDescriptor const & other) const;
 
+        // Writes the dimensions and offset of the RowTable to the stream.
+        void Write(std::ostream& output) const;
+
         // Returns the byte size of the buffer required to host a RowTable with
         // given dimensions. This assists the caller in allocating large enough
         // buffer for all RowTables.
@@ -111,6 +183,13 @@ namespace BitFunnel
         // it is placed either at quadword or at cacheline boundaries.
         static const size_t c_rowTableByteAlignment = c_bytesPerCacheLine;
 
+        // Value of summaryBitOffset for RowTables without a summary bitmap.
+        static const ptrdiff_t c_noSummary = -1;
+
+        // Returns the byte size of a summary bitmap with a bit for each of
+        // rowCount rows. The size is a whole number of quadwords.
+        static size_t GetSummaryBufferSize(size_t rowCount);
+
     private:
         // Declare but don't implement. This is required for a std::vector to
         // use a copy constructor instead of assignment operator.
@@ -123,6 +202,9 @@ namespace BitFunnel
         uint64_t const * GetRowData(void const * sliceBuffer,
                                     RowIndex rowIndex) const;
 
+        // Sets the row's summary bit, if the RowTable has a summary bitmap.
+        void SetSummaryBit(void* sliceBuffer, RowIndex rowIndex) const;
+
         // Returns the QWORD number for the given DocIndex.
         size_t QwordPositionFromDocIndex(DocIndex docIndex) const;
 
@@ -140,5 +222,9 @@ namespace BitFunnel
 
         // Cached value of the number of bytes per single row.
         const size_t m_bytesPerRow;
+
+        // Position of row 0's summary bit, in bits from the start of the
+        // slice buffer, or c_noSummary.
+        const ptrdiff_t m_summaryBitOffset;
     };
 }
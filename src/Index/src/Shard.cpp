@@ -20,6 +20,11 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include <unordered_set>
+
 #include "BitFunnel/Exceptions.h"
 #include "BitFunnel/IFileManager.h"
 #include "BitFunnel/Index/IRecycler.h"
@@ -28,12 +33,16 @@
 #include "BitFunnel/Index/Row.h"
 #include "BitFunnel/Index/RowIdSequence.h"
 #include "BitFunnel/Index/Token.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/ITaskProcessor.h"
 #include "BitFunnel/Utilities/StreamUtilities.h"
 #include "IRecyclable.h"
 #include "LoggerInterfaces/Check.h"
 #include "LoggerInterfaces/Logging.h"
+#include "MemoryMappedFile.h"
 #include "Recycler.h"
 #include "Rounding.h"
+#include "RowBitBuffer.h"
 #include "Shard.h"
 
 
@@ -76,8 +85,11 @@ namespace BitFunnel
                  ITermTable const & termTable,
                  IDocumentDataSchema const & docDataSchema,
                  ISliceBufferAllocator& sliceBufferAllocator,
-                 size_t sliceBufferSize)
+                 size_t sliceBufferSize,
+                 size_t statisticsBytes,
+                 unsigned numaNode)
         : m_shardId(id),
+          m_numaNode(numaNode),
           m_recycler(recycler),
           m_tokenManager(tokenManager),
           m_termTable(termTable),
@@ -85,12 +97,14 @@ namespace BitFunnel
           m_documentActiveRowId(RowIdForActiveDocument(termTable)),
           m_activeSlice(nullptr),
           m_sliceBuffers(new std::vector<void*>()),
+          m_isGroupOpen(false),
+          m_openGroup(0),
           m_sliceCapacity(GetCapacityForByteSize(sliceBufferSize,
                                                  docDataSchema,
                                                  termTable)),
           m_sliceBufferSize(sliceBufferSize),
           // TODO: will need one global, not one per shard.
-          m_docFrequencyTableBuilder(new DocumentFrequencyTableBuilder())
+          m_docFrequencyTableBuilder(new DocumentFrequencyTableBuilder(statisticsBytes))
     {
         const size_t bufferSize =
             InitializeDescriptors(this,
@@ -110,76 +124,387 @@ namespace BitFunnel
 
     DocumentHandleInternal Shard::AllocateDocument(DocId id)
     {
-        std::lock_guard<std::mutex> lock(m_slicesLock);
         DocIndex index;
-        if (m_activeSlice == nullptr || !m_activeSlice->TryAllocateDocument(index))
+        DocIndex count;
+        Slice* slice = AllocateDocuments(1, index, count);
+
+        return DocumentHandleInternal(slice, index, id);
+    }
+
+
+    Slice* Shard::AllocateDocuments(DocIndex maxCount,
+                                    DocIndex& first,
+                                    DocIndex& count)
+    {
+        for (;;)
         {
-            CreateNewActiveSlice();
+            // The active slice is only recycled once it is full, in which
+            // case the allocation fails. The Token keeps it alive until it
+            // is no longer compared with m_activeSlice below.
+            const Token token = m_tokenManager.RequestToken();
 
-            LogAssertB(m_activeSlice->TryAllocateDocument(index),
-                       "Newly allocated slice has no space.");
-        }
+            Slice* slice = m_activeSlice;
+            if (slice != nullptr)
+            {
+                count = slice->TryAllocateDocuments(maxCount, first);
+                if (count > 0)
+                {
+                    return slice;
+                }
+            }
 
-        return DocumentHandleInternal(m_activeSlice, index, id);
+            // Another thread may have replaced the full slice in the
+            // meantime, in which case its slice is tried next.
+            std::lock_guard<std::mutex> lock(m_slicesLock);
+            if (m_activeSlice == slice)
+            {
+                CreateNewActiveSlice();
+            }
+        }
     }
 
 
     void* Shard::AllocateSliceBuffer()
     {
-        return m_sliceBufferAllocator.Allocate(m_sliceBufferSize);
+        return m_sliceBufferAllocator.Allocate(m_sliceBufferSize, m_numaNode);
     }
 
 
-    void* Shard::LoadSliceBuffer(std::istream& input)
+    // Returns the position at which a slice buffer following a header that
+    // ends at the given stream position begins.
+    static size_t GetSliceBufferPosition(std::streamoff headerEnd)
     {
+        if (headerEnd < 0)
+        {
+            RecoverableError error("Shard: slice persistence requires a positioned stream.");
+            throw error;
+        }
+
+        return RoundUp(static_cast<size_t>(headerEnd), c_bytesPerPage);
+    }
+
+
+    void Shard::WriteSliceHeader(std::ostream& output) const
+    {
+        // Copy the version to avoid odr-using the in-class constant.
+        const uint32_t version = c_sliceFormatVersion;
+        StreamUtilities::WriteField<uint32_t>(output, version);
+
+        // Write out the size of the slice buffer and the descriptors for
+        // compatibility check.
+        StreamUtilities::WriteField<size_t>(output, m_sliceBufferSize);
+        m_docTable->Write(output);
+        StreamUtilities::WriteField<size_t>(output, m_rowTables.size());
+        for (auto const & rowTable : m_rowTables)
+        {
+            rowTable.Write(output);
+        }
+    }
+
+
+    void Shard::ReadSliceHeader(std::istream& input) const
+    {
+        const uint32_t version = StreamUtilities::ReadField<uint32_t>(input);
+        if (version != c_sliceFormatVersion)
+        {
+            RecoverableError error("Shard: unsupported slice format version.");
+            throw error;
+        }
+
         const size_t bufferSizePersisted = StreamUtilities::ReadField<size_t>(input);
         if (bufferSizePersisted != m_sliceBufferSize)
         {
-            throw std::runtime_error("Data in the stream is not compatible with the current schema.");
+            RecoverableError error("Shard: slice buffer size in the stream is not compatible with the current schema.");
+            throw error;
+        }
+
+        const DocTableDescriptor docTable(input);
+        if (!docTable.IsCompatibleWith(*m_docTable))
+        {
+            RecoverableError error("Shard: DocTable in the stream is not compatible with the current schema.");
+            throw error;
+        }
+
+        const size_t rowTableCount = StreamUtilities::ReadField<size_t>(input);
+        if (rowTableCount != m_rowTables.size())
+        {
+            RecoverableError error("Shard: RowTables in the stream are not compatible with the current TermTable.");
+            throw error;
+        }
+        for (auto const & rowTable : m_rowTables)
+        {
+            if (!RowTableDescriptor(input).IsCompatibleWith(rowTable))
+            {
+                RecoverableError error("Shard: RowTables in the stream are not compatible with the current TermTable.");
+                throw error;
+            }
         }
+    }
 
-        // TODO: verify compatibility of DocTableDescriptor, RowTableDescriptor with the stream's data.
 
-        void* buffer = m_sliceBufferAllocator.Allocate(m_sliceBufferSize);
+    void* Shard::LoadSliceBuffer(std::istream& input)
+    {
+        ReadSliceHeader(input);
+
+        const std::streamoff headerEnd = input.tellg();
+        const size_t position = GetSliceBufferPosition(headerEnd);
+        input.ignore(static_cast<std::streamsize>(position - static_cast<size_t>(headerEnd)));
+
+        void* buffer = m_sliceBufferAllocator.Allocate(m_sliceBufferSize, m_numaNode);
 
         try
         {
             StreamUtilities::ReadBytes(input, buffer, m_sliceBufferSize);
         }
-        catch (std::exception e)
+        catch (...)
         {
 	  //            LogB(Logging::Error, "LoadSliceBuffer", "Error reading slice buffer data from stream");
             m_sliceBufferAllocator.Release(buffer);
-	    throw e;
+            throw;
         }
 
         return buffer;
     }
 
 
+    void* Shard::MapSliceBuffer(std::istream& input, MemoryMappedFile const & file)
+    {
+        ReadSliceHeader(input);
+
+        const size_t position = GetSliceBufferPosition(input.tellg());
+        if (position + m_sliceBufferSize > file.GetSize())
+        {
+            RecoverableError error("Shard::MapSliceBuffer: slice file is truncated.");
+            throw error;
+        }
+
+        input.seekg(static_cast<std::streamoff>(position + m_sliceBufferSize));
+
+        return file.GetBuffer() + position;
+    }
+
+
     // TODO: Should this really be in Shard? Seems it's only here because
     // m_sliceBufferSize is here.
     void Shard::WriteSliceBuffer(void* buffer, std::ostream& output)
     {
-        // Write out the size of the slice buffer for compatibility check.
-        StreamUtilities::WriteField<size_t>(output, m_sliceBufferSize);
+        WriteSliceHeader(output);
+
+        // Pad to a page boundary so that the buffer can be memory mapped.
+        const std::streamoff headerEnd = output.tellp();
+        const size_t position = GetSliceBufferPosition(headerEnd);
+        const std::vector<char>
+            padding(position - static_cast<size_t>(headerEnd), 0);
+        if (!padding.empty())
+        {
+            StreamUtilities::WriteBytes(output, padding.data(), padding.size());
+        }
+
         StreamUtilities::WriteBytes(output, reinterpret_cast<char*>(buffer), m_sliceBufferSize);
+    }
+
+
+    Slice* Shard::LoadSlice(std::istream& input)
+    {
+        Slice* slice = new Slice(*this, input);
+
+        std::lock_guard<std::mutex> lock(m_slicesLock);
+        AddSliceBuffer(*slice);
 
-        // TODO: persist DocTableDescriptor, RowTableDescriptor compatibility information.
+        return slice;
     }
 
 
-    // Must be called with m_slicesLock held.
-    void Shard::CreateNewActiveSlice()
+    Slice* Shard::MapSlice(char const * fileName)
     {
-        Slice* newSlice = new Slice(*this);
+        std::unique_ptr<MemoryMappedFile> file(new MemoryMappedFile(fileName));
+
+        // The header and the variable size blobs surrounding the slice buffer
+        // are read through an ordinary stream.
+        std::ifstream input(fileName, std::ios::in | std::ios::binary);
+        if (!input.is_open())
+        {
+            RecoverableError error("Shard::MapSlice: unable to open slice file.");
+            throw error;
+        }
 
+        Slice* slice = new Slice(*this, input, std::move(file));
+
+        std::lock_guard<std::mutex> lock(m_slicesLock);
+        AddSliceBuffer(*slice);
+
+        return slice;
+    }
+
+
+    std::vector<Slice*> Shard::AcquireSparseSlices(double maxLiveFraction)
+    {
+        std::vector<Slice*> slices;
+
+        std::lock_guard<std::mutex> lock(m_slicesLock);
+
+        std::unordered_set<Slice*> groupSlices;
+        for (auto const & group : m_groups)
+        {
+            groupSlices.insert(group.second.begin(), group.second.end());
+        }
+
+        for (auto buffer : *m_sliceBuffers)
+        {
+            Slice* slice = Slice::GetSliceFromBuffer(buffer, GetSlicePtrOffset());
+
+            // Fully expired slices are already on their way to the Recycler,
+            // and the active slice is still receiving documents.
+            if (slice == m_activeSlice ||
+                slice->IsExpired() ||
+                !slice->IsFullyIngested() ||
+                groupSlices.find(slice) != groupSlices.end())
+            {
+                continue;
+            }
+
+            const DocIndex liveCount =
+                m_sliceCapacity - slice->GetExpiredCount();
+            if (static_cast<double>(liveCount) <=
+                maxLiveFraction * static_cast<double>(m_sliceCapacity))
+            {
+                Slice::IncrementRefCount(slice);
+                slices.push_back(slice);
+            }
+        }
+
+        return slices;
+    }
+
+
+    Slice* Shard::CreateCompactionSlice()
+    {
+        Slice* slice = new Slice(*this);
+        Slice::IncrementRefCount(slice);
+
+        std::lock_guard<std::mutex> lock(m_slicesLock);
+        AddSliceBuffer(*slice);
+
+        return slice;
+    }
+
+
+    void Shard::ExpireUnusedColumns(Slice& slice)
+    {
+        DocIndex index;
+        while (slice.TryAllocateDocument(index))
+        {
+            slice.CommitDocument();
+            DocumentHandleInternal(&slice, index).Expire();
+        }
+    }
+
+
+    void Shard::OpenGroup(GroupId groupId)
+    {
+        RetireActiveSlice();
+
+        std::lock_guard<std::mutex> lock(m_slicesLock);
+        m_isGroupOpen = true;
+        m_openGroup = groupId;
+        m_groups[groupId];
+    }
+
+
+    void Shard::CloseGroup()
+    {
+        RetireActiveSlice();
+
+        std::lock_guard<std::mutex> lock(m_slicesLock);
+        m_isGroupOpen = false;
+    }
+
+
+    void Shard::ExpireGroup(GroupId groupId)
+    {
+        std::vector<Slice*> slices;
+
+        {
+            std::lock_guard<std::mutex> lock(m_slicesLock);
+
+            LogAssertB(!m_isGroupOpen || m_openGroup != groupId,
+                       "Shard::ExpireGroup(): group is open.");
+
+            auto it = m_groups.find(groupId);
+            if (it == m_groups.end())
+            {
+                return;
+            }
+            slices.swap(it->second);
+            m_groups.erase(it);
+        }
+
+        // Recycling takes m_slicesLock, so slices are expired outside of it.
+        // The caller's Token keeps slices that were concurrently recycled by
+        // Delete() alive.
+        for (auto slice : slices)
+        {
+            if (slice->ExpireAllDocuments())
+            {
+                Slice::DecrementRefCount(slice);
+            }
+        }
+    }
+
+
+    void Shard::RetireActiveSlice()
+    {
+        Slice* slice = nullptr;
+        bool isGroupSlice = false;
+
+        {
+            std::lock_guard<std::mutex> lock(m_slicesLock);
+            slice = m_activeSlice;
+            m_activeSlice = nullptr;
+            isGroupSlice = m_isGroupOpen;
+        }
+
+        // Expiring the unused columns may recycle the slice, which takes
+        // m_slicesLock.
+        if (slice != nullptr && !isGroupSlice)
+        {
+            ExpireUnusedColumns(*slice);
+        }
+    }
+
+
+    void Shard::CopyColumnRows(Slice const & source,
+                               DocIndex from,
+                               Slice& destination,
+                               DocIndex to) const
+    {
+        void* const sourceBuffer = source.GetSliceBuffer();
+        void* const destinationBuffer = destination.GetSliceBuffer();
+
+        for (Rank rank = 0; rank <= c_maxRankValue; ++rank)
+        {
+            RowTableDescriptor const & rowTable = m_rowTables[rank];
+            const RowIndex excludedRow =
+                (rank == m_documentActiveRowId.GetRank()) ?
+                m_documentActiveRowId.GetIndex() :
+                rowTable.GetRowCount();
+            rowTable.CopyColumn(sourceBuffer,
+                                from,
+                                destinationBuffer,
+                                to,
+                                excludedRow);
+        }
+    }
+
+
+    // Must be called with m_slicesLock held.
+    void Shard::AddSliceBuffer(Slice& slice)
+    {
         std::vector<void*>* oldSlices = m_sliceBuffers;
         std::vector<void*>* const newSlices = new std::vector<void*>(*m_sliceBuffers);
-        newSlices->push_back(newSlice->GetSliceBuffer());
+        newSlices->push_back(slice.GetSliceBuffer());
 
         m_sliceBuffers = newSlices;
-        m_activeSlice = newSlice;
 
         // TODO: think if this can be done outside of the lock.
         std::unique_ptr<IRecyclable>
@@ -191,6 +516,21 @@ namespace BitFunnel
     }
 
 
+    // Must be called with m_slicesLock held.
+    void Shard::CreateNewActiveSlice()
+    {
+        Slice* newSlice = new Slice(*this);
+
+        AddSliceBuffer(*newSlice);
+        m_activeSlice = newSlice;
+
+        if (m_isGroupOpen)
+        {
+            m_groups[m_openGroup].push_back(newSlice);
+        }
+    }
+
+
     /* static */
     DocIndex Shard::GetCapacityForByteSize(size_t bufferSizeInBytes,
                                            IDocumentDataSchema const & schema,
@@ -234,6 +574,12 @@ namespace BitFunnel
     }
 
 
+    ptrdiff_t Shard::GetRowSummaryBit(RowId rowId) const
+    {
+        return GetRowTable(rowId.GetRank()).GetSummaryBit(rowId.GetIndex());
+    }
+
+
     RowTableDescriptor const & Shard::GetRowTable(Rank rank) const
     {
         return m_rowTables.at(rank);
@@ -264,6 +610,12 @@ namespace BitFunnel
     }
 
 
+    unsigned Shard::GetNumaNode() const
+    {
+        return m_numaNode;
+    }
+
+
     RowId Shard::GetDocumentActiveRowId() const
     {
         return m_documentActiveRowId;
@@ -312,6 +664,19 @@ namespace BitFunnel
         }
         currentOffset += DocTableDescriptor::GetBufferSize(sliceCapacity, docDataSchema);
 
+        //
+        // Row summary bitmap, with one bit for each row of each rank. The
+        // bits of each RowTable follow those of the RowTable before it.
+        //
+        currentOffset = RoundUp(currentOffset, sizeof(uint64_t));
+        ptrdiff_t summaryBitOffset = static_cast<ptrdiff_t>(currentOffset * 8);
+        size_t totalRowCount = 0;
+        for (Rank rank = 0; rank <= c_maxRankValue; ++rank)
+        {
+            totalRowCount += termTable.GetTotalRowCount(rank);
+        }
+        currentOffset += RowTableDescriptor::GetSummaryBufferSize(totalRowCount);
+
         //
         // RowTables
         //
@@ -323,9 +688,14 @@ namespace BitFunnel
 
             if (shard != nullptr)
             {
-                shard->m_rowTables.emplace_back(
-                    sliceCapacity, rowCount, rank, maxRank, currentOffset);
+                shard->m_rowTables.emplace_back(sliceCapacity,
+                                                rowCount,
+                                                rank,
+                                                maxRank,
+                                                currentOffset,
+                                                summaryBitOffset);
             }
+            summaryBitOffset += static_cast<ptrdiff_t>(rowCount);
 
             currentOffset += RowTableDescriptor::GetBufferSize(
                 sliceCapacity, rowCount, rank, maxRank);
@@ -374,6 +744,19 @@ namespace BitFunnel
                 // last Slice in the Shard.
                 m_activeSlice = nullptr;
             }
+
+            // A group Slice whose documents were all deleted no longer
+            // belongs to its group.
+            for (auto & group : m_groups)
+            {
+                auto & slices = group.second;
+                auto it = std::find(slices.begin(), slices.end(), &slice);
+                if (it != slices.end())
+                {
+                    slices.erase(it);
+                    break;
+                }
+            }
         }
 
         // Scheduling the Slice and the old list of slice buffers can be
@@ -408,11 +791,21 @@ namespace BitFunnel
 
         RowIdSequence rows(term, m_termTable);
 
+        // Batched ingestion defers the bits to a RowBitBuffer which merges
+        // them into the slice a quadword at a time.
+        RowBitBuffer* buffer = RowBitBuffer::GetAttached();
+
         for (auto const row : rows)
         {
-            m_rowTables[row.GetRank()].SetBit(sliceBuffer,
-                                              row.GetIndex(),
-                                              index);
+            RowTableDescriptor const & rowTable = m_rowTables[row.GetRank()];
+            if (buffer == nullptr)
+            {
+                rowTable.SetBit(sliceBuffer, row.GetIndex(), index);
+            }
+            else
+            {
+                rowTable.BufferBit(*buffer, sliceBuffer, row.GetIndex(), index);
+            }
         }
     }
 
@@ -511,6 +904,90 @@ namespace BitFunnel
     }
 
 
+    //*************************************************************************
+    //
+    // DensityProcessor
+    //
+    // ITaskProcessor which computes the densities of a block of consecutive
+    // rows for Shard::GetDensities(). Each task writes only the densities of
+    // its own block.
+    //
+    //*************************************************************************
+    class DensityProcessor : public ITaskProcessor
+    {
+    public:
+        DensityProcessor(std::vector<void*> const & buffers,
+                         RowTableDescriptor const & rowTable,
+                         RowTableDescriptor const & rowTable0,
+                         RowIndex activeRow,
+                         size_t activeBitCount,
+                         std::vector<double>& densities);
+
+        //
+        // ITaskProcessor methods
+        //
+
+        virtual void ProcessTask(size_t taskId) override;
+        virtual void Finished() override;
+
+        // Number of rows processed by each task.
+        static const RowIndex c_rowsPerTask = 64;
+
+    private:
+        std::vector<void*> const & m_buffers;
+        RowTableDescriptor const & m_rowTable;
+        RowTableDescriptor const & m_rowTable0;
+        const RowIndex m_activeRow;
+        const size_t m_activeBitCount;
+        std::vector<double>& m_densities;
+    };
+
+
+    DensityProcessor::DensityProcessor(std::vector<void*> const & buffers,
+                                       RowTableDescriptor const & rowTable,
+                                       RowTableDescriptor const & rowTable0,
+                                       RowIndex activeRow,
+                                       size_t activeBitCount,
+                                       std::vector<double>& densities)
+      : m_buffers(buffers),
+        m_rowTable(rowTable),
+        m_rowTable0(rowTable0),
+        m_activeRow(activeRow),
+        m_activeBitCount(activeBitCount),
+        m_densities(densities)
+    {
+    }
+
+
+    void DensityProcessor::ProcessTask(size_t taskId)
+    {
+        const RowIndex begin = taskId * c_rowsPerTask;
+        const RowIndex end =
+            std::min(begin + c_rowsPerTask, m_rowTable.GetRowCount());
+
+        for (RowIndex row = begin; row < end; ++row)
+        {
+            // Only count bits for active documents.
+            size_t setBitCount = 0;
+            for (auto buffer : m_buffers)
+            {
+                setBitCount += m_rowTable.GetBitCount(buffer,
+                                                      row,
+                                                      m_rowTable0,
+                                                      m_activeRow);
+            }
+
+            m_densities[row] =
+                static_cast<double>(setBitCount) / m_activeBitCount;
+        }
+    }
+
+
+    void DensityProcessor::Finished()
+    {
+    }
+
+
     std::vector<double> Shard::GetDensities(Rank rank) const
     {
         // Hold a token to ensure that m_sliceBuffers won't be recycled.
@@ -529,37 +1006,45 @@ namespace BitFunnel
         RowIndex active = (*RowIdSequence(m_termTable.GetDocumentActiveTerm(),
                                           m_termTable).begin()).GetIndex();
 
-        std::vector<double> densities;
-        for (RowIndex row = 0; row < rowTable.GetRowCount(); ++row)
+        // The number of active documents is the same for every row.
+        size_t activeBitCount = 0;
+        for (auto buffer : buffers)
         {
-            size_t activeBitCount = 0;
-            size_t setBitCount = 0;
-            for (auto buffer : buffers)
-            {
-                for (DocIndex doc = 0; doc < GetSliceCapacity(); ++doc)
-                {
-                    // Only count bits for active documents.
-                    if (rowTable0.GetBit(buffer, active, doc) != 0)
-                    {
-                        // This document is active in the index.
-                        // Go ahead and include its bits in the density
-                        // calculation.
-                        ++activeBitCount;
-                        if (rowTable.GetBit(buffer, row, doc) != 0)
-                        {
-                            ++setBitCount;
-                        }
-                    }
-                }
-            }
-            double density =
-                (activeBitCount == 0) ?
-                0.0 :
-                static_cast<double>(setBitCount) / activeBitCount;
+            activeBitCount += rowTable0.GetBitCount(buffer, active);
+        }
 
-            densities.push_back(density);
+        std::vector<double> densities(rowTable.GetRowCount(), 0.0);
+        if (activeBitCount == 0 || densities.empty())
+        {
+            return densities;
         }
 
+        // Distribute blocks of rows across threads.
+        const size_t taskCount =
+            (rowTable.GetRowCount() + DensityProcessor::c_rowsPerTask - 1) /
+            DensityProcessor::c_rowsPerTask;
+        const size_t threadCount =
+            std::min(taskCount,
+                     std::max(static_cast<size_t>(std::thread::hardware_concurrency()),
+                              static_cast<size_t>(1)));
+
+        std::vector<std::unique_ptr<ITaskProcessor>> processors;
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            processors.push_back(
+                std::unique_ptr<ITaskProcessor>(
+                    new DensityProcessor(buffers,
+                                         rowTable,
+                                         rowTable0,
+                                         active,
+                                         activeBitCount,
+                                         densities)));
+        }
+
+        auto distributor =
+            Factories::CreateTaskDistributor(processors, taskCount);
+        distributor->WaitForCompletion();
+
         return densities;
     }
 
@@ -23,11 +23,14 @@
 #pragma once
 
 
+#include <atomic>                           // std::atomic member.
 #include <memory>                           // std::unique_ptr member.
 #include <ostream>                          // TODO: Remove this temporary include.
+#include <unordered_map>                    // std::unordered_map member.
 #include <vector>
 
 #include "BitFunnel/BitFunnelTypes.h"       // ShardId parameter, embedded.
+#include "BitFunnel/Index/IIngestor.h"      // GroupId parameter.
 #include "BitFunnel/Index/IShard.h"         // Base class.
 #include "BitFunnel/NonCopyable.h"          // Base class.
 #include "BitFunnel/Term.h"                 // Term parameter.
@@ -46,6 +49,7 @@ namespace BitFunnel
     class ITermToText;
     class ITokenManager;
     class IRecycler;
+    class MemoryMappedFile;
     class Slice;
     class Term;     // TODO: Remove this temporary declaration.
 
@@ -68,16 +72,24 @@ namespace BitFunnel
         // Constructs an empty Shard with no slices. sliceBufferSize must be
         // sufficient to hold the minimum capacity Slice. The minimum capacity
         // is determined by a value returned by Row::DocumentsInRank0Row(1).
+        // Document frequencies are counted exactly when statisticsBytes is
+        // zero and approximately in about statisticsBytes of memory
+        // otherwise.
         Shard(ShardId id,
               IRecycler& recycler,
               ITokenManager& tokenManager,
               ITermTable const & termTable,
               IDocumentDataSchema const & docDataSchema,
               ISliceBufferAllocator& sliceBufferAllocator,
-              size_t sliceBufferSize);
+              size_t sliceBufferSize,
+              size_t statisticsBytes,
+              unsigned numaNode);
 
         virtual ~Shard();
 
+        // Sets the bits for the term's rows in the given column. When the
+        // calling thread has a RowBitBuffer attached, the bits are recorded
+        // in the buffer and reach the slice when the buffer is merged.
         void AddPosting(Term const & term, DocIndex index, void* sliceBuffer);
         void AssertFact(FactHandle fact, bool value, DocIndex index, void* sliceBuffer);
 
@@ -100,6 +112,9 @@ namespace BitFunnel
         // Return the size of the slice buffer in bytes.
         virtual size_t GetSliceBufferSize() const override;
 
+        // Returns the NUMA node the shard is bound to.
+        virtual unsigned GetNumaNode() const override;
+
         // Returns a vector of slice buffers for this shard.  The callers needs
         // to obtain a Token from ITokenManager to protect the pointer to the
         // list of slice buffers, as well as the buffers themselves.
@@ -108,6 +123,10 @@ namespace BitFunnel
         // Returns the offset of the row in the slice buffer in a shard.
         virtual ptrdiff_t GetRowOffset(RowId rowId) const override;
 
+        // Returns the position of the row's summary bit, in bits from the
+        // start of a slice buffer.
+        virtual ptrdiff_t GetRowSummaryBit(RowId rowId) const override;
+
         virtual void TemporaryWriteDocumentFrequencyTable(
             std::ostream& out,
             ITermToText const * termToText) const override;
@@ -130,17 +149,27 @@ namespace BitFunnel
         // use to populate document's contents. When there is no space in the
         // current slice and no memory available in the SliceBufferAllocator,
         // this method throws.
+        DocumentHandleInternal AllocateDocument(DocId id);
+
+        // Allocates storage for up to maxCount new documents in consecutive
+        // columns of the active slice, creating a new slice if required.
+        // Returns the slice and sets first and count to the range of
+        // DocIndexes allocated, where count is at least 1. The caller
+        // constructs a DocumentHandleInternal for each column. Allows a
+        // batch of documents to reserve its columns with a few atomic
+        // operations.
         //
         // Implementation:
-        // with (m_slicesLock)
-        //   DocIndex docIndex;
-        //   while (m_activeSlice == nullptr || !m_activeSlice->TryAllocateDocument(docIndex))
-        //   {
-        //       CreateNewActiveSlice();
-        //   }
-        //
-        //   return DocumentHandleInternal(m_activeSlice, docIndex);
-        DocumentHandleInternal AllocateDocument(DocId id);
+        //   loop
+        //     with (Token)
+        //       if (m_activeSlice->TryAllocateDocuments(maxCount, first) > 0)
+        //         return m_activeSlice
+        //     with (m_slicesLock)
+        //       if (m_activeSlice is still the full slice)
+        //         CreateNewActiveSlice()
+        Slice* AllocateDocuments(DocIndex maxCount,
+                                 DocIndex& first,
+                                 DocIndex& count);
 
         // Loads a Slice from a previously serialized state and adds it to the
         // list of Slices. As part of deserialization, LoadSlice loads
@@ -153,9 +182,72 @@ namespace BitFunnel
         // expected that the index may not be able to restore some or all slices
         // from the cache, and the host will re-ingest the documents which were
         // not restored.
-        //void LoadSlice(std::istream& input);
+        //
+        // Loaded slices never become the active slice. New documents are
+        // ingested into newly created slices.
+        Slice* LoadSlice(std::istream& input);
 
-        // TODO: WriteSlice here or in Slice?
+        // Same as LoadSlice(), except that the slice buffer is memory mapped
+        // directly from the file with the given name instead of being copied
+        // into a buffer from the ISliceBufferAllocator. The mapping is
+        // copy-on-write, so the file is never modified.
+        Slice* MapSlice(char const * fileName);
+
+        //
+        // Slice compaction.
+        //
+
+        // Returns the fully ingested Slices, other than the active Slice, in
+        // which at most maxLiveFraction of the columns hold unexpired
+        // documents. Slices that belong to a group are skipped, since they
+        // are recycled with their group. The reference count of each
+        // returned Slice is incremented, so it cannot be recycled until the
+        // caller calls Slice::DecrementRefCount().
+        std::vector<Slice*> AcquireSparseSlices(double maxLiveFraction);
+
+        // Creates a Slice to receive documents moved out of sparse Slices.
+        // The Slice is added to the list of slice buffers but never becomes
+        // the active Slice. Its reference count is incremented as for
+        // AcquireSparseSlices().
+        Slice* CreateCompactionSlice();
+
+        // Copies the row bits of column from in source to column to in
+        // destination, for all rows other than the document active row.
+        // The destination is a compaction slice, which only the calling
+        // thread writes, so its bits are set with plain stores.
+        // Rows of rank greater than 0 are shared by several columns, so the
+        // copy may set bits for documents that share the destination
+        // quadword. This yields additional false positives but never false
+        // negatives.
+        void CopyColumnRows(Slice const & source,
+                            DocIndex from,
+                            Slice& destination,
+                            DocIndex to) const;
+
+        // Allocates and commits the remaining columns of the slice and
+        // expires them, so that the slice can be recycled once its documents
+        // expire. Used for slices that will receive no more documents.
+        void ExpireUnusedColumns(Slice& slice);
+
+        //
+        // Document groups.
+        //
+
+        // Starts a new group. Documents allocated from now on are placed in
+        // Slices that belong to the group. The active Slice is retired from
+        // ingestion, so no Slice holds documents of more than one group.
+        // Must not be called concurrently with AllocateDocument().
+        void OpenGroup(GroupId groupId);
+
+        // Ends the open group, if any. Documents allocated from now on are
+        // placed in Slices that belong to no group. Must not be called
+        // concurrently with AllocateDocument().
+        void CloseGroup();
+
+        // Expires all Slices of the group at once and schedules them for
+        // recycling. The group must not be open. The caller must hold a
+        // Token.
+        void ExpireGroup(GroupId groupId);
 
         // Remove slice buffer and its Slice from the list of slices. Throws if
         // slice buffer wasn't found in the list of active slice buffers.
@@ -180,14 +272,23 @@ namespace BitFunnel
         void* AllocateSliceBuffer();
 
         // Allocates and loads the contents of the slice buffer from the
-        // stream. The stream has the size of the buffer embedded as the first
-        // element, and the function verifies that it matches the value stored
-        // in buffer m_sliceBufferSize.
+        // stream. The stream begins with the header written by
+        // WriteSliceBuffer(), and the function verifies that it matches the
+        // buffer size and the descriptors of this Shard. Throws
+        // RecoverableError if the stream is not compatible.
         void* LoadSliceBuffer(std::istream& input);
 
+        // Verifies the header at the current position of the stream, as does
+        // LoadSliceBuffer(), and returns a pointer to the slice buffer within
+        // the memory mapped file that backs the stream. On return, the stream
+        // is positioned just after the slice buffer.
+        void* MapSliceBuffer(std::istream& input, MemoryMappedFile const & file);
+
         // Writes the contents of the slice buffer to the output stream. The
-        // size of the stream is stored in m_sliceBufferSize and is written
-        // before the buffer's data for compatibility checks.
+        // buffer is preceded by a versioned header containing the buffer size
+        // and the DocTable and RowTable descriptors for compatibility checks,
+        // and is padded to start on a page boundary within the stream so that
+        // it can be memory mapped by MapSlice().
         void WriteSliceBuffer(void* buffer, std::ostream& output);
 
         // Releases the slice buffer and returns it to the
@@ -221,7 +322,20 @@ namespace BitFunnel
         // is stored. This is the same offset for all slices in the Shard.
         static ptrdiff_t GetSlicePtrOffset();
 
+        // Version of the slice persistence format written by
+        // WriteSliceBuffer(). Must be incremented whenever the format changes.
+        static const uint32_t c_sliceFormatVersion = 2;
+
     private:
+        // Adds the slice's buffer to m_sliceBuffers. Must be called with
+        // m_slicesLock held.
+        void AddSliceBuffer(Slice& slice);
+
+        // Writes and verifies the header which precedes each persisted slice
+        // buffer.
+        void WriteSliceHeader(std::ostream& output) const;
+        void ReadSliceHeader(std::istream& input) const;
+
         // Tries to add a new slice. Throws if no memory in the allocator.
         // Implementation:
         //   std::vector<void*>* newSlices = new std::vector<void*>(m_sliceBuffers);
@@ -230,12 +344,20 @@ namespace BitFunnel
         //   swap newSlices and m_sliceBuffers, schedule newSlices for recycling.
         void CreateNewActiveSlice();
 
+        // Retires the active Slice from ingestion. A Slice that belongs to
+        // no group has its unused columns expired, since only its documents
+        // can expire it.
+        void RetireActiveSlice();
+
         //
         // Constructor parameters.
         //
 
         const ShardId m_shardId;
 
+        // NUMA node on which slice buffers are allocated.
+        const unsigned m_numaNode;
+
         IRecycler& m_recycler;
 
         ITokenManager& m_tokenManager;
@@ -262,8 +384,9 @@ namespace BitFunnel
 
         // Pointer to the current Slice where documents are being ingested to.
         // Initially set to nullptr. First call to AllocateDocument() will
-        // allocate a new Slice via CreateNewActiveSlice().
-        Slice* m_activeSlice;
+        // allocate a new Slice via CreateNewActiveSlice(). Only changed with
+        // m_slicesLock held, but read without it when allocating documents.
+        std::atomic<Slice*> m_activeSlice;
 
         // Vector of pointers to slice buffers.
         //
@@ -303,6 +426,16 @@ namespace BitFunnel
         // of vectors is implemented.
         std::atomic<std::vector<void*>*> m_sliceBuffers;
 
+        // Group of the Slices created by CreateNewActiveSlice() when
+        // m_isGroupOpen is true.
+        bool m_isGroupOpen;
+        GroupId m_openGroup;
+
+        // Slices of each group which has not yet been expired. Slices whose
+        // documents are all deleted before the group expires are removed by
+        // RecycleSlice(). Protected by m_slicesLock.
+        std::unordered_map<GroupId, std::vector<Slice*>> m_groups;
+
        // Capacity of a Slice. All Slices in the shard have the same capacity.
         const DocIndex m_sliceCapacity;
 
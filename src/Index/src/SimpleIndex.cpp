@@ -54,7 +54,11 @@ namespace BitFunnel
     SimpleIndex::SimpleIndex(IFileSystem& fileSystem)
         : m_fileSystem(fileSystem),
           m_isStarted(false),
-          m_blockAllocatorBufferSize(0)
+          m_blockAllocatorBufferSize(0),
+          m_pageSize(PageSize::Default),
+          m_numaNodeCount(1),
+          m_statisticsBytes(0),
+          m_isForwardIndexEnabled(false)
     {
     }
 
@@ -145,6 +149,22 @@ namespace BitFunnel
     }
 
 
+    void SimpleIndex::SetSliceBufferPlacement(PageSize pageSize,
+                                              unsigned numaNodeCount)
+    {
+        EnsureStarted(false);
+        m_pageSize = pageSize;
+        m_numaNodeCount = numaNodeCount;
+    }
+
+
+    void SimpleIndex::SetStatisticsMemory(size_t bytes)
+    {
+        EnsureStarted(false);
+        m_statisticsBytes = bytes;
+    }
+
+
     void SimpleIndex::SetSliceBufferAllocator(
         std::unique_ptr<ISliceBufferAllocator> sliceAllocator)
     {
@@ -169,6 +189,13 @@ namespace BitFunnel
     // Configuration methods.
     //
 
+    void SimpleIndex::EnableForwardIndex()
+    {
+        EnsureStarted(false);
+        m_isForwardIndexEnabled = true;
+    }
+
+
     void SimpleIndex::ConfigureForStatistics(char const * directory,
                                              size_t gramSize,
                                              bool generateTermToText)
@@ -281,9 +308,10 @@ namespace BitFunnel
 
         if (m_idfTable == nullptr)
         {
-            auto input = m_fileManager->IndexedIdfTable(0).OpenForRead();
+            auto file = m_fileManager->IndexedIdfTable(0).OpenForMappedRead();
             Term::IdfX10 defaultIdf = 60;   // TODO: use proper value here.
-            m_idfTable = Factories::CreateIndexedIdfTable(*input, defaultIdf);
+            m_idfTable = Factories::CreateIndexedIdfTable(std::move(file),
+                                                          defaultIdf);
         }
 
         if (m_facts.get() == nullptr)
@@ -354,6 +382,13 @@ namespace BitFunnel
     {
         EnsureStarted(false);
 
+        // The forward index blob must be registered before the schema
+        // determines the size of the DocTable.
+        if (m_isForwardIndexEnabled)
+        {
+            m_forwardIndex.reset(new ForwardIndex(*m_schema));
+        }
+
         if (m_sliceAllocator.get() == nullptr)
         {
             const ShardId tempId = 0;
@@ -374,9 +409,17 @@ namespace BitFunnel
                 blockCount = m_blockAllocatorBufferSize / m_blockSize;
             }
 
+            // Slice buffer memory is committed as it is first used, so the
+            // allocator reserves address space well beyond the expected block
+            // count. The requested buffer size is a hint rather than a hard
+            // limit on the number of Slices.
+            const size_t c_reservationFactor = 16;
+
             m_sliceAllocator =
                 Factories::CreateSliceBufferAllocator(m_blockSize,
-                                                      blockCount);
+                                                      blockCount * c_reservationFactor,
+                                                      m_pageSize,
+                                                      m_numaNodeCount);
         }
 
         if (m_recycler.get() == nullptr)
@@ -389,7 +432,9 @@ namespace BitFunnel
                                                *m_recycler,
                                                *m_termTables,
                                                *m_shardDefinition,
-                                               *m_sliceAllocator);
+                                               *m_sliceAllocator,
+                                               m_statisticsBytes,
+                                               m_forwardIndex.get());
 
         m_isStarted = true;
     }
@@ -447,6 +492,13 @@ namespace BitFunnel
     }
 
 
+    ForwardIndex const * SimpleIndex::GetForwardIndex() const
+    {
+        EnsureStarted(true);
+        return m_forwardIndex.get();
+    }
+
+
     ITermTable const & SimpleIndex::GetTermTable0() const
     {
         return GetTermTable(0);
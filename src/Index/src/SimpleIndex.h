@@ -28,6 +28,7 @@
 #include "BitFunnel/Configuration/IFileSystem.h"    // Parameterizes std::unique_ptr.
 #include "BitFunnel/Configuration/IShardDefinition.h"  // Parameterizes std::unique_ptr.
 #include "BitFunnel/IFileManager.h"                 // Parameterizes std::unique_ptr.
+#include "BitFunnel/Index/ForwardIndex.h"           // Parameterizes std::unique_ptr.
 #include "BitFunnel/Index/IConfiguration.h"         // Parameterizes std::unique_ptr.
 #include "BitFunnel/Index/IDocumentDataSchema.h"    // Parameterizes std::unique_ptr.
 #include "BitFunnel/Index/IIndexedIdfTable.h"       // Parameterizes std::unique_ptr.
@@ -39,6 +40,7 @@
 #include "BitFunnel/Index/ITermTableCollection.h"   // Parameterizes std::unique_ptr.
 #include "BitFunnel/NonCopyable.h"                  // Base class.
 #include "BitFunnel/Term.h"                         // Term::GramSize embedded.
+#include "BitFunnel/Utilities/IBlockAllocator.h"    // PageSize embedded.
 
 
 namespace BitFunnel
@@ -71,12 +73,17 @@ namespace BitFunnel
             std::unique_ptr<IShardDefinition> definition) override;
 
         virtual void SetBlockAllocatorBufferSize(size_t size) override;
+        virtual void SetSliceBufferPlacement(PageSize pageSize,
+                                             unsigned numaNodeCount) override;
+        virtual void SetStatisticsMemory(size_t bytes) override;
         virtual void SetSliceBufferAllocator(
             std::unique_ptr<ISliceBufferAllocator> sliceAllocator) override;
 
         virtual void SetTermTableCollection(
             std::unique_ptr<ITermTableCollection> termTables) override;
 
+        virtual void EnableForwardIndex() override;
+
 
         virtual void ConfigureForStatistics(char const * directory,
                                             size_t gramSize,
@@ -98,6 +105,7 @@ namespace BitFunnel
         virtual IFileSystem & GetFileSystem() const override;
         virtual IIngestor & GetIngestor() const override;
         virtual IRecycler & GetRecycler() const override;
+        virtual ForwardIndex const * GetForwardIndex() const override;
         virtual ITermTable const & GetTermTable0() const override;
         virtual ITermTable const & GetTermTable(ShardId shardId) const override;
 
@@ -132,9 +140,16 @@ namespace BitFunnel
         std::unique_ptr<IConfiguration> m_configuration;
 
         size_t m_blockAllocatorBufferSize;
+        PageSize m_pageSize;
+        unsigned m_numaNodeCount;
+        size_t m_statisticsBytes;
         std::unique_ptr<ISliceBufferAllocator> m_sliceAllocator;
         std::unique_ptr<IShardDefinition> m_shardDefinition;
 
+        // Declared before m_ingestor, which refers to it.
+        bool m_isForwardIndexEnabled;
+        std::unique_ptr<ForwardIndex> m_forwardIndex;
+
         std::unique_ptr<IIngestor> m_ingestor;
     };
 }
@@ -21,8 +21,12 @@
 // THE SOFTWARE.
 
 
+#include <algorithm>
+#include <thread>
+
 #include "BitFunnel/Utilities/StreamUtilities.h"
 #include "LoggerInterfaces/Logging.h"
+#include "MemoryMappedFile.h"
 #include "Shard.h"
 
 
@@ -33,8 +37,8 @@ namespace BitFunnel
           m_capacity(shard.GetSliceCapacity()),
           m_refCount(1),
           m_buffer(shard.AllocateSliceBuffer()),
-          m_unallocatedCount(shard.GetSliceCapacity()),
-          m_commitPendingCount(0),
+          m_allocatedCount(0),
+          m_committedCount(0),
           m_expiredCount(0)
     {
         Initialize();
@@ -54,8 +58,8 @@ namespace BitFunnel
           m_capacity(shard.GetSliceCapacity()),
           m_refCount(1),
           m_buffer(shard.LoadSliceBuffer(input)),
-          m_unallocatedCount(StreamUtilities::ReadField<DocIndex>(input)),
-          m_commitPendingCount(StreamUtilities::ReadField<DocIndex>(input)),
+          m_allocatedCount(m_capacity - StreamUtilities::ReadField<DocIndex>(input)),
+          m_committedCount(m_allocatedCount - StreamUtilities::ReadField<DocIndex>(input)),
           m_expiredCount(StreamUtilities::ReadField<DocIndex>(input))
     {
         // Initializes the slice buffer, place pointer to a Slice at the 
@@ -72,12 +76,37 @@ namespace BitFunnel
     }
 
 
+    Slice::Slice(Shard& shard,
+                 std::istream& input,
+                 std::unique_ptr<MemoryMappedFile> mappedFile)
+        : m_shard(shard),
+          m_capacity(shard.GetSliceCapacity()),
+          m_refCount(1),
+          m_mappedFile(std::move(mappedFile)),
+          m_buffer(shard.MapSliceBuffer(input, *m_mappedFile)),
+          m_allocatedCount(m_capacity - StreamUtilities::ReadField<DocIndex>(input)),
+          m_committedCount(m_allocatedCount - StreamUtilities::ReadField<DocIndex>(input)),
+          m_expiredCount(StreamUtilities::ReadField<DocIndex>(input))
+    {
+        // The Slice pointer and the variable size blob pointers are the only
+        // writes to the mapped buffer, so only the pages holding them become
+        // private copies. The RowTables remain backed by the file.
+        Initialize();
+        GetDocTable().LoadVariableSizeBlobs(m_buffer, input);
+    }
+
+
     Slice::~Slice()
     {
         try
         {
             GetDocTable().Cleanup(m_buffer);
-            m_shard.ReleaseSliceBuffer(m_buffer);
+
+            // Mapped buffers are released along with m_mappedFile.
+            if (m_mappedFile == nullptr)
+            {
+                m_shard.ReleaseSliceBuffer(m_buffer);
+            }
         }
         catch (...)
         {
@@ -92,21 +121,23 @@ namespace BitFunnel
         // Only complete slices are allowed to be persisted.
         // TODO: Do we really need the following check?
         // Temporarily disable to allow testing of write from the repl.
-        //LogAssertB((m_unallocatedCount + m_commitPendingCount) == 0,
+        //LogAssertB(m_committedCount == m_capacity,
         //           "Only full slices are allowed to be persisted. This slice has %u unallocated"
         //           " and %u commit pending columns",
-        //           m_unallocatedCount,
-        //           m_commitPendingCount);
+        //           m_capacity - m_allocatedCount,
+        //           m_allocatedCount - m_committedCount);
 
         // WARNING: Field write order must be consistent with the order the
         // fields are declared in the header file.
 
         m_shard.WriteSliceBuffer(m_buffer, output);
 
-        // TODO: Why do we write out m_unallocatedCount and m_commitPendingCount,
+        // TODO: Why do we write out the unallocated and commit pending counts,
         // when the assert, above requires they both be zero?
-        StreamUtilities::WriteField<DocIndex>(output, m_unallocatedCount);
-        StreamUtilities::WriteField<DocIndex>(output, m_commitPendingCount);
+        const DocIndex allocatedCount = m_allocatedCount;
+        const DocIndex committedCount = m_committedCount;
+        StreamUtilities::WriteField<DocIndex>(output, m_capacity - allocatedCount);
+        StreamUtilities::WriteField<DocIndex>(output, allocatedCount - committedCount);
         StreamUtilities::WriteField<DocIndex>(output, m_expiredCount);
 
         // Write out variable size blobs which are not part of the slice buffer.
@@ -122,14 +153,18 @@ namespace BitFunnel
 
     bool Slice::CommitDocument()
     {
-        std::lock_guard<std::mutex> lock(m_docIndexLock);
+        return CommitDocuments(1);
+    }
 
-        LogAssertB(m_commitPendingCount > 0,
-                   "CommitDocument with m_commitPendingCount == 0");
 
-        --m_commitPendingCount;
+    bool Slice::CommitDocuments(DocIndex count)
+    {
+        const DocIndex committedCount = (m_committedCount += count);
+
+        LogAssertB(committedCount <= m_allocatedCount,
+                   "Slice committed more documents than allocated.");
 
-        return (m_unallocatedCount + m_commitPendingCount) == 0;
+        return committedCount == m_capacity;
     }
 
 
@@ -147,17 +182,53 @@ namespace BitFunnel
 
     bool Slice::ExpireDocument()
     {
-        std::lock_guard<std::mutex> lock(m_docIndexLock);
+        DocIndex expiredCount = m_expiredCount;
+        do
+        {
+            // A concurrent Delete() may find a document whose Slice has just
+            // been retired along with its group.
+            if (expiredCount == m_capacity)
+            {
+                return false;
+            }
+
+            // Cannot expire more than what was committed.
+            LogAssertB(expiredCount < m_committedCount,
+                       "Slice expired more documents than committed.");
+        }
+        while (!m_expiredCount.compare_exchange_weak(expiredCount,
+                                                     expiredCount + 1));
 
-        // Cannot expire more than what was committed.
-        const DocIndex committedCount =
-            m_capacity - m_unallocatedCount - m_commitPendingCount;
-        LogAssertB(m_expiredCount < committedCount,
-                   "Slice expired more documents than committed.");
+        return expiredCount + 1 == m_capacity;
+    }
 
-        m_expiredCount++;
 
-        return m_expiredCount == m_capacity;
+    bool Slice::ExpireAllDocuments()
+    {
+        // Stops further allocation and counts the columns that were never
+        // allocated as committed.
+        const DocIndex allocatedCount = m_allocatedCount.exchange(m_capacity);
+        m_committedCount += m_capacity - allocatedCount;
+
+        // A concurrent AddBatch() may still hold columns it reserved before
+        // the Slice was retired. They are committed once ingested.
+        while (m_committedCount != m_capacity)
+        {
+            std::this_thread::yield();
+        }
+
+        DocIndex expiredCount = m_expiredCount;
+        do
+        {
+            if (expiredCount == m_capacity)
+            {
+                return false;
+            }
+        }
+        while (!m_expiredCount.compare_exchange_weak(expiredCount,
+                                                     m_capacity));
+
+        return true;
     }
 
 
@@ -217,19 +288,40 @@ namespace BitFunnel
     }
 
 
+    bool Slice::IsFullyIngested() const
+    {
+        return m_committedCount == m_capacity;
+    }
+
+
+    DocIndex Slice::GetExpiredCount() const
+    {
+        return m_expiredCount;
+    }
+
+
     bool Slice::TryAllocateDocument(size_t& index)
     {
-        std::lock_guard<std::mutex> lock(m_docIndexLock);
+        return TryAllocateDocuments(1, index) != 0;
+    }
+
 
-        if (m_unallocatedCount == 0)
+    DocIndex Slice::TryAllocateDocuments(DocIndex maxCount, DocIndex& first)
+    {
+        DocIndex allocatedCount = m_allocatedCount;
+        DocIndex count;
+        do
         {
-            return false;
+            if (allocatedCount == m_capacity)
+            {
+                return 0;
+            }
+            count = (std::min)(maxCount, m_capacity - allocatedCount);
         }
+        while (!m_allocatedCount.compare_exchange_weak(allocatedCount,
+                                                       allocatedCount + count));
 
-        index = m_capacity - m_unallocatedCount;
-        m_unallocatedCount--;
-        m_commitPendingCount++;
-
-        return true;
+        first = allocatedCount;
+        return count;
     }
 }
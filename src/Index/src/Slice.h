@@ -23,9 +23,10 @@
 #pragma once
 
 #include <atomic>
+#include <iosfwd>
+#include <memory>                       // std::unique_ptr member.
 #include <stddef.h>
 #include <stdint.h>
-#include <mutex>
 
 #include "BitFunnel/NonCopyable.h"      // Inherits from NonCopyable.
 #include "BitFunnel/BitFunnelTypes.h"   // for DocIndex, Rank.
@@ -35,6 +36,7 @@ namespace BitFunnel
 {
     class DocumentFrequencyTableBuilder;
     class DocTableDescriptor;
+    class MemoryMappedFile;
     class RowTableDescriptor;
     class Shard;
 
@@ -107,6 +109,8 @@ namespace BitFunnel
     //
     // DocTable data
     // <padding>
+    // Row summary bits (one bit per row of each rank, see RowTableDescriptor)
+    // <padding>
     // RowTable0 data
     // <padding>
     // ... (RowTables for other ranks which have rows)
@@ -138,6 +142,14 @@ namespace BitFunnel
         // descriptors are not compatible.
         Slice(Shard& shard, std::istream& input);
 
+        // Same as above, except that the slice buffer is not allocated but
+        // resides in the memory mapped file that backs the input stream. The
+        // Slice takes ownership of the mapping and releases it on
+        // destruction.
+        Slice(Shard& shard,
+              std::istream& input,
+              std::unique_ptr<MemoryMappedFile> mappedFile);
+
         // Releases all heap-allocated data blobs, returns the slice buffer
         // back to its allocator and destroys the Slice.
         ~Slice();
@@ -168,29 +180,37 @@ namespace BitFunnel
         // Attempts to allocate a DocIndex. If Slice is not full, this method
         // returns true with index set to the allocated DocIndex. Otherwise
         // this method returns false.
-        // Thread safe.
+        // Thread safe and lock free.
+        bool TryAllocateDocument(DocIndex& index);
+
+        // Attempts to allocate up to maxCount consecutive DocIndexes, so that
+        // a batch of documents reserves its columns with a single atomic
+        // operation. Returns the number of DocIndexes allocated, starting at
+        // first. Returns 0 if the Slice is full.
+        // Thread safe and lock free.
         //
         // Implementation:
-        // with (m_docIndexLock)
-        //   if (m_unallocated == 0) return false;
-        //   m_unallocatedCount--
-        //   m_commitPendingCount++
-        //   return true
-        bool TryAllocateDocument(DocIndex& index);
+        //   do
+        //     allocated = m_allocatedCount
+        //     if (allocated == m_capacity) return 0
+        //     count = min(maxCount, m_capacity - allocated)
+        //   until CAS(m_allocatedCount, allocated, allocated + count)
+        //   first = allocated
+        //   return count
+        DocIndex TryAllocateDocuments(DocIndex maxCount, DocIndex& first);
 
         // Makes document visible to the matcher. May only be called once per
         // DocIndex value. Returns true if this was the last document in this
         // slice to commit, in which case the caller is responsible of
         // scheduling the Slice for backup. Returns false otherwise.
-        // Thread safe.
-        //
-        // Implementation:
-        // with (m_docIndexLock)
-        //   LogAssert(m_commitPendingCount > 0)
-        //   --m_commitPendingCount;
-        //   return (m_unallocated + m_commitPending) == 0;
+        // Thread safe and lock free.
         bool CommitDocument();
 
+        // Same as count calls to CommitDocument() in a single atomic
+        // operation. Returns true if the last of the documents was the last
+        // document in this slice to commit.
+        bool CommitDocuments(DocIndex count);
+
         // Hides document from future matching operations. May only be called
         // once per DocIndex value.  DocIndex value must have been successfully
         // allocated by TryAllocateDocument().  Returns true if the entire
@@ -200,11 +220,25 @@ namespace BitFunnel
         // Thread safe.
         //
         // Implementation:
-        // with (m_docIndexLock)
-        //   m_expiredCount++;
-        //   return m_expiredCount == m_capacity.
+        // A compare-and-swap loop increments m_expiredCount, so that the
+        // count never exceeds the committed count and exactly one caller
+        // sees it reach m_capacity.
+        //
+        // Returns false without effect if the Slice was already retired by
+        // ExpireAllDocuments().
         bool ExpireDocument();
 
+        // Expires every column of the Slice at once, including columns that
+        // were never allocated, so that no further documents can be added.
+        // Used to retire all of the Slice's documents without per document
+        // work. Returns true if this call fully expired the Slice, in which
+        // case the caller is responsible of recycling the Slice, as for
+        // ExpireDocument(). Returns false if the Slice was already fully
+        // expired. Documents pending commit are waited for, so the call may
+        // race with ingestion into the Slice.
+        // Thread safe.
+        bool ExpireAllDocuments();
+
         // Returns true if the Slice is fully expired, meaning that all of its
         // documents are expired. In this case the Slice can be removed from
         // the index.
@@ -212,6 +246,14 @@ namespace BitFunnel
         // Slices are scheduled for recycling. Think if this is needed at all.
         bool IsExpired() const;
 
+        // Returns true if all columns of the Slice have been allocated and
+        // committed.
+        bool IsFullyIngested() const;
+
+        // Returns the number of documents which have been expired from the
+        // Slice.
+        DocIndex GetExpiredCount() const;
+
         // Extracts Slice information from the buffer where its data is stored.
         // Slice places a pointer to itself at the offset which is controlled
         // by Shard.
@@ -244,14 +286,6 @@ namespace BitFunnel
         // Capacity of the slice.
         const size_t m_capacity;
 
-        // Lock protecting operations on DocIndex members below to guarantee
-        // atomic state changes that depend on these values.
-        // There isn't a straightforward way to use std::atomic because
-        // ExpireDocument uses `m_unallocatedCount - m_commitPending`.
-        // DESIGN NOTE: made mutable in order to be able to acquire a lock from
-        // const methods.
-        mutable std::mutex m_docIndexLock;
-
         // Reference count of the Slice. Initially Slice is created with one
         // reference. Slice taken for a backup increases its reference count
         // by one for the duration of the backup writing and then is decreased
@@ -260,6 +294,11 @@ namespace BitFunnel
         // for recycling.
         std::atomic<uint32_t> m_refCount;
 
+        // Memory mapped file which holds m_buffer for slices created by
+        // Shard::MapSlice(). nullptr for slices whose buffer came from the
+        // ISliceBufferAllocator.
+        std::unique_ptr<MemoryMappedFile> m_mappedFile;
+
         // WARNING: The persistence format depends on the order in which the
         // following members are declared. If the order is changed, it is
         // neccesary to update the corresponding code in the Write() method.
@@ -268,17 +307,24 @@ namespace BitFunnel
         // Slice. See the class comment for more details on buffer layout.
         void* const m_buffer;
 
-        // The number of unallocated DocIndex'es in the slice. When created,
-        // Slice starts with the value of m_capacity in this field and gradually
-        // goes down as documents are being ingested.
-        size_t m_unallocatedCount;
+        // The number of allocated DocIndex'es in the slice. DocIndex'es are
+        // allocated in ascending order, so this is also the next DocIndex to
+        // allocate. Persisted as the number of unallocated DocIndex'es.
+        std::atomic<size_t> m_allocatedCount;
 
-        // The number of DocIndex'es that have been allocated but not yet
-        // committed by a call to CommitDocument().
-        size_t m_commitPendingCount;
+        // The number of DocIndex'es that have been committed by a call to
+        // CommitDocument(). Persisted as the number of DocIndex'es that have
+        // been allocated but not yet committed.
+        std::atomic<size_t> m_committedCount;
 
         // The number of DocIndex'es that have been expired from the slice.
         // When this value reaches m_capacity, the slice can be recycled.
+        //
+        // DESIGN NOTE: The three counts are updated independently with
+        // atomic operations rather than under a common lock. A count may
+        // therefore briefly lag behind a count it depends on, but never
+        // passes it: documents are allocated before they are committed and
+        // committed before they are expired.
         std::atomic<size_t> m_expiredCount;
     };
 }
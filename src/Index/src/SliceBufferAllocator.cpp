@@ -25,6 +25,7 @@
 
 #include "BitFunnel/Index/Factories.h"
 #include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/Numa.h"
 #include "LoggerInterfaces/Logging.h"
 #include "SliceBufferAllocator.h"
 
@@ -32,40 +33,108 @@ namespace BitFunnel
 {
     std::unique_ptr<ISliceBufferAllocator>
         Factories::CreateSliceBufferAllocator(size_t blockSize,
-                                              size_t blockCount)
+                                              size_t maxBlockCount,
+                                              PageSize pageSize,
+                                              unsigned numaNodeCount)
     {
         return std::unique_ptr<ISliceBufferAllocator>(
-            new SliceBufferAllocator(blockSize, blockCount));
+            new SliceBufferAllocator(blockSize,
+                                     maxBlockCount,
+                                     pageSize,
+                                     numaNodeCount));
     }
 
 
     SliceBufferAllocator::SliceBufferAllocator(size_t blockSize,
-                                               size_t blockCount)
-        : m_blockAllocator(Factories::CreateBlockAllocator(blockSize,
-                                                           blockCount))
+                                               size_t maxBlockCount,
+                                               PageSize pageSize,
+                                               unsigned numaNodeCount)
     {
+        if (numaNodeCount <= 1)
+        {
+            m_blockAllocators.push_back(
+                Factories::CreateBlockAllocator(blockSize,
+                                                maxBlockCount,
+                                                pageSize,
+                                                c_anyNumaNode));
+        }
+        else
+        {
+            for (unsigned node = 0; node < numaNodeCount; ++node)
+            {
+                m_blockAllocators.push_back(
+                    Factories::CreateBlockAllocator(blockSize,
+                                                    maxBlockCount,
+                                                    pageSize,
+                                                    node));
+            }
+        }
     }
 
 
-    void* SliceBufferAllocator::Allocate(size_t byteSize)
+    void* SliceBufferAllocator::Allocate(size_t byteSize, unsigned numaNode)
     {
         // Other implementations of IBlockAllocator may not have this
         // restriction.
-        LogAssertB(m_blockAllocator->GetBlockSize() == byteSize,
+        LogAssertB(m_blockAllocators[0]->GetBlockSize() == byteSize,
                    "Allocate byteSize != block size.");
 
-        return m_blockAllocator->AllocateBlock();
+        const size_t pool = (numaNode < m_blockAllocators.size()) ? numaNode : 0;
+        return m_blockAllocators[pool]->AllocateBlock();
     }
 
 
     void SliceBufferAllocator::Release(void* buffer)
     {
-        m_blockAllocator->ReleaseBlock(reinterpret_cast<uint64_t*>(buffer));
+        GetOwner(buffer).ReleaseBlock(reinterpret_cast<uint64_t*>(buffer));
     }
 
 
     size_t SliceBufferAllocator::GetSliceBufferSize() const
     {
-        return m_blockAllocator->GetBlockSize();
+        return m_blockAllocators[0]->GetBlockSize();
+    }
+
+
+    size_t SliceBufferAllocator::GetInUseBufferCount() const
+    {
+        size_t count = 0;
+        for (auto const & allocator : m_blockAllocators)
+        {
+            count += allocator->GetInUseBlockCount();
+        }
+        return count;
+    }
+
+
+    size_t SliceBufferAllocator::GetCommittedBufferCount() const
+    {
+        size_t count = 0;
+        for (auto const & allocator : m_blockAllocators)
+        {
+            count += allocator->GetCommittedBlockCount();
+        }
+        return count;
+    }
+
+
+    unsigned SliceBufferAllocator::GetNumaNodeCount() const
+    {
+        return static_cast<unsigned>(m_blockAllocators.size());
+    }
+
+
+    IBlockAllocator& SliceBufferAllocator::GetOwner(void const * buffer) const
+    {
+        for (auto const & allocator : m_blockAllocators)
+        {
+            if (allocator->Contains(buffer))
+            {
+                return *allocator;
+            }
+        }
+
+        // Let the first pool report the invalid buffer.
+        return *m_blockAllocators[0];
     }
 }
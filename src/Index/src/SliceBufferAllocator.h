@@ -25,6 +25,7 @@
 
 #include <memory>
 #include <stddef.h>
+#include <vector>
 
 #include "BitFunnel/Index/ISliceBufferAllocator.h"
 #include "BitFunnel/Utilities/IBlockAllocator.h"
@@ -35,8 +36,12 @@ namespace BitFunnel
 {
     //*************************************************************************
     //
-    // Implementation of the ISliceBufferAllocator which pre-allocates a fixed
-    // number of blocks of the same byte size and re-uses them for Slices.
+    // Implementation of the ISliceBufferAllocator which reserves a fixed
+    // maximum number of blocks of the same byte size and re-uses them for
+    // Slices. Memory for the blocks is committed as they are first used.
+    //
+    // The allocator may use huge pages, and may keep one pool of blocks for
+    // each of several NUMA nodes.
     // Slices adjusts their capacity based on the size of the buffer.
     //
     // Allocate method expects only a well-known value of the buffer size,
@@ -49,19 +54,30 @@ namespace BitFunnel
     {
     public:
         // Creates a SliceBufferAllocator which uses IBlockAllocator under the
-        // hood to allocate and release blocks of the same byte size.
-        SliceBufferAllocator(size_t blockSize, size_t blockCount);
+        // hood to allocate and release blocks of the same byte size. If
+        // numaNodeCount is greater than one, each node gets its own pool of
+        // up to maxBlockCount blocks.
+        SliceBufferAllocator(size_t blockSize,
+                             size_t maxBlockCount,
+                             PageSize pageSize,
+                             unsigned numaNodeCount);
 
         //
         // ISliceBufferAllocator API.
         //
-        virtual void* Allocate(size_t byteSize) override;
+        virtual void* Allocate(size_t byteSize, unsigned numaNode) override;
         virtual void Release(void* buffer) override;
         virtual size_t GetSliceBufferSize() const override;
+        virtual size_t GetInUseBufferCount() const override;
+        virtual size_t GetCommittedBufferCount() const override;
+        virtual unsigned GetNumaNodeCount() const override;
 
     private:
+        // Returns the block allocator whose pool contains the buffer.
+        IBlockAllocator& GetOwner(void const * buffer) const;
 
-        // Block allocator which hands out the blocks of the fixed size.
-        std::unique_ptr<IBlockAllocator> const m_blockAllocator;
+        // Block allocators which hand out the blocks of the fixed size, one
+        // per NUMA node.
+        std::vector<std::unique_ptr<IBlockAllocator>> m_blockAllocators;
     };
 }
@@ -0,0 +1,123 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "BitFunnel/Exceptions.h"
+#include "DocumentFrequencyTableBuilder.h"
+#include "TermCountBuffer.h"
+
+
+namespace BitFunnel
+{
+    // The buffer attached to each thread, if any.
+    static thread_local TermCountBuffer* g_attachedBuffer = nullptr;
+
+
+    TermCountBuffer::TermCountBuffer()
+      : m_current(0),
+        m_isAttached(false)
+    {
+    }
+
+
+    TermCountBuffer::~TermCountBuffer()
+    {
+        if (m_isAttached)
+        {
+            Detach();
+        }
+    }
+
+
+    void TermCountBuffer::Attach()
+    {
+        if (g_attachedBuffer != nullptr)
+        {
+            RecoverableError error("TermCountBuffer::Attach: thread already has a buffer attached.");
+            throw error;
+        }
+        g_attachedBuffer = this;
+        m_isAttached = true;
+    }
+
+
+    void TermCountBuffer::Detach()
+    {
+        if (g_attachedBuffer == this)
+        {
+            g_attachedBuffer = nullptr;
+        }
+        m_isAttached = false;
+    }
+
+
+    TermCountBuffer* TermCountBuffer::GetAttached()
+    {
+        return g_attachedBuffer;
+    }
+
+
+    void TermCountBuffer::OnDocumentEnter(DocumentFrequencyTableBuilder& builder)
+    {
+        ++GetCounts(builder).m_documentCount;
+    }
+
+
+    void TermCountBuffer::OnTerm(DocumentFrequencyTableBuilder& builder,
+                                 Term const & term)
+    {
+        ++GetCounts(builder).m_termCounts[term];
+    }
+
+
+    void TermCountBuffer::Merge()
+    {
+        for (auto & counts : m_counts)
+        {
+            counts.m_builder->Merge(counts.m_documentCount,
+                                    counts.m_termCounts);
+        }
+        m_counts.clear();
+        m_current = 0;
+    }
+
+
+    TermCountBuffer::Counts&
+        TermCountBuffer::GetCounts(DocumentFrequencyTableBuilder& builder)
+    {
+        if (m_current < m_counts.size() &&
+            m_counts[m_current].m_builder == &builder)
+        {
+            return m_counts[m_current];
+        }
+
+        for (m_current = 0; m_current < m_counts.size(); ++m_current)
+        {
+            if (m_counts[m_current].m_builder == &builder)
+            {
+                return m_counts[m_current];
+            }
+        }
+
+        m_counts.push_back(Counts { &builder, 0, TermCounts() });
+        return m_counts.back();
+    }
+}
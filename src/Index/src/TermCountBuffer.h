@@ -0,0 +1,102 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                     // size_t member.
+#include <unordered_map>                // std::unordered_map member.
+#include <vector>                       // std::vector member.
+
+#include "BitFunnel/NonCopyable.h"      // Base class.
+#include "BitFunnel/Term.h"             // Term and Term::Hasher template parameters.
+
+
+namespace BitFunnel
+{
+    class DocumentFrequencyTableBuilder;
+
+    //*************************************************************************
+    //
+    // TermCountBuffer
+    //
+    // Accumulates the document and term counts of a batch of documents so
+    // that they can be merged into their DocumentFrequencyTableBuilders under
+    // one lock acquisition per builder, instead of one per posting.
+    //
+    // While a TermCountBuffer is attached to a thread, calls to
+    // DocumentFrequencyTableBuilder::OnDocumentEnter() and OnTerm() on that
+    // thread are recorded in the buffer. Merge() then adds the counts to each
+    // builder. Counts may be buffered for any number of builders.
+    //
+    // Thread safety: a TermCountBuffer must only be used by the thread that
+    // attached it.
+    //
+    //*************************************************************************
+    class TermCountBuffer : public NonCopyable
+    {
+    public:
+        typedef std::unordered_map<Term, size_t, Term::Hasher> TermCounts;
+
+        TermCountBuffer();
+
+        // Detaches the buffer if it is still attached. Counts that were not
+        // merged are discarded.
+        ~TermCountBuffer();
+
+        // Directs the calling thread's DocumentFrequencyTableBuilder calls to
+        // this buffer. Throws if the thread already has a buffer attached.
+        void Attach();
+
+        // Restores direct updates to the builders for the calling thread.
+        void Detach();
+
+        // Returns the buffer attached to the calling thread or nullptr if
+        // there is none.
+        static TermCountBuffer* GetAttached();
+
+        // Records the start of a document for builder.
+        void OnDocumentEnter(DocumentFrequencyTableBuilder& builder);
+
+        // Records an occurrence of term for builder.
+        void OnTerm(DocumentFrequencyTableBuilder& builder, Term const & term);
+
+        // Adds the accumulated counts to their builders and empties the
+        // buffer.
+        void Merge();
+
+    private:
+        struct Counts
+        {
+            DocumentFrequencyTableBuilder* m_builder;
+            size_t m_documentCount;
+            TermCounts m_termCounts;
+        };
+
+        Counts& GetCounts(DocumentFrequencyTableBuilder& builder);
+
+        // One entry per builder. Batches touch few shards, so a linear search
+        // starting from the most recently used entry is sufficient.
+        std::vector<Counts> m_counts;
+        size_t m_current;
+        bool m_isAttached;
+    };
+}
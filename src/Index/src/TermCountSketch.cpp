@@ -0,0 +1,266 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "BitFunnel/Exceptions.h"
+#include "FibonacciHash.h"
+#include "TermCountSketch.h"
+
+
+namespace BitFunnel
+{
+    // Seeds that give each row of the count-min sketch an independent hash.
+    static const uint64_t c_rowSeeds[] =
+    {
+        c_fibonacciMultiplier,
+        0xc2b2ae3d27d4eb4full,
+        0x165667b19e3779f9ull,
+        0x27d4eb2f165667c5ull
+    };
+
+
+    static uint64_t lzcnt(uint64_t value)
+    {
+#ifdef _MSC_VER
+        return __lzcnt64(value);
+#else
+        // DESIGN NOTE: this is undefined if the input operand is 0. The only
+        // caller sets a guard bit to guarantee that the input isn't 0.
+        return static_cast<uint64_t>(__builtin_clzll(value));
+#endif
+    }
+
+
+    TermCountSketch::TermCountSketch(size_t maxBytes)
+      : m_width(1),
+        m_heavyHitterCapacity(0),
+        m_admissionThreshold(0),
+        m_registers(c_registerCount, 0),
+        m_inverseSum(static_cast<double>(c_registerCount)),
+        m_zeroRegisterCount(c_registerCount)
+    {
+        if (maxBytes < c_minByteSize)
+        {
+            RecoverableError error("TermCountSketch: memory budget is too small.");
+            throw error;
+        }
+
+        // Half of the memory left after the HyperLogLog registers goes to the
+        // count-min sketch, rounded down to a power of two counters per row.
+        const size_t available = maxBytes - c_registerCount;
+        while (c_depth * (m_width * 2) * sizeof(uint32_t) <= available / 2)
+        {
+            m_width *= 2;
+        }
+        m_counters.resize(c_depth * m_width, 0);
+
+        m_heavyHitterCapacity =
+            (available - m_counters.size() * sizeof(uint32_t)) /
+            GetHeavyHitterByteSize();
+        m_heavyHitters.reserve(m_heavyHitterCapacity);
+    }
+
+
+    void TermCountSketch::Add(Term const & term, size_t count)
+    {
+        const uint64_t hash = GetHash(term);
+        AddDistinct(hash);
+
+        const uint32_t maxCounter = std::numeric_limits<uint32_t>::max();
+        uint32_t estimate = maxCounter;
+        for (size_t row = 0; row < c_depth; ++row)
+        {
+            const size_t column =
+                static_cast<size_t>(Mix(hash ^ c_rowSeeds[row])) & (m_width - 1);
+            uint32_t & counter = m_counters[row * m_width + column];
+
+            // Counters saturate rather than wrap.
+            if (count >= maxCounter - counter)
+            {
+                counter = maxCounter;
+            }
+            else
+            {
+                counter += static_cast<uint32_t>(count);
+            }
+            estimate = (std::min)(estimate, counter);
+        }
+
+        auto it = m_heavyHitters.find(term);
+        if (it != m_heavyHitters.end())
+        {
+            it->second = estimate;
+        }
+        else if (estimate >= m_admissionThreshold)
+        {
+            m_heavyHitters.insert(std::make_pair(term, estimate));
+            if (m_heavyHitters.size() > m_heavyHitterCapacity)
+            {
+                EvictHeavyHitters();
+            }
+        }
+    }
+
+
+    size_t TermCountSketch::GetEstimate(Term const & term) const
+    {
+        const uint64_t hash = GetHash(term);
+
+        uint32_t estimate = std::numeric_limits<uint32_t>::max();
+        for (size_t row = 0; row < c_depth; ++row)
+        {
+            const size_t column =
+                static_cast<size_t>(Mix(hash ^ c_rowSeeds[row])) & (m_width - 1);
+            estimate = (std::min)(estimate, m_counters[row * m_width + column]);
+        }
+
+        return estimate;
+    }
+
+
+    TermCountSketch::TermCounts const & TermCountSketch::GetHeavyHitters() const
+    {
+        return m_heavyHitters;
+    }
+
+
+    size_t TermCountSketch::GetDistinctCount() const
+    {
+        const double m = static_cast<double>(c_registerCount);
+        const double alpha = 0.7213 / (1.0 + 1.079 / m);
+        double estimate = alpha * m * m / m_inverseSum;
+
+        // Linear counting is more accurate while many registers are empty.
+        if (estimate <= 2.5 * m && m_zeroRegisterCount != 0)
+        {
+            estimate = m * std::log(m / static_cast<double>(m_zeroRegisterCount));
+        }
+
+        return static_cast<size_t>(std::round(estimate));
+    }
+
+
+    size_t TermCountSketch::GetByteSize() const
+    {
+        return m_counters.size() * sizeof(uint32_t)
+            + m_registers.size()
+            + m_heavyHitters.size() * GetHeavyHitterByteSize();
+    }
+
+
+    uint64_t TermCountSketch::GetHash(Term const & term)
+    {
+        return Mix(term.GetGeneralHash() ^
+                   (static_cast<uint64_t>(term.GetGramSize()) << 56));
+    }
+
+
+    // The finalizer from SplitMix64.
+    uint64_t TermCountSketch::Mix(uint64_t value)
+    {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+
+
+    size_t TermCountSketch::GetHeavyHitterByteSize()
+    {
+        // Each entry is a node holding the value, the cached hash and a next
+        // pointer, plus roughly one bucket pointer.
+        return sizeof(TermCounts::value_type) + 3 * sizeof(void*);
+    }
+
+
+    void TermCountSketch::AddDistinct(uint64_t hash)
+    {
+        // The top bits select the register. The guard bit bounds the rank of
+        // the remaining bits.
+        const size_t index = static_cast<size_t>(hash >> (64 - c_registerBits));
+        const uint64_t rest = (hash << c_registerBits) | (1ull << (c_registerBits - 1));
+        const uint8_t rank = static_cast<uint8_t>(lzcnt(rest) + 1);
+
+        uint8_t & value = m_registers[index];
+        if (rank > value)
+        {
+            if (value == 0)
+            {
+                --m_zeroRegisterCount;
+            }
+            m_inverseSum += std::ldexp(1.0, -rank) - std::ldexp(1.0, -value);
+            value = rank;
+        }
+    }
+
+
+    void TermCountSketch::EvictHeavyHitters()
+    {
+        // Find the median count and keep the terms above it.
+        std::vector<size_t> counts;
+        counts.reserve(m_heavyHitters.size());
+        for (auto const & entry : m_heavyHitters)
+        {
+            counts.push_back(entry.second);
+        }
+        auto median = counts.begin() + counts.size() / 2;
+        std::nth_element(counts.begin(), median, counts.end());
+        const size_t pivot = *median;
+
+        const size_t target = m_heavyHitterCapacity / 2;
+        for (auto it = m_heavyHitters.begin(); it != m_heavyHitters.end(); )
+        {
+            if (it->second < pivot)
+            {
+                it = m_heavyHitters.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        // Break ties at the median.
+        for (auto it = m_heavyHitters.begin();
+             it != m_heavyHitters.end() && m_heavyHitters.size() > target; )
+        {
+            if (it->second == pivot)
+            {
+                it = m_heavyHitters.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        // An evicted term had a count of at most pivot, so it is readmitted
+        // once its estimate grows past that.
+        m_admissionThreshold = (std::max)(m_admissionThreshold, pivot + 1);
+    }
+}
@@ -0,0 +1,114 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                     // size_t parameter.
+#include <stdint.h>                     // uint32_t, uint64_t members.
+#include <unordered_map>                // std::unordered_map member.
+#include <vector>                       // std::vector member.
+
+#include "BitFunnel/NonCopyable.h"      // Base class.
+#include "BitFunnel/Term.h"             // Term and Term::Hasher template parameters.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // TermCountSketch
+    //
+    // Approximate document frequency counts for corpora whose vocabulary is
+    // too large to count exactly. Memory use is fixed at construction and
+    // does not grow with the number of distinct terms.
+    //
+    // Roughly half of the memory budget goes to a count-min sketch. The
+    // sketch estimate for a term never falls below its true count, and
+    // exceeds it by at most a small fraction of the total count with high
+    // probability.
+    //
+    // The other half holds the heavy hitters, the terms with the highest
+    // estimated counts, which are the only terms that can be enumerated.
+    // When the heavy hitter table fills, its lower half is evicted and the
+    // admission threshold is raised to the count of the last term evicted.
+    // Terms that are not heavy hitters are rare enough to be dropped by the
+    // frequency truncation applied when statistics are written.
+    //
+    // The number of distinct terms is estimated with a HyperLogLog counter.
+    //
+    // Thread safety: not thread safe.
+    //
+    //*************************************************************************
+    class TermCountSketch : public NonCopyable
+    {
+    public:
+        typedef std::unordered_map<Term, size_t, Term::Hasher> TermCounts;
+
+        // Throws if maxBytes is too small to hold a useful sketch.
+        explicit TermCountSketch(size_t maxBytes);
+
+        // Adds count occurrences of term.
+        void Add(Term const & term, size_t count);
+
+        // Returns an estimate of the number of occurrences of term that is
+        // never less than the true count.
+        size_t GetEstimate(Term const & term) const;
+
+        // Returns the heavy hitters with their estimated counts.
+        TermCounts const & GetHeavyHitters() const;
+
+        // Returns an estimate of the number of distinct terms added.
+        size_t GetDistinctCount() const;
+
+        // Returns an upper bound on the memory in use, in bytes.
+        size_t GetByteSize() const;
+
+        // Smallest memory budget accepted by the constructor.
+        static const size_t c_minByteSize = 64 * 1024;
+
+    private:
+        static uint64_t GetHash(Term const & term);
+        static uint64_t Mix(uint64_t value);
+        static size_t GetHeavyHitterByteSize();
+
+        void AddDistinct(uint64_t hash);
+        void EvictHeavyHitters();
+
+        static const size_t c_depth = 4;
+        static const unsigned c_registerBits = 12;
+        static const size_t c_registerCount = 1ull << c_registerBits;
+
+        // Count-min sketch with c_depth rows of m_width counters each.
+        size_t m_width;
+        std::vector<uint32_t> m_counters;
+
+        size_t m_heavyHitterCapacity;
+        size_t m_admissionThreshold;
+        TermCounts m_heavyHitters;
+
+        // HyperLogLog registers. The harmonic sum of the registers and the
+        // number of zero registers are maintained incrementally.
+        std::vector<uint8_t> m_registers;
+        double m_inverseSum;
+        size_t m_zeroRegisterCount;
+    };
+}
@@ -0,0 +1,92 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "BitFunnel/Exceptions.h"
+#include "TermHashBuffer.h"
+
+
+namespace BitFunnel
+{
+    // The buffer attached to each thread, if any.
+    static thread_local TermHashBuffer* g_attachedBuffer = nullptr;
+
+
+    TermHashBuffer::TermHashBuffer()
+      : m_isAttached(false)
+    {
+    }
+
+
+    TermHashBuffer::~TermHashBuffer()
+    {
+        if (m_isAttached)
+        {
+            Detach();
+        }
+    }
+
+
+    void TermHashBuffer::Attach()
+    {
+        if (g_attachedBuffer != nullptr)
+        {
+            RecoverableError error("TermHashBuffer::Attach: thread already has a buffer attached.");
+            throw error;
+        }
+        g_attachedBuffer = this;
+        m_isAttached = true;
+    }
+
+
+    void TermHashBuffer::Detach()
+    {
+        if (g_attachedBuffer == this)
+        {
+            g_attachedBuffer = nullptr;
+        }
+        m_isAttached = false;
+    }
+
+
+    TermHashBuffer* TermHashBuffer::GetAttached()
+    {
+        return g_attachedBuffer;
+    }
+
+
+    void TermHashBuffer::OnTerm(Term const & term)
+    {
+        m_hashes.push_back(term.GetRawHash());
+    }
+
+
+    std::vector<Term::Hash> & TermHashBuffer::GetHashes()
+    {
+        return m_hashes;
+    }
+
+
+    void TermHashBuffer::Reset()
+    {
+        m_hashes.clear();
+    }
+}
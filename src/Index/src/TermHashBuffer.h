@@ -0,0 +1,81 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <vector>                       // std::vector member.
+
+#include "BitFunnel/NonCopyable.h"      // Base class.
+#include "BitFunnel/Term.h"             // Term::Hash parameterizes std::vector.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // TermHashBuffer
+    //
+    // Collects the hashes of the terms posted for a document so that they can
+    // be written to the ForwardIndex once the document has been ingested.
+    //
+    // While a TermHashBuffer is attached to a thread, calls to
+    // DocumentHandle::AddPosting() on that thread record the term's hash in
+    // the buffer.
+    //
+    // Thread safety: a TermHashBuffer must only be used by the thread that
+    // attached it.
+    //
+    //*************************************************************************
+    class TermHashBuffer : public NonCopyable
+    {
+    public:
+        TermHashBuffer();
+
+        // Detaches the buffer if it is still attached.
+        ~TermHashBuffer();
+
+        // Directs the calling thread's postings to this buffer. Throws if the
+        // thread already has a buffer attached.
+        void Attach();
+
+        // Stops recording the calling thread's postings.
+        void Detach();
+
+        // Returns the buffer attached to the calling thread or nullptr if
+        // there is none.
+        static TermHashBuffer* GetAttached();
+
+        // Records the hash of term.
+        void OnTerm(Term const & term);
+
+        // Returns the hashes recorded since the last call to Reset(), in the
+        // order they were recorded.
+        std::vector<Term::Hash> & GetHashes();
+
+        // Discards the recorded hashes.
+        void Reset();
+
+    private:
+        std::vector<Term::Hash> m_hashes;
+        bool m_isAttached;
+    };
+}
@@ -22,11 +22,17 @@
 
 #include <math.h>
 #include <sstream>
+#include <streambuf>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #include "BitFunnel/BitFunnelTypes.h"
 #include "BitFunnel/Exceptions.h"
 #include "BitFunnel/Index/Factories.h"
 #include "BitFunnel/Utilities/StreamUtilities.h"
+#include "FibonacciHash.h"
 #include "LoggerInterfaces/Check.h"
 #include "TermTable.h"
 
@@ -51,6 +57,46 @@ namespace BitFunnel
     }
 
 
+    std::unique_ptr<ITermTable>
+        Factories::CreateTermTable(std::unique_ptr<IMappedFile> file)
+    {
+        return std::unique_ptr<ITermTable>(new TermTable(std::move(file)));
+    }
+
+
+    // Returns the high 64 bits of the 128-bit product a * b.
+    static uint64_t MultiplyHigh(uint64_t a, uint64_t b)
+    {
+#ifdef _MSC_VER
+        return __umulh(a, b);
+#else
+        return static_cast<uint64_t>(
+            (static_cast<unsigned __int128>(a) * b) >> 64);
+#endif
+    }
+
+
+    //*************************************************************************
+    //
+    // MappedStreamBuffer
+    //
+    // Exposes a read-only region of memory as a std::streambuf so that the
+    // fields following the explicit term table in a mapped file can be read
+    // with StreamUtilities without copying them into a string first.
+    //
+    //*************************************************************************
+    class MappedStreamBuffer : public std::streambuf
+    {
+    public:
+        MappedStreamBuffer(char const * buffer, size_t size)
+        {
+            // std::streambuf never writes through the get area pointers.
+            char* start = const_cast<char*>(buffer);
+            setg(start, start, start + size);
+        }
+    };
+
+
     //*************************************************************************
     //
     // TermTable
@@ -85,17 +131,33 @@ namespace BitFunnel
 
     TermTable::TermTable(std::istream& input)
       : m_sealed(true),
+        m_termOpen(false),
         m_start(0)
     {
-        size_t count = StreamUtilities::ReadField<size_t>(input);
-        for (size_t i = 0; i < count; ++i)
-        {
-            const Term::Hash hash = StreamUtilities::ReadField<Term::Hash>(input);
-            const PackedRowIdSequence rows = StreamUtilities::ReadField<PackedRowIdSequence>(input);
+        m_explicitTerms.Read(input);
+        ReadFields(input);
+    }
+
+
+    TermTable::TermTable(std::unique_ptr<IMappedFile> file)
+      : m_sealed(true),
+        m_termOpen(false),
+        m_start(0),
+        m_file(std::move(file))
+    {
+        char const * buffer = m_file->GetBuffer();
+        const size_t size = m_file->GetSize();
+
+        const size_t tableSize = m_explicitTerms.Attach(buffer, size);
+
+        MappedStreamBuffer streamBuffer(buffer + tableSize, size - tableSize);
+        std::istream input(&streamBuffer);
+        ReadFields(input);
+    }
 
-            m_termHashToRows.insert(std::make_pair(hash, rows));
-        }
 
+    void TermTable::ReadFields(std::istream& input)
+    {
         m_ranksInUse = StreamUtilities::ReadField<RanksInUse>(input);
         m_maxRankInUse = StreamUtilities::ReadField<Rank>(input);
         m_adhocRows = StreamUtilities::ReadField<AdhocRecipes>(input);
@@ -104,22 +166,15 @@ namespace BitFunnel
         m_adhocRowCounts = StreamUtilities::ReadVector<RowIndex>(input);
         m_sharedRowCounts = StreamUtilities::ReadVector<RowIndex>(input);
         m_factRowCount = StreamUtilities::ReadField<RowIndex>(input);
-
-        m_sealed = true;
     }
 
 
     void TermTable::Write(std::ostream& output) const
     {
-        StreamUtilities::WriteField<size_t>(output, m_termHashToRows.size());
-        for (auto entry : m_termHashToRows)
-        {
-            const Term::Hash hash = entry.first;
-            const PackedRowIdSequence rows = entry.second;
+        // The explicit terms are only in their persistent form after Seal().
+        EnsureSealed(true);
 
-            StreamUtilities::WriteField<Term::Hash>(output, hash);
-            StreamUtilities::WriteField<PackedRowIdSequence>(output, rows);
-        }
+        m_explicitTerms.Write(output);
 
         StreamUtilities::WriteField<RanksInUse>(output, m_ranksInUse);
         StreamUtilities::WriteField<Rank>(output, m_maxRankInUse);
@@ -285,6 +340,16 @@ namespace BitFunnel
                 }
             }
         }
+
+        // Move the explicit terms into their read-only form.
+        std::vector<FlatHashTable<PackedRowIdSequence>::Entry> entries;
+        entries.reserve(m_termHashToRows.size());
+        for (auto const & rows : m_termHashToRows)
+        {
+            entries.push_back({ rows.first, rows.second });
+        }
+        m_explicitTerms.Build(entries);
+        m_termHashToRows.clear();
     }
 
 
@@ -327,10 +392,10 @@ namespace BitFunnel
         }
         else
         {
-            auto it = m_termHashToRows.find(term.GetRawHash());
-            if (it != m_termHashToRows.end())
+            PackedRowIdSequence const * rows = m_explicitTerms.Find(hash);
+            if (rows != nullptr)
             {
-                return (*it).second;
+                return *rows;
             }
             else
             {
@@ -409,8 +474,14 @@ namespace BitFunnel
         // value even after 64 rotations.
         hash = hash ^ m_randomHashes[variant];
 
+        // Reduce the hash to [0, adhocRowCount) with a multiply-shift rather
+        // than a modulus, which compiles to a slow integer division. Once
+        // FibonacciMix() has moved entropy into the high order bits, the high
+        // half of the second product is uniform in [0, adhocRowCount).
+        hash = FibonacciMix(hash);
+
         // Adhoc rows start at RowIndex 0.
-        return RowId(rank, (hash % adhocRowCount));
+        return RowId(rank, static_cast<RowIndex>(MultiplyHigh(hash, adhocRowCount)));
     }
 
 
@@ -446,6 +517,7 @@ namespace BitFunnel
         equals = equals && (m_ranksInUse == other.m_ranksInUse);
         equals = equals && (m_maxRankInUse == other.m_maxRankInUse);
         equals = equals && (m_termHashToRows == other.m_termHashToRows);
+        equals = equals && (m_explicitTerms == other.m_explicitTerms);
         equals = equals && (m_adhocRows == other.m_adhocRows);
         equals = equals && (m_rowIds == other.m_rowIds);
         equals = equals && (m_explicitRowCounts == other.m_explicitRowCounts);
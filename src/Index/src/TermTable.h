@@ -22,13 +22,16 @@
 
 #pragma once
 
-#include <unordered_map>                // std::unordered_map member.
 #include <array>                        // std::array member.
+#include <memory>                       // std::unique_ptr member.
+#include <unordered_map>                // std::unordered_map member.
 #include <vector>                       // std::vector member.
 
+#include "BitFunnel/Configuration/IMappedFile.h"    // std::unique_ptr template parameter.
 #include "BitFunnel/Index/ITermTable.h" // Base class.
 #include "BitFunnel/Index/RowId.h"      // RowId template parameter.
 #include "BitFunnel/Term.h"             // Term::Hash parameter.
+#include "FlatHashTable.h"              // FlatHashTable member.
 
 
 namespace BitFunnel
@@ -42,6 +45,11 @@ namespace BitFunnel
         // Write() method.
         TermTable(std::istream& input);
 
+        // Constructs a TermTable from the contents of a file previously
+        // written by the Write() method. The table of explicit terms is used
+        // in place, so the TermTable retains the mapped file.
+        TermTable(std::unique_ptr<IMappedFile> file);
+
         // Writes the contents of the ITermTable to a stream.
         virtual void Write(std::ostream& output) const override;
 
@@ -73,7 +81,9 @@ namespace BitFunnel
 
         // Completes the TermTable build process by converting relative
         // RowIndex values to absolute RowIndex values. This can only be done
-        // after the row counts are set via a call to SetRowCounts().
+        // after the row counts are set via a call to SetRowCounts(). Also
+        // converts the explicit terms into the read-only FlatHashTable used
+        // by GetRows().
         virtual void Seal() override;
 
         //
@@ -132,6 +142,10 @@ namespace BitFunnel
         bool operator==(TermTable const & other) const;
 
     private:
+        // Reads the fields that follow the explicit terms in the persistent
+        // format.
+        void ReadFields(std::istream& input);
+
         void EnsureSealed(bool value) const;
 
         // This is a helper method to catch careless bugs. There's no reason, in
@@ -153,13 +167,16 @@ namespace BitFunnel
         RanksInUse m_ranksInUse{};
         Rank m_maxRankInUse;
 
-        // TODO: Is the term table big enough that we would benefit from
-        // a more compact class than std::pair<RowIndex, RowIndex>>? Would this
-        // even lead to a benefit if we didn't replace std::unordered_map with
-        // a better hash table? Should measure actual memory use for this data
-        // structure.
+        // Explicit terms recorded by CloseTerm() while the TermTable is being
+        // built. Seal() moves them into m_explicitTerms.
         std::unordered_map<Term::Hash, PackedRowIdSequence> m_termHashToRows;
 
+        // Explicit terms of a sealed TermTable. When the TermTable is loaded
+        // from a mapped file, m_explicitTerms refers to memory owned by
+        // m_file.
+        std::unique_ptr<IMappedFile> m_file;
+        FlatHashTable<PackedRowIdSequence> m_explicitTerms;
+
         typedef
             std::array<
                 std::array<PackedRowIdSequence,
@@ -21,6 +21,7 @@
 // THE SOFTWARE.
 
 #include <istream>
+#include <utility>
 
 #include "BitFunnel/IFileManager.h"
 #include "BitFunnel/Index/Factories.h"
@@ -79,9 +80,9 @@ namespace BitFunnel
     {
         for (ShardId shard = 0; shard < shardCount; ++shard)
         {
-            auto input = fileManager.TermTable(shard).OpenForRead();
+            auto file = fileManager.TermTable(shard).OpenForMappedRead();
             m_termTables.emplace_back(
-                std::unique_ptr<ITermTable>(new TermTable(*input)));
+                std::unique_ptr<ITermTable>(new TermTable(std::move(file))));
         }
     }
 
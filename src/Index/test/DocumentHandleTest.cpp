@@ -32,6 +32,7 @@
 #include "BitFunnel/Index/ITermTable.h"
 #include "BitFunnel/Index/Token.h"
 #include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/Numa.h"
 #include "DocumentDataSchema.h"
 #include "IndexUtils.h"
 #include "Shard.h"
@@ -109,7 +110,9 @@ namespace BitFunnel
                     *termTable,
                     docDataSchema,
                     *trackingAllocator,
-                    blockSize);
+                    blockSize,
+                    0,
+                    c_anyNumaNode);
         auto sliceCapacity = shard.GetSliceCapacity();
         Slice* currentSlice = nullptr;
         std::vector<Slice*> slices;
@@ -200,7 +203,7 @@ namespace BitFunnel
             handle.Expire();
         }
 
-        while(trackingAllocator->GetInUseBuffersCount() != 0u) {}
+        while(trackingAllocator->GetInUseBufferCount() != 0u) {}
 
         tokenManager->Shutdown();
         recycler->Shutdown();
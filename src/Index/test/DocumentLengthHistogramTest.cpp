@@ -21,6 +21,9 @@
 // THE SOFTWARE.
 
 
+#include <future>
+#include <vector>
+
 #include "DocumentHistogramBuilder.h"
 #include "gtest/gtest.h"
 
@@ -57,5 +60,42 @@ namespace BitFunnel
         ASSERT_EQ("Postings,Count\n0,1\n3,2\n5,1\n", stream.str());
     }
 
+
+    //*********************************************************************
+    // Threads count into bins of their own. Verifies that the counts from
+    // all threads are merged when the histogram is read.
+    TEST(DocumentHistogramBuilder, MultipleThreads)
+    {
+        DocumentHistogramBuilder testHistogram;
+
+        const size_t c_threadCount = 4;
+        const size_t c_documentCount = 1000;
+
+        std::vector<std::future<void>> threads;
+        for (size_t t = 0; t < c_threadCount; ++t)
+        {
+            threads.push_back(std::async(std::launch::async, [&]()
+            {
+                for (size_t i = 0; i < c_documentCount; ++i)
+                {
+                    testHistogram.AddDocument(i % 3);
+                }
+            }));
+        }
+        for (auto & thread : threads)
+        {
+            thread.wait();
+        }
+
+        EXPECT_EQ(testHistogram.GetValue(0), c_threadCount * 334);
+        EXPECT_EQ(testHistogram.GetValue(1), c_threadCount * 333);
+        EXPECT_EQ(testHistogram.GetValue(2), c_threadCount * 333);
+        EXPECT_EQ(testHistogram.GetPostingCount(), c_threadCount * 999);
+
+        std::stringstream stream;
+        testHistogram.Write(stream);
+        ASSERT_EQ("Postings,Count\n0,1336\n1,1332\n2,1332\n", stream.str());
+    }
+
         // TODO: Implement and test file read/write.
 }
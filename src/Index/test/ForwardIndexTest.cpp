@@ -0,0 +1,124 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IFileSystem.h"
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/ForwardIndex.h"
+#include "BitFunnel/Index/IDocument.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Index/ISliceBufferAllocator.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/ITermTableCollection.h"
+#include "BitFunnel/Mocks/Factories.h"
+#include "BitFunnel/Utilities/IBlockAllocator.h"
+#include "BitFunnel/Utilities/Primes.h"
+
+
+namespace BitFunnel
+{
+    namespace ForwardIndexTest
+    {
+        static const Term::StreamId c_streamId = 0;
+
+        // Ingests the PrimeFactors documents into an index with a forward
+        // index and verifies that each document's hashes contain exactly
+        // its prime factors.
+        TEST(ForwardIndex, PrimeFactors)
+        {
+            const DocId c_maxDocId = 200;
+
+            auto fileSystem = Factories::CreateFileSystem();
+            auto termTables = Factories::CreateTermTableCollection();
+            termTables->AddTermTable(
+                Factories::CreatePrimeFactorsTermTable(c_maxDocId, c_streamId));
+
+            auto index = Factories::CreateSimpleIndex(*fileSystem);
+            index->SetTermTableCollection(std::move(termTables));
+            index->SetSliceBufferAllocator(
+                Factories::CreateSliceBufferAllocator(20000,
+                                                      512,
+                                                      PageSize::Default,
+                                                      1));
+            index->EnableForwardIndex();
+            index->ConfigureAsMock(1, false);
+            index->StartIndex();
+
+            ASSERT_NE(index->GetForwardIndex(), nullptr);
+            ForwardIndex const & forwardIndex = *index->GetForwardIndex();
+            IIngestor & ingestor = index->GetIngestor();
+
+            // Ingest half of the documents with Add() and half with
+            // AddBatch().
+            std::vector<std::unique_ptr<IDocument>> documents;
+            std::vector<std::pair<DocId, IDocument const *>> batch;
+            for (DocId docId = 0; docId <= c_maxDocId; ++docId)
+            {
+                documents.push_back(
+                    Factories::CreatePrimeFactorsDocument(
+                        index->GetConfiguration(),
+                        docId,
+                        c_maxDocId,
+                        c_streamId));
+                if ((docId & 1) == 0)
+                {
+                    ingestor.Add(docId, *documents.back());
+                }
+                else
+                {
+                    batch.push_back(std::make_pair(docId,
+                                                   documents.back().get()));
+                }
+            }
+            ingestor.AddBatch(batch);
+
+            std::vector<Term::Hash> hashes;
+            for (DocId docId = 0; docId <= c_maxDocId; ++docId)
+            {
+                ASSERT_TRUE(forwardIndex.Read(ingestor.GetHandle(docId),
+                                              hashes));
+                EXPECT_TRUE(std::is_sorted(hashes.begin(), hashes.end()));
+                EXPECT_TRUE(std::adjacent_find(hashes.begin(), hashes.end())
+                            == hashes.end());
+
+                for (size_t i = 0; Primes::c_primesBelow10000[i] <= c_maxDocId; ++i)
+                {
+                    const size_t prime = Primes::c_primesBelow10000[i];
+                    const Term::Hash hash = Term::ComputeRawHash(
+                        Primes::c_primesBelow10000Text[i].c_str());
+                    const bool expected = (docId != 0) && ((docId % prime) == 0);
+                    EXPECT_EQ(std::binary_search(hashes.begin(),
+                                                 hashes.end(),
+                                                 hash),
+                              expected)
+                        << "docId " << docId << ", prime " << prime;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,86 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include <sstream>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IFileSystem.h"
+#include "BitFunnel/Exceptions.h"
+#include "IndexedIdfTable.h"
+
+
+namespace BitFunnel
+{
+    namespace IndexedIdfTableTest
+    {
+        TEST(IndexedIdfTable, RoundTrip)
+        {
+            const Term::IdfX10 defaultIdf = 60;
+            const size_t entryCount = 5000;
+
+            // Hashes differing only in their low bits exercise the hash
+            // mixing that selects directory buckets.
+            std::vector<IndexedIdfTable::Entry> entries;
+            for (size_t i = 0; i < entryCount; ++i)
+            {
+                entries.push_back({ 1000 + i,
+                                    static_cast<Term::IdfX10>(i % defaultIdf) });
+            }
+
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            IndexedIdfTable::Write(*fileSystem->OpenForWrite("Idf.bin"),
+                                   entries);
+
+            IndexedIdfTable fromStream(*fileSystem->OpenForRead("Idf.bin"),
+                                       defaultIdf);
+            IndexedIdfTable fromMappedFile(
+                fileSystem->OpenForMappedRead("Idf.bin"),
+                defaultIdf);
+
+            for (auto const & entry : entries)
+            {
+                EXPECT_EQ(fromStream.GetIdf(entry.m_hash), entry.m_value);
+                EXPECT_EQ(fromMappedFile.GetIdf(entry.m_hash), entry.m_value);
+            }
+
+            // Unknown terms get the default idf.
+            EXPECT_EQ(fromStream.GetIdf(999), defaultIdf);
+            EXPECT_EQ(fromMappedFile.GetIdf(1000 + entryCount), defaultIdf);
+        }
+
+
+        TEST(IndexedIdfTable, Duplicates)
+        {
+            std::vector<IndexedIdfTable::Entry> entries = {
+                { 1234, 10 },
+                { 5678, 20 },
+                { 1234, 30 }
+            };
+
+            std::stringstream stream;
+            EXPECT_THROW(IndexedIdfTable::Write(stream, entries),
+                         RecoverableError);
+        }
+    }
+}
@@ -23,7 +23,9 @@
 
 #include <iostream>  // TODO: remove.
 
+#include <atomic>
 #include <cmath>
+#include <future>
 #include <vector>
 #include <unordered_map>
 
@@ -32,13 +34,22 @@
 #include "BitFunnel/BitFunnelTypes.h"
 #include "BitFunnel/Configuration/IFileSystem.h"
 #include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/IDocument.h"
 #include "BitFunnel/Index/IIngestor.h"
 #include "BitFunnel/Index/IShard.h"
 #include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Index/ISliceBufferAllocator.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/ITermTableCollection.h"
 #include "BitFunnel/Index/RowIdSequence.h"
 #include "BitFunnel/Mocks/Factories.h"
+#include "BitFunnel/Utilities/IBlockAllocator.h"
 #include "BitFunnel/Utilities/Primes.h"
 #include "DocumentFrequencyTable.h"
+#include "DocumentHandleInternal.h"
+#include "Slice.h"
 
 
 namespace BitFunnel
@@ -296,4 +307,438 @@ namespace BitFunnel
         }
     }
 
+
+    // Ingests the PrimeFactors documents through IIngestor::AddBatch() and
+    // verifies that every row quadword matches an index built with
+    // IIngestor::Add().
+    TEST(Ingestor, AddBatch)
+    {
+        const DocId c_maxDocId = 127;
+        const size_t c_batchSize = 10;
+
+        auto fileSystem = Factories::CreateFileSystem();
+        auto expected = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                           c_maxDocId,
+                                                           c_streamId,
+                                                           1);
+
+        // Configure a second index the same way CreatePrimeFactorsIndex()
+        // does, but without ingesting any documents.
+        auto termTables = Factories::CreateTermTableCollection();
+        termTables->AddTermTable(
+            Factories::CreatePrimeFactorsTermTable(c_maxDocId, c_streamId));
+
+        auto index = Factories::CreateSimpleIndex(*fileSystem);
+        index->SetTermTableCollection(std::move(termTables));
+        index->SetSliceBufferAllocator(
+            Factories::CreateSliceBufferAllocator(20000,
+                                                  512,
+                                                  PageSize::Default,
+                                                  1));
+        index->ConfigureAsMock(1, false);
+        index->StartIndex();
+
+        std::vector<std::unique_ptr<IDocument>> documents;
+        std::vector<std::pair<DocId, IDocument const *>> batch;
+        for (DocId docId = 0; docId <= c_maxDocId; ++docId)
+        {
+            documents.push_back(
+                Factories::CreatePrimeFactorsDocument(index->GetConfiguration(),
+                                                      docId,
+                                                      c_maxDocId,
+                                                      c_streamId));
+            batch.push_back(std::make_pair(docId, documents.back().get()));
+            if (batch.size() == c_batchSize || docId == c_maxDocId)
+            {
+                index->GetIngestor().AddBatch(batch);
+                batch.clear();
+            }
+        }
+
+        EXPECT_EQ(index->GetIngestor().GetDocumentCount(), c_maxDocId + 1);
+        for (DocId docId = 0; docId <= c_maxDocId; ++docId)
+        {
+            EXPECT_TRUE(index->GetIngestor().Contains(docId));
+        }
+
+        IShard & expectedShard = expected->GetIngestor().GetShard(0);
+        IShard & shard = index->GetIngestor().GetShard(0);
+        ASSERT_EQ(shard.GetSliceBuffers().size(), 1u);
+
+        // Compare the "0" row, each prime's rows and the document active row.
+        std::vector<Term> terms;
+        terms.push_back(Term(Term::ComputeRawHash("0"), c_streamId, 0));
+        for (size_t i = 0; Primes::c_primesBelow10000[i] <= c_maxDocId; ++i)
+        {
+            char const* text = Primes::c_primesBelow10000Text[i].c_str();
+            terms.push_back(Term(Term::ComputeRawHash(text), c_streamId, 0));
+        }
+        terms.push_back(index->GetTermTable(0).GetDocumentActiveTerm());
+
+        for (auto const & term : terms)
+        {
+            RowIdSequence rows(term, index->GetTermTable(0));
+            for (auto row : rows)
+            {
+                const size_t quadwords =
+                    shard.GetSliceCapacity() >> (6 + row.GetRank());
+                auto actual = reinterpret_cast<uint64_t const *>(
+                    static_cast<char const *>(shard.GetSliceBuffers()[0]) +
+                    shard.GetRowOffset(row));
+                auto reference = reinterpret_cast<uint64_t const *>(
+                    static_cast<char const *>(expectedShard.GetSliceBuffers()[0]) +
+                    expectedShard.GetRowOffset(row));
+                for (size_t q = 0; q < quadwords; ++q)
+                {
+                    EXPECT_EQ(actual[q], reference[q]);
+                }
+            }
+        }
+    }
+
+
+    // A batch containing a duplicate DocId keeps the documents before the
+    // duplicate and removes the duplicate and every document after it.
+    TEST(Ingestor, AddBatchDuplicate)
+    {
+        const DocId c_maxDocId = 20;
+
+        auto fileSystem = Factories::CreateFileSystem();
+        auto termTables = Factories::CreateTermTableCollection();
+        termTables->AddTermTable(
+            Factories::CreatePrimeFactorsTermTable(c_maxDocId, c_streamId));
+
+        auto index = Factories::CreateSimpleIndex(*fileSystem);
+        index->SetTermTableCollection(std::move(termTables));
+        index->ConfigureAsMock(1, false);
+        index->StartIndex();
+        IIngestor & ingestor = index->GetIngestor();
+
+        std::vector<std::unique_ptr<IDocument>> documents;
+        for (DocId docId = 0; docId <= c_maxDocId; ++docId)
+        {
+            documents.push_back(
+                Factories::CreatePrimeFactorsDocument(index->GetConfiguration(),
+                                                      docId,
+                                                      c_maxDocId,
+                                                      c_streamId));
+        }
+
+        std::vector<std::pair<DocId, IDocument const *>> batch;
+        for (DocId docId = 0; docId < 10; ++docId)
+        {
+            batch.push_back(std::make_pair(docId, documents[docId].get()));
+        }
+        ingestor.AddBatch(batch);
+
+        // Documents 10, 3, and 11 take consecutive columns of the slice.
+        batch.clear();
+        batch.push_back(std::make_pair(10, documents[10].get()));
+        batch.push_back(std::make_pair(3, documents[3].get()));
+        batch.push_back(std::make_pair(11, documents[11].get()));
+        EXPECT_ANY_THROW(ingestor.AddBatch(batch));
+
+        EXPECT_TRUE(ingestor.Contains(3));
+        EXPECT_TRUE(ingestor.Contains(10));
+        EXPECT_FALSE(ingestor.Contains(11));
+
+        DocumentHandleInternal handle(ingestor.GetHandle(10));
+        EXPECT_TRUE(handle.IsActive());
+        EXPECT_FALSE(DocumentHandleInternal(&handle.GetSlice(),
+                                            handle.GetIndex() + 1).IsActive());
+        EXPECT_FALSE(DocumentHandleInternal(&handle.GetSlice(),
+                                            handle.GetIndex() + 2).IsActive());
+
+        // Document 11 can be added again.
+        ingestor.Add(11, *documents[11]);
+        EXPECT_TRUE(ingestor.Contains(11));
+        EXPECT_TRUE(ingestor.GetHandle(11).IsActive());
+    }
+
+
+    // An IDocument whose ingestion fails.
+    class ThrowingDocument : public IDocument
+    {
+    public:
+        size_t GetPostingCount() const override { return 0; }
+        size_t GetSourceByteSize() const override { return 0; }
+
+        void Ingest(DocumentHandle /*handle*/) const override
+        {
+            RecoverableError error("ThrowingDocument::Ingest");
+            throw error;
+        }
+
+        bool Contains(Term & /*term*/) const override { return false; }
+        void OpenStream(Term::StreamId /*id*/) override {}
+        void AddTerm(char const * /*term*/) override {}
+        void CloseStream() override {}
+        void CloseDocument(size_t /*sourceByteSize*/) override {}
+    };
+
+
+    // A batch whose ingestion fails commits and expires the columns it
+    // reserved, so that their slice can still be fully expired.
+    TEST(Ingestor, AddBatchIngestionFailure)
+    {
+        const DocId c_maxDocId = 20;
+
+        auto fileSystem = Factories::CreateFileSystem();
+        auto termTables = Factories::CreateTermTableCollection();
+        termTables->AddTermTable(
+            Factories::CreatePrimeFactorsTermTable(c_maxDocId, c_streamId));
+
+        auto index = Factories::CreateSimpleIndex(*fileSystem);
+        index->SetTermTableCollection(std::move(termTables));
+        index->ConfigureAsMock(1, false);
+        index->StartIndex();
+        IIngestor & ingestor = index->GetIngestor();
+
+        std::vector<std::unique_ptr<IDocument>> documents;
+        for (DocId docId = 0; docId <= c_maxDocId; ++docId)
+        {
+            documents.push_back(
+                Factories::CreatePrimeFactorsDocument(index->GetConfiguration(),
+                                                      docId,
+                                                      c_maxDocId,
+                                                      c_streamId));
+        }
+
+        ingestor.Add(0, *documents[0]);
+        DocumentHandleInternal first(ingestor.GetHandle(0));
+        Slice & slice = first.GetSlice();
+        const DocIndex expiredCount = slice.GetExpiredCount();
+
+        ThrowingDocument throwing;
+        std::vector<std::pair<DocId, IDocument const *>> batch;
+        batch.push_back(std::make_pair(1, documents[1].get()));
+        batch.push_back(std::make_pair(2, &throwing));
+        batch.push_back(std::make_pair(3, documents[3].get()));
+        EXPECT_ANY_THROW(ingestor.AddBatch(batch));
+
+        EXPECT_FALSE(ingestor.Contains(1));
+        EXPECT_FALSE(ingestor.Contains(3));
+        EXPECT_EQ(slice.GetExpiredCount(), expiredCount + 3);
+        for (DocIndex i = 1; i <= 3; ++i)
+        {
+            EXPECT_FALSE(DocumentHandleInternal(&slice,
+                                                first.GetIndex() + i).IsActive());
+        }
+
+        // The documents can be added again.
+        batch[1].second = documents[2].get();
+        ingestor.AddBatch(batch);
+        EXPECT_TRUE(ingestor.Contains(1));
+        EXPECT_TRUE(ingestor.Contains(2));
+        EXPECT_TRUE(ingestor.Contains(3));
+    }
+
+
+    // Deletes three quarters of the documents and verifies that compaction
+    // moves the survivors into fewer slices while preserving their postings.
+    TEST(Ingestor, CompactSlices)
+    {
+        const DocId c_maxDocId = 2047;
+        auto fileSystem = Factories::CreateFileSystem();
+        auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                        c_maxDocId,
+                                                        c_streamId,
+                                                        1);
+        IIngestor & ingestor = index->GetIngestor();
+        IShard & shard = ingestor.GetShard(0);
+
+        const size_t sliceCount = shard.GetSliceBuffers().size();
+        ASSERT_GE(sliceCount, 3u);
+
+        for (DocId docId = 0; docId <= c_maxDocId; ++docId)
+        {
+            if (docId % 4 != 0)
+            {
+                EXPECT_TRUE(ingestor.Delete(docId));
+            }
+        }
+
+        // The active slice is never compacted.
+        const size_t movedCount = ingestor.CompactSlices(0.5);
+        EXPECT_GT(movedCount, 0u);
+        EXPECT_LT(shard.GetSliceBuffers().size(), sliceCount);
+
+        // Each surviving document is active in exactly one column.
+        size_t activeCount = 0;
+        for (auto buffer : shard.GetSliceBuffers())
+        {
+            for (DocIndex i = 0; i < shard.GetSliceCapacity(); ++i)
+            {
+                if (Factories::CreateDocumentHandle(buffer, i).IsActive())
+                {
+                    ++activeCount;
+                }
+            }
+        }
+        EXPECT_EQ(activeCount, (c_maxDocId + 1) / 4);
+
+        for (DocId docId = 0; docId <= c_maxDocId; ++docId)
+        {
+            ASSERT_EQ(ingestor.Contains(docId), docId % 4 == 0);
+            if (docId % 4 != 0)
+            {
+                continue;
+            }
+
+            DocumentHandle handle = ingestor.GetHandle(docId);
+            EXPECT_TRUE(handle.IsActive());
+            EXPECT_EQ(handle.GetDocId(), docId);
+
+            // Verify the rows for each prime factor.
+            for (size_t i = 0; Primes::c_primesBelow10000[i] <= docId; ++i)
+            {
+                if (docId % Primes::c_primesBelow10000[i] == 0)
+                {
+                    char const* text = Primes::c_primesBelow10000Text[i].c_str();
+                    Term term(Term::ComputeRawHash(text), c_streamId, 0);
+                    RowIdSequence rows(term, index->GetTermTable(0));
+                    for (auto row : rows)
+                    {
+                        EXPECT_TRUE(handle.GetBit(row));
+                    }
+                }
+            }
+        }
+
+        // A second pass finds nothing worth compacting.
+        EXPECT_EQ(ingestor.CompactSlices(0.5), 0u);
+    }
+
+
+    // Ingests documents into two groups and between them, and verifies that
+    // expiring a group retires exactly its slices and documents.
+    TEST(Ingestor, Groups)
+    {
+        const DocId c_maxDocId = 39;
+
+        auto fileSystem = Factories::CreateFileSystem();
+        auto termTables = Factories::CreateTermTableCollection();
+        termTables->AddTermTable(
+            Factories::CreatePrimeFactorsTermTable(c_maxDocId, c_streamId));
+
+        auto index = Factories::CreateSimpleIndex(*fileSystem);
+        index->SetTermTableCollection(std::move(termTables));
+        index->SetSliceBufferAllocator(
+            Factories::CreateSliceBufferAllocator(20000,
+                                                  512,
+                                                  PageSize::Default,
+                                                  1));
+        index->ConfigureAsMock(1, false);
+        index->StartIndex();
+
+        IIngestor & ingestor = index->GetIngestor();
+        IShard & shard = ingestor.GetShard(0);
+        ASSERT_GT(shard.GetSliceCapacity(), 10u);
+
+        // DocIds 0-9 belong to no group, 10-19 to group 1, 20-29 to group 2
+        // and 30-39 to no group.
+        for (DocId docId = 0; docId <= c_maxDocId; ++docId)
+        {
+            if (docId == 10)
+            {
+                ingestor.OpenGroup(1);
+            }
+            else if (docId == 20)
+            {
+                ingestor.OpenGroup(2);
+            }
+            else if (docId == 30)
+            {
+                ingestor.CloseGroup();
+            }
+
+            auto document =
+                Factories::CreatePrimeFactorsDocument(index->GetConfiguration(),
+                                                      docId,
+                                                      c_maxDocId,
+                                                      c_streamId);
+            ingestor.Add(docId, *document);
+        }
+
+        // Each change of group starts a new slice.
+        EXPECT_EQ(shard.GetSliceBuffers().size(), 4u);
+
+        EXPECT_THROW(ingestor.OpenGroup(1), RecoverableError);
+        EXPECT_THROW(ingestor.ExpireGroup(3), RecoverableError);
+
+        // Deleting a group's documents one at a time does not interfere with
+        // expiring the group.
+        EXPECT_TRUE(ingestor.Delete(25));
+
+        ingestor.ExpireGroup(1);
+        EXPECT_EQ(shard.GetSliceBuffers().size(), 3u);
+        EXPECT_THROW(ingestor.ExpireGroup(1), RecoverableError);
+
+        ingestor.ExpireGroup(2);
+        EXPECT_EQ(shard.GetSliceBuffers().size(), 2u);
+
+        for (DocId docId = 0; docId <= c_maxDocId; ++docId)
+        {
+            const bool isGrouped = docId >= 10 && docId < 30;
+            EXPECT_EQ(ingestor.Contains(docId), !isGrouped);
+            EXPECT_EQ(ingestor.Delete(docId), !isGrouped);
+        }
+
+        // Deleting the remaining documents recycles the slice which was
+        // active when group 1 was opened, since its unused columns were
+        // expired. The slice that is still active remains.
+        EXPECT_EQ(shard.GetSliceBuffers().size(), 1u);
+    }
+
+
+    // Several threads delete overlapping ranges of DocIds while others look
+    // them up. Each document must be deleted exactly once.
+    TEST(Ingestor, ConcurrentDelete)
+    {
+        const DocId c_maxDocId = 2047;
+        auto fileSystem = Factories::CreateFileSystem();
+        auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                        c_maxDocId,
+                                                        c_streamId,
+                                                        1);
+        IIngestor & ingestor = index->GetIngestor();
+        IShard & shard = ingestor.GetShard(0);
+
+        const size_t c_threadCount = 4;
+        std::atomic<size_t> deletedCount(0);
+        std::vector<std::future<void>> threads;
+        for (size_t t = 0; t < c_threadCount; ++t)
+        {
+            threads.push_back(std::async(std::launch::async, [&]()
+            {
+                for (DocId docId = 0; docId <= c_maxDocId; ++docId)
+                {
+                    ingestor.Contains(docId);
+                    if (ingestor.Delete(docId))
+                    {
+                        ++deletedCount;
+                    }
+                }
+            }));
+        }
+        for (auto & thread : threads)
+        {
+            thread.wait();
+        }
+
+        EXPECT_EQ(deletedCount, c_maxDocId + 1);
+
+        for (auto buffer : shard.GetSliceBuffers())
+        {
+            for (DocIndex i = 0; i < shard.GetSliceCapacity(); ++i)
+            {
+                EXPECT_FALSE(Factories::CreateDocumentHandle(buffer, i).IsActive());
+            }
+        }
+
+        for (DocId docId = 0; docId <= c_maxDocId; ++docId)
+        {
+            EXPECT_FALSE(ingestor.Contains(docId));
+        }
+    }
 }
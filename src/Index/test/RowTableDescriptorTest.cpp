@@ -21,12 +21,198 @@
 // THE SOFTWARE.
 
 
+#include <vector>
+
 #include "gtest/gtest.h"
 
+#include "RowBitBuffer.h"
+#include "RowTableDescriptor.h"
+
 
 namespace BitFunnel
 {
     TEST(RowTableDescriptor, Placeholder)
     {
     }
+
+
+    TEST(RowTableDescriptor, BitCounts)
+    {
+        const Rank maxRank = 3;
+        const DocIndex capacity = 64 << maxRank;
+        const RowIndex rowCount = 3;
+
+        const size_t rank0Bytes =
+            RowTableDescriptor::GetBufferSize(capacity, rowCount, 0, maxRank);
+        const size_t rank3Bytes =
+            RowTableDescriptor::GetBufferSize(capacity, rowCount, 3, maxRank);
+
+        RowTableDescriptor rank0(capacity, rowCount, 0, maxRank, 0);
+        RowTableDescriptor rank3(capacity,
+                                 rowCount,
+                                 3,
+                                 maxRank,
+                                 static_cast<ptrdiff_t>(rank0Bytes));
+
+        std::vector<uint64_t> buffer((rank0Bytes + rank3Bytes) / sizeof(uint64_t), 0);
+        void* sliceBuffer = buffer.data();
+
+        // Row 0 of rank 0 acts as a filter selecting the even documents.
+        for (DocIndex doc = 0; doc < capacity; doc += 2)
+        {
+            rank0.SetBit(sliceBuffer, 0, doc);
+        }
+
+        // Row 1 of rank 0 has every third document.
+        for (DocIndex doc = 0; doc < capacity; doc += 3)
+        {
+            rank0.SetBit(sliceBuffer, 1, doc);
+        }
+
+        // Row 1 of rank 3 has a single bit, shared by 8 rank 0 documents.
+        rank3.SetBit(sliceBuffer, 1, 5);
+
+        EXPECT_EQ(rank0.GetBitCount(sliceBuffer, 0), capacity / 2);
+        EXPECT_EQ(rank0.GetBitCount(sliceBuffer, 1), (capacity + 2) / 3);
+        EXPECT_EQ(rank0.GetBitCount(sliceBuffer, 2), 0u);
+        EXPECT_EQ(rank3.GetBitCount(sliceBuffer, 1), 1u);
+
+        // Only documents divisible by 6 pass the filter in rank 0. The rank 3
+        // bit covers documents 5, 69, 133, ..., which are all odd.
+        EXPECT_EQ(rank0.GetBitCount(sliceBuffer, 1, rank0, 0),
+                  (capacity + 5) / 6);
+        EXPECT_EQ(rank3.GetBitCount(sliceBuffer, 1, rank0, 0), 0u);
+
+        // Bit 6 of the rank 3 row covers the even documents 6, 70, 134, ...
+        rank3.SetBit(sliceBuffer, 1, 6);
+        EXPECT_EQ(rank3.GetBitCount(sliceBuffer, 1, rank0, 0),
+                  static_cast<size_t>(1 << maxRank));
+
+        std::vector<uint32_t> counts(capacity, 0);
+        rank0.AddColumnBitCounts(sliceBuffer, counts);
+        rank3.AddColumnBitCounts(sliceBuffer, counts);
+
+        for (DocIndex doc = 0; doc < capacity; ++doc)
+        {
+            uint32_t expected = 0;
+            for (RowIndex row = 0; row < rowCount; ++row)
+            {
+                expected += (rank0.GetBit(sliceBuffer, row, doc) != 0) ? 1 : 0;
+                expected += (rank3.GetBit(sliceBuffer, row, doc) != 0) ? 1 : 0;
+            }
+            EXPECT_EQ(counts[doc], expected) << "doc " << doc;
+        }
+    }
+
+
+    TEST(RowTableDescriptor, SummaryBits)
+    {
+        const Rank maxRank = 3;
+        const DocIndex capacity = 64 << maxRank;
+        const RowIndex rowCount = 3;
+
+        // The summary quadword comes first, followed by the two RowTables,
+        // whose summary bits share it.
+        const size_t summaryBytes =
+            RowTableDescriptor::GetSummaryBufferSize(2 * rowCount);
+        EXPECT_EQ(summaryBytes, sizeof(uint64_t));
+
+        const ptrdiff_t rank0Offset =
+            static_cast<ptrdiff_t>(RowTableDescriptor::c_rowTableByteAlignment);
+        const size_t rank0Bytes =
+            RowTableDescriptor::GetBufferSize(capacity, rowCount, 0, maxRank);
+        const size_t rank3Bytes =
+            RowTableDescriptor::GetBufferSize(capacity, rowCount, 3, maxRank);
+
+        RowTableDescriptor rank0(capacity, rowCount, 0, maxRank, rank0Offset, 0);
+        RowTableDescriptor rank3(capacity,
+                                 rowCount,
+                                 3,
+                                 maxRank,
+                                 rank0Offset + static_cast<ptrdiff_t>(rank0Bytes),
+                                 static_cast<ptrdiff_t>(rowCount));
+
+        EXPECT_EQ(rank0.GetSummaryBit(2), 2);
+        EXPECT_EQ(rank3.GetSummaryBit(0), static_cast<ptrdiff_t>(rowCount));
+
+        std::vector<uint64_t> buffer(
+            (static_cast<size_t>(rank0Offset) + rank0Bytes + rank3Bytes) / sizeof(uint64_t),
+            0);
+        void* sliceBuffer = buffer.data();
+
+        for (RowIndex row = 0; row < rowCount; ++row)
+        {
+            EXPECT_FALSE(rank0.MayHaveBits(sliceBuffer, row));
+            EXPECT_FALSE(rank3.MayHaveBits(sliceBuffer, row));
+        }
+
+        rank0.SetBit(sliceBuffer, 1, 100);
+        EXPECT_FALSE(rank0.MayHaveBits(sliceBuffer, 0));
+        EXPECT_TRUE(rank0.MayHaveBits(sliceBuffer, 1));
+        EXPECT_FALSE(rank3.MayHaveBits(sliceBuffer, 1));
+
+        // Buffered bits mark the summary before they are merged.
+        RowBitBuffer rowBits;
+        rank3.BufferBit(rowBits, sliceBuffer, 2, 7);
+        EXPECT_TRUE(rank3.MayHaveBits(sliceBuffer, 2));
+        EXPECT_EQ(rank3.GetBit(sliceBuffer, 2, 7), 0u);
+        rowBits.Merge();
+        EXPECT_NE(rank3.GetBit(sliceBuffer, 2, 7), 0u);
+
+        // Clearing the row's last bit leaves its summary bit set.
+        rank0.ClearBit(sliceBuffer, 1, 100);
+        EXPECT_EQ(rank0.GetBitCount(sliceBuffer, 1), 0u);
+        EXPECT_TRUE(rank0.MayHaveBits(sliceBuffer, 1));
+
+        EXPECT_EQ(buffer[0], (1ull << 1) | (1ull << (rowCount + 2)));
+
+        // Without a summary, every row may have bits.
+        RowTableDescriptor unsummarized(capacity, rowCount, 0, maxRank, rank0Offset);
+        EXPECT_EQ(unsummarized.GetSummaryBit(0),
+                  static_cast<ptrdiff_t>(RowTableDescriptor::c_noSummary));
+        EXPECT_TRUE(unsummarized.MayHaveBits(sliceBuffer, 0));
+    }
+
+
+    TEST(RowTableDescriptor, CopyColumn)
+    {
+        const Rank maxRank = 3;
+        const DocIndex capacity = 64 << maxRank;
+        const RowIndex rowCount = 4;
+
+        const ptrdiff_t rank0Offset =
+            static_cast<ptrdiff_t>(RowTableDescriptor::c_rowTableByteAlignment);
+        const size_t rank0Bytes =
+            RowTableDescriptor::GetBufferSize(capacity, rowCount, 0, maxRank);
+        RowTableDescriptor rank0(capacity, rowCount, 0, maxRank, rank0Offset, 0);
+
+        const size_t quadwordCount =
+            (static_cast<size_t>(rank0Offset) + rank0Bytes) / sizeof(uint64_t);
+        std::vector<uint64_t> source(quadwordCount, 0);
+        std::vector<uint64_t> destination(quadwordCount, 0);
+
+        const DocIndex from = 70;
+        const DocIndex to = 3;
+
+        rank0.SetBit(source.data(), 0, from);
+        rank0.SetBit(source.data(), 1, from);
+        rank0.SetBit(source.data(), 2, from + 1);
+        rank0.SetBit(source.data(), 3, from);
+
+        // Row 1 is excluded and row 2 has no bit in the copied column.
+        rank0.CopyColumn(source.data(), from, destination.data(), to, 1);
+
+        EXPECT_NE(rank0.GetBit(destination.data(), 0, to), 0u);
+        EXPECT_EQ(rank0.GetBit(destination.data(), 1, to), 0u);
+        EXPECT_EQ(rank0.GetBit(destination.data(), 2, to), 0u);
+        EXPECT_NE(rank0.GetBit(destination.data(), 3, to), 0u);
+        for (RowIndex row = 0; row < rowCount; ++row)
+        {
+            EXPECT_EQ(rank0.GetBitCount(destination.data(), row),
+                      (row == 0 || row == 3) ? 1u : 0u);
+        }
+
+        // Only the rows that received a bit are marked in the summary.
+        EXPECT_EQ(destination[0], (1ull << 0) | (1ull << 3));
+    }
 }
@@ -20,10 +20,16 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>
+#include <chrono>
 #include <future>
+#include <set>
+#include <sstream>
+#include <vector>
 
 #include "gtest/gtest.h"
 
+#include "BitFunnel/Exceptions.h"
 #include "BitFunnel/Index/Factories.h"
 #include "BitFunnel/Index/Helpers.h"
 #include "BitFunnel/Index/IRecycler.h"
@@ -31,6 +37,7 @@
 #include "BitFunnel/Index/ITermTable.h"
 #include "BitFunnel/Index/Token.h"
 #include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/Numa.h"
 #include "DocumentDataSchema.h"
 #include "IndexUtils.h"
 #include "Shard.h"
@@ -65,7 +72,9 @@ namespace BitFunnel
                         *termTable,
                         docDataSchema,
                         *trackingAllocator,
-                        blockSize);
+                        blockSize,
+                        0,
+                        c_anyNumaNode);
 
             auto sliceCapacity = shard.GetSliceCapacity();
             ASSERT_GT(sliceCapacity, 0u);
@@ -84,7 +93,7 @@ namespace BitFunnel
                 currentSlice = &h.GetSlice();
             }
 
-            EXPECT_EQ(trackingAllocator->GetInUseBuffersCount(),
+            EXPECT_EQ(trackingAllocator->GetInUseBufferCount(),
                       c_numSlices);
 
             for (auto const & slice : slices)
@@ -99,7 +108,7 @@ namespace BitFunnel
             // TODO: check that the slice pointer points to something we can
             // write to?
 
-            EXPECT_EQ(trackingAllocator->GetInUseBuffersCount(),
+            EXPECT_EQ(trackingAllocator->GetInUseBufferCount(),
                       c_numSlices);
 
             for (auto & slice : slices)
@@ -112,7 +121,7 @@ namespace BitFunnel
                 shard.RecycleSlice(*slice);
             }
 
-            while(trackingAllocator->GetInUseBuffersCount() != 0u) {}
+            while(trackingAllocator->GetInUseBufferCount() != 0u) {}
 
             // TODO: try to recycle non-existent slice.
 
@@ -120,5 +129,269 @@ namespace BitFunnel
             recycler->Shutdown();
             background.wait();
         }
+
+
+        // Several threads reserve ranges of columns concurrently. Verifies
+        // that every column is reserved exactly once and that the slices
+        // fill up before new ones are created.
+        TEST(Shard, AllocateDocuments)
+        {
+            auto recycler = Factories::CreateRecycler();
+            auto background = std::async(std::launch::async, &IRecycler::Run, recycler.get());
+
+            auto tokenManager = Factories::CreateTokenManager();
+            auto termTable = Factories::CreateTermTable();
+            termTable->Seal();
+
+            DocumentDataSchema docDataSchema;
+
+            const size_t blockSize =
+                GetMinimumBlockSize(docDataSchema, *termTable);
+
+            std::unique_ptr<TrackingSliceBufferAllocator>
+                trackingAllocator(new TrackingSliceBufferAllocator(blockSize));
+
+            Shard shard(0,
+                        *recycler,
+                        *tokenManager,
+                        *termTable,
+                        docDataSchema,
+                        *trackingAllocator,
+                        blockSize,
+                        0,
+                        c_anyNumaNode);
+
+            const DocIndex sliceCapacity = shard.GetSliceCapacity();
+            const size_t c_threadCount = 4;
+            const DocIndex c_maxRange = 7;
+
+            // Each thread reserves the columns of one slice in total.
+            std::vector<std::future<std::vector<std::pair<Slice*, DocIndex>>>> threads;
+            for (size_t t = 0; t < c_threadCount; ++t)
+            {
+                threads.push_back(std::async(std::launch::async, [&]()
+                {
+                    std::vector<std::pair<Slice*, DocIndex>> columns;
+                    while (columns.size() < sliceCapacity)
+                    {
+                        const DocIndex maxCount =
+                            (std::min)(c_maxRange,
+                                       sliceCapacity - columns.size());
+                        DocIndex first;
+                        DocIndex count;
+                        Slice* slice =
+                            shard.AllocateDocuments(maxCount, first, count);
+                        EXPECT_GT(count, 0u);
+                        EXPECT_LE(count, maxCount);
+                        EXPECT_LE(first + count, sliceCapacity);
+                        for (DocIndex i = first; i < first + count; ++i)
+                        {
+                            columns.push_back(std::make_pair(slice, i));
+                        }
+                        slice->CommitDocuments(count);
+                    }
+                    return columns;
+                }));
+            }
+
+            std::set<std::pair<Slice*, DocIndex>> columns;
+            std::set<Slice*> slices;
+            for (auto & thread : threads)
+            {
+                for (auto column : thread.get())
+                {
+                    EXPECT_TRUE(columns.insert(column).second);
+                    slices.insert(column.first);
+                }
+            }
+            EXPECT_EQ(columns.size(), sliceCapacity * c_threadCount);
+            EXPECT_EQ(slices.size(), c_threadCount);
+            EXPECT_EQ(trackingAllocator->GetInUseBufferCount(), c_threadCount);
+
+            for (auto slice : slices)
+            {
+                EXPECT_TRUE(slice->IsFullyIngested());
+                EXPECT_TRUE(slice->ExpireAllDocuments());
+                shard.RecycleSlice(*slice);
+            }
+
+            while(trackingAllocator->GetInUseBufferCount() != 0u) {}
+
+            tokenManager->Shutdown();
+            recycler->Shutdown();
+            background.wait();
+        }
+
+
+        TEST(Shard, ExpireAllDocumentsPendingCommit)
+        {
+            auto recycler = Factories::CreateRecycler();
+            auto background = std::async(std::launch::async, &IRecycler::Run, recycler.get());
+
+            auto tokenManager = Factories::CreateTokenManager();
+            auto termTable = Factories::CreateTermTable();
+            termTable->Seal();
+
+            DocumentDataSchema docDataSchema;
+
+            const size_t blockSize =
+                GetMinimumBlockSize(docDataSchema, *termTable);
+
+            std::unique_ptr<TrackingSliceBufferAllocator>
+                trackingAllocator(new TrackingSliceBufferAllocator(blockSize));
+
+            Shard shard(0,
+                        *recycler,
+                        *tokenManager,
+                        *termTable,
+                        docDataSchema,
+                        *trackingAllocator,
+                        blockSize,
+                        0,
+                        c_anyNumaNode);
+
+            // Reserve a few columns, as AddBatch() does, and retire the
+            // Slice before they are committed.
+            DocIndex first;
+            DocIndex count;
+            Slice* slice = shard.AllocateDocuments(3, first, count);
+            ASSERT_EQ(count, 3u);
+
+            auto expire = std::async(std::launch::async, [slice]()
+            {
+                return slice->ExpireAllDocuments();
+            });
+
+            EXPECT_EQ(expire.wait_for(std::chrono::milliseconds(10)),
+                      std::future_status::timeout);
+
+            slice->CommitDocuments(count);
+            EXPECT_TRUE(expire.get());
+
+            // No further columns are handed out once the Slice is retired.
+            DocIndex index;
+            EXPECT_FALSE(slice->TryAllocateDocument(index));
+            EXPECT_FALSE(slice->ExpireAllDocuments());
+            EXPECT_TRUE(slice->IsExpired());
+
+            shard.RecycleSlice(*slice);
+            while(trackingAllocator->GetInUseBufferCount() != 0u) {}
+
+            tokenManager->Shutdown();
+            recycler->Shutdown();
+            background.wait();
+        }
+
+
+        TEST(Shard, WriteAndLoadSlice)
+        {
+            auto recycler = Factories::CreateRecycler();
+            auto background = std::async(std::launch::async, &IRecycler::Run, recycler.get());
+
+            auto tokenManager = Factories::CreateTokenManager();
+            auto termTable = Factories::CreateTermTable();
+            termTable->Seal();
+
+            DocumentDataSchema docDataSchema;
+
+            // A schema with a different DocTable layout. Its block size is
+            // used for all shards so that only the descriptors differ.
+            DocumentDataSchema otherSchema;
+            otherSchema.RegisterFixedSizeBlob(64);
+
+            const size_t blockSize =
+                GetMinimumBlockSize(otherSchema, *termTable);
+
+            std::unique_ptr<TrackingSliceBufferAllocator>
+                trackingAllocator(new TrackingSliceBufferAllocator(blockSize));
+
+            Shard shard(0,
+                        *recycler,
+                        *tokenManager,
+                        *termTable,
+                        docDataSchema,
+                        *trackingAllocator,
+                        blockSize,
+                        0,
+                        c_anyNumaNode);
+
+            // Fill one slice, activating every other document.
+            const DocIndex sliceCapacity = shard.GetSliceCapacity();
+            Slice* slice = nullptr;
+            for (DocIndex i = 0; i < sliceCapacity; ++i)
+            {
+                DocumentHandleInternal h = shard.AllocateDocument(1000 + i);
+                if (i % 2 == 0)
+                {
+                    h.Activate();
+                }
+                slice = &h.GetSlice();
+                slice->CommitDocument();
+            }
+
+            std::stringstream stream;
+            slice->Write(stream);
+            const std::string persisted = stream.str();
+
+            // The slice buffer is page aligned within the stream.
+            EXPECT_GT(persisted.size(), blockSize);
+
+            Slice* loaded = nullptr;
+            {
+                std::stringstream input(persisted);
+                loaded = shard.LoadSlice(input);
+            }
+            ASSERT_NE(loaded, nullptr);
+            EXPECT_NE(loaded, slice);
+            EXPECT_EQ(shard.GetSliceBuffers().size(), 2u);
+            EXPECT_EQ(Slice::GetSliceFromBuffer(loaded->GetSliceBuffer(),
+                                                Shard::GetSlicePtrOffset()),
+                      loaded);
+
+            for (DocIndex i = 0; i < sliceCapacity; ++i)
+            {
+                DocumentHandleInternal h(loaded, i);
+                EXPECT_EQ(h.IsActive(), i % 2 == 0);
+                EXPECT_EQ(h.GetDocId(), 1000 + i);
+            }
+
+            // An unknown format version is rejected.
+            {
+                std::string corrupt = persisted;
+                corrupt[0] = static_cast<char>(corrupt[0] + 1);
+                std::stringstream input(corrupt);
+                EXPECT_THROW(shard.LoadSlice(input), RecoverableError);
+            }
+
+            // A shard with a different DocTable layout rejects the slice.
+            {
+                Shard otherShard(1,
+                                 *recycler,
+                                 *tokenManager,
+                                 *termTable,
+                                 otherSchema,
+                                 *trackingAllocator,
+                                 blockSize,
+                                 0,
+                                 c_anyNumaNode);
+                std::stringstream input(persisted);
+                EXPECT_THROW(otherShard.LoadSlice(input), RecoverableError);
+            }
+
+            for (auto s : { slice, loaded })
+            {
+                for (DocIndex i = 0; i < sliceCapacity; ++i)
+                {
+                    s->ExpireDocument();
+                }
+                shard.RecycleSlice(*s);
+            }
+
+            while(trackingAllocator->GetInUseBufferCount() != 0u) {}
+
+            tokenManager->Shutdown();
+            recycler->Shutdown();
+            background.wait();
+        }
     }
 }
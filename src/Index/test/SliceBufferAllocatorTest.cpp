@@ -0,0 +1,80 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/ISliceBufferAllocator.h"
+#include "BitFunnel/Utilities/IBlockAllocator.h"
+#include "BitFunnel/Utilities/Numa.h"
+
+
+namespace BitFunnel
+{
+    namespace SliceBufferAllocatorTest
+    {
+        TEST(SliceBufferAllocator, NumaPools)
+        {
+            static const size_t c_bufferSize = 4096;
+            static const size_t c_maxBufferCount = 4;
+            static const unsigned c_nodeCount = 2;
+
+            // Pools are created for each requested node, whether or not the
+            // system has that many nodes.
+            auto allocator =
+                Factories::CreateSliceBufferAllocator(c_bufferSize,
+                                                      c_maxBufferCount,
+                                                      PageSize::Default,
+                                                      c_nodeCount);
+
+            EXPECT_EQ(c_nodeCount, allocator->GetNumaNodeCount());
+            EXPECT_EQ(c_bufferSize, allocator->GetSliceBufferSize());
+
+            // Each node has its own pool of c_maxBufferCount buffers.
+            std::vector<void*> buffers;
+            for (unsigned node = 0; node < c_nodeCount; ++node)
+            {
+                for (size_t i = 0; i < c_maxBufferCount; ++i)
+                {
+                    buffers.push_back(allocator->Allocate(c_bufferSize, node));
+                }
+            }
+            EXPECT_EQ(c_nodeCount * c_maxBufferCount,
+                      allocator->GetInUseBufferCount());
+            EXPECT_ANY_THROW(allocator->Allocate(c_bufferSize, 0));
+
+            // Buffers are returned to the pool they came from.
+            for (auto buffer : buffers)
+            {
+                allocator->Release(buffer);
+            }
+            EXPECT_EQ(0u, allocator->GetInUseBufferCount());
+
+            // Unbound requests are served from the first pool.
+            void* buffer = allocator->Allocate(c_bufferSize, c_anyNumaNode);
+            EXPECT_EQ(1u, allocator->GetInUseBufferCount());
+            allocator->Release(buffer);
+        }
+    }
+}
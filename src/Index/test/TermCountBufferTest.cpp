@@ -0,0 +1,122 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <future>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Exceptions.h"
+#include "DocumentFrequencyTableBuilder.h"
+#include "TermCountBuffer.h"
+
+
+namespace BitFunnel
+{
+    namespace TermCountBufferTest
+    {
+        static const size_t c_documentCount = 1000;
+        static const size_t c_threadCount = 4;
+
+        // Document d contains term t for each t dividing d.
+        static void AddDocument(DocumentFrequencyTableBuilder& builder,
+                                size_t d)
+        {
+            builder.OnDocumentEnter();
+            for (size_t t = 1; t <= d; ++t)
+            {
+                if (d % t == 0)
+                {
+                    builder.OnTerm(Term(static_cast<Term::Hash>(t), 0, 0));
+                }
+            }
+        }
+
+
+        TEST(TermCountBuffer, MatchesDirectCounts)
+        {
+            DocumentFrequencyTableBuilder expected(0);
+            for (size_t d = 1; d <= c_documentCount; ++d)
+            {
+                AddDocument(expected, d);
+            }
+
+            // Each thread buffers its share of the documents in batches.
+            DocumentFrequencyTableBuilder observed(0);
+            std::vector<std::future<void>> threads;
+            for (size_t thread = 0; thread < c_threadCount; ++thread)
+            {
+                threads.push_back(std::async(std::launch::async, [&, thread]()
+                {
+                    TermCountBuffer buffer;
+                    buffer.Attach();
+                    for (size_t d = thread + 1; d <= c_documentCount; d += c_threadCount)
+                    {
+                        AddDocument(observed, d);
+                        if (d % 100 < c_threadCount)
+                        {
+                            buffer.Merge();
+                        }
+                    }
+                    buffer.Detach();
+                    buffer.Merge();
+                }));
+            }
+            for (auto & thread : threads)
+            {
+                thread.get();
+            }
+
+            EXPECT_EQ(observed.GetDocumentCount(), c_documentCount);
+            for (size_t t = 1; t <= c_documentCount + 1; ++t)
+            {
+                const Term term(static_cast<Term::Hash>(t), 0, 0);
+                EXPECT_EQ(observed.GetTermCount(term), expected.GetTermCount(term));
+            }
+        }
+
+
+        TEST(TermCountBuffer, Attach)
+        {
+            DocumentFrequencyTableBuilder builder(0);
+
+            TermCountBuffer buffer;
+            buffer.Attach();
+            EXPECT_EQ(TermCountBuffer::GetAttached(), &buffer);
+
+            TermCountBuffer other;
+            EXPECT_THROW(other.Attach(), RecoverableError);
+
+            // Counts reach the builder only when merged.
+            AddDocument(builder, 6);
+            EXPECT_EQ(builder.GetDocumentCount(), 0u);
+
+            buffer.Detach();
+            EXPECT_EQ(TermCountBuffer::GetAttached(), nullptr);
+            buffer.Merge();
+
+            EXPECT_EQ(builder.GetDocumentCount(), 1u);
+            EXPECT_EQ(builder.GetTermCount(Term(3, 0, 0)), 1u);
+            EXPECT_EQ(builder.GetTermCount(Term(4, 0, 0)), 0u);
+        }
+    }
+}
@@ -0,0 +1,121 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Exceptions.h"
+#include "TermCountSketch.h"
+
+
+namespace BitFunnel
+{
+    namespace TermCountSketchTest
+    {
+        static const size_t c_maxBytes = 256 * 1024;
+        static const size_t c_termCount = 100000;
+
+        // Term i occurs about c_termCount / (i + 1) times, so the vocabulary
+        // is far too large for the heavy hitter table.
+        static size_t GetCount(size_t i)
+        {
+            return c_termCount / (i + 1);
+        }
+
+
+        static Term MakeTerm(size_t i)
+        {
+            return Term(static_cast<Term::Hash>(i), 0, 0);
+        }
+
+
+        TEST(TermCountSketch, ZipfStream)
+        {
+            TermCountSketch sketch(c_maxBytes);
+
+            // Interleave the terms so that frequent terms must survive the
+            // eviction of the heavy hitter table.
+            size_t total = 0;
+            for (size_t round = 0; round < GetCount(0); ++round)
+            {
+                for (size_t i = 0; i < c_termCount && GetCount(i) > round; ++i)
+                {
+                    sketch.Add(MakeTerm(i), 1);
+                    ++total;
+                }
+            }
+
+            EXPECT_LE(sketch.GetByteSize(), c_maxBytes);
+
+            // Estimates never fall below the true counts and the frequent
+            // terms are estimated closely.
+            for (size_t i = 0; i < c_termCount; ++i)
+            {
+                const size_t estimate = sketch.GetEstimate(MakeTerm(i));
+                ASSERT_GE(estimate, GetCount(i));
+                if (i < 100)
+                {
+                    EXPECT_LE(estimate, GetCount(i) + total / 1000);
+                }
+            }
+
+            // The most frequent terms are heavy hitters.
+            auto const & heavyHitters = sketch.GetHeavyHitters();
+            EXPECT_LT(heavyHitters.size(), c_termCount);
+            for (size_t i = 0; i < 100; ++i)
+            {
+                auto it = heavyHitters.find(MakeTerm(i));
+                ASSERT_NE(it, heavyHitters.end());
+                EXPECT_EQ(it->second, sketch.GetEstimate(MakeTerm(i)));
+            }
+
+            // HyperLogLog with 4096 registers has a standard error of about
+            // 1.6%.
+            const double distinct = static_cast<double>(sketch.GetDistinctCount());
+            EXPECT_NEAR(distinct, static_cast<double>(c_termCount), c_termCount * 0.05);
+        }
+
+
+        TEST(TermCountSketch, BatchedCounts)
+        {
+            TermCountSketch sketch(TermCountSketch::c_minByteSize);
+
+            sketch.Add(MakeTerm(1), 5);
+            sketch.Add(MakeTerm(2), 7);
+            sketch.Add(MakeTerm(1), 3);
+
+            EXPECT_EQ(sketch.GetEstimate(MakeTerm(1)), 8u);
+            EXPECT_EQ(sketch.GetEstimate(MakeTerm(2)), 7u);
+            EXPECT_EQ(sketch.GetEstimate(MakeTerm(3)), 0u);
+            EXPECT_EQ(sketch.GetHeavyHitters().size(), 2u);
+            EXPECT_EQ(sketch.GetDistinctCount(), 2u);
+        }
+
+
+        TEST(TermCountSketch, TooSmall)
+        {
+            EXPECT_THROW(TermCountSketch(TermCountSketch::c_minByteSize - 1),
+                         RecoverableError);
+        }
+    }
+}
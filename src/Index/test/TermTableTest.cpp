@@ -24,6 +24,9 @@
 
 #include "gtest/gtest.h"
 
+#include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IFileSystem.h"
+#include "BitFunnel/Exceptions.h"
 #include "BitFunnel/Index/RowIdSequence.h"
 #include "TermTable.h"
 
@@ -446,7 +449,61 @@ namespace BitFunnel
 
         TEST(TermTable, RoundTrip)
         {
-            // TODO: Implement this test.
+            const size_t termCount = 1000;
+            const size_t explicitRowCount = 2000;
+            const size_t adhocRowCount = 200;
+            const Term::Hash c_firstHash = 1000ull;
+
+            TermTable termTable;
+            for (size_t i = 0; i < termCount; ++i)
+            {
+                termTable.OpenTerm();
+                for (size_t r = 0; r <= (i % 3); ++r)
+                {
+                    termTable.AddRowId(RowId(0, 2 * i + r));
+                }
+                termTable.CloseTerm(c_firstHash + i);
+            }
+            termTable.SetRowCounts(0, explicitRowCount, adhocRowCount);
+            termTable.SetFactCount(0);
+            termTable.Seal();
+
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            termTable.Write(*fileSystem->OpenForWrite("TermTable.bin"));
+
+            TermTable fromStream(*fileSystem->OpenForRead("TermTable.bin"));
+            TermTable fromMappedFile(
+                fileSystem->OpenForMappedRead("TermTable.bin"));
+
+            EXPECT_EQ(termTable, fromStream);
+            EXPECT_EQ(termTable, fromMappedFile);
+
+            for (size_t i = 0; i < termCount; ++i)
+            {
+                Term term(c_firstHash + i, 0, 0);
+                PackedRowIdSequence expected = termTable.GetRows(term);
+                EXPECT_EQ(expected.GetType(),
+                          PackedRowIdSequence::Type::Explicit);
+                EXPECT_EQ(expected.GetEnd() - expected.GetStart(), (i % 3) + 1);
+                EXPECT_EQ(expected, fromStream.GetRows(term));
+                EXPECT_EQ(expected, fromMappedFile.GetRows(term));
+            }
+
+            // Terms not in the table are treated as adhoc.
+            Term adhoc(c_firstHash + termCount, 0, 0);
+            EXPECT_EQ(fromMappedFile.GetRows(adhoc).GetType(),
+                      PackedRowIdSequence::Type::Adhoc);
+
+            // A truncated file is rejected.
+            {
+                std::stringstream stream;
+                termTable.Write(stream);
+                *fileSystem->OpenForWrite("Truncated.bin")
+                    << stream.str().substr(0, 100);
+            }
+            EXPECT_THROW(
+                TermTable table(fileSystem->OpenForMappedRead("Truncated.bin")),
+                RecoverableError);
         }
     }
 }
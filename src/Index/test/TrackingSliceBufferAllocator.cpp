@@ -37,7 +37,7 @@ namespace BitFunnel
     }
 
 
-    size_t TrackingSliceBufferAllocator::GetInUseBuffersCount() const
+    size_t TrackingSliceBufferAllocator::GetInUseBufferCount() const
     {
         std::lock_guard<std::mutex> lock(m_lock);
 
@@ -45,7 +45,16 @@ namespace BitFunnel
     }
 
 
-    void* TrackingSliceBufferAllocator::Allocate(size_t byteSize)
+    size_t TrackingSliceBufferAllocator::GetCommittedBufferCount() const
+    {
+        // Buffers are allocated individually, so only buffers in use are
+        // committed.
+        return GetInUseBufferCount();
+    }
+
+
+    void* TrackingSliceBufferAllocator::Allocate(size_t byteSize,
+                                                 unsigned /*numaNode*/)
     {
         std::lock_guard<std::mutex> lock(m_lock);
 
@@ -75,4 +84,10 @@ namespace BitFunnel
     {
         return m_blockSize;
     }
+
+
+    unsigned TrackingSliceBufferAllocator::GetNumaNodeCount() const
+    {
+        return 1;
+    }
 }
@@ -38,11 +38,12 @@ namespace BitFunnel
     public:
         TrackingSliceBufferAllocator(size_t blockSize);
 
-        size_t GetInUseBuffersCount() const;
-
-        virtual void* Allocate(size_t byteSize) override;
+        virtual void* Allocate(size_t byteSize, unsigned numaNode) override;
         virtual void Release(void* buffer) override;
         virtual size_t GetSliceBufferSize() const override;
+        virtual size_t GetInUseBufferCount() const override;
+        virtual size_t GetCommittedBufferCount() const override;
+        virtual unsigned GetNumaNodeCount() const override;
 
     private:
         mutable std::mutex m_lock;
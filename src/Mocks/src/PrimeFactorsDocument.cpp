@@ -33,6 +33,7 @@
 #include "BitFunnel/Index/ITermTable.h"
 #include "BitFunnel/Index/ITermTableCollection.h"
 #include "BitFunnel/Mocks/Factories.h"
+#include "BitFunnel/Utilities/IBlockAllocator.h"
 #include "BitFunnel/Utilities/Primes.h"
 #include "LoggerInterfaces/Check.h"
 
@@ -219,7 +220,9 @@ namespace BitFunnel
         size_t blockCount = 512;
         auto sliceAllocator =
             Factories::CreateSliceBufferAllocator(blockSize,
-                                                  blockCount);
+                                                  blockCount,
+                                                  PageSize::Default,
+                                                  1);
 
         auto index = Factories::CreateSimpleIndex(fileSystem);
         index->SetTermTableCollection(std::move(termTableCollection));
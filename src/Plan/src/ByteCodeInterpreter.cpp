@@ -20,7 +20,9 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>
 #include <iostream>
+#include <smmintrin.h>  // For SSE4.1 intrinsics.
 
 #ifdef _MSC_VER
 #include <intrin.h>
@@ -67,7 +69,11 @@ Decide on type of Slices
         ptrdiff_t const * rowOffsets,
         IDiagnosticStream * diagnosticStream,
         QueryInstrumentation & instrumentation,
-        CacheLineRecorder * cacheLineRecorder)
+        CacheLineRecorder * cacheLineRecorder,
+        size_t laneCount,
+        size_t prefetchDistance,
+        QueryDeadline const & deadline,
+        Stacks * stacks)
       : m_code(code.GetCode()),
         m_jumpTable(code.GetJumpTable()),
         m_resultsBuffer(resultsBuffer),
@@ -76,11 +82,33 @@ Decide on type of Slices
         m_iterationsPerSlice(iterationsPerSlice),
         m_initialRank(initialRank),
         m_rowOffsets(rowOffsets),
+        m_laneCount(1),
+        m_prefetchDistance(prefetchDistance),
+        m_rowCount(code.GetRowCount()),
+        m_deadline(deadline),
+        m_stacks((stacks == nullptr) ? m_localStacks : *stacks),
+        m_callStack(m_stacks.m_callStack),
+        m_valueStack(m_stacks.m_valueStack),
+        m_divergences(m_stacks.m_divergences),
         m_dedupe(),
         m_diagnosticStream(diagnosticStream),
         m_instrumentation(instrumentation),
         m_cacheLineRecorder(cacheLineRecorder)
     {
+        // A previous interpreter may have stopped with values on the stacks.
+        m_callStack.clear();
+        m_valueStack.clear();
+        m_divergences.clear();
+
+        // Diagnostics and cache line recording describe the accesses of a
+        // single lane, so they run on the reference path.
+        if (laneCount >= c_maxLaneCount &&
+            code.SupportsLanes() &&
+            diagnosticStream == nullptr &&
+            cacheLineRecorder == nullptr)
+        {
+            m_laneCount = c_maxLaneCount;
+        }
     }
 
 
@@ -88,6 +116,11 @@ Decide on type of Slices
     {
         for (size_t i = 0; i < m_sliceCount; ++i)
         {
+            if (m_deadline.HasExpired())
+            {
+                return true;
+            }
+
             bool terminate = ProcessOneSlice(i);
             if (terminate)
             {
@@ -110,17 +143,32 @@ Decide on type of Slices
             m_cacheLineRecorder->SetBase(sliceBuffer);
         }
 
+        if (m_prefetchDistance > 0 &&
+            m_prefetchDistance < m_sliceCount - slice)
+        {
+            PrefetchSlice(slice + m_prefetchDistance);
+        }
+
         bool terminate = false;
+        size_t i = 0;
 
-        for (size_t i = 0; i < m_iterationsPerSlice; ++i)
+        if (m_laneCount == c_maxLaneCount)
         {
-            terminate = RunOneIteration(sliceBuffer, i);
-            if (terminate)
+            for (; i + c_maxLaneCount <= m_iterationsPerSlice; i += c_maxLaneCount)
             {
-                break;
+                terminate = RunLanes(sliceBuffer, i);
+                if (terminate)
+                {
+                    break;
+                }
             }
         }
 
+        for (; !terminate && i < m_iterationsPerSlice; ++i)
+        {
+            terminate = RunOneIteration(sliceBuffer, i);
+        }
+
         if (m_cacheLineRecorder != nullptr)
         {
             m_instrumentation.IncrementCacheLineCount(
@@ -132,6 +180,18 @@ Decide on type of Slices
     }
 
 
+    void ByteCodeInterpreter::PrefetchSlice(size_t slice)
+    {
+        char const * sliceBuffer =
+            reinterpret_cast<char const *>(m_sliceBuffers[slice]);
+        for (size_t row = 0; row < m_rowCount; ++row)
+        {
+            _mm_prefetch(sliceBuffer + m_rowOffsets[row], _MM_HINT_T0);
+        }
+        m_instrumentation.IncrementPrefetchCount(m_rowCount);
+    }
+
+
     bool ByteCodeInterpreter::RunOneIteration(
         void const * voidSliceBuffer,
         size_t iteration)
@@ -275,7 +335,7 @@ Decide on type of Slices
                 // TODO: Combine accumulator with value stack.
                 if (accumulator != 0)
                 {
-                    AddResult(accumulator, offset, base);
+                    AddResult(0, accumulator, offset, base);
                 }
                 ip++;
                 break;
@@ -317,12 +377,228 @@ Decide on type of Slices
         }  // while
 
 
-        bool terminate = FinishIteration(base, sliceBuffer);
+        bool terminate = FinishIteration(0, base, sliceBuffer);
+
+        return terminate;
+    }
+
+
+    // Returns a bitmap with bit i set if lane i of value is zero.
+    static unsigned ZeroLanes(__m128i value)
+    {
+        const __m128i zero = _mm_cmpeq_epi64(value, _mm_setzero_si128());
+        return static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(zero)));
+    }
+
+
+    // Returns a vector with all bits set in each lane whose bit is set in
+    // lanes.
+    static __m128i LaneMask(unsigned lanes)
+    {
+        return _mm_set_epi64x(-static_cast<int64_t>((lanes >> 1) & 1),
+                              -static_cast<int64_t>(lanes & 1));
+    }
+
+
+    bool ByteCodeInterpreter::RunLanes(
+        void const * voidSliceBuffer,
+        size_t iteration)
+    {
+        static_assert(c_maxLaneCount == 2,
+                      "RunLanes() assumes two 64-bit lanes per __m128i.");
+        const unsigned c_allLanes = 3;
+
+        char const * sliceBuffer =
+            reinterpret_cast<char const *>(voidSliceBuffer);
+
+        const __m128i ones = _mm_set1_epi64x(-1);
+        __m128i accumulator = _mm_setzero_si128();
+        auto ip = m_code.data();
+
+        // Lane 0 runs 'iteration' and tracks 'offset' exactly as
+        // RunOneIteration() does. After a net left shift of 'shift', lane 1
+        // is (1 << shift) quadwords further along.
+        size_t offset = iteration;
+        size_t shift = 0;
+
+        // Bitmap of lanes that took a Jz the other lanes did not take.
+        unsigned inactive = 0;
+        m_divergences.clear();
+
+        while (ip->GetOpcode() != Opcode::End)
+        {
+            // Lanes that jumped rejoin at the jump target. They jumped because
+            // their accumulator was zero.
+            while (!m_divergences.empty() && m_divergences.back().m_target == ip)
+            {
+                accumulator = _mm_andnot_si128(LaneMask(inactive), accumulator);
+                inactive = m_divergences.back().m_inactive;
+                m_divergences.pop_back();
+            }
+
+            const Opcode opcode = ip->GetOpcode();
+            const unsigned row = ip->GetRow();
+            const unsigned delta = ip->GetDelta();
+            const bool inverted = ip->IsInverted();
+
+            switch (opcode)
+            {
+            case Opcode::AndRow:
+            case Opcode::LoadRow:
+                {
+                    m_instrumentation.IncrementQuadwordCount(c_maxLaneCount);
+                    uint64_t const * rowPtr =
+                        reinterpret_cast<uint64_t const *>(
+                            sliceBuffer + m_rowOffsets[row]);
+
+                    auto ptr0 = rowPtr + (offset >> delta);
+                    auto ptr1 = rowPtr + ((offset + (1ull << shift)) >> delta);
+
+                    // Adjacent quadwords are loaded together. Otherwise the
+                    // lanes share a quadword of a higher rank row or are
+                    // spread apart by a rank down.
+                    __m128i value = (ptr1 == ptr0 + 1) ?
+                        _mm_loadu_si128(reinterpret_cast<__m128i const *>(ptr0)) :
+                        _mm_set_epi64x(static_cast<int64_t>(*ptr1),
+                                       static_cast<int64_t>(*ptr0));
+                    if (inverted)
+                    {
+                        value = _mm_xor_si128(value, ones);
+                    }
+
+                    accumulator = (opcode == Opcode::AndRow) ?
+                        _mm_and_si128(accumulator, value) :
+                        value;
+                    ip++;
+                }
+                break;
+            case Opcode::LeftShiftOffset:
+                offset <<= row;
+                shift += row;
+                ip++;
+                break;
+            case Opcode::RightShiftOffset:
+                offset >>= row;
+                shift -= row;
+                ip++;
+                break;
+            case Opcode::IncrementOffset:
+                offset++;
+                ip++;
+                break;
+            case Opcode::Push:
+                {
+                    const size_t size = m_valueStack.size();
+                    m_valueStack.resize(size + c_maxLaneCount);
+                    _mm_storeu_si128(
+                        reinterpret_cast<__m128i *>(m_valueStack.data() + size),
+                        accumulator);
+                    ip++;
+                }
+                break;
+            case Opcode::Pop:
+            case Opcode::AndStack:
+            case Opcode::OrStack:
+                {
+                    const size_t size = m_valueStack.size() - c_maxLaneCount;
+                    const __m128i value = _mm_loadu_si128(
+                        reinterpret_cast<__m128i const *>(m_valueStack.data() + size));
+                    m_valueStack.resize(size);
+
+                    if (opcode == Opcode::Pop)
+                    {
+                        accumulator = value;
+                    }
+                    else if (opcode == Opcode::AndStack)
+                    {
+                        accumulator = _mm_and_si128(accumulator, value);
+                    }
+                    else
+                    {
+                        accumulator = _mm_or_si128(accumulator, value);
+                    }
+                    ip++;
+                }
+                break;
+            case Opcode::Not:
+                // Logical not, as in RunOneIteration().
+                accumulator = _mm_srli_epi64(
+                    _mm_cmpeq_epi64(accumulator, _mm_setzero_si128()), 63);
+                ip++;
+                break;
+            case Opcode::UpdateFlags:
+                // Jz tests the accumulator directly.
+                ip++;
+                break;
+            case Opcode::Report:
+                {
+                    uint64_t lanes[c_maxLaneCount];
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes),
+                                     accumulator);
+                    for (size_t lane = 0; lane < c_maxLaneCount; ++lane)
+                    {
+                        if ((inactive & (1u << lane)) == 0 && lanes[lane] != 0)
+                        {
+                            AddResult(lane,
+                                      lanes[lane],
+                                      offset + (lane << shift),
+                                      (iteration + lane) << m_initialRank);
+                        }
+                    }
+                    ip++;
+                }
+                break;
+            case Opcode::Call:
+                m_callStack.push_back(ip + 1);
+                ip = m_jumpTable[row];
+                break;
+            case Opcode::Jmp:
+                ip = m_jumpTable[row];
+                break;
+            case Opcode::Jz:
+                {
+                    const unsigned jumping = ZeroLanes(accumulator) | inactive;
+                    if (jumping == c_allLanes)
+                    {
+                        ip = m_jumpTable[row];
+                    }
+                    else
+                    {
+                        if (jumping != inactive)
+                        {
+                            m_divergences.push_back({ m_jumpTable[row], inactive });
+                            inactive = jumping;
+                        }
+                        ip++;
+                    }
+                }
+                break;
+            case Opcode::Return:
+                ip = m_callStack.back();
+                m_callStack.pop_back();
+                break;
+            default:
+                // Jnz and Constant are rejected by
+                // ByteCodeGenerator::SupportsLanes().
+                RecoverableError error("ByteCodeInterpreter:: bad opcode.");
+                throw error;
+            }  // switch
+        }  // while
+
+        bool terminate = false;
+        for (size_t lane = 0; lane < c_maxLaneCount && !terminate; ++lane)
+        {
+            terminate = FinishIteration(lane,
+                                        (iteration + lane) << m_initialRank,
+                                        sliceBuffer);
+        }
 
         return terminate;
     }
 
-    void ByteCodeInterpreter::AddResult(uint64_t accumulator,
+
+    void ByteCodeInterpreter::AddResult(size_t lane,
+                                        uint64_t accumulator,
                                         size_t offset,
                                         size_t base)
     {
@@ -336,11 +612,13 @@ Decide on type of Slices
         CHECK_LT(offset, 64u)
             << "Offset out of range.";
 
+        uint64_t * dedupe = m_dedupe[lane];
+
         // Set bit indicating that we're storing an accululator at offset.
-        m_dedupe[0] |= (1ull << offset);
+        dedupe[0] |= (1ull << offset);
 
         // Or in the accumulator.
-        m_dedupe[offset + 1] |= accumulator;
+        dedupe[offset + 1] |= accumulator;
     }
 
 
@@ -359,18 +637,20 @@ Decide on type of Slices
     }
 
 
-    bool ByteCodeInterpreter::FinishIteration(size_t base,
+    bool ByteCodeInterpreter::FinishIteration(size_t lane,
+                                              size_t base,
                                               void const * sliceBuffer)
     {
         //std::cout
         //    << "FinishIteration: " << base << std::endl;
 
-        uint64_t map = m_dedupe[0];
+        uint64_t * dedupe = m_dedupe[lane];
+        uint64_t map = dedupe[0];
         while (map != 0)
         {
             size_t offset = bsf(map);
 
-            uint64_t accumulator = m_dedupe[offset + 1];
+            uint64_t accumulator = dedupe[offset + 1];
 
             while (accumulator != 0)
             {
@@ -386,12 +666,12 @@ Decide on type of Slices
                 // Clear the lowest bit set in the accumulator.
                 accumulator &= (accumulator - 1);
             }
-            m_dedupe[offset + 1] = 0;
+            dedupe[offset + 1] = 0;
 
             // Clear the lowest bit set in the map.
             map &= (map - 1);
         }
-        m_dedupe[0] = 0;
+        dedupe[0] = 0;
 
         // TODO: don't always return false.
         return false;
@@ -404,7 +684,9 @@ Decide on type of Slices
     //
     //*************************************************************************
     ByteCodeGenerator::ByteCodeGenerator()
-        : m_sealed(false)
+        : m_sealed(false),
+          m_supportsLanes(false),
+          m_rowCount(0)
     {
     }
 
@@ -429,10 +711,40 @@ Decide on type of Slices
             m_jumpTable.push_back(&m_code[0] + offset);
         }
 
+        // RunLanes() can only defer the jumps of lanes whose accumulator is
+        // zero, which rules out Jnz. The row count sizes prefetching.
+        m_supportsLanes = true;
+        for (auto const & instruction : m_code)
+        {
+            const auto opcode = instruction.GetOpcode();
+            if (opcode == ByteCodeInterpreter::Opcode::AndRow ||
+                opcode == ByteCodeInterpreter::Opcode::LoadRow)
+            {
+                m_rowCount = (std::max)(m_rowCount,
+                                        static_cast<size_t>(instruction.GetRow()) + 1);
+            }
+            else if (opcode == ByteCodeInterpreter::Opcode::Jnz ||
+                opcode == ByteCodeInterpreter::Opcode::Constant)
+            {
+                m_supportsLanes = false;
+            }
+        }
+
         m_sealed = true;
     }
 
 
+    void ByteCodeGenerator::Reset()
+    {
+        m_sealed = false;
+        m_supportsLanes = false;
+        m_rowCount = 0;
+        m_code.clear();
+        m_jumpOffsets.clear();
+        m_jumpTable.clear();
+    }
+
+
     std::vector<ByteCodeInterpreter::Instruction> const &
         ByteCodeGenerator::GetCode() const
     {
@@ -449,6 +761,20 @@ Decide on type of Slices
     }
 
 
+    bool ByteCodeGenerator::SupportsLanes() const
+    {
+        EnsureSealed(true);
+        return m_supportsLanes;
+    }
+
+
+    size_t ByteCodeGenerator::GetRowCount() const
+    {
+        EnsureSealed(true);
+        return m_rowCount;
+    }
+
+
     void ByteCodeGenerator::AndRow(size_t row, bool inverted, size_t rankDelta)
     {
         EnsureSealed(false);
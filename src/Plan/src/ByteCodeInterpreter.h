@@ -29,6 +29,7 @@
 #include "BitFunnel/BitFunnelTypes.h"       // Rank parameter.
 #include "ICodeGenerator.h"                 // Base class.
 #include "LoggerInterfaces/Check.h"         // CHECK macro used in template code.
+#include "QueryDeadline.h"                  // QueryDeadline embedded.
 
 
 namespace BitFunnel
@@ -46,6 +47,24 @@ namespace BitFunnel
     // intended as a reference implementation for the native x64 code which is
     // generated by MatchTreeCodeGenerator.
     //
+    // When constructed with a laneCount of c_maxLaneCount, the interpreter
+    // executes consecutive iterations side by side in the lanes of an SSE
+    // register, amortizing instruction dispatch over c_maxLaneCount
+    // quadwords. A conditional jump is taken only when it is taken in every
+    // lane. Otherwise the lanes that would have jumped are masked off until
+    // execution reaches the jump target. Code containing Jnz or Constant and
+    // runs with a diagnostic stream or CacheLineRecorder always use a single
+    // lane.
+    //
+    // When prefetchDistance is non-zero, the interpreter issues a software
+    // prefetch for the first cache line of each plan row of slice
+    // i + prefetchDistance before matching slice i, so that the misses at
+    // the start of each slice overlap with useful work.
+    //
+    // Before each slice, the interpreter checks its QueryDeadline. Once the
+    // deadline has expired, Run() returns true, leaving the matches from
+    // the slices already processed in the ResultsBuffer.
+    //
     // Usage pattern:
     //   1. Construct a ByteCodeGenerator.
     //   2. Fill the ByteCodeGenerator with instructions via calls to its
@@ -59,10 +78,14 @@ namespace BitFunnel
     {
     public:
         class Instruction;
+        class Stacks;
 
         // Constructs a ByteCodeInterpreter for the sequence of instructions
         // in a specific ByteCodeGenerator. This interpreter will run against
-        // the rows passed as that second parameter.
+        // the rows passed as that second parameter. The virtual machine
+        // stacks live in the caller's Stacks so that their storage can be
+        // reused from one query to the next. If stacks is nullptr, the
+        // interpreter uses stacks of its own.
         ByteCodeInterpreter(ByteCodeGenerator const & code,
                             ResultsBuffer & resultsBuffer,
                             size_t sliceCount,
@@ -72,12 +95,19 @@ namespace BitFunnel
                             ptrdiff_t const * rowOffsets,
                             IDiagnosticStream * diagnosticStream,
                             QueryInstrumentation & instrumentation,
-                            CacheLineRecorder * cacheLineRecorder);
+                            CacheLineRecorder * cacheLineRecorder,
+                            size_t laneCount,
+                            size_t prefetchDistance,
+                            QueryDeadline const & deadline,
+                            Stacks * stacks);
+
+        // Maximum number of iterations executed side by side.
+        static const size_t c_maxLaneCount = 2;
 
         // Runs the instruction sequence for a specified number of iterations.
         // Each iteration processes a single quadword of row data at the
         // highest rank in the plan.  Returns true to indicate early
-        // termination.
+        // termination because the deadline expired.
         bool Run();
 
         // Virtual machine opcodes. With the exception of the End opcode,
@@ -174,24 +204,56 @@ namespace BitFunnel
             uint32_t m_inverted : 1;
         };
 
+        // Records a Jz that some, but not all, of the active lanes took.
+        // Lanes in m_inactive resume at m_target.
+        struct Divergence
+        {
+            Instruction const * m_target;
+            unsigned m_inactive;
+        };
+
+        // Storage for the virtual machine stacks. The stacks keep their
+        // capacity between interpreters, so a Stacks that is reused for
+        // every query stops allocating once it has seen the deepest plan.
+        // A Stacks may only be used by one interpreter at a time.
+        class Stacks
+        {
+        public:
+            std::vector<Instruction const *> m_callStack;
+            std::vector<uint64_t> m_valueStack;
+            std::vector<Divergence> m_divergences;
+        };
+
     private:
         //  Returns true to indicate early termination.
         bool ProcessOneSlice(size_t slice);
 
+        // Prefetches the first cache line of each plan row in the specified
+        // slice.
+        void PrefetchSlice(size_t slice);
+
         // Executes the instruction sequence for the specified iteration
         // number. Returns true to indicate early termination.
         bool RunOneIteration(void const * sliceBuffer, size_t iteration);
 
+        // Executes the instruction sequence for c_maxLaneCount consecutive
+        // iterations, starting at the specified iteration number. Returns
+        // true to indicate early termination.
+        bool RunLanes(void const * sliceBuffer, size_t iteration);
+
         // The 'base' parameter has the rank0 quadword position for the start
-        // of the current iteration. The accumulator corresponds to position
-        // 'base + offset'.
-        void AddResult(uint64_t accumulator,
+        // of the iteration running in 'lane'. The accumulator corresponds to
+        // position 'base + offset'.
+        void AddResult(size_t lane,
+                       uint64_t accumulator,
                        size_t offset,
                        size_t base);
 
         // The 'base' parameter has the rank0 quadword position for the start
-        // of this iteration.
-        bool FinishIteration(size_t base, void const * sliceBuffer);
+        // of the iteration running in 'lane'.
+        bool FinishIteration(size_t lane,
+                             size_t base,
+                             void const * sliceBuffer);
 
         //
         // Cached constructor parameters.
@@ -209,23 +271,38 @@ namespace BitFunnel
 
         ptrdiff_t const * m_rowOffsets;
 
+        // Either 1 or c_maxLaneCount.
+        size_t m_laneCount;
+
+        size_t m_prefetchDistance;
+        size_t m_rowCount;
+
+        QueryDeadline m_deadline;
 
         //
         // Virtual machine state.
         //
 
+        Stacks m_localStacks;
+        Stacks & m_stacks;
+
         // Control flow call stack. Holds return addresses for calls.
-        std::vector<Instruction const *> m_callStack;
+        std::vector<Instruction const *> & m_callStack;
 
-        // 64-bit value stack for Rank0 methods.
-        std::vector<uint64_t> m_valueStack;
+        // 64-bit value stack for Rank0 methods. RunLanes() pushes
+        // c_maxLaneCount values at a time.
+        std::vector<uint64_t> & m_valueStack;
+
+        // Records a Jz that some, but not all, of the active lanes took.
+        std::vector<Divergence> & m_divergences;
 
         // TODO: Formalize definition and usage of zero flag.
         bool m_zeroFlag;
 
-        // Dedupe buffer. First entry is bitmap indicating which of the
-        // remaining 64 entries correspond to accumulators with matches.
-        uint64_t m_dedupe[65];
+        // Dedupe buffer for each lane. First entry is bitmap indicating which
+        // of the remaining 64 entries correspond to accumulators with
+        // matches.
+        uint64_t m_dedupe[c_maxLaneCount][65];
 
         IDiagnosticStream* m_diagnosticStream;
         QueryInstrumentation& m_instrumentation;
@@ -294,6 +371,7 @@ namespace BitFunnel
     //   Invoke ICodeGenerator methods to create vector of instructions.
     //   Invoke Seal() method. From this point on, the class is read-only.
     //   Pass the ByteCodeGenerator to the ByteCodeInterpreter.
+    //   Optionally invoke Reset() and start over for the next query.
     //
     //*************************************************************************
     class ByteCodeGenerator : public ICodeGenerator
@@ -313,6 +391,12 @@ namespace BitFunnel
         // calls to ICodeGenerator methods will throw an exception.
         void Seal();
 
+        // Returns the class to the empty, unsealed state so that it can
+        // generate code for another query. The instruction and jump vectors
+        // keep their capacity, so a reused ByteCodeGenerator stops
+        // allocating once it has seen the longest plan.
+        void Reset();
+
         // Returns the vector of instructions create by calls to ICodeGenerator
         // methods. Class must be sealed before calling this method.
         std::vector<ByteCodeInterpreter::Instruction> const & GetCode() const;
@@ -324,6 +408,15 @@ namespace BitFunnel
         std::vector<ByteCodeInterpreter::Instruction const *> const &
             GetJumpTable() const;
 
+        // Returns true if the code can be executed by
+        // ByteCodeInterpreter::RunLanes(). Class must be sealed before
+        // calling this method.
+        bool SupportsLanes() const;
+
+        // Returns one more than the largest row index referenced by the
+        // code. Class must be sealed before calling this method.
+        size_t GetRowCount() const;
+
         //
         // ICodeGenerator methods
         //
@@ -364,6 +457,8 @@ namespace BitFunnel
         void EnsureSealed(bool sealed) const;
 
         bool m_sealed;
+        bool m_supportsLanes;
+        size_t m_rowCount;
         std::vector<ByteCodeInterpreter::Instruction> m_code;
         std::vector<size_t> m_jumpOffsets;
         std::vector<ByteCodeInterpreter::Instruction const *> m_jumpTable;
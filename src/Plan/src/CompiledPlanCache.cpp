@@ -0,0 +1,169 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include <sstream>
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/IObjectFormatter.h"
+#include "CompileNode.h"
+#include "CompiledPlanCache.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // CompiledPlanCache::Entry
+    //
+    //*************************************************************************
+    CompiledPlanCache::Entry::Entry(NativeJIT::Allocator & expressionTreeAllocator,
+                                    size_t codeBufferBytes,
+                                    CompileNode const & tree,
+                                    RegisterAllocator const & registers,
+                                    Rank initialRank)
+      : m_codeAllocator(codeBufferBytes),
+        m_code(m_codeAllocator, static_cast<unsigned>(codeBufferBytes)),
+        m_compiler(expressionTreeAllocator,
+                   m_code,
+                   tree,
+                   registers,
+                   initialRank,
+                   NativeCodeGenerator::c_maxLaneCount)
+    {
+    }
+
+
+    MatchTreeCompiler & CompiledPlanCache::Entry::GetCompiler()
+    {
+        return m_compiler;
+    }
+
+
+    //*************************************************************************
+    //
+    // CompiledPlanCache
+    //
+    //*************************************************************************
+    CompiledPlanCache::CompiledPlanCache(size_t capacity,
+                                         size_t codeBufferBytes)
+      : m_capacity(capacity),
+        m_codeBufferBytes(codeBufferBytes),
+        m_hitCount(0),
+        m_missCount(0)
+    {
+        if (m_capacity == 0)
+        {
+            RecoverableError error("CompiledPlanCache: capacity must be positive.");
+            throw error;
+        }
+    }
+
+
+    // static
+    std::string CompiledPlanCache::CreateKey(CompileNode const & tree,
+                                             Rank initialRank,
+                                             size_t rowCount)
+    {
+        std::stringstream key;
+        key << initialRank << ',' << rowCount << ':';
+
+        std::unique_ptr<IObjectFormatter>
+            formatter(Factories::CreateObjectFormatter(key));
+        tree.Format(*formatter);
+
+        return key.str();
+    }
+
+
+    std::shared_ptr<CompiledPlanCache::Entry>
+        CompiledPlanCache::Find(std::string const & key)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        auto it = m_keys.find(key);
+        if (it == m_keys.end())
+        {
+            ++m_missCount;
+            return nullptr;
+        }
+
+        ++m_hitCount;
+
+        // Move to front of most recently used list.
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return it->second->second;
+    }
+
+
+    std::shared_ptr<CompiledPlanCache::Entry>
+        CompiledPlanCache::Add(std::string const & key,
+                               std::shared_ptr<Entry> entry)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        auto it = m_keys.find(key);
+        if (it != m_keys.end())
+        {
+            // Another thread compiled the same plan first.
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            return it->second->second;
+        }
+
+        if (m_entries.size() == m_capacity)
+        {
+            // Evict least recently used entry. Threads still running the
+            // evicted matcher hold their own reference to it.
+            m_keys.erase(m_entries.back().first);
+            m_entries.pop_back();
+        }
+
+        m_entries.emplace_front(key, entry);
+        m_keys[key] = m_entries.begin();
+
+        return entry;
+    }
+
+
+    size_t CompiledPlanCache::GetCodeBufferBytes() const
+    {
+        return m_codeBufferBytes;
+    }
+
+
+    size_t CompiledPlanCache::GetEntryCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_entries.size();
+    }
+
+
+    size_t CompiledPlanCache::GetHitCount() const
+    {
+        return m_hitCount;
+    }
+
+
+    size_t CompiledPlanCache::GetMissCount() const
+    {
+        return m_missCount;
+    }
+}
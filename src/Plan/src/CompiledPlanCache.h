@@ -0,0 +1,132 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#pragma once
+
+#include <atomic>                               // std::atomic embedded.
+#include <list>                                 // std::list embedded.
+#include <memory>                               // std::shared_ptr return value.
+#include <mutex>                                // std::mutex embedded.
+#include <stddef.h>                             // size_t parameter.
+#include <string>                               // std::string parameter.
+#include <unordered_map>                        // std::unordered_map embedded.
+
+#include "BitFunnel/BitFunnelTypes.h"           // Rank parameter.
+#include "BitFunnel/NonCopyable.h"              // Base class.
+#include "MatchTreeCompiler.h"                  // MatchTreeCompiler embedded.
+#include "NativeJIT/CodeGen/ExecutionBuffer.h"  // ExecutionBuffer embedded.
+#include "NativeJIT/CodeGen/FunctionBuffer.h"   // FunctionBuffer embedded.
+
+
+namespace NativeJIT
+{
+    class Allocator;
+}
+
+
+namespace BitFunnel
+{
+    class CompileNode;
+    class RegisterAllocator;
+
+    //*************************************************************************
+    //
+    // CompiledPlanCache
+    //
+    // A thread-safe, fixed capacity, least-recently-used cache of matchers
+    // compiled by NativeJIT. Entries are keyed by the structure of the
+    // CompileNode tree, the initial rank, and the number of rows in the
+    // RowSet. The generated code only refers to rows by their position in
+    // the RowSet, so a cached matcher can be rerun with the row offsets of
+    // any query that yields the same key.
+    //
+    // Each entry owns the ExecutionBuffer and FunctionBuffer holding its
+    // code. Entries are handed out as std::shared_ptr so that an entry
+    // evicted by one thread remains valid for threads still running it.
+    //
+    //*************************************************************************
+    class CompiledPlanCache : public NonCopyable
+    {
+    public:
+        class Entry : public NonCopyable
+        {
+        public:
+            // Compiles the matcher for tree into a code buffer of
+            // codeBufferBytes owned by this Entry. The expression tree
+            // allocator is only used during construction.
+            Entry(NativeJIT::Allocator & expressionTreeAllocator,
+                  size_t codeBufferBytes,
+                  CompileNode const & tree,
+                  RegisterAllocator const & registers,
+                  Rank initialRank);
+
+            MatchTreeCompiler & GetCompiler();
+
+        private:
+            NativeJIT::ExecutionBuffer m_codeAllocator;
+            NativeJIT::FunctionBuffer m_code;
+            MatchTreeCompiler m_compiler;
+        };
+
+        CompiledPlanCache(size_t capacity = c_defaultCapacity,
+                          size_t codeBufferBytes = c_defaultCodeBufferBytes);
+
+        // Returns the key for a compiled plan. Two plans with the same key
+        // generate identical code.
+        static std::string CreateKey(CompileNode const & tree,
+                                     Rank initialRank,
+                                     size_t rowCount);
+
+        // Returns the entry associated with key, or nullptr if there is no
+        // such entry. Updates the hit and miss counters.
+        std::shared_ptr<Entry> Find(std::string const & key);
+
+        // Adds entry under key, evicting the least recently used entry if
+        // the cache is full. If another thread added an entry for key in the
+        // meantime, that entry is kept and returned instead.
+        std::shared_ptr<Entry> Add(std::string const & key,
+                                   std::shared_ptr<Entry> entry);
+
+        size_t GetCodeBufferBytes() const;
+        size_t GetEntryCount() const;
+        size_t GetHitCount() const;
+        size_t GetMissCount() const;
+
+        static const size_t c_defaultCapacity = 256;
+        static const size_t c_defaultCodeBufferBytes = 1ull << 17;
+
+    private:
+        typedef std::pair<std::string, std::shared_ptr<Entry>> KeyEntryPair;
+        typedef std::list<KeyEntryPair> EntryList;
+
+        const size_t m_capacity;
+        const size_t m_codeBufferBytes;
+
+        mutable std::mutex m_lock;
+
+        // Entries in most recently used order.
+        EntryList m_entries;
+        std::unordered_map<std::string, EntryList::iterator> m_keys;
+
+        std::atomic<size_t> m_hitCount;
+        std::atomic<size_t> m_missCount;
+    };
+}
@@ -0,0 +1,439 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "BitFunnel/Exceptions.h"
+#include "LaneCodeGenerator.h"
+#include "LoggerInterfaces/Logging.h"
+#include "NativeCodeGenerator.h"
+#include "RegisterAllocator.h"
+
+using namespace NativeJIT;
+
+
+namespace BitFunnel
+{
+    // XMM register assignments.
+    static const unsigned c_accumulator = 0;
+    static const unsigned c_scratch = 1;
+    static const unsigned c_mask = 3;
+    static const unsigned c_scratch2 = 4;
+
+    // Opcodes of the 66 0F xx instructions.
+    static const uint8_t c_punpcklqdq = 0x6c;
+    static const uint8_t c_movdqa = 0x6f;
+    static const uint8_t c_pcmpeqd = 0x76;
+    static const uint8_t c_pand = 0xdb;
+    static const uint8_t c_pandn = 0xdf;
+    static const uint8_t c_por = 0xeb;
+    static const uint8_t c_pxor = 0xef;
+
+    // Opcodes of the SSE4.1 66 0F 38 xx instructions.
+    static const uint8_t c_ptest = 0x17;
+    static const uint8_t c_pcmpeqq = 0x29;
+
+    // Prefixes and opcodes of the 0F xx loads.
+    static const uint8_t c_noPrefix = 0x00;
+    static const uint8_t c_movdquPrefix = 0xf3;
+    static const uint8_t c_movdqu = 0x6f;
+    static const uint8_t c_movqPrefix = 0xf3;
+    static const uint8_t c_movq = 0x7e;
+    static const uint8_t c_movhps = 0x16;
+
+
+    LaneCodeGenerator::LaneCodeGenerator(RegisterAllocator const & registers,
+                                         FunctionBuffer & code)
+      : MachineCodeGenerator(registers, code),
+        m_shift(0)
+    {
+    }
+
+
+    void LaneCodeGenerator::ActivateAllLanes()
+    {
+        EmitOp(c_pcmpeqd, c_mask, c_mask);
+    }
+
+
+    //
+    // ICodeGenerator methods
+    //
+
+    //
+    // RankDown compiler primitives
+    //
+    void LaneCodeGenerator::AndRow(size_t id, bool inverted, size_t rankDelta)
+    {
+        LoadLanes(c_scratch, id, rankDelta);
+
+        if (!inverted)
+        {
+            EmitOp(c_pand, c_accumulator, c_scratch);
+        }
+        else
+        {
+            EmitOp(c_pandn, c_scratch, c_accumulator);
+            EmitOp(c_movdqa, c_accumulator, c_scratch);
+        }
+    }
+
+
+    void LaneCodeGenerator::LoadRow(size_t id, bool inverted, size_t rankDelta)
+    {
+        LoadLanes(c_accumulator, id, rankDelta);
+
+        if (inverted)
+        {
+            Not();
+        }
+    }
+
+
+    void LaneCodeGenerator::LeftShiftOffset(size_t shift)
+    {
+        MachineCodeGenerator::LeftShiftOffset(shift);
+        m_shift += shift;
+    }
+
+
+    void LaneCodeGenerator::RightShiftOffset(size_t shift)
+    {
+        MachineCodeGenerator::RightShiftOffset(shift);
+        m_shift -= shift;
+    }
+
+
+    void LaneCodeGenerator::Push()
+    {
+        EmitPush(c_accumulator);
+        ++m_pushCount;
+    }
+
+
+    void LaneCodeGenerator::Pop()
+    {
+        EmitPop(c_accumulator);
+        --m_pushCount;
+    }
+
+
+    //
+    // Stack machine primitives
+    //
+    void LaneCodeGenerator::AndStack()
+    {
+        EmitPop(c_scratch);
+        EmitOp(c_pand, c_accumulator, c_scratch);
+        --m_pushCount;
+    }
+
+
+    void LaneCodeGenerator::Constant(int value)
+    {
+        m_code.EmitImmediate<OpCode::Mov>(rax, value);
+
+        // movq xmm0, rax
+        m_code.Emit8(0x66);
+        m_code.Emit8(0x48);
+        m_code.Emit8(0x0f);
+        m_code.Emit8(0x6e);
+        m_code.Emit8(static_cast<uint8_t>(0xc0 | (c_accumulator << 3)));
+
+        EmitOp(c_punpcklqdq, c_accumulator, c_accumulator);
+    }
+
+
+    void LaneCodeGenerator::Not()
+    {
+        EmitOp(c_pcmpeqd, c_scratch, c_scratch);
+        EmitOp(c_pxor, c_accumulator, c_scratch);
+    }
+
+
+    void LaneCodeGenerator::OrStack()
+    {
+        EmitPop(c_scratch);
+        EmitOp(c_por, c_accumulator, c_scratch);
+        --m_pushCount;
+    }
+
+
+    void LaneCodeGenerator::UpdateFlags()
+    {
+        // Jz() tests the accumulator itself.
+    }
+
+
+    void LaneCodeGenerator::Report()
+    {
+        // Only the active lanes report.
+        EmitOp(c_movdqa, c_scratch, c_accumulator);
+        EmitOp(c_pand, c_scratch, c_mask);
+
+        // Free up a register.
+        m_code.Emit<OpCode::Push>(rcx);
+
+        // Compute the quadword number of the first lane in rcx.
+        m_code.Emit<OpCode::Sub>(rcx, rdx);
+        m_code.EmitImmediate<OpCode::Shr>(rcx, static_cast<uint8_t>(3));
+        m_code.Emit<OpCode::Sub>(rcx, rdi, NativeCodeGenerator::m_base);
+
+        for (unsigned lane = 0; lane < 2; ++lane)
+        {
+            if (lane > 0)
+            {
+                m_code.EmitImmediate<OpCode::Add>(rcx, 1 << m_shift);
+            }
+
+            // Mark the quadword for this lane.
+            m_code.EmitImmediate<OpCode::Mov>(rax, 1);
+            m_code.Emit<OpCode::Shl>(rax);
+            m_code.Emit<OpCode::Or>(rdi, NativeCodeGenerator::m_dedupe, rax);
+
+            // Or the lane into that quadword.
+            EmitMoveLaneToRax(c_scratch, lane);
+            m_code.Emit<OpCode::Or>(rdi,
+                                    rcx,
+                                    SIB::Scale8, 8 + NativeCodeGenerator::m_dedupe,
+                                    rax);
+        }
+
+        // Restore registers.
+        m_code.Emit<OpCode::Pop>(rcx);
+    }
+
+
+    //
+    // Control flow primitives.
+    //
+    void LaneCodeGenerator::PlaceLabel(Label label)
+    {
+        MachineCodeGenerator::PlaceLabel(label);
+
+        if (m_jzTargets.find(label) != m_jzTargets.end())
+        {
+            // Clear the accumulator of the lanes that were masked off by
+            // the Jz and restore the mask it saved.
+            EmitOp(c_pand, c_accumulator, c_mask);
+            EmitPop(c_mask);
+        }
+    }
+
+
+    void LaneCodeGenerator::Jnz(Label /*label*/)
+    {
+        throw NotImplemented("Jnz is not supported in lane mode.");
+    }
+
+
+    void LaneCodeGenerator::Jz(Label label)
+    {
+        // Save the mask for the jump target. Both paths reach the target
+        // with the mask on the stack.
+        EmitPush(c_mask);
+
+        // ptest sets ZF when the accumulator is zero in every active lane.
+        EmitOp38(c_ptest, c_accumulator, c_mask);
+        MachineCodeGenerator::Jz(label);
+
+        // Mask off the lanes whose accumulator is zero.
+        EmitOp(c_pxor, c_scratch2, c_scratch2);
+        EmitOp38(c_pcmpeqq, c_scratch2, c_accumulator);
+        EmitOp(c_pandn, c_scratch2, c_mask);
+        EmitOp(c_movdqa, c_mask, c_scratch2);
+
+        m_jzTargets.insert(label);
+    }
+
+
+    void LaneCodeGenerator::LoadLanes(unsigned lanes,
+                                      size_t id,
+                                      size_t rankDelta)
+    {
+        if (rankDelta == 0)
+        {
+            // The lanes are 2^m_shift quadwords apart.
+            m_code.Emit<OpCode::Mov>(rax, rcx);
+            AddRowOffset(rax, id);
+
+            if (m_shift == 0)
+            {
+                EmitLoad(c_movdquPrefix, c_movdqu, lanes, rax, 0);
+            }
+            else
+            {
+                EmitLoad(c_movqPrefix, c_movq, lanes, rax, 0);
+                EmitLoad(c_noPrefix, c_movhps, lanes, rax, 8 << m_shift);
+            }
+        }
+        else if (rankDelta <= m_shift)
+        {
+            // The lanes are 2^(m_shift - rankDelta) quadwords apart at the
+            // rank of the row.
+            m_code.Emit<OpCode::Mov>(rax, rcx);
+            m_code.Emit<OpCode::Sub>(rax, rdx);
+            m_code.EmitImmediate<OpCode::Shr>(rax, static_cast<uint8_t>(rankDelta + 3));
+            m_code.EmitImmediate<OpCode::Shl>(rax, static_cast<uint8_t>(3));
+            m_code.Emit<OpCode::Add>(rax, rdx);
+            AddRowOffset(rax, id);
+
+            if (rankDelta == m_shift)
+            {
+                EmitLoad(c_movdquPrefix, c_movdqu, lanes, rax, 0);
+            }
+            else
+            {
+                EmitLoad(c_movqPrefix, c_movq, lanes, rax, 0);
+                EmitLoad(c_noPrefix,
+                         c_movhps,
+                         lanes,
+                         rax,
+                         8 << (m_shift - rankDelta));
+            }
+        }
+        else
+        {
+            // The lanes may share a quadword of the row, so compute the
+            // address of each lane.
+            m_code.Emit<OpCode::Mov>(rax, rcx);
+            m_code.Emit<OpCode::Sub>(rax, rdx);
+            m_code.Emit<OpCode::Mov>(rbx, rax);
+            m_code.EmitImmediate<OpCode::Add>(rbx, 8 << m_shift);
+
+            Register<8u, false> addresses[] = { rax, rbx };
+            for (auto address : addresses)
+            {
+                m_code.EmitImmediate<OpCode::Shr>(address, static_cast<uint8_t>(rankDelta + 3));
+                m_code.EmitImmediate<OpCode::Shl>(address, static_cast<uint8_t>(3));
+                m_code.Emit<OpCode::Add>(address, rdx);
+                AddRowOffset(address, id);
+            }
+
+            EmitLoad(c_movqPrefix, c_movq, lanes, rax, 0);
+            EmitLoad(c_noPrefix, c_movhps, lanes, rbx, 0);
+        }
+    }
+
+
+    void LaneCodeGenerator::AddRowOffset(Register<8u, false> base, size_t id)
+    {
+        const unsigned row = static_cast<unsigned>(id);
+        if (m_registers.IsRegister(row))
+        {
+            unsigned reg = m_registers.GetRegister(row);
+            m_code.Emit<OpCode::Add>(base, Register<8u, false>(reg));
+        }
+        else
+        {
+            m_code.Emit<OpCode::Add>(base, rsi, row * 8);
+        }
+    }
+
+
+    void LaneCodeGenerator::EmitOp(uint8_t opcode, unsigned dest, unsigned src)
+    {
+        m_code.Emit8(0x66);
+        m_code.Emit8(0x0f);
+        m_code.Emit8(opcode);
+        m_code.Emit8(static_cast<uint8_t>(0xc0 | (dest << 3) | src));
+    }
+
+
+    void LaneCodeGenerator::EmitOp38(uint8_t opcode, unsigned dest, unsigned src)
+    {
+        m_code.Emit8(0x66);
+        m_code.Emit8(0x0f);
+        m_code.Emit8(0x38);
+        m_code.Emit8(opcode);
+        m_code.Emit8(static_cast<uint8_t>(0xc0 | (dest << 3) | src));
+    }
+
+
+    void LaneCodeGenerator::EmitLoad(uint8_t prefix,
+                                     uint8_t opcode,
+                                     unsigned dest,
+                                     Register<8u, false> base,
+                                     int32_t displacement)
+    {
+        LogAssertB(base.IsSameHardwareRegister(rax) ||
+                   base.IsSameHardwareRegister(rbx),
+                   "Unsupported base register.");
+
+        if (prefix != c_noPrefix)
+        {
+            m_code.Emit8(prefix);
+        }
+        m_code.Emit8(0x0f);
+        m_code.Emit8(opcode);
+
+        // [base + disp32]
+        m_code.Emit8(static_cast<uint8_t>(0x80 | (dest << 3) | base.GetId()));
+        m_code.Emit32(static_cast<uint32_t>(displacement));
+    }
+
+
+    void LaneCodeGenerator::EmitPush(unsigned src)
+    {
+        m_code.EmitImmediate<OpCode::Sub>(rsp, 16);
+
+        // movdqu [rsp], xmm
+        m_code.Emit8(0xf3);
+        m_code.Emit8(0x0f);
+        m_code.Emit8(0x7f);
+        m_code.Emit8(static_cast<uint8_t>(0x04 | (src << 3)));
+        m_code.Emit8(0x24);
+    }
+
+
+    void LaneCodeGenerator::EmitPop(unsigned dest)
+    {
+        // movdqu xmm, [rsp]
+        m_code.Emit8(0xf3);
+        m_code.Emit8(0x0f);
+        m_code.Emit8(0x6f);
+        m_code.Emit8(static_cast<uint8_t>(0x04 | (dest << 3)));
+        m_code.Emit8(0x24);
+
+        m_code.EmitImmediate<OpCode::Add>(rsp, 16);
+    }
+
+
+    void LaneCodeGenerator::EmitMoveLaneToRax(unsigned src, unsigned lane)
+    {
+        m_code.Emit8(0x66);
+        m_code.Emit8(0x48);
+        m_code.Emit8(0x0f);
+        if (lane == 0)
+        {
+            // movq rax, xmm
+            m_code.Emit8(0x7e);
+            m_code.Emit8(static_cast<uint8_t>(0xc0 | (src << 3)));
+        }
+        else
+        {
+            // pextrq rax, xmm, lane
+            m_code.Emit8(0x3a);
+            m_code.Emit8(0x16);
+            m_code.Emit8(static_cast<uint8_t>(0xc0 | (src << 3)));
+            m_code.Emit8(static_cast<uint8_t>(lane));
+        }
+    }
+}
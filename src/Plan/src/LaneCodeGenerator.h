@@ -0,0 +1,126 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stdint.h>                     // uint8_t parameter.
+#include <unordered_set>                // std::unordered_set member.
+
+#include "MachineCodeGenerator.h"       // Base class.
+#include "NativeJIT/CodeGen/Register.h"  // Register parameter.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // LaneCodeGenerator is a MachineCodeGenerator that matches two
+    // consecutive iterations side by side, one in each 64-bit lane of an SSE
+    // register, as ByteCodeInterpreter::RunLanes() does.
+    //
+    // Register usage differs from MachineCodeGenerator as follows:
+    //   xmm0: accumulator
+    //   xmm1, xmm4: scratch
+    //   xmm3: mask with all ones in the lanes that are active
+    //   rbx: scratch
+    // rcx tracks the offset of the first lane. After a net left shift of
+    // shift, the offset of the second lane is 2^shift quadwords further.
+    //
+    // A Jz is taken only when the accumulator is zero in every active lane.
+    // Otherwise the lanes that would have jumped are masked off until the
+    // jump target, where their accumulator is cleared and the previous mask
+    // is restored from the stack. CompileNode trees never contain Jnz, which
+    // is not supported.
+    //
+    // NativeJIT has no SSE integer instructions, so their encodings are
+    // emitted directly. The generated code requires SSE4.1. See
+    // NativeCodeGenerator::SupportsLanes().
+    //
+    //*************************************************************************
+    class LaneCodeGenerator : public MachineCodeGenerator
+    {
+    public:
+        LaneCodeGenerator(RegisterAllocator const & registers,
+                          FunctionBuffer & code);
+
+        // Emits code that marks both lanes active. Must run before the code
+        // for each pair of iterations.
+        void ActivateAllLanes();
+
+        //
+        // ICodeGenerator methods
+        //
+
+        // RankDown compiler primitives
+        void AndRow(size_t id, bool inverted, size_t rankDelta);
+        void LoadRow(size_t id, bool inverted, size_t rankDelta);
+
+        void LeftShiftOffset(size_t shift);
+        void RightShiftOffset(size_t shift);
+
+        void Push();
+        void Pop();
+
+        // Stack machine primitives
+        void AndStack();
+        void Constant(int value);
+        void Not();
+        void OrStack();
+        void UpdateFlags();
+
+        void Report();
+
+        // Control flow primitives.
+        void PlaceLabel(Label label);
+        void Jnz(Label label);
+        void Jz(Label label);
+
+    private:
+        // Loads the quadwords of row id for both lanes into xmm register
+        // lanes.
+        void LoadLanes(unsigned lanes, size_t id, size_t rankDelta);
+
+        // Adds the offset of row id to the pointer in base.
+        void AddRowOffset(Register<8u, false> base, size_t id);
+
+        // Helpers that emit the encodings of SSE instructions. Memory
+        // operands are addressed as [base + displacement], where base is
+        // rax or rbx.
+        void EmitOp(uint8_t opcode, unsigned dest, unsigned src);
+        void EmitOp38(uint8_t opcode, unsigned dest, unsigned src);
+        void EmitLoad(uint8_t prefix,
+                      uint8_t opcode,
+                      unsigned dest,
+                      Register<8u, false> base,
+                      int32_t displacement);
+        void EmitPush(unsigned src);
+        void EmitPop(unsigned dest);
+        void EmitMoveLaneToRax(unsigned src, unsigned lane);
+
+        // Net left shift of the offset in rcx at the current point in the
+        // code.
+        size_t m_shift;
+
+        // Labels that are targets of Jz.
+        std::unordered_set<Label> m_jzTargets;
+    };
+}
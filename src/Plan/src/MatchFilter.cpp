@@ -0,0 +1,290 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <limits>
+#include <nmmintrin.h>  // For _mm_cmpgt_epi64, _mm_popcnt_u32.
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Index/DocumentHandle.h"
+#include "BitFunnel/Index/ForwardIndex.h"
+#include "BitFunnel/Index/IConfiguration.h"
+#include "LoggerInterfaces/Logging.h"
+#include "MatchFilter.h"
+#include "ResultsBuffer.h"
+#include "StringVector.h"
+
+
+namespace BitFunnel
+{
+    MatchFilter::MatchFilter(ForwardIndex const & forwardIndex,
+                             IConfiguration const & configuration)
+      : m_forwardIndex(forwardIndex),
+        m_configuration(configuration),
+        m_isVerifiable(false)
+    {
+    }
+
+
+    void MatchFilter::SetQuery(TermMatchNode const & tree)
+    {
+        m_code.clear();
+        m_probes.clear();
+        m_isVerifiable = true;
+
+        Compile(tree);
+
+        std::sort(m_probes.begin(), m_probes.end());
+        m_probes.erase(std::unique(m_probes.begin(), m_probes.end()),
+                       m_probes.end());
+        for (auto & instruction : m_code)
+        {
+            if (instruction.m_opcode == Opcode::Term)
+            {
+                instruction.m_probe = static_cast<size_t>(
+                    std::lower_bound(m_probes.begin(),
+                                     m_probes.end(),
+                                     instruction.m_hash) - m_probes.begin());
+            }
+        }
+
+        // Size the per document buffers once per query.
+        m_found.resize(m_probes.size());
+        m_stack.reserve(m_code.size());
+    }
+
+
+    bool MatchFilter::Verify(DocumentHandle document)
+    {
+        if (!m_isVerifiable || !m_forwardIndex.Read(document, m_hashes))
+        {
+            return true;
+        }
+
+        Intersect(m_hashes.data(),
+                  m_hashes.size(),
+                  m_probes.data(),
+                  m_probes.size(),
+                  m_found.data());
+
+        m_stack.clear();
+        for (auto const & instruction : m_code)
+        {
+            switch (instruction.m_opcode)
+            {
+            case Opcode::Term:
+                m_stack.push_back(m_found[instruction.m_probe]);
+                break;
+            case Opcode::And:
+                {
+                    const char right = m_stack.back();
+                    m_stack.pop_back();
+                    m_stack.back() &= right;
+                }
+                break;
+            case Opcode::Or:
+                {
+                    const char right = m_stack.back();
+                    m_stack.pop_back();
+                    m_stack.back() |= right;
+                }
+                break;
+            case Opcode::Not:
+                m_stack.back() ^= 1;
+                break;
+            }
+        }
+
+        return m_stack.back() != 0;
+    }
+
+
+    size_t MatchFilter::Filter(ResultsBuffer & results)
+    {
+        if (!m_isVerifiable)
+        {
+            return 0;
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < results.m_size; ++i)
+        {
+            ResultsBuffer::Result const result = results.m_buffer[i];
+            if (Verify(result.GetHandle()))
+            {
+                results.m_buffer[kept++] = result;
+            }
+        }
+
+        const size_t removed = results.m_size - kept;
+        results.m_size = kept;
+        return removed;
+    }
+
+
+    void MatchFilter::Intersect(Term::Hash const * hashes,
+                                size_t hashCount,
+                                Term::Hash const * probes,
+                                size_t probeCount,
+                                char * found)
+    {
+        // _mm_cmpgt_epi64() compares signed quadwords. Flipping the sign bits
+        // of both operands turns it into an unsigned comparison.
+        const __m128i signBits =
+            _mm_set1_epi64x((std::numeric_limits<int64_t>::min)());
+
+        size_t position = 0;
+        for (size_t i = 0; i < probeCount; ++i)
+        {
+            const Term::Hash probe = probes[i];
+            const __m128i key =
+                _mm_xor_si128(_mm_set1_epi64x(static_cast<int64_t>(probe)),
+                              signBits);
+
+            // Compare the probe with four hashes at a time. Because the
+            // hashes are sorted, the ones smaller than the probe form a
+            // prefix of the block, and the number of comparison bits set is
+            // its length.
+            while (position + 4 <= hashCount)
+            {
+                __m128i const * block =
+                    reinterpret_cast<__m128i const *>(hashes + position);
+                const __m128i low =
+                    _mm_xor_si128(_mm_loadu_si128(block), signBits);
+                const __m128i high =
+                    _mm_xor_si128(_mm_loadu_si128(block + 1), signBits);
+                const int less =
+                    _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(key, low))) |
+                    (_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(key, high))) << 2);
+
+                position += static_cast<size_t>(
+                    _mm_popcnt_u32(static_cast<unsigned>(less)));
+                if (less != 0xf)
+                {
+                    break;
+                }
+            }
+
+            while (position < hashCount && hashes[position] < probe)
+            {
+                ++position;
+            }
+
+            found[i] = (position < hashCount && hashes[position] == probe) ? 1 : 0;
+        }
+    }
+
+
+    void MatchFilter::Compile(TermMatchNode const & node)
+    {
+        switch (node.GetType())
+        {
+        case TermMatchNode::AndMatch:
+            {
+                auto const & andNode =
+                    dynamic_cast<TermMatchNode::And const &>(node);
+                Compile(andNode.GetLeft());
+                Compile(andNode.GetRight());
+                Emit(Opcode::And);
+            }
+            break;
+        case TermMatchNode::NotMatch:
+            Compile(dynamic_cast<TermMatchNode::Not const &>(node).GetChild());
+            Emit(Opcode::Not);
+            break;
+        case TermMatchNode::OrMatch:
+            {
+                auto const & orNode =
+                    dynamic_cast<TermMatchNode::Or const &>(node);
+                Compile(orNode.GetLeft());
+                Compile(orNode.GetRight());
+                Emit(Opcode::Or);
+            }
+            break;
+        case TermMatchNode::PhraseMatch:
+            Compile(dynamic_cast<TermMatchNode::Phrase const &>(node));
+            break;
+        case TermMatchNode::UnigramMatch:
+            {
+                auto const & unigram =
+                    dynamic_cast<TermMatchNode::Unigram const &>(node);
+                Term term(unigram.GetText(),
+                          unigram.GetStreamId(),
+                          m_configuration);
+                Emit(Opcode::Term, term.GetRawHash());
+            }
+            break;
+        case TermMatchNode::FactMatch:
+            // Facts are not in the ForwardIndex. Compile a placeholder term
+            // to keep the program well formed.
+            m_isVerifiable = false;
+            Emit(Opcode::Term);
+            break;
+        default:
+            RecoverableError error("MatchFilter::Compile: Invalid node type.");
+            throw error;
+        }
+    }
+
+
+    void MatchFilter::Compile(TermMatchNode::Phrase const & node)
+    {
+        StringVector const & grams = node.GetGrams();
+        LogAssertB(grams.GetSize() > 0, "Phrase must have at least one gram.");
+
+        // Ingestion posts each run of up to GetMaxGramSize() consecutive
+        // terms as an n-gram, so a document containing the phrase contains
+        // every such n-gram of the phrase.
+        const size_t maxGramSize = m_configuration.GetMaxGramSize();
+        for (unsigned start = 0; start < grams.GetSize(); ++start)
+        {
+            Term term(grams[start], node.GetStreamId(), m_configuration);
+            Emit(Opcode::Term, term.GetRawHash());
+            if (start > 0)
+            {
+                Emit(Opcode::And);
+            }
+
+            for (unsigned n = 1;
+                 n < maxGramSize && start + n < grams.GetSize();
+                 ++n)
+            {
+                term.AddTerm(Term(grams[start + n],
+                                  node.GetStreamId(),
+                                  m_configuration),
+                             m_configuration);
+                Emit(Opcode::Term, term.GetRawHash());
+                Emit(Opcode::And);
+            }
+        }
+    }
+
+
+    void MatchFilter::Emit(Opcode opcode, Term::Hash hash)
+    {
+        m_code.push_back(Instruction { opcode, hash, 0 });
+        if (opcode == Opcode::Term)
+        {
+            m_probes.push_back(hash);
+        }
+    }
+}
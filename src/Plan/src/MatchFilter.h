@@ -0,0 +1,128 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                         // size_t parameter.
+#include <stdint.h>                         // uint8_t base type.
+#include <vector>                           // std::vector member.
+
+#include "BitFunnel/NonCopyable.h"          // Base class.
+#include "BitFunnel/Plan/TermMatchNode.h"   // Nested classes appear as parameters.
+#include "BitFunnel/Term.h"                 // Term::Hash parameter.
+
+
+namespace BitFunnel
+{
+    class DocumentHandle;
+    class ForwardIndex;
+    class IConfiguration;
+    class ResultsBuffer;
+
+    //*************************************************************************
+    //
+    // MatchFilter
+    //
+    // Removes the false positives reported by the bit sliced signatures by
+    // verifying each match against the document's term hashes in the
+    // ForwardIndex.
+    //
+    // SetQuery() compiles the query's TermMatchNode tree into a postfix
+    // program over the distinct hashes of its terms. A phrase becomes the
+    // conjunction of the n-grams that ingestion posts for it. To verify a
+    // document, the filter decodes the document's hashes, intersects them
+    // with the query's sorted hashes, and runs the program on the result.
+    //
+    // Facts are not recorded in the ForwardIndex, so queries with facts are
+    // not verified. Neither are documents without a ForwardIndex entry.
+    //
+    // Not thread safe. Intended to be owned by a single query thread and
+    // reused across queries so that its buffers keep their capacity.
+    //
+    //*************************************************************************
+    class MatchFilter : public NonCopyable
+    {
+    public:
+        MatchFilter(ForwardIndex const & forwardIndex,
+                    IConfiguration const & configuration);
+
+        // Prepares to verify matches of tree.
+        void SetQuery(TermMatchNode const & tree);
+
+        // Returns true if the document satisfies the query.
+        bool Verify(DocumentHandle document);
+
+        // Removes the matches in results that do not satisfy the query,
+        // preserving the order of the others. Returns the number of matches
+        // removed.
+        size_t Filter(ResultsBuffer & results);
+
+        // For each of the probeCount sorted probes, sets found[i] to 1 if the
+        // hashCount sorted hashes contain probes[i] and to 0 otherwise.
+        static void Intersect(Term::Hash const * hashes,
+                              size_t hashCount,
+                              Term::Hash const * probes,
+                              size_t probeCount,
+                              char * found);
+
+    private:
+        void Compile(TermMatchNode const & node);
+        void Compile(TermMatchNode::Phrase const & node);
+
+        enum class Opcode : uint8_t
+        {
+            Term,
+            And,
+            Or,
+            Not
+        };
+
+        class Instruction
+        {
+        public:
+            Opcode m_opcode;
+
+            // For Term instructions, the term's hash and its index in
+            // m_probes.
+            Term::Hash m_hash;
+            size_t m_probe;
+        };
+
+        void Emit(Opcode opcode, Term::Hash hash = 0);
+
+        ForwardIndex const & m_forwardIndex;
+        IConfiguration const & m_configuration;
+
+        // False when the query cannot be verified.
+        bool m_isVerifiable;
+
+        std::vector<Instruction> m_code;
+
+        // Distinct hashes of the query's terms in ascending order.
+        std::vector<Term::Hash> m_probes;
+
+        // Per document buffers.
+        std::vector<Term::Hash> m_hashes;
+        std::vector<char> m_found;
+        std::vector<char> m_stack;
+    };
+}
@@ -0,0 +1,248 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Utilities/Numa.h"
+#include "MatchThreadPool.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // MatchThreadPool::ThreadState
+    //
+    //*************************************************************************
+    MatchThreadPool::ThreadState::ThreadState(size_t threadId)
+      : m_threadId(threadId),
+        m_results(new ResultsBuffer(0))
+    {
+    }
+
+
+    //*************************************************************************
+    //
+    // MatchThreadPool
+    //
+    //*************************************************************************
+    MatchThreadPool::MatchThreadPool(std::vector<unsigned> const & numaNodes,
+                                     size_t threadCount)
+      : m_nodes(numaNodes),
+        m_work(nullptr),
+        m_generation(0),
+        m_busyThreadCount(0),
+        m_shutdown(false)
+    {
+        if (m_nodes.empty())
+        {
+            m_nodes.push_back(c_anyNumaNode);
+        }
+
+        for (auto node : m_nodes)
+        {
+            m_groups.push_back(Group());
+            m_groups.back().m_node = node;
+            m_groups.back().m_nextTask = 0;
+        }
+
+        threadCount = (std::max)(threadCount, m_groups.size());
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            m_threadGroups.push_back(i % m_groups.size());
+            m_states.emplace_back(new ThreadState(i));
+        }
+
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            m_threads.emplace_back(&MatchThreadPool::ThreadEntry, this, i);
+        }
+    }
+
+
+    MatchThreadPool::~MatchThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_shutdown = true;
+        }
+        m_start.notify_all();
+
+        for (auto & thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+
+    size_t MatchThreadPool::GetThreadCount() const
+    {
+        return m_threads.size();
+    }
+
+
+    std::vector<unsigned> const & MatchThreadPool::GetNumaNodes() const
+    {
+        return m_nodes;
+    }
+
+
+    std::mutex & MatchThreadPool::GetQueryLock()
+    {
+        return m_queryLock;
+    }
+
+
+    std::vector<ResultsBuffer::Result> const &
+        MatchThreadPool::GetMatches(size_t threadId) const
+    {
+        return m_states[threadId]->m_matches;
+    }
+
+
+    void MatchThreadPool::Run(IWork & work,
+                              unsigned const * taskNodes,
+                              size_t taskCount,
+                              size_t taskCapacity)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            for (auto & group : m_groups)
+            {
+                group.m_taskIds.clear();
+                group.m_nextTask = 0;
+            }
+
+            for (size_t taskId = 0; taskId < taskCount; ++taskId)
+            {
+                const auto node = std::find(m_nodes.begin(),
+                                            m_nodes.end(),
+                                            taskNodes[taskId]);
+                if (node == m_nodes.end())
+                {
+                    RecoverableError error("MatchThreadPool::Run: task for unknown NUMA node.");
+                    throw error;
+                }
+                m_groups[static_cast<size_t>(node - m_nodes.begin())].m_taskIds.push_back(taskId);
+            }
+
+            for (auto & state : m_states)
+            {
+                if (state->m_results->m_capacity < taskCapacity)
+                {
+                    state->m_results.reset(new ResultsBuffer(taskCapacity));
+                }
+                state->m_matches.clear();
+            }
+
+            m_work = &work;
+            m_error = nullptr;
+            m_busyThreadCount = m_threads.size();
+            ++m_generation;
+        }
+        m_start.notify_all();
+
+        std::exception_ptr error;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_finish.wait(lock, [this] { return m_busyThreadCount == 0; });
+            m_work = nullptr;
+            error = m_error;
+            m_error = nullptr;
+        }
+
+        if (error != nullptr)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+
+    void MatchThreadPool::ThreadEntry(size_t threadId)
+    {
+        Group & group = m_groups[m_threadGroups[threadId]];
+        ThreadState & state = *m_states[threadId];
+
+        if (group.m_node != c_anyNumaNode)
+        {
+            BindCurrentThreadToNumaNode(group.m_node);
+        }
+
+        size_t generation = 0;
+        for (;;)
+        {
+            IWork * work = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_start.wait(lock, [this, generation] {
+                    return m_shutdown || m_generation != generation;
+                });
+                if (m_shutdown)
+                {
+                    return;
+                }
+                generation = m_generation;
+                work = m_work;
+            }
+
+            for (;;)
+            {
+                size_t taskId;
+                {
+                    std::lock_guard<std::mutex> lock(m_lock);
+
+                    // After a failure, the remaining tasks are abandoned.
+                    if (m_error != nullptr ||
+                        group.m_nextTask == group.m_taskIds.size())
+                    {
+                        break;
+                    }
+                    taskId = group.m_taskIds[group.m_nextTask++];
+                }
+
+                state.m_results->Reset();
+                try
+                {
+                    work->ProcessTask(taskId, state);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(m_lock);
+                    if (m_error == nullptr)
+                    {
+                        m_error = std::current_exception();
+                    }
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                if (--m_busyThreadCount == 0)
+                {
+                    m_finish.notify_one();
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,158 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <condition_variable>                   // std::condition_variable embedded.
+#include <exception>                            // std::exception_ptr embedded.
+#include <memory>                               // std::unique_ptr embedded.
+#include <mutex>                                // std::mutex embedded.
+#include <stddef.h>                             // size_t parameter.
+#include <thread>                               // std::thread embedded.
+#include <vector>                               // std::vector embedded.
+
+#include "BitFunnel/NonCopyable.h"              // Base class.
+#include "ByteCodeInterpreter.h"                // ByteCodeInterpreter::Stacks embedded.
+#include "ResultsBuffer.h"                      // ResultsBuffer::Result embedded.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // MatchThreadPool
+    //
+    // Long-lived worker threads that match the slice ranges of a query in
+    // parallel. The threads are started once, when the pool is created, and
+    // wait between queries, so a query only pays for handing out its tasks.
+    //
+    // The threads are divided evenly among the NUMA nodes passed to the
+    // constructor, with at least one thread per node. Each thread is bound
+    // to its node when it starts, and only runs tasks whose data lives on
+    // that node. A node of c_anyNumaNode groups threads that are not bound.
+    //
+    // Each thread owns a ThreadState that is reused from one query to the
+    // next, so that a warmed-up pool matches without allocating.
+    //
+    // If a task throws, the remaining tasks are abandoned and Run() rethrows
+    // the first exception once every thread has stopped.
+    //
+    // Several query threads may share a pool, so that the process runs one
+    // set of match threads rather than one per query thread. A query holds
+    // GetQueryLock() from Run() until it has read its matches with
+    // GetMatches(), so queries take turns using the pool.
+    //
+    //*************************************************************************
+    class MatchThreadPool : public NonCopyable
+    {
+    public:
+        // The per-thread storage handed to each task.
+        class ThreadState : public NonCopyable
+        {
+        public:
+            ThreadState(size_t threadId);
+
+            size_t m_threadId;
+
+            // Scratch buffer for the matches of a single task. Run() sizes
+            // it, and empties it before each task.
+            std::unique_ptr<ResultsBuffer> m_results;
+
+            // The matches a task wants to keep after it returns. Emptied at
+            // the start of each Run(), but keeps its capacity.
+            std::vector<ResultsBuffer::Result> m_matches;
+
+            ByteCodeInterpreter::Stacks m_stacks;
+        };
+
+        // The work of a single query, divided into numbered tasks.
+        class IWork
+        {
+        public:
+            virtual ~IWork() {}
+
+            // Runs task taskId on the pool thread that owns state.
+            virtual void ProcessTask(size_t taskId, ThreadState & state) = 0;
+        };
+
+        MatchThreadPool(std::vector<unsigned> const & numaNodes,
+                        size_t threadCount);
+
+        ~MatchThreadPool();
+
+        size_t GetThreadCount() const;
+
+        std::vector<unsigned> const & GetNumaNodes() const;
+
+        // Serializes the queries that share the pool.
+        std::mutex & GetQueryLock();
+
+        // Returns the matches kept by the tasks that ran on thread threadId.
+        // Valid until the next call to Run().
+        std::vector<ResultsBuffer::Result> const &
+            GetMatches(size_t threadId) const;
+
+        // Runs tasks 0 through taskCount - 1 on the pool threads and waits
+        // for them to finish. Task i runs on a thread of node taskNodes[i],
+        // which must be one of the pool's nodes. Each thread's scratch
+        // ResultsBuffer is grown if necessary so that it can hold
+        // taskCapacity matches, the most that any single task produces.
+        void Run(IWork & work,
+                 unsigned const * taskNodes,
+                 size_t taskCount,
+                 size_t taskCapacity);
+
+    private:
+        void ThreadEntry(size_t threadId);
+
+        // Threads bound to a single NUMA node, and the tasks for that node
+        // in the current run.
+        class Group
+        {
+        public:
+            unsigned m_node;
+            std::vector<size_t> m_taskIds;
+            size_t m_nextTask;
+        };
+
+        std::vector<unsigned> m_nodes;
+        std::vector<Group> m_groups;
+        std::vector<size_t> m_threadGroups;
+        std::vector<std::unique_ptr<ThreadState>> m_states;
+
+        std::mutex m_queryLock;
+
+        // Guards the members below and the task assignment of each group.
+        std::mutex m_lock;
+        std::condition_variable m_start;
+        std::condition_variable m_finish;
+        IWork * m_work;
+        size_t m_generation;
+        size_t m_busyThreadCount;
+        bool m_shutdown;
+
+        // The first exception thrown by a task in the current run.
+        std::exception_ptr m_error;
+
+        std::vector<std::thread> m_threads;
+    };
+}
@@ -21,8 +21,10 @@
 // THE SOFTWARE.
 
 
+#include "BitFunnel/Plan/QueryInstrumentation.h"
 #include "BitFunnel/Utilities/Allocator.h"
 #include "MatchTreeCompiler.h"
+#include "QueryDeadline.h"
 #include "QueryResources.h"
 
 using namespace NativeJIT;
@@ -38,10 +40,27 @@ namespace BitFunnel
     MatchTreeCompiler::MatchTreeCompiler(QueryResources & resources,
                                          CompileNode const & tree,
                                          RegisterAllocator const & registers,
-                                         Rank initialRank)
+                                         Rank initialRank,
+                                         size_t laneCount)
+      : MatchTreeCompiler(resources.GetExpressionTreeAllocator(),
+                          resources.GetCode(),
+                          tree,
+                          registers,
+                          initialRank,
+                          laneCount)
     {
-        NativeCodeGenerator::Prototype expression(resources.GetExpressionTreeAllocator(),
-                                                  resources.GetCode());
+    }
+
+
+    MatchTreeCompiler::MatchTreeCompiler(NativeJIT::Allocator & expressionTreeAllocator,
+                                         NativeJIT::FunctionBuffer & code,
+                                         CompileNode const & tree,
+                                         RegisterAllocator const & registers,
+                                         Rank initialRank,
+                                         size_t laneCount)
+    {
+        NativeCodeGenerator::Prototype expression(expressionTreeAllocator,
+                                                  code);
         // TODO: Remove temporary debugging output.
         //expression.EnableDiagnostics(std::cout);
 
@@ -49,32 +68,41 @@ namespace BitFunnel
             expression.PlacementConstruct<NativeCodeGenerator>(expression,
                                                                tree,
                                                                registers,
-                                                               initialRank);
+                                                               initialRank,
+                                                               laneCount);
         m_function = expression.Compile(node);
     }
 
 
-    size_t MatchTreeCompiler::Run(size_t sliceCount,
-                                  void * const * sliceBuffers,
-                                  size_t iterationsPerSlice,
-                                  ptrdiff_t const * rowOffsets,
-                                  ResultsBuffer & results)
+    bool MatchTreeCompiler::Run(size_t sliceCount,
+                                void * const * sliceBuffers,
+                                size_t iterationsPerSlice,
+                                ptrdiff_t const * rowOffsets,
+                                size_t rowCount,
+                                size_t prefetchDistance,
+                                QueryDeadline const & deadline,
+                                ResultsBuffer & results,
+                                QueryInstrumentation & instrumentation) const
     {
         NativeCodeGenerator::Parameters parameters = {
             sliceCount,
             sliceBuffers,
             iterationsPerSlice,
             rowOffsets,
+            prefetchDistance,
+            rowCount,
+            deadline.GetTickLimit(),
             0,
             { 0 },
             results.m_capacity,
             results.m_size,
             results.m_buffer,
+            0,
             0
         };
 
-        // For now ignore return value.
-        m_function(&parameters);
+        // The generated code returns the number of slices it did not reach.
+        const size_t unmatchedSliceCount = m_function(&parameters);
 
         // TODO: Remove temporary debugging output.
         //std::cout
@@ -96,6 +124,9 @@ namespace BitFunnel
 
         results.m_size = parameters.m_matchCount;
 
-        return parameters.m_quadwordCount;
+        instrumentation.IncrementQuadwordCount(parameters.m_quadwordCount);
+        instrumentation.IncrementPrefetchCount(parameters.m_prefetchCount);
+
+        return unmatchedSliceCount != 0;
     }
 }
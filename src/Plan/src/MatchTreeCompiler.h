@@ -39,6 +39,8 @@ namespace NativeJIT
 namespace BitFunnel
 {
     class CompileNode;
+    class QueryDeadline;
+    class QueryInstrumentation;
     class QueryResources;
     class RegisterAllocator;
     class ResultsBuffer;
@@ -51,16 +53,40 @@ namespace BitFunnel
     class MatchTreeCompiler
     {
     public:
+        // See NativeCodeGenerator for the meaning of laneCount.
         MatchTreeCompiler(QueryResources & resources,
                           CompileNode const & tree,
                           RegisterAllocator const & registers,
-                          Rank initialRank);
+                          Rank initialRank,
+                          size_t laneCount);
 
-        size_t Run(size_t slicecount,
-                   void * const * slicebuffers,
-                   size_t iterationsperslice,
-                   ptrdiff_t const * rowoffsets,
-                   ResultsBuffer & results);
+        // Compiles into a caller supplied FunctionBuffer. Used by the
+        // CompiledPlanCache, whose entries own their code buffers and must
+        // outlive the per-query QueryResources.
+        MatchTreeCompiler(NativeJIT::Allocator & expressionTreeAllocator,
+                          NativeJIT::FunctionBuffer & code,
+                          CompileNode const & tree,
+                          RegisterAllocator const & registers,
+                          Rank initialRank,
+                          size_t laneCount);
+
+        // Matches the slices, appending to results. While matching each
+        // slice, prefetches the first cache line of each of the rowCount
+        // rows of the slice prefetchDistance slices ahead. Quadword and
+        // prefetch counts are recorded in instrumentation.
+        //
+        // Checks the deadline before each slice. Returns true if the
+        // deadline expired before all of the slices were matched, in which
+        // case results holds the matches from the slices processed.
+        bool Run(size_t sliceCount,
+                 void * const * sliceBuffers,
+                 size_t iterationsPerSlice,
+                 ptrdiff_t const * rowOffsets,
+                 size_t rowCount,
+                 size_t prefetchDistance,
+                 QueryDeadline const & deadline,
+                 ResultsBuffer & results,
+                 QueryInstrumentation & instrumentation) const;
 
     private:
         NativeCodeGenerator::Prototype::FunctionType m_function;
@@ -37,9 +37,10 @@ namespace BitFunnel
     RowMatchNode const & MatchTreeRewriter::Rewrite(RowMatchNode const & root,
                                                     unsigned targetRowCount,
                                                     unsigned targetCrossProductTermCount,
-                                                    IAllocator& allocator)
+                                                    IAllocator& allocator,
+                                                    double const * densities)
     {
-        Partition partition(allocator);
+        Partition partition(allocator, densities);
 
         unsigned currentCrossProductTermCount = 0;
         return BuildCompileTree(partition,
@@ -119,8 +120,10 @@ namespace BitFunnel
 #pragma warning(push)
 #pragma warning(disable:4351)
 #endif
-    MatchTreeRewriter::Partition::Partition(IAllocator& allocator)
+    MatchTreeRewriter::Partition::Partition(IAllocator& allocator,
+                                            double const * densities)
         : m_allocator(allocator),
+          m_densities(densities),
           m_rowCount(0),
           m_parentRank(c_maxRankValue),
           m_minRank(c_maxRankValue),
@@ -141,6 +144,7 @@ namespace BitFunnel
     MatchTreeRewriter::Partition::Partition(Partition const & parent,
                                             RowMatchNode const & node)
         : m_allocator(parent.m_allocator),
+          m_densities(parent.m_densities),
           m_rowCount(parent.m_rowCount),
           m_parentRank(parent.m_minRank),
           m_minRank(parent.m_minRank),
@@ -290,7 +294,9 @@ namespace BitFunnel
             {
                 ++m_rowCount;
 
-                AbstractRow row = dynamic_cast<RowMatchNode::Row const &>(node).GetRow();
+                RowMatchNode::Row const & rowNode =
+                    dynamic_cast<RowMatchNode::Row const &>(node);
+                AbstractRow row = rowNode.GetRow();
                 Rank rank = row.GetRank();
 
                 if (rank > 0 && rank < m_minRank)
@@ -303,11 +309,11 @@ namespace BitFunnel
                     RowMatchNode::Row* rankUpRow =
                         new (m_allocator.Allocate(sizeof(RowMatchNode::Row)))
                             RowMatchNode::Row(AbstractRow(row, rank - m_parentRank));
-                    AddNode(m_rows[rank], rankUpRow);
+                    AddRow(m_rows[rank], *rankUpRow);
                 }
                 else
                 {
-                    AddNode(m_rows[rank], &node);
+                    AddRow(m_rows[rank], rowNode);
                 }
             }
             break;
@@ -334,6 +340,63 @@ namespace BitFunnel
     }
 
 
+    void MatchTreeRewriter::Partition::AddRow(RowMatchNode const * & tree,
+                                              RowMatchNode::Row const & row) const
+    {
+        if (m_densities == nullptr || tree == nullptr)
+        {
+            AddNode(tree, &row);
+        }
+        else
+        {
+            tree = &InsertRow(*tree, row);
+        }
+    }
+
+
+    RowMatchNode const &
+        MatchTreeRewriter::Partition::InsertRow(RowMatchNode const & tree,
+                                                RowMatchNode::Row const & row) const
+    {
+        // The tree is either a single row or an and-node whose left child is
+        // a row and whose right child is the rest of the and-expression.
+        RowMatchNode::Row const * first = nullptr;
+        RowMatchNode const * rest = nullptr;
+        if (tree.GetType() == RowMatchNode::AndMatch)
+        {
+            RowMatchNode::And const & andNode = dynamic_cast<RowMatchNode::And const &>(tree);
+            first = &dynamic_cast<RowMatchNode::Row const &>(andNode.GetLeft());
+            rest = &andNode.GetRight();
+        }
+        else
+        {
+            first = &dynamic_cast<RowMatchNode::Row const &>(tree);
+        }
+
+        if (GetDensity(row) <= GetDensity(*first))
+        {
+            // Like AddNode(), place a new row ahead of rows that are no
+            // sparser.
+            return CreateAndNode(row, tree);
+        }
+        else if (rest == nullptr)
+        {
+            return CreateAndNode(tree, row);
+        }
+        else
+        {
+            return CreateAndNode(*first, InsertRow(*rest, row));
+        }
+    }
+
+
+    double MatchTreeRewriter::Partition::GetDensity(RowMatchNode::Row const & row) const
+    {
+        const double density = m_densities[row.GetRow().GetId()];
+        return row.GetRow().IsInverted() ? 1.0 - density : density;
+    }
+
+
     void MatchTreeRewriter::Partition::CreateReportNode(RowMatchNode const * & reportNode,
                                                         RowMatchNode const * node) const
     {
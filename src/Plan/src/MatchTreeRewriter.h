@@ -78,10 +78,20 @@ namespace BitFunnel
         // with a target of 3, the expression (a + b)(c + d)(e + f) would be
         // expanded to four terms, (ac + ad + bc + bd)(e + f), an amount
         // that is one greater than the target.
+        //
+        // densities:
+        // Optional estimates of the bit densities of the rows, indexed by
+        // AbstractRow id. When supplied, the rows of each rank are ordered
+        // from sparsest to densest, so that the RankDownCompiler intersects
+        // the sparsest rows first and its jumps on zero skip the remaining
+        // rows as early as possible. An inverted row's density is one minus
+        // the density of its row. Rows with equal densities, and all rows
+        // when densities is nullptr, keep the order of the rank-only rewrite.
         static RowMatchNode const & Rewrite(RowMatchNode const & root,
                                             unsigned targetRowCount,
                                             unsigned targetCrossProductTermCount,
-                                            IAllocator& allocator);
+                                            IAllocator& allocator,
+                                            double const * densities = nullptr);
 
     private:
         // Partition is a helper class that divides the and-expression at the
@@ -90,7 +100,7 @@ namespace BitFunnel
         class Partition : NonCopyable
         {
         public:
-            Partition(IAllocator& allocator);
+            Partition(IAllocator& allocator, double const * densities);
             Partition(Partition const & parent,
                       RowMatchNode const & node);
 
@@ -115,6 +125,20 @@ namespace BitFunnel
             void AddNode(RowMatchNode const * & tree,
                          RowMatchNode const * node) const;
 
+            // Adds row to an and-expression of rows. Without densities, this
+            // is the same as AddNode(). With densities, row is placed before
+            // the first row that is denser.
+            void AddRow(RowMatchNode const * & tree,
+                        RowMatchNode::Row const & row) const;
+
+            // Returns a copy of the and-expression of rows, tree, with row
+            // inserted in density order. Nodes in the copy that precede row
+            // are allocated from m_allocator and the rest are shared.
+            RowMatchNode const & InsertRow(RowMatchNode const & tree,
+                                           RowMatchNode::Row const & row) const;
+
+            double GetDensity(RowMatchNode::Row const & row) const;
+
             void CreateReportNode(RowMatchNode const * & reportNode, RowMatchNode const * node) const;
 
             // Given an existing RowMatchTree rooted at RowMatchNode node, create a
@@ -131,6 +155,10 @@ namespace BitFunnel
 
             IAllocator& m_allocator;
 
+            // Row densities indexed by AbstractRow id, or nullptr to order
+            // rows by rank alone.
+            double const * m_densities;
+
             // Maintains the total number of rows on the path from the match
             // tree root through all parent partitions and all rows in the tio
             // level and-expression of this partition. Used to determine when
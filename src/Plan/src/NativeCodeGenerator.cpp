@@ -22,8 +22,15 @@
 
 #include <iostream>
 
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+#include <intrin.h>     // For __cpuid.
+#else
+#include <cpuid.h>      // For __get_cpuid.
+#endif
+
 #include "BitFunnel/Index/DocumentHandle.h"
 #include "CompileNode.h"
+#include "LaneCodeGenerator.h"
 #include "MachineCodeGenerator.h"
 #include "NativeJIT/CodeGen/ExecutionBuffer.h"
 #include "NativeJIT/CodeGen/FunctionBuffer.h"
@@ -44,12 +51,39 @@ namespace BitFunnel
         Prototype& expression,
         CompileNode const & compileNodeTree,
         RegisterAllocator const & registers,
-        Rank initialRank)
+        Rank initialRank,
+        size_t laneCount)
       : Node(expression),
         m_compileNodeTree(compileNodeTree),
         m_registers(registers),
-        m_initialRank(initialRank)
+        m_initialRank(initialRank),
+        m_laneCount(1)
+    {
+        if (laneCount >= c_maxLaneCount &&
+            initialRank < c_maxRankValue &&
+            SupportsLanes())
+        {
+            m_laneCount = c_maxLaneCount;
+        }
+    }
+
+
+    bool NativeCodeGenerator::SupportsLanes()
     {
+        // SSE4.1 is reported in bit 19 of ecx by cpuid function 1.
+        const unsigned c_sse41 = 1u << 19;
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        int info[4];
+        __cpuid(info, 1);
+        const unsigned ecx = static_cast<unsigned>(info[2]);
+#else
+        unsigned eax, ebx, ecx, edx;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0)
+        {
+            return false;
+        }
+#endif
+        return (ecx & c_sse41) != 0;
     }
 
 
@@ -78,13 +112,11 @@ namespace BitFunnel
         EmitRegisterInitialization(tree);
         EmitOuterLoop(tree);
 
+        // Return the number of slices left unmatched, which is non-zero when
+        // the deadline expired.
         auto result = Storage<size_t>::ForFreeRegister(tree, rax);
         auto & code = tree.GetCodeGenerator();
-#ifdef QUADWORDCOUNT
-        code.Emit<OpCode::Mov>(rax, rdi, NativeCodeGenerator::m_quadwordCount);
-#else
-        code.Emit<OpCode::Xor>(rax, rax);
-#endif
+        code.Emit<OpCode::Mov>(rax, rdi, NativeCodeGenerator::m_sliceCount);
         return result;
     }
 
@@ -151,6 +183,8 @@ namespace BitFunnel
         code.Emit<OpCode::Or>(rax, rax);
         code.EmitConditionalJump<JccType::JZ>(bottomOfLoop);
 
+        EmitDeadlineCheck(tree, bottomOfLoop);
+        EmitPrefetch(tree);
         EmitInnerLoop(tree);
 
         // Decrement the slice count by 1.
@@ -169,6 +203,80 @@ namespace BitFunnel
     }
 
 
+    void NativeCodeGenerator::EmitDeadlineCheck(ExpressionTree& tree,
+                                                Label expired)
+    {
+        auto & code = tree.GetCodeGenerator();
+
+        auto notExpired = code.AllocateLabel();
+
+        code.Emit<OpCode::Mov>(rax, rdi, m_tickLimit);
+        code.Emit<OpCode::Or>(rax, rax);
+        code.EmitConditionalJump<JccType::JZ>(notExpired);
+
+        // NativeJIT has no rdtsc opcode, so emit its encoding directly. The
+        // time stamp counter is returned in edx:eax. rdx is reinitialized
+        // by EmitInnerLoop().
+        code.Emit8(0x0f);
+        code.Emit8(0x31);
+        code.EmitImmediate<OpCode::Shl>(rdx, static_cast<uint8_t>(32));
+        code.Emit<OpCode::Or>(rax, rdx);
+        code.Emit<OpCode::Cmp>(rax, rdi, m_tickLimit);
+        code.EmitConditionalJump<JccType::JAE>(expired);
+
+        code.PlaceLabel(notExpired);
+    }
+
+
+    void NativeCodeGenerator::EmitPrefetch(ExpressionTree& tree)
+    {
+        auto & code = tree.GetCodeGenerator();
+
+        auto topOfLoop = code.AllocateLabel();
+        auto exitLoop = code.AllocateLabel();
+
+        // Skip when prefetching is disabled or when fewer than
+        // m_prefetchDistance slices remain after the current one. The slice
+        // count in Parameters counts the slices remaining, starting with
+        // the current one.
+        code.Emit<OpCode::Mov>(rax, rdi, m_prefetchDistance);
+        code.Emit<OpCode::Or>(rax, rax);
+        code.EmitConditionalJump<JccType::JZ>(exitLoop);
+        code.Emit<OpCode::Cmp>(rax, rdi, m_sliceCount);
+        code.EmitConditionalJump<JccType::JAE>(exitLoop);
+
+        // rdx: the slice buffer m_prefetchDistance slices ahead.
+        // rcx: loop counter counts down the rows.
+        // Both are reinitialized by EmitInnerLoop().
+        code.Emit<OpCode::Mov>(rdx, rdi, m_sliceBuffers);
+        code.Emit<OpCode::Mov>(rdx, rdx, rax, SIB::Scale8, 0);
+        code.Emit<OpCode::Mov>(rcx, rdi, m_prefetchRowCount);
+
+        code.Emit<OpCode::Mov>(rax, rcx);
+        code.Emit<OpCode::Add>(rdi, m_prefetchCount, rax);
+
+        //
+        // Top of loop
+        //
+        code.PlaceLabel(topOfLoop);
+        code.Emit<OpCode::Or>(rcx, rcx);
+        code.EmitConditionalJump<JccType::JZ>(exitLoop);
+        code.Emit<OpCode::Dec>(rcx);
+        code.Emit<OpCode::Mov>(rax, rsi, rcx, SIB::Scale8, 0);
+
+        // NativeJIT has no prefetch opcode, so emit the encoding of
+        // prefetcht0 [rdx + rax] directly.
+        code.Emit8(0x0f);
+        code.Emit8(0x18);
+        code.Emit8(0x0c);
+        code.Emit8(0x02);
+
+        code.Jmp(topOfLoop);
+
+        code.PlaceLabel(exitLoop);
+    }
+
+
     void NativeCodeGenerator::EmitInnerLoop(ExpressionTree& tree)
     {
         auto & code = tree.GetCodeGenerator();
@@ -188,6 +296,11 @@ namespace BitFunnel
         CodeGenHelpers::Emit<OpCode::Mov>(code, m_innerLoopLimit, rax);
         code.Emit<OpCode::Mov>(rcx, rdx);
 
+        if (m_laneCount == c_maxLaneCount)
+        {
+            EmitLaneLoop(tree);
+        }
+
 
         //
         // Top of loop
@@ -204,15 +317,7 @@ namespace BitFunnel
 
         // TODO: Handle case where there are no rows.
 
-        // Store this iteration's base offset in m_base.
-        code.Emit<OpCode::Push>(rcx);
-        code.Emit<OpCode::Mov>(rax, rcx);
-        code.Emit<OpCode::Sub>(rax, rdx);
-        code.EmitImmediate<OpCode::Shr>(rax, static_cast<uint8_t>(3));
-        code.EmitImmediate<OpCode::Mov>(cl, static_cast<uint8_t>(m_initialRank));
-        code.Emit<OpCode::Shl>(rax);
-        code.Emit<OpCode::Mov>(rdi, m_base, rax);
-        code.Emit<OpCode::Pop>(rcx);
+        EmitStoreBase(tree);
 
         {
             MachineCodeGenerator generator(m_registers, tree.GetCodeGenerator());
@@ -233,6 +338,70 @@ namespace BitFunnel
     }
 
 
+    void NativeCodeGenerator::EmitLaneLoop(ExpressionTree& tree)
+    {
+        auto & code = tree.GetCodeGenerator();
+
+        auto topOfLoop = code.AllocateLabel();
+        auto exitLoop = code.AllocateLabel();
+
+        const int32_t c_bytesPerPass = static_cast<int32_t>(8 * c_maxLaneCount);
+
+        //
+        // Top of loop
+        //
+        code.PlaceLabel(topOfLoop);
+
+        // Exit when fewer than c_maxLaneCount iterations remain. The scalar
+        // loop in EmitInnerLoop() matches the rest.
+        code.Emit<OpCode::Mov>(rax, rcx);
+        code.EmitImmediate<OpCode::Add>(rax, c_bytesPerPass);
+        CodeGenHelpers::Emit<OpCode::Cmp>(code, rax, m_innerLoopLimit);
+        code.EmitConditionalJump<JccType::JA>(exitLoop);
+
+        //
+        // Body of loop
+        //
+
+        // The base offset of the first lane's iteration. The dedupe buffer
+        // covers the quadwords of both iterations.
+        EmitStoreBase(tree);
+
+        {
+            LaneCodeGenerator generator(m_registers, tree.GetCodeGenerator());
+            generator.ActivateAllLanes();
+            m_compileNodeTree.Compile(generator);
+        }
+
+        EmitFinishIteration(tree);
+
+        //
+        // Bottom of loop
+        //
+        code.EmitImmediate<OpCode::Add>(rcx, c_bytesPerPass);
+        code.Jmp(topOfLoop);
+
+
+        code.PlaceLabel(exitLoop);
+    }
+
+
+    void NativeCodeGenerator::EmitStoreBase(ExpressionTree& tree)
+    {
+        auto & code = tree.GetCodeGenerator();
+
+        // Store this iteration's base offset in m_base.
+        code.Emit<OpCode::Push>(rcx);
+        code.Emit<OpCode::Mov>(rax, rcx);
+        code.Emit<OpCode::Sub>(rax, rdx);
+        code.EmitImmediate<OpCode::Shr>(rax, static_cast<uint8_t>(3));
+        code.EmitImmediate<OpCode::Mov>(cl, static_cast<uint8_t>(m_initialRank));
+        code.Emit<OpCode::Shl>(rax);
+        code.Emit<OpCode::Mov>(rdi, m_base, rax);
+        code.Emit<OpCode::Pop>(rcx);
+    }
+
+
     // WARNING: The design of the dedupe buffer in EmitFinishIteration()
     // only supports ranks up to 6. The reason is that a single quadword
     // is used as a bitmap to 64 quadwords. In the worst case, with a
@@ -23,6 +23,7 @@
 #pragma once
 
 #include <stddef.h>     // size_t, ptrdiff_t parameters.
+#include <stdint.h>     // uint64_t embedded.
 
 #include "BitFunnel/BitFunnelTypes.h"           // Rank parameter.
 #include "NativeJIT/CodeGen/FunctionBuffer.h"   // FunctionBuffer embedded.
@@ -76,6 +77,18 @@ static_cast<int32_t>(reinterpret_cast<uint64_t>(&((static_cast<object*>(nullptr)
             size_t m_iterationsPerSlice;
             ptrdiff_t const * m_rowOffsets;
 
+            // Prefetching of upcoming slices. While matching a slice, the
+            // code prefetches the first cache line of each of the
+            // m_prefetchRowCount rows of the slice m_prefetchDistance
+            // slices ahead. A distance of zero disables prefetching.
+            size_t m_prefetchDistance;
+            size_t m_prefetchRowCount;
+
+            // Time stamp counter value at which to stop matching, checked
+            // before each slice. Zero disables the check. See
+            // QueryDeadline.
+            uint64_t m_tickLimit;
+
             // Dedupe buffer
             size_t m_base;
             size_t m_dedupe[65];
@@ -86,6 +99,7 @@ static_cast<int32_t>(reinterpret_cast<uint64_t>(&((static_cast<object*>(nullptr)
             ResultsBuffer::Result* m_matches;
 
             size_t m_quadwordCount;
+            size_t m_prefetchCount;
         };
         static_assert(std::is_standard_layout<Parameters>::value,
                       "Generated code requires that Parameters be standard layout.");
@@ -93,10 +107,24 @@ static_cast<int32_t>(reinterpret_cast<uint64_t>(&((static_cast<object*>(nullptr)
         typedef Function<size_t, Parameters const *> Prototype;
         Prototype::FunctionType m_function;
 
+        // When laneCount is c_maxLaneCount, the generated code matches
+        // pairs of consecutive iterations side by side in SSE lanes, as
+        // LaneCodeGenerator describes, and matches any remaining iteration
+        // on its own. Lanes are used only when SupportsLanes() returns true
+        // and initialRank is below c_maxRankValue, so that a pair of
+        // iterations fits in the dedupe buffer.
         NativeCodeGenerator(Prototype& expression,
                             CompileNode const & compileNodeTree,
                             RegisterAllocator const & registers,
-                            Rank initialRank);
+                            Rank initialRank,
+                            size_t laneCount);
+
+        // Maximum number of iterations matched side by side.
+        static const size_t c_maxLaneCount = 2;
+
+        // Returns true if the processor supports the SSE4.1 instructions
+        // used in lane mode.
+        static bool SupportsLanes();
 
         virtual ExpressionTree::Storage<size_t>
             CodeGenValue(ExpressionTree& tree) override;
@@ -107,18 +135,26 @@ static_cast<int32_t>(reinterpret_cast<uint64_t>(&((static_cast<object*>(nullptr)
         static const int32_t m_sliceBuffers = OFFSET_OF(Parameters, m_sliceBuffers);
         static const int32_t m_iterationsPerSlice = OFFSET_OF(Parameters, m_iterationsPerSlice);
         static const int32_t m_rowOffsets = OFFSET_OF(Parameters, m_rowOffsets);
+        static const int32_t m_prefetchDistance = OFFSET_OF(Parameters, m_prefetchDistance);
+        static const int32_t m_prefetchRowCount = OFFSET_OF(Parameters, m_prefetchRowCount);
+        static const int32_t m_tickLimit = OFFSET_OF(Parameters, m_tickLimit);
         static const int32_t m_base = OFFSET_OF(Parameters, m_base);
         static const int32_t m_dedupe = OFFSET_OF(Parameters, m_dedupe);
         static const int32_t m_capacity = OFFSET_OF(Parameters, m_capacity);
         static const int32_t m_matchCount = OFFSET_OF(Parameters, m_matchCount);
         static const int32_t m_matches = OFFSET_OF(Parameters, m_matches);
         static const int32_t m_quadwordCount = OFFSET_OF(Parameters, m_quadwordCount);
+        static const int32_t m_prefetchCount = OFFSET_OF(Parameters, m_prefetchCount);
 
 
     private:
         void EmitRegisterInitialization(ExpressionTree& tree);
         void EmitOuterLoop(ExpressionTree& tree);
+        void EmitDeadlineCheck(ExpressionTree& tree, Label expired);
+        void EmitPrefetch(ExpressionTree& tree);
         void EmitInnerLoop(ExpressionTree& tree);
+        void EmitLaneLoop(ExpressionTree& tree);
+        void EmitStoreBase(ExpressionTree& tree);
         void EmitFinishIteration(ExpressionTree& tree);
         void EmitStoreMatch(ExpressionTree & tree);
 
@@ -126,6 +162,9 @@ static_cast<int32_t>(reinterpret_cast<uint64_t>(&((static_cast<object*>(nullptr)
         RegisterAllocator const & m_registers;
         const Rank m_initialRank;
 
+        // Either 1 or c_maxLaneCount.
+        size_t m_laneCount;
+
         Register<8u, false> m_param1;
         Register<8u, false> m_return;
 
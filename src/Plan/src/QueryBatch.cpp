@@ -0,0 +1,266 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <limits>
+#include <smmintrin.h>  // For _mm_prefetch.
+
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/IShard.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Index/Token.h"
+#include "BitFunnel/Plan/QueryInstrumentation.h"
+#include "IPlanRows.h"
+#include "MatchFilter.h"
+#include "QueryBatch.h"
+#include "ResultsBuffer.h"
+#include "RowSet.h"
+#include "SlicePruner.h"
+#include "TopKResults.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // QueryBatch
+    //
+    //*************************************************************************
+    QueryBatch::QueryBatch(ISimpleIndex const & index, size_t prefetchDistance)
+      : m_index(index),
+        m_prefetchDistance(prefetchDistance)
+    {
+    }
+
+
+    void QueryBatch::Add(ByteCodeGenerator const & code,
+                         RowSet const & rowSet,
+                         Rank initialRank,
+                         QueryDeadline const & deadline,
+                         size_t quadwordBudget,
+                         SlicePruner const * pruner,
+                         ResultsBuffer & results,
+                         TopKResults * topK,
+                         MatchFilter * filter,
+                         QueryInstrumentation & instrumentation)
+    {
+        Plan plan;
+        plan.m_code = &code;
+        plan.m_rowSet = &rowSet;
+        plan.m_initialRank = initialRank;
+        plan.m_deadline = deadline;
+        plan.m_remainingQuadwords = (quadwordBudget == 0) ?
+            (std::numeric_limits<size_t>::max)() :
+            quadwordBudget;
+        plan.m_pruner = pruner;
+        plan.m_results = &results;
+        plan.m_topK = topK;
+        plan.m_filter = filter;
+        plan.m_falsePositiveCount = 0;
+        plan.m_instrumentation = &instrumentation;
+        plan.m_isActive = true;
+        plan.m_timedOut = false;
+
+        m_plans.push_back(plan);
+    }
+
+
+    void QueryBatch::Run()
+    {
+        for (auto & plan : m_plans)
+        {
+            plan.m_results->Reset();
+            if (plan.m_topK != nullptr)
+            {
+                plan.m_topK->Reset();
+            }
+        }
+
+        // Get token before we GetSliceBuffers.
+        {
+            auto token = m_index.GetIngestor().GetTokenManager().RequestToken();
+
+            bool isActive = !m_plans.empty();
+            for (ShardId shardId = 0;
+                 shardId < m_index.GetIngestor().GetShardCount() && isActive;
+                 ++shardId)
+            {
+                auto & shard = m_index.GetIngestor().GetShard(shardId);
+                auto & sliceBuffers = shard.GetSliceBuffers();
+                const size_t sliceCapacity = shard.GetSliceCapacity();
+
+                LoadRowUnion(shardId);
+
+                for (size_t slice = 0; slice < sliceBuffers.size() && isActive; ++slice)
+                {
+                    if (m_prefetchDistance > 0 &&
+                        m_prefetchDistance < sliceBuffers.size() - slice)
+                    {
+                        char const * buffer = static_cast<char const *>(
+                            sliceBuffers[slice + m_prefetchDistance]);
+                        for (auto offset : m_rowOffsets)
+                        {
+                            _mm_prefetch(buffer + offset, _MM_HINT_T0);
+                        }
+                    }
+
+                    isActive = false;
+                    for (auto & plan : m_plans)
+                    {
+                        if (plan.m_isActive)
+                        {
+                            plan.m_isActive = RunSlice(plan,
+                                                       shardId,
+                                                       sliceBuffers.data() + slice,
+                                                       sliceCapacity);
+                            isActive = isActive || plan.m_isActive;
+                        }
+                    }
+                }
+            }
+
+            // In top-k mode, each slice's matches were filtered before
+            // scoring.
+            for (auto & plan : m_plans)
+            {
+                if (plan.m_topK == nullptr)
+                {
+                    FilterMatches(plan);
+                }
+            }
+        } // End of token lifetime.
+
+        for (auto & plan : m_plans)
+        {
+            QueryInstrumentation & instrumentation = *plan.m_instrumentation;
+            instrumentation.IncrementFalsePositiveCount(plan.m_falsePositiveCount);
+            instrumentation.FinishMatching();
+            if (plan.m_timedOut)
+            {
+                instrumentation.SetTimedOut();
+            }
+            instrumentation.SetMatchCount((plan.m_topK == nullptr) ?
+                                          plan.m_results->size() :
+                                          plan.m_topK->GetMatchCount());
+            instrumentation.SetRetainedCount((plan.m_topK == nullptr) ?
+                                             plan.m_results->size() :
+                                             plan.m_topK->size());
+        }
+    }
+
+
+    void QueryBatch::Reset()
+    {
+        m_plans.clear();
+    }
+
+
+    size_t QueryBatch::GetPlanCount() const
+    {
+        return m_plans.size();
+    }
+
+
+    bool QueryBatch::RunSlice(Plan & plan,
+                              ShardId shard,
+                              void * const * sliceBuffer,
+                              size_t sliceCapacity)
+    {
+        if (plan.m_pruner != nullptr &&
+            !plan.m_pruner->CanMatch(shard, *sliceBuffer))
+        {
+            return true;
+        }
+
+        // As in QueryPlanner, a slice may start as long as the quadword
+        // budget is not yet exhausted.
+        if (plan.m_remainingQuadwords == 0)
+        {
+            plan.m_timedOut = true;
+            return false;
+        }
+
+        const size_t iterationsPerSlice = sliceCapacity >> 6 >> plan.m_initialRank;
+        plan.m_remainingQuadwords -=
+            (std::min)(plan.m_remainingQuadwords, iterationsPerSlice);
+
+        // The batch does the prefetching, so the interpreter does not.
+        ByteCodeInterpreter interpreter(*plan.m_code,
+                                        *plan.m_results,
+                                        1,
+                                        sliceBuffer,
+                                        iterationsPerSlice,
+                                        plan.m_initialRank,
+                                        plan.m_rowSet->GetRowOffsets(shard),
+                                        nullptr,
+                                        *plan.m_instrumentation,
+                                        nullptr,
+                                        ByteCodeInterpreter::c_maxLaneCount,
+                                        0,
+                                        plan.m_deadline,
+                                        &m_stacks);
+        if (interpreter.Run())
+        {
+            plan.m_timedOut = true;
+            return false;
+        }
+
+        if (plan.m_topK != nullptr)
+        {
+            FilterMatches(plan);
+            const bool terminate = plan.m_topK->Add(*plan.m_results);
+            plan.m_results->Reset();
+            return !terminate;
+        }
+
+        return true;
+    }
+
+
+    void QueryBatch::FilterMatches(Plan & plan)
+    {
+        if (plan.m_filter != nullptr)
+        {
+            plan.m_falsePositiveCount += plan.m_filter->Filter(*plan.m_results);
+        }
+    }
+
+
+    void QueryBatch::LoadRowUnion(ShardId shard)
+    {
+        m_rowOffsets.clear();
+        for (auto const & plan : m_plans)
+        {
+            if (plan.m_isActive)
+            {
+                ptrdiff_t const * rows = plan.m_rowSet->GetRowOffsets(shard);
+                m_rowOffsets.insert(m_rowOffsets.end(),
+                                    rows,
+                                    rows + plan.m_rowSet->GetRowCount());
+            }
+        }
+
+        std::sort(m_rowOffsets.begin(), m_rowOffsets.end());
+        m_rowOffsets.erase(std::unique(m_rowOffsets.begin(), m_rowOffsets.end()),
+                           m_rowOffsets.end());
+    }
+}
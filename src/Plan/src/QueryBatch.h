@@ -0,0 +1,151 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                         // size_t, ptrdiff_t embedded.
+#include <vector>                           // std::vector embedded.
+
+#include "BitFunnel/BitFunnelTypes.h"       // Rank parameter.
+#include "BitFunnel/NonCopyable.h"          // Base class.
+#include "ByteCodeInterpreter.h"            // ByteCodeInterpreter::Stacks embedded.
+#include "QueryDeadline.h"                  // QueryDeadline embedded.
+
+
+namespace BitFunnel
+{
+    class ISimpleIndex;
+    class MatchFilter;
+    class QueryInstrumentation;
+    class ResultsBuffer;
+    class RowSet;
+    class SlicePruner;
+    class TopKResults;
+
+    //*************************************************************************
+    //
+    // QueryBatch
+    //
+    // Matches the byte code plans of several queries in a single pass over
+    // the index. Each slice is matched against every plan in the batch
+    // before moving on to the next slice, so rows that the plans share, and
+    // rows that other plans touched moments earlier, are served from cache
+    // instead of being pulled from DRAM once per query.
+    //
+    // The physical rows of all plans are deduplicated per shard. The batch
+    // prefetches each row of the slice prefetchDistance slices ahead once,
+    // no matter how many plans use it. These prefetches are not attributed
+    // to individual queries.
+    //
+    // Each plan keeps its own ResultsBuffer, TopKResults, MatchFilter,
+    // SlicePruner, deadline, and quadword budget. A plan skips the slices
+    // its SlicePruner rules out without charging them to its budget. A
+    // plan that times out or asks for early termination drops out of the
+    // batch while the others continue.
+    //
+    // Usage pattern:
+    //   1. Add() each plan. QueryPlanner does this when given a QueryBatch.
+    //   2. Run() the batch.
+    //   3. Reset() before adding the next batch.
+    //
+    // QueryBatch is not thread safe.
+    //
+    //*************************************************************************
+    class QueryBatch : public NonCopyable
+    {
+    public:
+        QueryBatch(ISimpleIndex const & index, size_t prefetchDistance);
+
+        // Adds a plan to the batch. The code must be sealed. The code,
+        // rowSet, results, topK, filter, and instrumentation must remain
+        // valid until Run() returns. A quadwordBudget of zero is unlimited.
+        // When filter is non-null, it must already be set up for the plan's
+        // query. When pruner is non-null, it must remain valid until Run()
+        // returns.
+        void Add(ByteCodeGenerator const & code,
+                 RowSet const & rowSet,
+                 Rank initialRank,
+                 QueryDeadline const & deadline,
+                 size_t quadwordBudget,
+                 SlicePruner const * pruner,
+                 ResultsBuffer & results,
+                 TopKResults * topK,
+                 MatchFilter * filter,
+                 QueryInstrumentation & instrumentation);
+
+        // Matches every plan in the batch. Records the matching time, match
+        // count, false positives, and timeouts of each plan in its
+        // QueryInstrumentation.
+        void Run();
+
+        // Removes all plans from the batch.
+        void Reset();
+
+        // Returns the number of plans in the batch.
+        size_t GetPlanCount() const;
+
+    private:
+        class Plan
+        {
+        public:
+            ByteCodeGenerator const * m_code;
+            RowSet const * m_rowSet;
+            Rank m_initialRank;
+            QueryDeadline m_deadline;
+            size_t m_remainingQuadwords;
+            SlicePruner const * m_pruner;
+            ResultsBuffer * m_results;
+            TopKResults * m_topK;
+            MatchFilter * m_filter;
+            size_t m_falsePositiveCount;
+            QueryInstrumentation * m_instrumentation;
+            bool m_isActive;
+            bool m_timedOut;
+        };
+
+        // Runs plan against a single slice of shard. Returns false once the
+        // plan has finished with the index.
+        bool RunSlice(Plan & plan,
+                      ShardId shard,
+                      void * const * sliceBuffer,
+                      size_t sliceCapacity);
+
+        // Removes the false positives from the plan's results if it has a
+        // MatchFilter.
+        static void FilterMatches(Plan & plan);
+
+        // Fills m_rowOffsets with the distinct row offsets used by the plans
+        // in shard.
+        void LoadRowUnion(ShardId shard);
+
+        ISimpleIndex const & m_index;
+        size_t m_prefetchDistance;
+
+        std::vector<Plan> m_plans;
+
+        // Distinct row offsets of the current shard.
+        std::vector<ptrdiff_t> m_rowOffsets;
+
+        // Shared by the interpreters, which run one at a time.
+        ByteCodeInterpreter::Stacks m_stacks;
+    };
+}
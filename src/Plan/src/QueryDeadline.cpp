@@ -0,0 +1,118 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <chrono>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+#include "QueryDeadline.h"
+
+
+namespace BitFunnel
+{
+    QueryDeadline::QueryDeadline()
+      : m_tickLimit(0)
+    {
+    }
+
+
+    QueryDeadline::QueryDeadline(double seconds)
+    {
+        // The frequency is read before the time stamp counter, since the
+        // first call spins while it calibrates.
+        const double ticksPerSecond = GetTicksPerSecond();
+        const uint64_t now = GetTicks();
+        if (seconds <= 0.0)
+        {
+            m_tickLimit = now;
+        }
+        else
+        {
+            m_tickLimit =
+                now + static_cast<uint64_t>(seconds * ticksPerSecond);
+        }
+
+        // Zero is reserved for "never expires".
+        if (m_tickLimit == 0)
+        {
+            m_tickLimit = 1;
+        }
+    }
+
+
+    bool QueryDeadline::HasExpired() const
+    {
+        return m_tickLimit != 0 && GetTicks() >= m_tickLimit;
+    }
+
+
+    uint64_t QueryDeadline::GetTickLimit() const
+    {
+        return m_tickLimit;
+    }
+
+
+    // static
+    uint64_t QueryDeadline::GetTicks()
+    {
+        return __rdtsc();
+    }
+
+
+    // static
+    void QueryDeadline::Calibrate()
+    {
+        GetTicksPerSecond();
+    }
+
+
+    // static
+    double QueryDeadline::GetTicksPerSecond()
+    {
+        // Function statics are initialized once, even when several threads
+        // make the first call at the same time.
+        static const double ticksPerSecond = []()
+        {
+            typedef std::chrono::steady_clock Clock;
+            const auto duration = std::chrono::milliseconds(10);
+
+            const auto start = Clock::now();
+            const uint64_t startTicks = GetTicks();
+            auto end = Clock::now();
+            while (end - start < duration)
+            {
+                end = Clock::now();
+            }
+            const uint64_t endTicks = GetTicks();
+
+            const double seconds =
+                std::chrono::duration<double>(end - start).count();
+            return static_cast<double>(endTicks - startTicks) / seconds;
+        }();
+
+        return ticksPerSecond;
+    }
+}
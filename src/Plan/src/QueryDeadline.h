@@ -0,0 +1,75 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stdint.h>     // uint64_t embedded.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // QueryDeadline
+    //
+    // A point in time, measured with the processor's time stamp counter,
+    // after which matching should stop. Both the ByteCodeInterpreter and
+    // the code generated by NativeCodeGenerator compare the time stamp
+    // counter against GetTickLimit() before starting each slice, so the
+    // check costs a few cycles per slice rather than a system call.
+    //
+    // QueryDeadline is a value type. It is safe to share between the
+    // threads matching a single query.
+    //
+    //*************************************************************************
+    class QueryDeadline
+    {
+    public:
+        // Constructs a QueryDeadline that never expires.
+        QueryDeadline();
+
+        // Constructs a QueryDeadline that expires the specified number of
+        // seconds from now. A non-positive value has already expired.
+        explicit QueryDeadline(double seconds);
+
+        bool HasExpired() const;
+
+        // Returns the time stamp counter value at which the deadline
+        // expires, or zero if it never expires.
+        uint64_t GetTickLimit() const;
+
+        // Returns the current value of the time stamp counter.
+        static uint64_t GetTicks();
+
+        // Measures the time stamp counter frequency, which takes about 10ms
+        // on the first call and nothing afterwards. Call it while setting up
+        // queries, so that the first deadline does not wait for it.
+        static void Calibrate();
+
+    private:
+        // Returns the time stamp counter frequency, which is measured
+        // against std::chrono::steady_clock on first use.
+        static double GetTicksPerSecond();
+
+        uint64_t m_tickLimit;
+    };
+}
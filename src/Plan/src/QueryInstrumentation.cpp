@@ -32,8 +32,14 @@ namespace BitFunnel
     {
         formatter.WriteField("rows");
         formatter.WriteField("matches");
+        formatter.WriteField("retained");
+        formatter.WriteField("falsepositives");
         formatter.WriteField("quadwords");
         formatter.WriteField("cachelines");
+        formatter.WriteField("prefetches");
+        formatter.WriteField("planhits");
+        formatter.WriteField("planmisses");
+        formatter.WriteField("timedout");
         formatter.WriteField("parse");
         formatter.WriteField("plan");
         formatter.WriteField("match");
@@ -46,8 +52,14 @@ namespace BitFunnel
     {
         formatter.WriteField(m_rowCount);
         formatter.WriteField(m_matchCount);
+        formatter.WriteField(m_retainedCount);
+        formatter.WriteField(m_falsePositiveCount);
         formatter.WriteField(m_quadwordCount);
         formatter.WriteField(m_cacheLineCount);
+        formatter.WriteField(m_prefetchCount);
+        formatter.WriteField(m_planCacheHitCount);
+        formatter.WriteField(m_planCacheMissCount);
+        formatter.WriteField(m_timedOut);
         formatter.WriteField(m_parsingTime);
         formatter.WriteField(m_planningTime);
         formatter.WriteField(m_matchingTime);
@@ -20,6 +20,13 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
 #include "BitFunnel/Allocators/IAllocator.h"
 #include "BitFunnel/IDiagnosticStream.h"
 #include "BitFunnel/Index/IIngestor.h"
@@ -33,16 +40,24 @@
 #include "BitFunnel/Utilities/IObjectFormatter.h"
 #include "ByteCodeInterpreter.h"
 #include "CompileNode.h"
+#include "CompiledPlanCache.h"
 #include "IPlanRows.h"
+#include "MatchFilter.h"
+#include "MatchThreadPool.h"
 #include "MatchTreeCompiler.h"
 #include "MatchTreeRewriter.h"
+#include "QueryBatch.h"
 #include "QueryPlanner.h"
 #include "QueryResources.h"
 #include "RankDownCompiler.h"
 #include "RegisterAllocator.h"
+#include "ResultsBuffer.h"
+#include "RowDensityTable.h"
 #include "RowSet.h"
+#include "SlicePruner.h"
 #include "TermPlan.h"
 #include "TermPlanConverter.h"
+#include "TopKResults.h"
 
 
 namespace BitFunnel
@@ -55,7 +70,10 @@ namespace BitFunnel
                                     IDiagnosticStream & diagnosticStream,
                                     QueryInstrumentation & instrumentation,
                                     ResultsBuffer & resultsBuffer,
-                                    bool useNativeCode)
+                                    bool useNativeCode,
+                                    TopKResults * topK,
+                                    size_t matchThreadCount,
+                                    QueryBatch * batch)
     {
         const int c_arbitraryRowCount = 500;
         QueryPlanner planner(tree,
@@ -65,7 +83,164 @@ namespace BitFunnel
                              diagnosticStream,
                              instrumentation,
                              resultsBuffer,
-                             useNativeCode);
+                             useNativeCode,
+                             topK,
+                             matchThreadCount,
+                             batch);
+    }
+
+
+    //*************************************************************************
+    //
+    // SliceRange
+    //
+    // A run of consecutive slice buffers from one shard, matched as a single
+    // task in parallel mode. Its matches are at positions m_resultsBegin
+    // through m_resultsEnd - 1 of the kept matches of the pool thread that
+    // matched it.
+    //
+    //*************************************************************************
+    class SliceRange
+    {
+    public:
+        SliceRange(void * const * sliceBuffers,
+                   size_t sliceCount,
+                   size_t iterationsPerSlice,
+                   ptrdiff_t const * rowOffsets,
+                   unsigned numaNode)
+          : m_sliceBuffers(sliceBuffers),
+            m_sliceCount(sliceCount),
+            m_iterationsPerSlice(iterationsPerSlice),
+            m_rowOffsets(rowOffsets),
+            m_numaNode(numaNode),
+            m_threadId(0),
+            m_resultsBegin(0),
+            m_resultsEnd(0),
+            m_quadwordCount(0),
+            m_prefetchCount(0),
+            m_timedOut(false)
+        {
+        }
+
+        void * const * m_sliceBuffers;
+        size_t m_sliceCount;
+        size_t m_iterationsPerSlice;
+        ptrdiff_t const * m_rowOffsets;
+        unsigned m_numaNode;
+
+        size_t m_threadId;
+        size_t m_resultsBegin;
+        size_t m_resultsEnd;
+        size_t m_quadwordCount;
+        size_t m_prefetchCount;
+        bool m_timedOut;
+    };
+
+
+    //*************************************************************************
+    //
+    // SliceRangeWork
+    //
+    // The work of matching a query's SliceRanges on a MatchThreadPool, one
+    // range per task, using either a compiled matcher or the byte code
+    // interpreter.
+    //
+    //*************************************************************************
+    class SliceRangeWork : public MatchThreadPool::IWork
+    {
+    public:
+        SliceRangeWork(SliceRange * ranges,
+                       ByteCodeGenerator const & code,
+                       MatchTreeCompiler const * compiler,
+                       Rank initialRank,
+                       size_t rowCount,
+                       size_t prefetchDistance,
+                       QueryDeadline const & deadline);
+
+        virtual void ProcessTask(size_t taskId,
+                                 MatchThreadPool::ThreadState & state) override;
+
+    private:
+        SliceRange * m_ranges;
+        ByteCodeGenerator const & m_code;
+        MatchTreeCompiler const * m_compiler;
+        Rank m_initialRank;
+        size_t m_rowCount;
+        size_t m_prefetchDistance;
+        QueryDeadline const & m_deadline;
+    };
+
+
+    SliceRangeWork::SliceRangeWork(SliceRange * ranges,
+                                   ByteCodeGenerator const & code,
+                                   MatchTreeCompiler const * compiler,
+                                   Rank initialRank,
+                                   size_t rowCount,
+                                   size_t prefetchDistance,
+                                   QueryDeadline const & deadline)
+      : m_ranges(ranges),
+        m_code(code),
+        m_compiler(compiler),
+        m_initialRank(initialRank),
+        m_rowCount(rowCount),
+        m_prefetchDistance(prefetchDistance),
+        m_deadline(deadline)
+    {
+    }
+
+
+    void SliceRangeWork::ProcessTask(size_t taskId,
+                                     MatchThreadPool::ThreadState & state)
+    {
+        SliceRange & range = m_ranges[taskId];
+        ResultsBuffer & results = *state.m_results;
+
+        // QueryInstrumentation is not thread safe, so each task counts into
+        // its own.
+        QueryInstrumentation instrumentation;
+
+        if (m_compiler != nullptr)
+        {
+            range.m_timedOut =
+                m_compiler->Run(range.m_sliceCount,
+                                range.m_sliceBuffers,
+                                range.m_iterationsPerSlice,
+                                range.m_rowOffsets,
+                                m_rowCount,
+                                m_prefetchDistance,
+                                m_deadline,
+                                results,
+                                instrumentation);
+        }
+        else
+        {
+            ByteCodeInterpreter interpreter(m_code,
+                                            results,
+                                            range.m_sliceCount,
+                                            range.m_sliceBuffers,
+                                            range.m_iterationsPerSlice,
+                                            m_initialRank,
+                                            range.m_rowOffsets,
+                                            nullptr,
+                                            instrumentation,
+                                            nullptr,
+                                            ByteCodeInterpreter::c_maxLaneCount,
+                                            m_prefetchDistance,
+                                            m_deadline,
+                                            &state.m_stacks);
+            range.m_timedOut = interpreter.Run();
+        }
+
+        // The scratch buffer is sized for one range, so the matches are
+        // moved out before the thread takes its next range.
+        range.m_threadId = state.m_threadId;
+        range.m_resultsBegin = state.m_matches.size();
+        state.m_matches.insert(state.m_matches.end(),
+                               results.m_buffer,
+                               results.m_buffer + results.size());
+        range.m_resultsEnd = state.m_matches.size();
+        range.m_quadwordCount = instrumentation.GetData().GetQuadwordCount();
+        range.m_prefetchCount = instrumentation.GetData().GetPrefetchCount();
     }
 
 
@@ -80,8 +255,23 @@ namespace BitFunnel
                                IDiagnosticStream & diagnosticStream,
                                QueryInstrumentation & instrumentation,
                                ResultsBuffer & resultsBuffer,
-                               bool useNativeCode)
-      : m_resultsBuffer(resultsBuffer)
+                               bool useNativeCode,
+                               TopKResults * topK,
+                               size_t matchThreadCount,
+                               QueryBatch * batch)
+      : m_rowPlanTree(nullptr),
+        m_targetRowCount(targetRowCount),
+        m_shardDensities(nullptr),
+        m_code(resources.GetByteCodeGenerator()),
+        m_resultsBuffer(resultsBuffer),
+        m_topK(topK),
+        m_pruner(nullptr),
+        m_prunedSlices(resources.GetPrunedSlices()),
+        m_filter(resources.GetMatchFilter()),
+        m_falsePositiveCount(0),
+        m_matchThreadCount(matchThreadCount),
+        m_remainingQuadwords(0),
+        m_timedOut(false)
     {
         if (diagnosticStream.IsEnabled("planning/term"))
         {
@@ -95,6 +285,11 @@ namespace BitFunnel
             out << std::endl;
         }
 
+        if (m_filter != nullptr)
+        {
+            m_filter->SetQuery(tree);
+        }
+
         RowPlan const & rowPlan =
             TermPlanConverter::BuildRowPlan(tree,
                                             index,
@@ -138,12 +333,25 @@ namespace BitFunnel
             }
         }
 
+        m_rowPlanTree = &rowPlan.GetMatchTree();
+
+        // With a RowDensityTable, the rows of each rank are ordered sparsest
+        // first, using densities averaged over the shards.
+        double const * densities = nullptr;
+        if (resources.GetDensityTable() != nullptr)
+        {
+            densities = LoadDensities(index,
+                                      *resources.GetDensityTable(),
+                                      resources.GetMatchTreeAllocator());
+        }
+
         // Rewrite match tree to optimal form for the RankDownCompiler.
         RowMatchNode const & rewritten =
             MatchTreeRewriter::Rewrite(rowPlan.GetMatchTree(),
                                        targetRowCount,
                                        c_targetCrossProductTermCount,
-                                       resources.GetMatchTreeAllocator());
+                                       resources.GetMatchTreeAllocator(),
+                                       densities);
 
 
         if (diagnosticStream.IsEnabled("planning/rewrite"))
@@ -176,7 +384,11 @@ namespace BitFunnel
             out << std::endl;
         }
 
-        RowSet rowSet(index, *m_planRows, resources.GetMatchTreeAllocator());
+        // The RowSet lives in the arena so that a batched plan can use it
+        // after the QueryPlanner is gone.
+        IAllocator & allocator = resources.GetMatchTreeAllocator();
+        RowSet & rowSet = *new (allocator.Allocate(sizeof(RowSet)))
+                               RowSet(index, *m_planRows, allocator);
         rowSet.LoadRows();
 
         if (diagnosticStream.IsEnabled("planning/rowset"))
@@ -191,7 +403,22 @@ namespace BitFunnel
 
         instrumentation.SetRowCount(rowSet.GetRowCount());
 
-        if (useNativeCode)
+        if (resources.GetSlicePruning())
+        {
+            m_pruner = new (allocator.Allocate(sizeof(SlicePruner)))
+                           SlicePruner(*m_rowPlanTree, *m_planRows, index, allocator);
+        }
+
+        if (batch != nullptr)
+        {
+            AddToBatch(resources,
+                       instrumentation,
+                       compileTree,
+                       initialRank,
+                       rowSet,
+                       *batch);
+        }
+        else if (useNativeCode)
         {
             RunNativeCode(index,
                           resources,
@@ -220,44 +447,224 @@ namespace BitFunnel
                                               RowSet const & rowSet)
     {
         // TODO: Clear results buffer here?
+        m_code.Reset();
         compileTree.Compile(m_code);
         m_code.Seal();
 
         instrumentation.FinishPlanning();
+        StartBudgets(resources, instrumentation);
         m_resultsBuffer.Reset();
+        if (m_topK != nullptr)
+        {
+            m_topK->Reset();
+        }
 
         // Get token before we GetSliceBuffers.
         {
             auto token = index.GetIngestor().GetTokenManager().RequestToken();
 
-            for (ShardId shardId = 0; shardId < index.GetIngestor().GetShardCount(); ++shardId)
+            // Cache line counting records into a single CacheLineRecorder,
+            // so it requires serial matching.
+            if (m_matchThreadCount > 1 &&
+                resources.GetCacheLineRecorder() == nullptr)
             {
-                auto & shard = index.GetIngestor().GetShard(shardId);
-                auto & sliceBuffers = shard.GetSliceBuffers();
-
-                // Iterations per slice calculation.
-                auto iterationsPerSlice = shard.GetSliceCapacity() >> 6 >> initialRank;
-
-                ByteCodeInterpreter intepreter(m_code,
-                                               m_resultsBuffer,
-                                               sliceBuffers.size(),
-                                               sliceBuffers.data(),
-                                               iterationsPerSlice,
-                                               initialRank,
-                                               rowSet.GetRowOffsets(shardId),
-                                               nullptr,
-                                               instrumentation,
-                                               resources.GetCacheLineRecorder());
-
-                intepreter.Run();
+                RunParallel(index,
+                            resources,
+                            instrumentation,
+                            initialRank,
+                            rowSet,
+                            resources.GetPrefetchDistance(),
+                            nullptr);
             }
+            else
+            {
+                const ShardId shardCount = index.GetIngestor().GetShardCount();
+                bool terminate = false;
+                for (ShardId shardId = 0;
+                     shardId < shardCount && !terminate;
+                     ++shardId)
+                {
+                    // Each shard runs a plan ordered by its own densities.
+                    if (m_shardDensities != nullptr && shardCount > 1)
+                    {
+                        CompileShardPlan(resources, shardId, initialRank);
+                    }
+
+                    auto & shard = index.GetIngestor().GetShard(shardId);
+                    auto const & buffers = shard.GetSliceBuffers();
+                    m_prunedSlices.clear();
+                    m_prunedSlices.reserve(buffers.size());
+                    size_t shardSliceCount;
+                    void * const * sliceBuffers =
+                        SelectSlices(shardId, buffers, shardSliceCount);
+
+                    // Iterations per slice calculation.
+                    auto iterationsPerSlice = shard.GetSliceCapacity() >> 6 >> initialRank;
+
+                    const size_t batchSize =
+                        (m_topK == nullptr) ? shardSliceCount : 1;
+
+                    for (size_t start = 0;
+                         start < shardSliceCount && !terminate;
+                         start += batchSize)
+                    {
+                        const size_t sliceCount =
+                            ChargeQuadwordBudget((std::min)(batchSize, shardSliceCount - start),
+                                                 iterationsPerSlice);
+
+                        ByteCodeInterpreter interpreter(m_code,
+                                                        m_resultsBuffer,
+                                                        sliceCount,
+                                                        sliceBuffers + start,
+                                                        iterationsPerSlice,
+                                                        initialRank,
+                                                        rowSet.GetRowOffsets(shardId),
+                                                        nullptr,
+                                                        instrumentation,
+                                                        resources.GetCacheLineRecorder(),
+                                                        ByteCodeInterpreter::c_maxLaneCount,
+                                                        resources.GetPrefetchDistance(),
+                                                        m_deadline,
+                                                        &resources.GetByteCodeStacks());
+
+                        if (interpreter.Run())
+                        {
+                            m_timedOut = true;
+                        }
+                        terminate = FinishSliceBatch() || m_timedOut;
+                    }
+                }
+            }
+
+            // In top-k mode, each slice's matches were filtered before
+            // scoring.
+            if (m_topK == nullptr)
+            {
+                FilterMatches(m_resultsBuffer);
+            }
+            instrumentation.IncrementFalsePositiveCount(m_falsePositiveCount);
 
             instrumentation.FinishMatching();
-            instrumentation.SetMatchCount(m_resultsBuffer.size());
+            if (m_timedOut)
+            {
+                instrumentation.SetTimedOut();
+            }
+            instrumentation.SetMatchCount((m_topK == nullptr) ?
+                                          m_resultsBuffer.size() :
+                                          m_topK->GetMatchCount());
+            instrumentation.SetRetainedCount((m_topK == nullptr) ?
+                                             m_resultsBuffer.size() :
+                                             m_topK->size());
         } // End of token lifetime.
     }
 
 
+    double const * QueryPlanner::LoadDensities(ISimpleIndex const & index,
+                                               RowDensityTable & table,
+                                               IAllocator & allocator)
+    {
+        const ShardId shardCount = m_planRows->GetShardCount();
+        const unsigned rowCount = m_planRows->GetRowCount();
+
+        double * shardDensities = static_cast<double*>(
+            allocator.Allocate(sizeof(double) * shardCount * rowCount));
+        double * averages = static_cast<double*>(
+            allocator.Allocate(sizeof(double) * rowCount));
+        std::fill(averages, averages + rowCount, 0.0);
+
+        // Weight each shard's densities by its slice count, falling back to
+        // equal weights when the index is empty.
+        size_t totalSliceCount = 0;
+        {
+            auto token = index.GetIngestor().GetTokenManager().RequestToken();
+            for (ShardId shard = 0; shard < shardCount; ++shard)
+            {
+                double * densities = shardDensities + shard * rowCount;
+                table.GetDensities(*m_planRows, shard, densities);
+
+                const size_t sliceCount =
+                    index.GetIngestor().GetShard(shard).GetSliceBuffers().size();
+                totalSliceCount += sliceCount;
+                for (unsigned id = 0; id < rowCount; ++id)
+                {
+                    averages[id] += densities[id] * sliceCount;
+                }
+            }
+        }
+
+        if (totalSliceCount == 0)
+        {
+            for (ShardId shard = 0; shard < shardCount; ++shard)
+            {
+                for (unsigned id = 0; id < rowCount; ++id)
+                {
+                    averages[id] += shardDensities[shard * rowCount + id];
+                }
+            }
+            totalSliceCount = shardCount;
+        }
+
+        for (unsigned id = 0; id < rowCount; ++id)
+        {
+            averages[id] /= static_cast<double>(totalSliceCount);
+        }
+
+        m_shardDensities = shardDensities;
+        return averages;
+    }
+
+
+    void QueryPlanner::CompileShardPlan(QueryResources & resources,
+                                        ShardId shard,
+                                        Rank initialRank)
+    {
+        IAllocator & allocator = resources.GetMatchTreeAllocator();
+        RowMatchNode const & rewritten =
+            MatchTreeRewriter::Rewrite(*m_rowPlanTree,
+                                       m_targetRowCount,
+                                       c_targetCrossProductTermCount,
+                                       allocator,
+                                       m_shardDensities + shard * m_planRows->GetRowCount());
+
+        // Reordering rows within a rank does not change the maximum rank,
+        // so the shard's plan starts at the same rank as the shared plan.
+        RankDownCompiler compiler(allocator);
+        compiler.Compile(rewritten);
+        CompileNode const & compileTree = compiler.CreateTree(initialRank);
+
+        m_code.Reset();
+        compileTree.Compile(m_code);
+        m_code.Seal();
+    }
+
+
+    void QueryPlanner::AddToBatch(QueryResources & resources,
+                                  QueryInstrumentation & instrumentation,
+                                  CompileNode const & compileTree,
+                                  Rank initialRank,
+                                  RowSet const & rowSet,
+                                  QueryBatch & batch)
+    {
+        m_code.Reset();
+        compileTree.Compile(m_code);
+        m_code.Seal();
+
+        instrumentation.FinishPlanning();
+        StartBudgets(resources, instrumentation);
+
+        batch.Add(m_code,
+                  rowSet,
+                  initialRank,
+                  m_deadline,
+                  resources.GetQuadwordBudget(),
+                  m_pruner,
+                  m_resultsBuffer,
+                  m_topK,
+                  m_filter,
+                  instrumentation);
+    }
+
+
     void QueryPlanner::RunNativeCode(ISimpleIndex const & index,
                                      QueryResources & resources,
                                      QueryInstrumentation & instrumentation,
@@ -265,55 +672,380 @@ namespace BitFunnel
                                      Rank initialRank,
                                      RowSet const & rowSet)
     {
-         // Perform register allocation on the compile tree.
-         RegisterAllocator const registers(compileTree,
-                                           rowSet.GetRowCount(),
-                                           c_registerBase,
-                                           c_registerCount,
-                                           resources.GetMatchTreeAllocator());
+        // Holds the matcher when it comes from the CompiledPlanCache. The
+        // reference keeps the entry alive even if another thread evicts it.
+        std::shared_ptr<CompiledPlanCache::Entry> cachedPlan;
 
-         MatchTreeCompiler compiler(resources,
-                                    compileTree,
-                                    registers,
-                                    initialRank);
+        // Holds the matcher when there is no CompiledPlanCache.
+        std::unique_ptr<MatchTreeCompiler> localPlan;
 
+        CompiledPlanCache * cache = resources.GetPlanCache();
+        if (cache != nullptr)
+        {
+            const std::string key =
+                CompiledPlanCache::CreateKey(compileTree,
+                                             initialRank,
+                                             rowSet.GetRowCount());
+            cachedPlan = cache->Find(key);
 
-         // TODO: Clear results buffer here?
-        compileTree.Compile(m_code);
-        m_code.Seal();
+            if (cachedPlan != nullptr)
+            {
+                instrumentation.IncrementPlanCacheHitCount();
+            }
+            else
+            {
+                instrumentation.IncrementPlanCacheMissCount();
+
+                RegisterAllocator const registers(compileTree,
+                                                  rowSet.GetRowCount(),
+                                                  c_registerBase,
+                                                  c_registerCount,
+                                                  resources.GetMatchTreeAllocator());
+
+                cachedPlan = cache->Add(
+                    key,
+                    std::make_shared<CompiledPlanCache::Entry>(
+                        resources.GetExpressionTreeAllocator(),
+                        cache->GetCodeBufferBytes(),
+                        compileTree,
+                        registers,
+                        initialRank));
+            }
+        }
+        else
+        {
+            // Perform register allocation on the compile tree.
+            RegisterAllocator const registers(compileTree,
+                                              rowSet.GetRowCount(),
+                                              c_registerBase,
+                                              c_registerCount,
+                                              resources.GetMatchTreeAllocator());
+
+            localPlan.reset(new MatchTreeCompiler(resources,
+                                                  compileTree,
+                                                  registers,
+                                                  initialRank,
+                                                  NativeCodeGenerator::c_maxLaneCount));
+        }
+
+        MatchTreeCompiler & compiler =
+            (cachedPlan != nullptr) ? cachedPlan->GetCompiler() : *localPlan;
 
         instrumentation.FinishPlanning();
+        StartBudgets(resources, instrumentation);
 
         m_resultsBuffer.Reset();
+        if (m_topK != nullptr)
+        {
+            m_topK->Reset();
+        }
 
         // Get token before we GetSliceBuffers.
         {
             auto token = index.GetIngestor().GetTokenManager().RequestToken();
 
-            for (ShardId shardId = 0; shardId < index.GetIngestor().GetShardCount(); ++shardId)
+            if (m_matchThreadCount > 1)
+            {
+                RunParallel(index,
+                            resources,
+                            instrumentation,
+                            initialRank,
+                            rowSet,
+                            resources.GetPrefetchDistance(),
+                            &compiler);
+            }
+            else
             {
-                auto & shard = index.GetIngestor().GetShard(shardId);
-                auto & sliceBuffers = shard.GetSliceBuffers();
+                const ShardId shardCount = index.GetIngestor().GetShardCount();
+                bool terminate = false;
+                for (ShardId shardId = 0;
+                     shardId < shardCount && !terminate;
+                     ++shardId)
+                {
+                    auto & shard = index.GetIngestor().GetShard(shardId);
+                    auto const & buffers = shard.GetSliceBuffers();
+                    m_prunedSlices.clear();
+                    m_prunedSlices.reserve(buffers.size());
+                    size_t shardSliceCount;
+                    void * const * sliceBuffers =
+                        SelectSlices(shardId, buffers, shardSliceCount);
+
+                    // Iterations per slice calculation.
+                    auto iterationsPerSlice = shard.GetSliceCapacity() >> 6 >> initialRank;
 
-                // Iterations per slice calculation.
-                auto iterationsPerSlice = shard.GetSliceCapacity() >> 6 >> initialRank;
+                    const size_t batchSize =
+                        (m_topK == nullptr) ? shardSliceCount : 1;
 
+                    for (size_t start = 0;
+                         start < shardSliceCount && !terminate;
+                         start += batchSize)
+                    {
+                        const size_t sliceCount =
+                            ChargeQuadwordBudget((std::min)(batchSize, shardSliceCount - start),
+                                                 iterationsPerSlice);
 
-                size_t quadwordCount = compiler.Run(sliceBuffers.size(),
-                                                    sliceBuffers.data(),
-                                                    iterationsPerSlice,
-                                                    rowSet.GetRowOffsets(shardId),
-                                                    m_resultsBuffer);
+                        if (compiler.Run(sliceCount,
+                                         sliceBuffers + start,
+                                         iterationsPerSlice,
+                                         rowSet.GetRowOffsets(shardId),
+                                         rowSet.GetRowCount(),
+                                         resources.GetPrefetchDistance(),
+                                         m_deadline,
+                                         m_resultsBuffer,
+                                         instrumentation))
+                        {
+                            m_timedOut = true;
+                        }
+                        terminate = FinishSliceBatch() || m_timedOut;
+                    }
+                }
+            }
 
-                instrumentation.IncrementQuadwordCount(quadwordCount);
+            // In top-k mode, each slice's matches were filtered before
+            // scoring.
+            if (m_topK == nullptr)
+            {
+                FilterMatches(m_resultsBuffer);
             }
+            instrumentation.IncrementFalsePositiveCount(m_falsePositiveCount);
 
             instrumentation.FinishMatching();
-            instrumentation.SetMatchCount(m_resultsBuffer.size());
+            if (m_timedOut)
+            {
+                instrumentation.SetTimedOut();
+            }
+            instrumentation.SetMatchCount((m_topK == nullptr) ?
+                                          m_resultsBuffer.size() :
+                                          m_topK->GetMatchCount());
+            instrumentation.SetRetainedCount((m_topK == nullptr) ?
+                                             m_resultsBuffer.size() :
+                                             m_topK->size());
         } // End of token lifetime.
     }
 
 
+    void QueryPlanner::RunParallel(ISimpleIndex const & index,
+                                   QueryResources & resources,
+                                   QueryInstrumentation & instrumentation,
+                                   Rank initialRank,
+                                   RowSet const & rowSet,
+                                   size_t prefetchDistance,
+                                   MatchTreeCompiler const * compiler)
+    {
+        IIngestor const & ingestor = index.GetIngestor();
+        const ShardId shardCount = ingestor.GetShardCount();
+
+        // The per-query arrays below come from the match tree arena, so that
+        // a warmed-up query does not allocate.
+        IAllocator & allocator = resources.GetMatchTreeAllocator();
+
+        // Ingestion may replace a shard's slice list at any time, so each
+        // list is read once and the same snapshot is used for sizing and
+        // for selecting slices.
+        auto shardBuffers = static_cast<std::vector<void*> const **>(
+            allocator.Allocate(sizeof(std::vector<void*> const *) * shardCount));
+        size_t totalSliceCount = 0;
+        for (ShardId shardId = 0; shardId < shardCount; ++shardId)
+        {
+            shardBuffers[shardId] = &ingestor.GetShard(shardId).GetSliceBuffers();
+            totalSliceCount += shardBuffers[shardId]->size();
+        }
+
+        // Size the ranges so that each thread gets about c_rangesPerThread of
+        // them. Ranges never span shards because each shard has its own row
+        // offsets and slice capacity.
+        const size_t rangesPerThread = c_rangesPerThread;
+        const size_t targetRangeCount = m_matchThreadCount * rangesPerThread;
+        const size_t slicesPerRange =
+            (std::max)(static_cast<size_t>(1),
+                       (totalSliceCount + targetRangeCount - 1) / targetRangeCount);
+
+        // Ranges point into m_prunedSlices, which is reserved up front so
+        // that it never reallocates.
+        m_prunedSlices.clear();
+        m_prunedSlices.reserve(totalSliceCount);
+
+        // Pruning only removes slices, so the unpruned slice counts bound
+        // the number of ranges.
+        size_t maxRangeCount = 0;
+        for (ShardId shardId = 0; shardId < shardCount; ++shardId)
+        {
+            maxRangeCount +=
+                (shardBuffers[shardId]->size() + slicesPerRange - 1) / slicesPerRange;
+        }
+        auto ranges = static_cast<SliceRange*>(
+            allocator.Allocate(sizeof(SliceRange) * maxRangeCount));
+        auto rangeNodes = static_cast<unsigned*>(
+            allocator.Allocate(sizeof(unsigned) * maxRangeCount));
+        size_t rangeCount = 0;
+        size_t rangeCapacity = 0;
+        for (ShardId shardId = 0; shardId < shardCount; ++shardId)
+        {
+            auto & shard = ingestor.GetShard(shardId);
+            size_t shardSliceCount;
+            void * const * sliceBuffers =
+                SelectSlices(shardId, *shardBuffers[shardId], shardSliceCount);
+
+            // Iterations per slice calculation.
+            auto iterationsPerSlice = shard.GetSliceCapacity() >> 6 >> initialRank;
+
+            for (size_t start = 0; start < shardSliceCount; start += slicesPerRange)
+            {
+                const size_t sliceCount =
+                    ChargeQuadwordBudget((std::min)(slicesPerRange, shardSliceCount - start),
+                                         iterationsPerSlice);
+                if (sliceCount == 0)
+                {
+                    break;
+                }
+                new (ranges + rangeCount) SliceRange(sliceBuffers + start,
+                                                     sliceCount,
+                                                     iterationsPerSlice,
+                                                     rowSet.GetRowOffsets(shardId),
+                                                     shard.GetNumaNode());
+                rangeNodes[rangeCount] = shard.GetNumaNode();
+                ++rangeCount;
+
+                rangeCapacity = (std::max)(rangeCapacity,
+                                           sliceCount * shard.GetSliceCapacity());
+            }
+        }
+
+        // The pool may be shared with other query threads. The lock is held
+        // until the matches have been merged, since the next query's Run()
+        // discards them.
+        MatchThreadPool & pool =
+            resources.GetMatchThreadPool(index, m_matchThreadCount);
+        std::lock_guard<std::mutex> lock(pool.GetQueryLock());
+        SliceRangeWork work(ranges,
+                            m_code,
+                            compiler,
+                            initialRank,
+                            rowSet.GetRowCount(),
+                            prefetchDistance,
+                            m_deadline);
+        pool.Run(work, rangeNodes, rangeCount, rangeCapacity);
+
+        // Merge in slice order so that results match the serial path. In
+        // top-k mode, matches are scored one slice at a time, as in the
+        // serial path.
+        bool terminate = false;
+        for (size_t r = 0; r < rangeCount; ++r)
+        {
+            SliceRange const & range = ranges[r];
+            instrumentation.IncrementQuadwordCount(range.m_quadwordCount);
+            instrumentation.IncrementPrefetchCount(range.m_prefetchCount);
+            if (range.m_timedOut)
+            {
+                m_timedOut = true;
+            }
+
+            auto const & matches = pool.GetMatches(range.m_threadId);
+            Slice * slice = nullptr;
+            for (size_t i = range.m_resultsBegin; i < range.m_resultsEnd && !terminate; ++i)
+            {
+                auto const & result = matches[i];
+                if (result.m_slice != slice && slice != nullptr)
+                {
+                    terminate = FinishSliceBatch();
+                }
+                if (!terminate)
+                {
+                    m_resultsBuffer.push_back(result.m_slice, result.m_index);
+                }
+                slice = result.m_slice;
+            }
+            if (!terminate)
+            {
+                terminate = FinishSliceBatch();
+            }
+        }
+    }
+
+
+    void * const * QueryPlanner::SelectSlices(ShardId shard,
+                                              std::vector<void*> const & sliceBuffers,
+                                              size_t & sliceCount)
+    {
+        if (m_pruner == nullptr || !m_pruner->IsEnabled())
+        {
+            sliceCount = sliceBuffers.size();
+            return sliceBuffers.data();
+        }
+
+        const size_t first = m_prunedSlices.size();
+        m_prunedSlices.resize(first + sliceBuffers.size());
+        sliceCount = m_pruner->Prune(shard,
+                                     sliceBuffers.data(),
+                                     sliceBuffers.size(),
+                                     m_prunedSlices.data() + first);
+        m_prunedSlices.resize(first + sliceCount);
+        return m_prunedSlices.data() + first;
+    }
+
+
+    bool QueryPlanner::FinishSliceBatch()
+    {
+        if (m_topK == nullptr)
+        {
+            return false;
+        }
+
+        FilterMatches(m_resultsBuffer);
+        bool terminate = m_topK->Add(m_resultsBuffer);
+        m_resultsBuffer.Reset();
+        return terminate;
+    }
+
+
+    void QueryPlanner::FilterMatches(ResultsBuffer & results)
+    {
+        if (m_filter != nullptr)
+        {
+            m_falsePositiveCount += m_filter->Filter(results);
+        }
+    }
+
+
+    void QueryPlanner::StartBudgets(QueryResources const & resources,
+                                    QueryInstrumentation const & instrumentation)
+    {
+        // The time budget covers parsing and planning as well as matching.
+        const double timeBudget = resources.GetTimeBudget();
+        m_deadline = (timeBudget > 0.0) ?
+            QueryDeadline(timeBudget - instrumentation.GetElapsedTime()) :
+            QueryDeadline();
+
+        // A quadword budget of zero is unlimited.
+        m_remainingQuadwords = resources.GetQuadwordBudget();
+        if (m_remainingQuadwords == 0)
+        {
+            m_remainingQuadwords = (std::numeric_limits<size_t>::max)();
+        }
+        m_timedOut = false;
+    }
+
+
+    size_t QueryPlanner::ChargeQuadwordBudget(size_t sliceCount,
+                                              size_t iterationsPerSlice)
+    {
+        size_t charged = 0;
+        while (charged < sliceCount && m_remainingQuadwords > 0)
+        {
+            m_remainingQuadwords -=
+                (std::min)(m_remainingQuadwords, iterationsPerSlice);
+            ++charged;
+        }
+
+        if (charged < sliceCount)
+        {
+            m_timedOut = true;
+        }
+
+        return charged;
+    }
+
+
     IPlanRows const & QueryPlanner::GetPlanRows() const
     {
         return *m_planRows;
@@ -22,25 +22,40 @@
 
 #pragma once
 
+#include <vector>                          // std::vector parameter.
+
 #include "BitFunnel/NonCopyable.h"        // Inherits from NonCopyable.
 #include "ByteCodeInterpreter.h"
+#include "QueryDeadline.h"                // QueryDeadline embedded.
 
 
 namespace BitFunnel
 {
+    class IAllocator;
     class IPlanRows;
     class ISimpleIndex;
     class IThreadResources;
+    class MatchFilter;
+    class MatchTreeCompiler;
+    class QueryBatch;
     class QueryInstrumentation;
     class QueryResources;
     class ResultsBuffer;
+    class RowDensityTable;
+    class RowMatchNode;
     class RowSet;
+    class SlicePruner;
     class TermMatchNode;
+    class TopKResults;
 
     class QueryPlanner : public NonCopyable
     {
     public:
-        // Constructs a QueryPlanner with the specified resources.
+        // Constructs a QueryPlanner with the specified resources. When batch
+        // is non-null, the plan is compiled to byte code and added to the
+        // batch instead of being matched, so useNativeCode and
+        // matchThreadCount are ignored. The plan lives in resources, which
+        // must not be reset until the batch has run.
         QueryPlanner(TermMatchNode const & tree,
                      unsigned targetRowCount,
                      ISimpleIndex const & index,
@@ -49,7 +64,10 @@ namespace BitFunnel
                      IDiagnosticStream& diagnosticStream,
                      QueryInstrumentation & instrumentation,
                      ResultsBuffer & resultsBuffer,
-                     bool useNativeCode);
+                     bool useNativeCode,
+                     TopKResults * topK = nullptr,
+                     size_t matchThreadCount = 1,
+                     QueryBatch * batch = nullptr);
 
         IPlanRows const & GetPlanRows() const;
 
@@ -61,6 +79,29 @@ namespace BitFunnel
                                     Rank maxRank,
                                     RowSet const & rowSet);
 
+        // Looks up the densities of the plan rows in every shard and saves
+        // them in m_shardDensities. Returns each row's average density over
+        // the shards, weighted by slice count. Both arrays are allocated
+        // from allocator and are indexed by AbstractRow id.
+        double const * LoadDensities(ISimpleIndex const & index,
+                                     RowDensityTable & table,
+                                     IAllocator & allocator);
+
+        // Recompiles the row plan into m_code with the rows ordered by the
+        // densities of the specified shard. Only the serial byte code path
+        // uses per-shard plans. Native code and parallel matching run the
+        // single plan ordered by the average densities.
+        void CompileShardPlan(QueryResources & resources,
+                              ShardId shard,
+                              Rank initialRank);
+
+        void AddToBatch(QueryResources & resources,
+                        QueryInstrumentation & instrumentation,
+                        CompileNode const & compileTree,
+                        Rank initialRank,
+                        RowSet const & rowSet,
+                        QueryBatch & batch);
+
         void RunNativeCode(ISimpleIndex const & index,
                            QueryResources & resources,
                            QueryInstrumentation & instrumentation,
@@ -68,8 +109,44 @@ namespace BitFunnel
                            Rank maxRank,
                            RowSet const & rowSet);
 
+        // Matches ranges of slices on the MatchThreadPool of resources, which
+        // keeps matchThreadCount worker threads across queries. Each worker
+        // matches one range at a time into a ResultsBuffer sized for the
+        // largest range, and keeps only the matches it found. These are then
+        // merged in slice order into m_resultsBuffer or m_topK. Uses
+        // the compiled matcher when compiler is non-null, and the byte code
+        // in m_code otherwise. When the deadline expires, ranges stop
+        // independently, so partial results need not be a prefix of the
+        // slices.
+        void RunParallel(ISimpleIndex const & index,
+                         QueryResources & resources,
+                         QueryInstrumentation & instrumentation,
+                         Rank initialRank,
+                         RowSet const & rowSet,
+                         size_t prefetchDistance,
+                         MatchTreeCompiler const * compiler);
+
+        // Appends to m_prunedSlices the slice buffers of shard that may
+        // match the query and returns a pointer to the first of them, or
+        // returns sliceBuffers.data() when slices are not pruned. Sets
+        // sliceCount to the number of buffers. The caller must reserve room
+        // in m_prunedSlices for all of sliceBuffers, so that earlier
+        // pointers stay valid.
+        void * const * SelectSlices(ShardId shard,
+                                    std::vector<void*> const & sliceBuffers,
+                                    size_t & sliceCount);
+
         IPlanRows const * m_planRows;
 
+        // The row plan's match tree, before rewriting.
+        RowMatchNode const * m_rowPlanTree;
+        unsigned m_targetRowCount;
+
+        // Row densities for each shard, stored shard by shard and indexed by
+        // AbstractRow id within a shard. Null unless the QueryResources have
+        // a RowDensityTable.
+        double const * m_shardDensities;
+
         // The maximum number of iterations that can be performed before a termination
         // check is mandatory. Details can be found in the MatchTreeCodeGenerator.
         // const unsigned m_maxIterationsScannedBetweenTerminationChecks;
@@ -82,8 +159,59 @@ namespace BitFunnel
         // TODO: is this valid on all platforms or only on Windows?
         static const unsigned c_registerCount = 8;
 
-        ByteCodeGenerator m_code;
+        // When m_topK is set, matching runs one slice at a time and each
+        // slice's matches are drained from m_resultsBuffer into m_topK.
+        // Returns true if the query should terminate early.
+        bool FinishSliceBatch();
+
+        // Removes the false positives from results when the query's
+        // resources have a MatchFilter. Must be called while the token that
+        // guards the slice buffers is held.
+        void FilterMatches(ResultsBuffer & results);
+
+        // Starts the query's time and quadword budgets from
+        // QueryResources. Call just before matching.
+        void StartBudgets(QueryResources const & resources,
+                          QueryInstrumentation const & instrumentation);
+
+        // Returns how many of the next sliceCount slices, each scanning
+        // iterationsPerSlice quadwords, may start within the remaining
+        // quadword budget and charges them against it. A slice may start
+        // as long as the budget is not yet exhausted. Sets m_timedOut if
+        // any of the slices may not start.
+        size_t ChargeQuadwordBudget(size_t sliceCount,
+                                    size_t iterationsPerSlice);
+
+        // Reused from QueryResources so that its vectors keep their
+        // capacity from one query to the next.
+        ByteCodeGenerator & m_code;
 
         ResultsBuffer& m_resultsBuffer;
+        TopKResults * m_topK;
+
+        // Skips the slices that cannot match. Allocated from the query's
+        // arena so that a batched plan can use it. Null when slice pruning
+        // is disabled.
+        SlicePruner const * m_pruner;
+
+        // Reused from QueryResources, like m_code.
+        std::vector<void*> & m_prunedSlices;
+
+        // Null when matches are not filtered.
+        MatchFilter * m_filter;
+        size_t m_falsePositiveCount;
+
+        // Number of threads matching this query. Values of 0 and 1 match on
+        // the calling thread.
+        size_t m_matchThreadCount;
+
+        QueryDeadline m_deadline;
+        size_t m_remainingQuadwords;
+        bool m_timedOut;
+
+        // Target number of slice ranges per matching thread. Several ranges
+        // per thread allow threads that finish early to pick up the
+        // remaining work.
+        static const size_t c_rangesPerThread = 4;
     };
 }
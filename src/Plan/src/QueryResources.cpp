@@ -20,11 +20,14 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>
 
+#include "BitFunnel/Exceptions.h"
 #include "BitFunnel/Index/IIngestor.h"
 #include "BitFunnel/Index/IShard.h"
 #include "BitFunnel/Index/ISimpleIndex.h"
 #include "BitFunnel/Utilities/Allocator.h"
+#include "BitFunnel/Utilities/Numa.h"
 #include "QueryResources.h"
 
 
@@ -33,11 +36,24 @@ namespace BitFunnel
     QueryResources::QueryResources(size_t treeAllocatorBytes,
                                    size_t codeAllocatorBytes)
       : m_matchTreeAllocator(new BitFunnel::Allocator(treeAllocatorBytes)),
-        m_expressionTreeAllocator(new NativeJIT::Allocator(treeAllocatorBytes)),
-        m_codeAllocator(new NativeJIT::ExecutionBuffer(codeAllocatorBytes))
+        m_sharedMatchThreadPool(nullptr),
+        m_matchThreadCount(0),
+        m_planCache(nullptr),
+        m_densityTable(nullptr),
+        m_prefetchDistance(c_defaultPrefetchDistance),
+        m_slicePruning(true),
+        m_timeBudget(0.0),
+        m_quadwordBudget(0)
     {
-        m_code.reset(new NativeJIT::FunctionBuffer(*m_codeAllocator,
-                                                   static_cast<unsigned>(codeAllocatorBytes)));
+        if (codeAllocatorBytes > 0)
+        {
+            m_expressionTreeAllocator.reset(
+                new NativeJIT::Allocator(treeAllocatorBytes));
+            m_codeAllocator.reset(
+                new NativeJIT::ExecutionBuffer(codeAllocatorBytes));
+            m_code.reset(new NativeJIT::FunctionBuffer(*m_codeAllocator,
+                                                       static_cast<unsigned>(codeAllocatorBytes)));
+        }
     }
 
 
@@ -48,12 +64,103 @@ namespace BitFunnel
     }
 
 
+    void QueryResources::EnableMatchFiltering(ISimpleIndex const & index)
+    {
+        if (index.GetForwardIndex() == nullptr)
+        {
+            RecoverableError error("Match filtering requires an index with a forward index.");
+            throw error;
+        }
+
+        m_matchFilter.reset(new MatchFilter(*index.GetForwardIndex(),
+                                            index.GetConfiguration()));
+    }
+
+
+    // Replaces the contents of nodes with the distinct NUMA nodes of the
+    // index's shards.
+    static void GetShardNodes(ISimpleIndex const & index,
+                              std::vector<unsigned> & nodes)
+    {
+        nodes.clear();
+        for (ShardId shard = 0; shard < index.GetIngestor().GetShardCount(); ++shard)
+        {
+            const unsigned node = index.GetIngestor().GetShard(shard).GetNumaNode();
+            if (std::find(nodes.begin(), nodes.end(), node) == nodes.end())
+            {
+                nodes.push_back(node);
+            }
+        }
+        if (nodes.empty())
+        {
+            nodes.push_back(c_anyNumaNode);
+        }
+    }
+
+
+    std::unique_ptr<MatchThreadPool>
+        QueryResources::CreateMatchThreadPool(ISimpleIndex const & index,
+                                              size_t threadCount)
+    {
+        std::vector<unsigned> nodes;
+        GetShardNodes(index, nodes);
+        return std::unique_ptr<MatchThreadPool>(
+            new MatchThreadPool(nodes, threadCount));
+    }
+
+
+    MatchThreadPool & QueryResources::GetMatchThreadPool(ISimpleIndex const & index,
+                                                         size_t threadCount)
+    {
+        if (m_sharedMatchThreadPool != nullptr)
+        {
+            return *m_sharedMatchThreadPool;
+        }
+
+        // m_matchThreadNodes keeps its capacity, so that checking the nodes
+        // of the index does not allocate once the pool exists.
+        GetShardNodes(index, m_matchThreadNodes);
+
+        // The pool's threads are bound to the nodes of the index it was
+        // created for, so a different set of nodes needs a new pool.
+        bool isSameNodes = (m_matchThreadPool != nullptr) &&
+            (m_matchThreadPool->GetNumaNodes().size() == m_matchThreadNodes.size());
+        if (isSameNodes)
+        {
+            auto const & poolNodes = m_matchThreadPool->GetNumaNodes();
+            for (auto node : m_matchThreadNodes)
+            {
+                if (std::find(poolNodes.begin(), poolNodes.end(), node) == poolNodes.end())
+                {
+                    isSameNodes = false;
+                    break;
+                }
+            }
+        }
+
+        if (!isSameNodes || m_matchThreadCount != threadCount)
+        {
+            // Destroy the old pool first so that its threads are not
+            // running alongside the new ones.
+            m_matchThreadPool.reset();
+            m_matchThreadPool.reset(new MatchThreadPool(m_matchThreadNodes,
+                                                        threadCount));
+            m_matchThreadCount = threadCount;
+        }
+
+        return *m_matchThreadPool;
+    }
+
+
     void QueryResources::Reset()
     {
         m_matchTreeAllocator->Reset();
-        m_expressionTreeAllocator->Reset();
-        // WARNING: Do not reset m_codeAllocator. It is used to provision m_code.
-        m_code->Reset();
+        if (m_code != nullptr)
+        {
+            m_expressionTreeAllocator->Reset();
+            // WARNING: Do not reset m_codeAllocator. It is used to provision m_code.
+            m_code->Reset();
+        }
         if (m_cacheLineRecorder != nullptr)
         {
             m_cacheLineRecorder->Reset();
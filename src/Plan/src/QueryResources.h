@@ -23,9 +23,13 @@
 #pragma once
 
 #include <memory>                               // std::unique_ptr embedded.
+#include <vector>                               // std::vector embedded.
 
 #include "BitFunnel/Allocators/IAllocator.h"    // Template parameter.
+#include "ByteCodeInterpreter.h"                // ByteCodeGenerator embedded.
 #include "CacheLineRecorder.h"                  // Template parameter.
+#include "MatchFilter.h"                        // Template parameter.
+#include "MatchThreadPool.h"                    // Template parameter.
 #include "NativeJIT/CodeGen/ExecutionBuffer.h"  // Template parameter.
 #include "NativeJIT/CodeGen/FunctionBuffer.h"   // Template parameter.
 #include "Temporary/Allocator.h"                // Template parameter.
@@ -33,16 +37,50 @@
 
 namespace BitFunnel
 {
+    class CompiledPlanCache;
     class ISimpleIndex;
+    class RowDensityTable;
 
     class QueryResources
     {
     public:
+        // A codeAllocatorBytes of zero creates resources for the byte code
+        // path only, such as the slots of a QueryBatch. They have no
+        // expression tree allocator and no code buffers, so they cannot be
+        // used to compile native code.
         QueryResources(size_t treeAllocatorBytes = 1ull << 16,
                        size_t codeAllocatorBytes = 1ull << 16);
 
         void EnableCacheLineCounting(ISimpleIndex const & index);
 
+        // Verifies matches against the index's ForwardIndex and removes the
+        // false positives. Throws if the index has no ForwardIndex.
+        void EnableMatchFiltering(ISimpleIndex const & index);
+
+        // Returns the worker threads for matching a query on threadCount
+        // threads. If a shared pool was set with SetMatchThreadPool(), it is
+        // returned. Otherwise these QueryResources own a pool, which is
+        // created on first use, with threads for the NUMA nodes of the
+        // index's shards, and is then reused by later queries. It is
+        // recreated if threadCount or the set of nodes changes.
+        MatchThreadPool & GetMatchThreadPool(ISimpleIndex const & index,
+                                             size_t threadCount);
+
+        // Creates a pool of threadCount threads for the NUMA nodes of the
+        // index's shards, to be shared by the QueryResources of several
+        // query threads.
+        static std::unique_ptr<MatchThreadPool>
+            CreateMatchThreadPool(ISimpleIndex const & index,
+                                  size_t threadCount);
+
+        // Like the CompiledPlanCache, a shared MatchThreadPool is not owned
+        // by QueryResources. It must have been created for the index that
+        // is queried, with the thread count passed to GetMatchThreadPool().
+        void SetMatchThreadPool(MatchThreadPool * pool)
+        {
+            m_sharedMatchThreadPool = pool;
+        }
+
         virtual void Reset();
 
         IAllocator & GetMatchTreeAllocator() const
@@ -65,16 +103,138 @@ namespace BitFunnel
             return *m_code;
         }
 
+        // The byte code path regenerates its code into this generator for
+        // each query.
+        ByteCodeGenerator & GetByteCodeGenerator()
+        {
+            return m_byteCodeGenerator;
+        }
+
+        // Virtual machine stacks for byte code interpreters running on the
+        // thread that owns these QueryResources.
+        ByteCodeInterpreter::Stacks & GetByteCodeStacks()
+        {
+            return m_byteCodeStacks;
+        }
+
+        // Holds the slice buffers that remain after slice pruning. Reused
+        // so that it keeps its capacity from one query to the next.
+        std::vector<void*> & GetPrunedSlices()
+        {
+            return m_prunedSlices;
+        }
+
         CacheLineRecorder* GetCacheLineRecorder() const
         {
             return m_cacheLineRecorder.get();
         }
 
+        // Null unless EnableMatchFiltering() was called.
+        MatchFilter* GetMatchFilter() const
+        {
+            return m_matchFilter.get();
+        }
+
+        // The CompiledPlanCache is shared by the QueryResources of all
+        // threads and is not owned by QueryResources. When no cache is set,
+        // each query is compiled into the code buffer returned by GetCode().
+        void SetPlanCache(CompiledPlanCache * cache)
+        {
+            m_planCache = cache;
+        }
+
+        CompiledPlanCache * GetPlanCache() const
+        {
+            return m_planCache;
+        }
+
+        // Like the CompiledPlanCache, the RowDensityTable is shared by the
+        // QueryResources of all threads and is not owned by QueryResources.
+        // When a table is set, the planner orders rows of equal rank from
+        // sparsest to densest. Otherwise rows are ordered by rank alone.
+        void SetDensityTable(RowDensityTable * table)
+        {
+            m_densityTable = table;
+        }
+
+        RowDensityTable * GetDensityTable() const
+        {
+            return m_densityTable;
+        }
+
+        // While matching slice i, the matcher prefetches the first cache
+        // line of each plan row of slice i + distance. A distance of zero
+        // disables prefetching.
+        void SetPrefetchDistance(size_t distance)
+        {
+            m_prefetchDistance = distance;
+        }
+
+        size_t GetPrefetchDistance() const
+        {
+            return m_prefetchDistance;
+        }
+
+        static const size_t c_defaultPrefetchDistance = 1;
+
+        // When slice pruning is enabled, which is the default, the matcher
+        // skips slices where the row summary bits show that the query
+        // cannot match.
+        void SetSlicePruning(bool enabled)
+        {
+            m_slicePruning = enabled;
+        }
+
+        bool GetSlicePruning() const
+        {
+            return m_slicePruning;
+        }
+
+        // Limits on the work done by each query. Matching stops before the
+        // first slice that starts after the query has run for timeBudget
+        // seconds, or after it has scanned quadwordBudget quadwords at the
+        // plan's initial rank. The query then reports partial results and
+        // is flagged as timed out in its QueryInstrumentation. A budget of
+        // zero is unlimited.
+        void SetTimeBudget(double seconds)
+        {
+            m_timeBudget = seconds;
+        }
+
+        double GetTimeBudget() const
+        {
+            return m_timeBudget;
+        }
+
+        void SetQuadwordBudget(size_t quadwords)
+        {
+            m_quadwordBudget = quadwords;
+        }
+
+        size_t GetQuadwordBudget() const
+        {
+            return m_quadwordBudget;
+        }
+
     private:
         std::unique_ptr<IAllocator> m_matchTreeAllocator;
         std::unique_ptr<NativeJIT::Allocator> m_expressionTreeAllocator;
         std::unique_ptr<NativeJIT::ExecutionBuffer> m_codeAllocator;
         std::unique_ptr<NativeJIT::FunctionBuffer> m_code;
         std::unique_ptr<CacheLineRecorder> m_cacheLineRecorder;
+        std::unique_ptr<MatchFilter> m_matchFilter;
+        std::unique_ptr<MatchThreadPool> m_matchThreadPool;
+        MatchThreadPool * m_sharedMatchThreadPool;
+        size_t m_matchThreadCount;
+        std::vector<unsigned> m_matchThreadNodes;
+        ByteCodeGenerator m_byteCodeGenerator;
+        ByteCodeInterpreter::Stacks m_byteCodeStacks;
+        std::vector<void*> m_prunedSlices;
+        CompiledPlanCache * m_planCache;
+        RowDensityTable * m_densityTable;
+        size_t m_prefetchDistance;
+        bool m_slicePruning;
+        double m_timeBudget;
+        size_t m_quadwordBudget;
     };
 }
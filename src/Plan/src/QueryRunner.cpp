@@ -20,13 +20,16 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>
 #include <condition_variable>
 #include <iostream>             // Used for DiagnosticStream ref; not actually used.
 
 #include "BitFunnel/Configuration/Factories.h"
 #include "BitFunnel/Configuration/IStreamConfiguration.h"
+#include "BitFunnel/Exceptions.h"
 #include "BitFunnel/IDiagnosticStream.h"
 #include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/IShard.h"
 #include "BitFunnel/Index/ISimpleIndex.h"
 #include "BitFunnel/Plan/Factories.h"
 #include "BitFunnel/Plan/QueryInstrumentation.h"
@@ -34,9 +37,14 @@
 #include "BitFunnel/Plan/QueryRunner.h"
 #include "BitFunnel/Utilities/Factories.h"
 #include "BitFunnel/Utilities/Allocator.h"
+#include "CompiledPlanCache.h"
 #include "CsvTsv/Csv.h"
+#include "QueryBatch.h"
+#include "QueryDeadline.h"
 #include "QueryResources.h"
 #include "ResultsBuffer.h"
+#include "RowDensityTable.h"
+#include "TopKResults.h"
 
 
 namespace BitFunnel
@@ -46,18 +54,28 @@ namespace BitFunnel
         size_t uniqueQueryCount,
         size_t processedCount,
         size_t matchCount,
+        size_t retainedCount,
         double elapsedTime,
         double parsingTime,
         double planningTime,
-        double matchingTime)
+        double matchingTime,
+        size_t planCacheHitCount,
+        size_t planCacheMissCount,
+        size_t timedOutCount,
+        size_t falsePositiveCount)
       : m_threadCount(threadCount),
         m_uniqueQueryCount(uniqueQueryCount),
         m_processedCount(processedCount),
         m_matchCount(matchCount),
+        m_retainedCount(retainedCount),
         m_elapsedTime(elapsedTime),
         m_parsingLatency(parsingTime),
         m_planningLatency(planningTime),
-        m_matchingLatency(matchingTime)
+        m_matchingLatency(matchingTime),
+        m_planCacheHitCount(planCacheHitCount),
+        m_planCacheMissCount(planCacheMissCount),
+        m_timedOutCount(timedOutCount),
+        m_falsePositiveCount(falsePositiveCount)
     {
     }
 
@@ -78,6 +96,7 @@ namespace BitFunnel
             << "Unique queries: " << m_uniqueQueryCount << std::endl
             << "Queries processed: " << m_processedCount << std::endl
             << "Match count: " << m_matchCount << std::endl
+            << "Retained count: " << m_retainedCount << std::endl
             << "Elapsed time: " << m_elapsedTime << std::endl
             << "Total parsing latency: " << m_parsingLatency << std::endl
             << "Total planning latency: " << m_planningLatency << std::endl
@@ -86,7 +105,11 @@ namespace BitFunnel
             << "Planning overhead: " << overheadLatency / totalLatency << std::endl
             << "QPS: " << m_processedCount / m_elapsedTime << std::endl
             << "MPS: " << m_matchCount / m_elapsedTime << std::endl
-            << "MPQ: " << static_cast<double>(m_matchCount) / m_processedCount << std::endl;
+            << "MPQ: " << static_cast<double>(m_matchCount) / m_processedCount << std::endl
+            << "Plan cache hits: " << m_planCacheHitCount << std::endl
+            << "Plan cache misses: " << m_planCacheMissCount << std::endl
+            << "Timed out queries: " << m_timedOutCount << std::endl
+            << "False positives removed: " << m_falsePositiveCount << std::endl;
     }
 
 
@@ -152,6 +175,43 @@ namespace BitFunnel
     }
 
 
+    // Returns the largest slice capacity over all shards. In top-k mode, the
+    // ResultsBuffer only needs to hold the matches from a single slice.
+    static size_t GetMaxSliceCapacity(ISimpleIndex const & index)
+    {
+        size_t capacity = 0;
+        for (ShardId shard = 0; shard < index.GetIngestor().GetShardCount(); ++shard)
+        {
+            capacity = (std::max)(capacity,
+                                  static_cast<size_t>(index.GetIngestor().GetShard(shard).GetSliceCapacity()));
+        }
+        return capacity;
+    }
+
+
+    static_assert(QueryRunner::c_noScoreBlob == TopKResults::c_noScoreBlob,
+                  "QueryRunner and TopKResults must agree on c_noScoreBlob.");
+
+
+    // Returns the scoring stage for top-k mode, or nullptr when topK is zero
+    // and every match is retained.
+    static TopKResults * CreateTopKResults(size_t topK,
+                                           FixedSizeBlobId scoreBlob,
+                                           float maxScore)
+    {
+        if (topK == 0)
+        {
+            return nullptr;
+        }
+
+        // Without a score blob, every match scores zero, so the first k
+        // matches fill the heap and the query stops.
+        return new TopKResults(topK,
+                               scoreBlob,
+                               (scoreBlob == TopKResults::c_noScoreBlob) ? 0.0f : maxScore);
+    }
+
+
     //*************************************************************************
     //
     // QueryProcessor
@@ -164,19 +224,33 @@ namespace BitFunnel
                        IStreamConfiguration const & config,
                        std::vector<std::string> const & queries,
                        std::vector<QueryInstrumentation::Data> & results,
-                       size_t maxResultCount,
+                       size_t topK,
+                       FixedSizeBlobId scoreBlob,
+                       float maxScore,
+                       size_t matchThreadCount,
+                       size_t prefetchDistance,
+                       double timeBudget,
+                       size_t quadwordBudget,
+                       size_t batchSize,
                        bool useNativeCode,
                        bool countCacheLines,
+                       CompiledPlanCache * planCache,
+                       RowDensityTable * densityTable,
+                       MatchThreadPool * matchThreadPool,
                        ThreadSynchronizer& synchronizer);
 
         //
         // ITaskProcessor methods
         //
 
+        // When the batch size is greater than one, task i processes queries
+        // i * batchSize through (i + 1) * batchSize - 1 as a QueryBatch.
         virtual void ProcessTask(size_t taskId) override;
         virtual void Finished() override;
 
     private:
+        void ProcessBatch(size_t taskId);
+
         //
         // constructor parameters
         //
@@ -184,22 +258,38 @@ namespace BitFunnel
         IStreamConfiguration const & m_config;
         std::vector<std::string> const & m_queries;
         std::vector<QueryInstrumentation::Data> & m_results;
+        size_t m_matchThreadCount;
         bool m_useNativeCode;
         ThreadSynchronizer& m_synchronizer;
 
-        std::vector<ResultsBuffer::Result> m_matches;
+        // Scoring stage for top-k mode. Null when every match is retained.
+        std::unique_ptr<TopKResults> m_topK;
 
+        // In top-k mode, holds the matches for a single slice. Otherwise
+        // holds all of the matches for a query.
         ResultsBuffer m_resultsBuffer;
 
         QueryResources m_resources;
 
         size_t m_queriesProcessed;
 
-        // TODO: Issue #390. Trec 2006 Efficiency Topic 43860 is too bit for
-        // c_allocatorSize == 1ull << 17 when using TreatmentClassicBitsliced:
-        //     the nps air quality monitoring program provides information on ozone
-        //     levels acid rain and visibility impairment in parks from 1990 1999
-        //     of the 28 parks that were monitored for visibility
+        // Each query in a batch keeps its plan and results until the batch
+        // has run, so it gets its own resources. Empty unless the batch size
+        // is greater than one.
+        size_t m_batchSize;
+        std::unique_ptr<QueryBatch> m_batch;
+        std::vector<std::unique_ptr<QueryResources>> m_batchResources;
+        std::vector<std::unique_ptr<ResultsBuffer>> m_batchResults;
+        std::vector<std::unique_ptr<TopKResults>> m_batchTopK;
+        std::vector<QueryInstrumentation> m_batchInstrumentation;
+
+        // Diagnostics are disabled unless explicitly enabled. Created once
+        // so that queries do not allocate a stream each.
+        std::unique_ptr<IDiagnosticStream> m_diagnosticStream;
+
+        // Initial size of the match tree arena, which grows as long queries
+        // require. The NativeJIT expression tree allocator and code buffer
+        // are fixed at this size.
         static const size_t c_allocatorSize = 1ull << 17;
     };
 
@@ -208,25 +298,75 @@ namespace BitFunnel
                                    IStreamConfiguration const & config,
                                    std::vector<std::string> const & queries,
                                    std::vector<QueryInstrumentation::Data> & results,
-                                   size_t maxResultCount,
+                                   size_t topK,
+                                   FixedSizeBlobId scoreBlob,
+                                   float maxScore,
+                                   size_t matchThreadCount,
+                                   size_t prefetchDistance,
+                                   double timeBudget,
+                                   size_t quadwordBudget,
+                                   size_t batchSize,
                                    bool useNativeCode,
                                    bool countCacheLines,
+                                   CompiledPlanCache * planCache,
+                                   RowDensityTable * densityTable,
+                                   MatchThreadPool * matchThreadPool,
                                    ThreadSynchronizer& synchronizer)
       : m_index(index),
         m_config(config),
         m_queries(queries),
         m_results(results),
+        m_matchThreadCount(matchThreadCount),
         m_useNativeCode(useNativeCode),
         m_synchronizer(synchronizer),
-        m_matches(maxResultCount, {nullptr, 0}),
-        m_resultsBuffer(index.GetIngestor().GetDocumentCount()),
+        m_topK(CreateTopKResults(topK, scoreBlob, maxScore)),
+        m_resultsBuffer((topK == 0) ?
+                        index.GetIngestor().GetDocumentCount() :
+                        GetMaxSliceCapacity(index)),
         m_resources(c_allocatorSize, c_allocatorSize),
-        m_queriesProcessed(0)
+        m_queriesProcessed(0),
+        m_batchSize(batchSize),
+        m_diagnosticStream(Factories::CreateDiagnosticStream(std::cout))
     {
         if (countCacheLines)
         {
             m_resources.EnableCacheLineCounting(index);
         }
+        m_resources.SetPlanCache(planCache);
+        m_resources.SetDensityTable(densityTable);
+        m_resources.SetMatchThreadPool(matchThreadPool);
+        m_resources.SetPrefetchDistance(prefetchDistance);
+        m_resources.SetTimeBudget(timeBudget);
+        m_resources.SetQuadwordBudget(quadwordBudget);
+        if (index.GetForwardIndex() != nullptr)
+        {
+            m_resources.EnableMatchFiltering(index);
+        }
+
+        if (m_batchSize > 1)
+        {
+            m_batch.reset(new QueryBatch(index, prefetchDistance));
+            for (size_t i = 0; i < m_batchSize; ++i)
+            {
+                // Batched queries always run as byte code.
+                m_batchResources.emplace_back(
+                    new QueryResources(c_allocatorSize, 0));
+                m_batchResources.back()->SetTimeBudget(timeBudget);
+                m_batchResources.back()->SetQuadwordBudget(quadwordBudget);
+                m_batchResources.back()->SetDensityTable(densityTable);
+                if (index.GetForwardIndex() != nullptr)
+                {
+                    m_batchResources.back()->EnableMatchFiltering(index);
+                }
+                m_batchResults.emplace_back(
+                    new ResultsBuffer((topK == 0) ?
+                                      index.GetIngestor().GetDocumentCount() :
+                                      GetMaxSliceCapacity(index)));
+                m_batchTopK.emplace_back(
+                    CreateTopKResults(topK, scoreBlob, maxScore));
+            }
+            m_batchInstrumentation.resize(m_batchSize);
+        }
     }
 
 
@@ -239,6 +379,12 @@ namespace BitFunnel
         }
         ++m_queriesProcessed;
 
+        if (m_batch != nullptr)
+        {
+            ProcessBatch(taskId);
+            return;
+        }
+
         QueryInstrumentation instrumentation;
         m_resources.Reset();
 
@@ -250,23 +396,68 @@ namespace BitFunnel
         auto tree = parser.Parse();
         instrumentation.FinishParsing();
 
-        // TODO: remove diagnosticStream and replace with nullable.
-        auto diagnosticStream = Factories::CreateDiagnosticStream(std::cout);
         if (tree != nullptr)
         {
             Factories::RunQueryPlanner(*tree,
                                        m_index,
                                        m_resources,
-                                       *diagnosticStream,
+                                       *m_diagnosticStream,
                                        instrumentation,
                                        m_resultsBuffer,
-                                       m_useNativeCode);
+                                       m_useNativeCode,
+                                       m_topK.get(),
+                                       m_matchThreadCount);
         }
 
         m_results[taskId] = instrumentation.GetData();
     }
 
 
+    void QueryProcessor::ProcessBatch(size_t taskId)
+    {
+        const size_t first = taskId * m_batchSize;
+        const size_t count = (std::min)(m_batchSize, m_results.size() - first);
+
+        m_batch->Reset();
+        for (size_t i = 0; i < count; ++i)
+        {
+            QueryInstrumentation & instrumentation = m_batchInstrumentation[i];
+            instrumentation = QueryInstrumentation();
+
+            QueryResources & resources = *m_batchResources[i];
+            resources.Reset();
+
+            const size_t queryId = (first + i) % m_queries.size();
+            QueryParser parser(m_queries[queryId].c_str(),
+                               m_config,
+                               resources.GetMatchTreeAllocator());
+            auto tree = parser.Parse();
+            instrumentation.FinishParsing();
+
+            if (tree != nullptr)
+            {
+                Factories::RunQueryPlanner(*tree,
+                                           m_index,
+                                           resources,
+                                           *m_diagnosticStream,
+                                           instrumentation,
+                                           *m_batchResults[i],
+                                           false,
+                                           m_batchTopK[i].get(),
+                                           1,
+                                           m_batch.get());
+            }
+        }
+
+        m_batch->Run();
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            m_results[first + i] = m_batchInstrumentation[i].GetData();
+        }
+    }
+
+
     void QueryProcessor::Finished()
     {
     }
@@ -280,7 +471,15 @@ namespace BitFunnel
         char const * query,
         ISimpleIndex const & index,
         bool useNativeCode,
-        bool countCacheLines)
+        bool countCacheLines,
+        size_t topK,
+        FixedSizeBlobId scoreBlob,
+        float maxScore,
+        size_t matchThreadCount,
+        size_t prefetchDistance,
+        double timeBudget,
+        size_t quadwordBudget,
+        bool orderByDensity)
     {
         std::vector<std::string> queries;
         queries.push_back(std::string(query));
@@ -289,18 +488,32 @@ namespace BitFunnel
 
         auto config = Factories::CreateStreamConfiguration();
 
-        size_t maxResultCount = index.GetIngestor().GetDocumentCount();
-
         ThreadSynchronizer synchronizer(1);
 
+        std::unique_ptr<RowDensityTable> densityTable;
+        if (orderByDensity)
+        {
+            densityTable.reset(new RowDensityTable(index));
+        }
+
         QueryProcessor
             processor(index,
                       *config,
                       queries,
                       results,
-                      maxResultCount,
+                      topK,
+                      scoreBlob,
+                      maxScore,
+                      matchThreadCount,
+                      prefetchDistance,
+                      timeBudget,
+                      quadwordBudget,
+                      1,
                       useNativeCode,
                       countCacheLines,
+                      nullptr,
+                      densityTable.get(),
+                      nullptr,
                       synchronizer);
         processor.ProcessTask(0);
         processor.Finished();
@@ -316,16 +529,61 @@ namespace BitFunnel
         std::vector<std::string> const & queries,
         size_t iterations,
         bool useNativeCode,
-        bool countCacheLines)
+        bool countCacheLines,
+        size_t topK,
+        FixedSizeBlobId scoreBlob,
+        float maxScore,
+        size_t matchThreadCount,
+        size_t prefetchDistance,
+        double timeBudget,
+        size_t quadwordBudget,
+        size_t batchSize,
+        bool orderByDensity)
     {
+        if (batchSize > 1 && useNativeCode)
+        {
+            RecoverableError error("Query batches require the byte code interpreter.");
+            throw error;
+        }
+        batchSize = (std::max)(batchSize, static_cast<size_t>(1));
+
         std::vector<QueryInstrumentation::Data> results(queries.size() * iterations);
 
         auto config = Factories::CreateStreamConfiguration();
 
-        size_t maxResultCount = index.GetIngestor().GetDocumentCount();
-
         ThreadSynchronizer synchronizer(threadCount);
 
+        // Repeated queries with the same plan shape share a single compiled
+        // matcher across all threads.
+        std::unique_ptr<CompiledPlanCache> planCache;
+        if (useNativeCode)
+        {
+            planCache.reset(new CompiledPlanCache());
+        }
+
+        // Density estimates are shared by all threads and iterations.
+        std::unique_ptr<RowDensityTable> densityTable;
+        if (orderByDensity)
+        {
+            densityTable.reset(new RowDensityTable(index));
+        }
+
+        // All query threads share one set of match threads, rather than
+        // starting matchThreadCount threads each.
+        std::unique_ptr<MatchThreadPool> matchThreadPool;
+        if (matchThreadCount > 1 && batchSize == 1)
+        {
+            matchThreadPool =
+                QueryResources::CreateMatchThreadPool(index, matchThreadCount);
+        }
+
+        // Calibrate the time stamp counter now, rather than in the first
+        // query's deadline.
+        if (timeBudget > 0.0)
+        {
+            QueryDeadline::Calibrate();
+        }
+
         std::vector<std::unique_ptr<ITaskProcessor>> processors;
         for (size_t i = 0; i < threadCount; ++i) {
             processors.push_back(
@@ -334,15 +592,25 @@ namespace BitFunnel
                                        *config,
                                        queries,
                                        results,
-                                       maxResultCount,
+                                       topK,
+                                       scoreBlob,
+                                       maxScore,
+                                       matchThreadCount,
+                                       prefetchDistance,
+                                       timeBudget,
+                                       quadwordBudget,
+                                       batchSize,
                                        useNativeCode,
                                        countCacheLines,
+                                       planCache.get(),
+                                       densityTable.get(),
+                                       matchThreadPool.get(),
                                        synchronizer)));
         }
 
         auto distributor =
             Factories::CreateTaskDistributor(processors,
-                                             queries.size() * iterations);
+                                             (results.size() + batchSize - 1) / batchSize);
 
         distributor->WaitForCompletion();
         double elapsedTime = synchronizer.GetElapsedTime();
@@ -353,15 +621,28 @@ namespace BitFunnel
 
         size_t queriesProcessed = 0;
         size_t matchCount = 0;
+        size_t retainedCount = 0;
+        size_t planCacheHitCount = 0;
+        size_t planCacheMissCount = 0;
+        size_t timedOutCount = 0;
+        size_t falsePositiveCount = 0;
         for (auto result : results)
         {
             if (result.GetRowCount() > 0)
             {
                 ++queriesProcessed;
                 matchCount += result.GetMatchCount();
+                retainedCount += result.GetRetainedCount();
+                falsePositiveCount += result.GetFalsePositiveCount();
                 totalParsingTime += result.GetParsingTime();
                 totalPlanningTime += result.GetPlanningTime();
                 totalMatchingTime += result.GetMatchingTime();
+                planCacheHitCount += result.GetPlanCacheHitCount();
+                planCacheMissCount += result.GetPlanCacheMissCount();
+                if (result.GetTimedOut())
+                {
+                    ++timedOutCount;
+                }
             }
         }
 
@@ -369,10 +650,15 @@ namespace BitFunnel
                                                 queries.size(),
                                                 queriesProcessed,
                                                 matchCount,
+                                                retainedCount,
                                                 elapsedTime,
                                                 totalParsingTime,
                                                 totalPlanningTime,
-                                                totalMatchingTime));
+                                                totalMatchingTime,
+                                                planCacheHitCount,
+                                                planCacheMissCount,
+                                                timedOutCount,
+                                                falsePositiveCount));
 
         {
             std::cout << "Writing results ..." << std::endl;
@@ -0,0 +1,152 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <nmmintrin.h>  // For _mm_popcnt_u64.
+#include <vector>
+
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/IShard.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Index/Token.h"
+#include "IPlanRows.h"
+#include "RowDensityTable.h"
+
+
+namespace BitFunnel
+{
+    // Packs the shard and the fields of the RowId into a map key.
+    static uint64_t GetKey(ShardId shard, RowId row)
+    {
+        return (static_cast<uint64_t>(shard) << 32) |
+               (static_cast<uint64_t>(row.IsAdhoc() ? 1 : 0) << 31) |
+               (static_cast<uint64_t>(row.GetRank()) << c_log2MaxRowIndexValue) |
+               static_cast<uint64_t>(row.GetIndex());
+    }
+
+
+    RowDensityTable::RowDensityTable(ISimpleIndex const & index)
+      : m_index(index),
+        m_buckets(new Bucket[c_bucketCount]),
+        m_estimateCount(0)
+    {
+    }
+
+
+    void RowDensityTable::GetDensities(IPlanRows const & planRows,
+                                       ShardId shard,
+                                       double * densities)
+    {
+        // Hold a token while reading the shard's slice buffers.
+        auto token = m_index.GetIngestor().GetTokenManager().RequestToken();
+
+        for (unsigned id = 0; id < planRows.GetRowCount(); ++id)
+        {
+            densities[id] = GetDensityInternal(shard,
+                                               planRows.PhysicalRow(shard, id));
+        }
+    }
+
+
+    double RowDensityTable::GetDensity(ShardId shard, RowId row)
+    {
+        auto token = m_index.GetIngestor().GetTokenManager().RequestToken();
+        return GetDensityInternal(shard, row);
+    }
+
+
+    size_t RowDensityTable::GetEstimateCount() const
+    {
+        return m_estimateCount;
+    }
+
+
+    double RowDensityTable::GetDensityInternal(ShardId shard, RowId row)
+    {
+        IShard const & s = m_index.GetIngestor().GetShard(shard);
+        std::vector<void*> const & buffers = s.GetSliceBuffers();
+        const size_t sliceCount = buffers.size();
+
+        const uint64_t key = GetKey(shard, row);
+        Bucket & bucket = m_buckets[key % c_bucketCount];
+
+        {
+            std::lock_guard<std::mutex> lock(bucket.m_lock);
+            auto it = bucket.m_entries.find(key);
+            if (it != bucket.m_entries.end())
+            {
+                const size_t previous = it->second.m_sliceCount;
+                const size_t change = (sliceCount > previous) ?
+                    sliceCount - previous :
+                    previous - sliceCount;
+                if (change * c_refreshDivisor <= previous)
+                {
+                    return it->second.m_density;
+                }
+            }
+        }
+
+        // Estimate outside of the lock. Should two threads estimate the same
+        // row, the later estimate wins.
+        const double density = Estimate(s, row, buffers);
+        ++m_estimateCount;
+
+        std::lock_guard<std::mutex> lock(bucket.m_lock);
+        bucket.m_entries[key] = Entry { density, sliceCount };
+        return density;
+    }
+
+
+    double RowDensityTable::Estimate(IShard const & shard,
+                                     RowId row,
+                                     std::vector<void*> const & buffers)
+    {
+        const size_t sliceCount = buffers.size();
+
+        const size_t quadwordCount =
+            shard.GetSliceCapacity() >> 6 >> row.GetRank();
+        if (sliceCount == 0 || quadwordCount == 0)
+        {
+            return 0.0;
+        }
+
+        const ptrdiff_t offset = shard.GetRowOffset(row);
+        const size_t sampleCount = (std::min)(sliceCount,
+                                                static_cast<size_t>(c_sampleSliceCount));
+
+        size_t setBitCount = 0;
+        for (size_t i = 0; i < sampleCount; ++i)
+        {
+            char const * buffer =
+                static_cast<char const *>(buffers[i * sliceCount / sampleCount]);
+            uint64_t const * quadwords =
+                reinterpret_cast<uint64_t const *>(buffer + offset);
+            for (size_t q = 0; q < quadwordCount; ++q)
+            {
+                setBitCount += static_cast<size_t>(_mm_popcnt_u64(quadwords[q]));
+            }
+        }
+
+        return static_cast<double>(setBitCount) /
+               static_cast<double>(sampleCount * quadwordCount * 64);
+    }
+}
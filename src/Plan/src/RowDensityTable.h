@@ -0,0 +1,117 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <atomic>                       // std::atomic embedded.
+#include <memory>                       // std::unique_ptr embedded.
+#include <mutex>                        // std::mutex embedded.
+#include <stddef.h>                     // size_t parameter.
+#include <stdint.h>                     // uint64_t map key.
+#include <unordered_map>                // std::unordered_map embedded.
+#include <vector>                       // std::vector parameter.
+
+#include "BitFunnel/BitFunnelTypes.h"   // ShardId parameter.
+#include "BitFunnel/Index/RowId.h"      // RowId parameter.
+#include "BitFunnel/NonCopyable.h"      // Base class.
+
+
+namespace BitFunnel
+{
+    class IPlanRows;
+    class IShard;
+    class ISimpleIndex;
+
+    //*************************************************************************
+    //
+    // RowDensityTable
+    //
+    // A thread-safe cache of bit density estimates for the physical rows of
+    // an index, shared by the queries running against it. The QueryPlanner
+    // uses the estimates to intersect the sparsest rows of each rank first,
+    // so that the byte code's jumps on zero skip the remaining rows sooner.
+    //
+    // A row's density is estimated on first use by counting its bits in up
+    // to c_sampleSliceCount slices spread evenly across its shard. The
+    // estimate records the shard's slice count, and is recomputed the next
+    // time it is used after the slice count has changed by more than one
+    // part in c_refreshDivisor. Refreshes are therefore incremental: only
+    // the rows that queries actually use are re-estimated, one at a time.
+    //
+    // Estimates include unused and expired columns, so they are only
+    // meaningful relative to other rows of the same rank in the same shard.
+    //
+    //*************************************************************************
+    class RowDensityTable : public NonCopyable
+    {
+    public:
+        RowDensityTable(ISimpleIndex const & index);
+
+        // Writes the estimated density of each of the plan's rows in shard
+        // to densities, which is indexed by abstract row id and must have
+        // room for planRows.GetRowCount() values.
+        void GetDensities(IPlanRows const & planRows,
+                          ShardId shard,
+                          double * densities);
+
+        // Returns the estimated density of row in shard.
+        double GetDensity(ShardId shard, RowId row);
+
+        // Returns the number of estimates made so far, including refreshes.
+        // For tests and diagnostics.
+        size_t GetEstimateCount() const;
+
+        static const size_t c_sampleSliceCount = 16;
+        static const size_t c_refreshDivisor = 8;
+
+    private:
+        // Returns the cached estimate for row in shard, making a new one
+        // when there is none or it is stale. The caller must hold a token.
+        double GetDensityInternal(ShardId shard, RowId row);
+
+        // Counts row's bits in a sample of the shard's slice buffers. The
+        // caller must hold a token.
+        static double Estimate(IShard const & shard,
+                               RowId row,
+                               std::vector<void*> const & buffers);
+
+        struct Entry
+        {
+            double m_density;
+            size_t m_sliceCount;
+        };
+
+        // Entries are spread over buckets with their own locks so that
+        // planning threads rarely contend.
+        struct Bucket
+        {
+            std::mutex m_lock;
+            std::unordered_map<uint64_t, Entry> m_entries;
+        };
+
+        static const size_t c_bucketCount = 64;
+
+        ISimpleIndex const & m_index;
+        std::unique_ptr<Bucket[]> m_buckets;
+        std::atomic<size_t> m_estimateCount;
+    };
+}
@@ -0,0 +1,174 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <stdint.h>
+
+#include "BitFunnel/Allocators/IAllocator.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/IShard.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
+#include "IPlanRows.h"
+#include "RowMatchNode.h"
+#include "SlicePruner.h"
+
+
+namespace BitFunnel
+{
+    SlicePruner::SlicePruner(RowMatchNode const & tree,
+                             IPlanRows const & planRows,
+                             ISimpleIndex const & index,
+                             IAllocator & allocator)
+        : m_tree(tree),
+          m_rowCount(planRows.GetRowCount()),
+          m_isEnabled(IsPrunable(tree)),
+          m_summaryBits(nullptr)
+    {
+        const ShardId shardCount = planRows.GetShardCount();
+        m_summaryBits = static_cast<ptrdiff_t*>(
+            allocator.Allocate(sizeof(ptrdiff_t) * shardCount * m_rowCount));
+
+        for (ShardId shardId = 0; shardId < shardCount; ++shardId)
+        {
+            IShard const & shard = index.GetIngestor().GetShard(shardId);
+            for (unsigned id = 0; id < m_rowCount; ++id)
+            {
+                const ptrdiff_t bit =
+                    shard.GetRowSummaryBit(planRows.PhysicalRow(shardId, id));
+                if (bit < 0)
+                {
+                    m_isEnabled = false;
+                }
+                m_summaryBits[shardId * m_rowCount + id] = bit;
+            }
+        }
+    }
+
+
+    bool SlicePruner::IsEnabled() const
+    {
+        return m_isEnabled;
+    }
+
+
+    bool SlicePruner::CanMatch(ShardId shard, void const * sliceBuffer) const
+    {
+        return !m_isEnabled ||
+            CanMatch(m_tree, m_summaryBits + shard * m_rowCount, sliceBuffer);
+    }
+
+
+    size_t SlicePruner::Prune(ShardId shard,
+                              void * const * sliceBuffers,
+                              size_t sliceCount,
+                              void ** pruned) const
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < sliceCount; ++i)
+        {
+            if (CanMatch(shard, sliceBuffers[i]))
+            {
+                pruned[count++] = sliceBuffers[i];
+            }
+        }
+        return count;
+    }
+
+
+    bool SlicePruner::CanMatch(RowMatchNode const & node,
+                               ptrdiff_t const * summaryBits,
+                               void const * sliceBuffer) const
+    {
+        switch (node.GetType())
+        {
+        case RowMatchNode::AndMatch:
+            {
+                RowMatchNode::And const & andNode =
+                    dynamic_cast<RowMatchNode::And const &>(node);
+                return CanMatch(andNode.GetLeft(), summaryBits, sliceBuffer)
+                    && CanMatch(andNode.GetRight(), summaryBits, sliceBuffer);
+            }
+        case RowMatchNode::OrMatch:
+            {
+                RowMatchNode::Or const & orNode =
+                    dynamic_cast<RowMatchNode::Or const &>(node);
+                return CanMatch(orNode.GetLeft(), summaryBits, sliceBuffer)
+                    || CanMatch(orNode.GetRight(), summaryBits, sliceBuffer);
+            }
+        case RowMatchNode::ReportMatch:
+            {
+                RowMatchNode const * child =
+                    dynamic_cast<RowMatchNode::Report const &>(node).GetChild();
+                return child == nullptr ||
+                    CanMatch(*child, summaryBits, sliceBuffer);
+            }
+        case RowMatchNode::RowMatch:
+            {
+                AbstractRow const & row =
+                    dynamic_cast<RowMatchNode::Row const &>(node).GetRow();
+                if (row.IsInverted())
+                {
+                    return true;
+                }
+
+                const size_t bit = static_cast<size_t>(summaryBits[row.GetId()]);
+                uint64_t const * summary =
+                    static_cast<uint64_t const *>(sliceBuffer);
+                return (summary[bit >> 6] & (1ull << (bit & 0x3F))) != 0;
+            }
+        default:
+            // Not nodes match slices where their rows are empty.
+            return true;
+        }
+    }
+
+
+    bool SlicePruner::IsPrunable(RowMatchNode const & node)
+    {
+        switch (node.GetType())
+        {
+        case RowMatchNode::AndMatch:
+            {
+                RowMatchNode::And const & andNode =
+                    dynamic_cast<RowMatchNode::And const &>(node);
+                return IsPrunable(andNode.GetLeft())
+                    || IsPrunable(andNode.GetRight());
+            }
+        case RowMatchNode::OrMatch:
+            {
+                RowMatchNode::Or const & orNode =
+                    dynamic_cast<RowMatchNode::Or const &>(node);
+                return IsPrunable(orNode.GetLeft())
+                    && IsPrunable(orNode.GetRight());
+            }
+        case RowMatchNode::ReportMatch:
+            {
+                RowMatchNode const * child =
+                    dynamic_cast<RowMatchNode::Report const &>(node).GetChild();
+                return child != nullptr && IsPrunable(*child);
+            }
+        case RowMatchNode::RowMatch:
+            return !dynamic_cast<RowMatchNode::Row const &>(node).GetRow().IsInverted();
+        default:
+            return false;
+        }
+    }
+}
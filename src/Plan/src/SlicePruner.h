@@ -0,0 +1,102 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                     // size_t, ptrdiff_t embedded.
+
+#include "BitFunnel/BitFunnelTypes.h"   // ShardId parameter.
+#include "BitFunnel/NonCopyable.h"      // Base class.
+
+
+namespace BitFunnel
+{
+    class IAllocator;
+    class IPlanRows;
+    class ISimpleIndex;
+    class RowMatchNode;
+
+    //*************************************************************************
+    //
+    // SlicePruner
+    //
+    // Decides, from the row summary bits kept in each slice buffer, which
+    // slices cannot contain a match for a query so that the matcher can
+    // skip them. A row's summary bit is clear only when the row has no bits
+    // set in the slice, so a slice cannot match when the clear summary bits
+    // of its rows make the query's row plan false. Rows under a Not node and
+    // inverted rows may match when their row is empty, so they never prune.
+    //
+    // Summary bits are never cleared once set, so pruning is conservative:
+    // it may visit slices without matches, but never skips a slice with
+    // matches. For selective queries, most slices of a large index have
+    // empty rows for the query's rarest term, and a scan of every slice
+    // becomes a scan of the handful that may match.
+    //
+    // SlicePruner is allocated from the query's arena and holds pointers to
+    // the row plan, so it is valid until the arena is reset. Its methods
+    // must be called while holding a token that guards the slice buffers.
+    //
+    //*************************************************************************
+    class SlicePruner : public NonCopyable
+    {
+    public:
+        // Looks up the summary bits of the rows of tree in every shard.
+        SlicePruner(RowMatchNode const & tree,
+                    IPlanRows const & planRows,
+                    ISimpleIndex const & index,
+                    IAllocator & allocator);
+
+        // Returns false when no slice can be pruned, either because the
+        // tree matches regardless of empty rows, or because the index has
+        // no summary bits.
+        bool IsEnabled() const;
+
+        // Returns false if no document in the slice can match the query.
+        bool CanMatch(ShardId shard, void const * sliceBuffer) const;
+
+        // Copies the slice buffers of shard that may match the query, in
+        // order, to pruned, which must have room for sliceCount buffers.
+        // Returns the number of buffers copied.
+        size_t Prune(ShardId shard,
+                     void * const * sliceBuffers,
+                     size_t sliceCount,
+                     void ** pruned) const;
+
+    private:
+        bool CanMatch(RowMatchNode const & node,
+                      ptrdiff_t const * summaryBits,
+                      void const * sliceBuffer) const;
+
+        // Returns true if the tree can be false when some of its rows are
+        // empty.
+        static bool IsPrunable(RowMatchNode const & node);
+
+        RowMatchNode const & m_tree;
+        const unsigned m_rowCount;
+        bool m_isEnabled;
+
+        // Summary bit positions, stored shard by shard and indexed by
+        // AbstractRow id within a shard.
+        ptrdiff_t * m_summaryBits;
+    };
+}
@@ -0,0 +1,163 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include <algorithm>
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Index/Factories.h"
+#include "ResultsBuffer.h"
+#include "TopKResults.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // TopKResults::Entry
+    //
+    //*************************************************************************
+    DocumentHandle TopKResults::Entry::GetHandle() const
+    {
+        return Factories::CreateDocumentHandle(m_slice, m_index);
+    }
+
+
+    //*************************************************************************
+    //
+    // TopKResults
+    //
+    //*************************************************************************
+    TopKResults::TopKResults(size_t capacity,
+                             FixedSizeBlobId scoreBlob,
+                             float maxScore)
+      : m_capacity(capacity),
+        m_scoreBlob(scoreBlob),
+        m_maxScore(maxScore),
+        m_matchCount(0)
+    {
+        if (capacity == 0)
+        {
+            RecoverableError error("TopKResults: capacity must be positive.");
+            throw error;
+        }
+        m_heap.reserve(capacity);
+    }
+
+
+    void TopKResults::Reset()
+    {
+        m_heap.clear();
+        m_matchCount = 0;
+    }
+
+
+    bool TopKResults::Add(ResultsBuffer const & results)
+    {
+        for (auto result : results)
+        {
+            Add(result.m_slice,
+                result.m_index,
+                GetScore(result.m_slice, result.m_index));
+        }
+
+        return CanTerminate();
+    }
+
+
+    void TopKResults::Add(Slice* slice, DocIndex index, float score)
+    {
+        ++m_matchCount;
+
+        if (m_heap.size() < m_capacity)
+        {
+            m_heap.push_back({ score, slice, index });
+            std::push_heap(m_heap.begin(), m_heap.end(), Greater);
+        }
+        else if (score > m_heap.front().m_score)
+        {
+            std::pop_heap(m_heap.begin(), m_heap.end(), Greater);
+            m_heap.back() = { score, slice, index };
+            std::push_heap(m_heap.begin(), m_heap.end(), Greater);
+        }
+    }
+
+
+    bool TopKResults::CanTerminate() const
+    {
+        return m_heap.size() == m_capacity &&
+               m_heap.front().m_score >= m_maxScore;
+    }
+
+
+    float TopKResults::GetThreshold() const
+    {
+        if (m_heap.size() < m_capacity)
+        {
+            return -std::numeric_limits<float>::infinity();
+        }
+        return m_heap.front().m_score;
+    }
+
+
+    size_t TopKResults::GetMatchCount() const
+    {
+        return m_matchCount;
+    }
+
+
+    size_t TopKResults::GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+
+    size_t TopKResults::size() const
+    {
+        return m_heap.size();
+    }
+
+
+    std::vector<TopKResults::Entry> const & TopKResults::Sort()
+    {
+        // sort_heap with a greater-than comparison yields descending order.
+        std::sort_heap(m_heap.begin(), m_heap.end(), Greater);
+        return m_heap;
+    }
+
+
+    float TopKResults::GetScore(Slice* slice, DocIndex index) const
+    {
+        if (m_scoreBlob == c_noScoreBlob)
+        {
+            return 0.0f;
+        }
+
+        DocumentHandle handle = Factories::CreateDocumentHandle(slice, index);
+        return *static_cast<float*>(handle.GetFixedSizeBlob(m_scoreBlob));
+    }
+
+
+    // static
+    bool TopKResults::Greater(Entry const & a, Entry const & b)
+    {
+        return a.m_score > b.m_score;
+    }
+}
@@ -0,0 +1,126 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#pragma once
+
+#include <limits>                                   // std::numeric_limits.
+#include <stddef.h>                                 // size_t embedded.
+#include <vector>                                   // std::vector embedded.
+
+#include "BitFunnel/BitFunnelTypes.h"               // DocIndex embedded.
+#include "BitFunnel/Index/DocumentHandle.h"         // DocumentHandle return value.
+#include "BitFunnel/Index/IDocumentDataSchema.h"    // FixedSizeBlobId parameter.
+#include "BitFunnel/NonCopyable.h"                  // Base class.
+
+
+namespace BitFunnel
+{
+    class ResultsBuffer;
+    class Slice;
+
+    //*************************************************************************
+    //
+    // TopKResults
+    //
+    // A scoring stage that retains the k highest scoring matches in a
+    // fixed-capacity min-heap. Matches are fed in batches from a
+    // ResultsBuffer after the byte code interpreter or the native matcher has
+    // processed a slice, so a query needs a ResultsBuffer sized for a single
+    // slice rather than for the whole corpus.
+    //
+    // Each document's score is read as a float from a fixed size blob in its
+    // DocTable entry. When no score blob is configured, every document scores
+    // zero and TopKResults retains the first k matches.
+    //
+    // Scores must not exceed the maxScore passed to the constructor. Once the
+    // heap is full and its smallest score reaches maxScore, no further match
+    // can enter the heap and Add() requests early termination.
+    //
+    // Not thread safe. Intended to be owned by a single query thread and
+    // reused across queries by calling Reset().
+    //
+    //*************************************************************************
+    class TopKResults : public NonCopyable
+    {
+    public:
+        class Entry
+        {
+        public:
+            DocumentHandle GetHandle() const;
+
+            float m_score;
+            Slice* m_slice;
+            DocIndex m_index;
+        };
+
+        static const FixedSizeBlobId c_noScoreBlob =
+            std::numeric_limits<FixedSizeBlobId>::max();
+
+        TopKResults(size_t capacity,
+                    FixedSizeBlobId scoreBlob = c_noScoreBlob,
+                    float maxScore = 0.0f);
+
+        // Discards all entries and resets the match count.
+        void Reset();
+
+        // Scores each match in results and offers it to the heap. Returns
+        // true if the remaining matches in the query cannot improve the
+        // results.
+        bool Add(ResultsBuffer const & results);
+
+        // Offers a single scored match to the heap. Ties with the current
+        // threshold are rejected so that earlier matches win.
+        void Add(Slice* slice, DocIndex index, float score);
+
+        // Returns true if the remaining matches in the query cannot improve
+        // the results.
+        bool CanTerminate() const;
+
+        // Returns the smallest score in a full heap, or negative infinity if
+        // the heap is not yet full.
+        float GetThreshold() const;
+
+        // Returns the number of matches offered since the last Reset().
+        size_t GetMatchCount() const;
+
+        size_t GetCapacity() const;
+        size_t size() const;
+
+        // Returns the retained entries in descending score order. Subsequent
+        // calls to Add() are not allowed until Reset() is called.
+        std::vector<Entry> const & Sort();
+
+    private:
+        float GetScore(Slice* slice, DocIndex index) const;
+
+        static bool Greater(Entry const & a, Entry const & b);
+
+        const size_t m_capacity;
+        const FixedSizeBlobId m_scoreBlob;
+        const float m_maxScore;
+
+        size_t m_matchCount;
+
+        // Min-heap on m_score. Capacity is reserved at construction so that
+        // the steady state never allocates.
+        std::vector<Entry> m_heap;
+    };
+}
@@ -0,0 +1,136 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.h"
+
+
+namespace BitFunnel
+{
+    // Trivially constructible, so they are safe to use from operator new
+    // on any thread at any time.
+    static thread_local bool g_isCounting = false;
+    static thread_local size_t g_allocationCount = 0;
+
+
+    static void* CountedAllocate(size_t size)
+    {
+        if (g_isCounting)
+        {
+            ++g_allocationCount;
+        }
+
+        // operator new must return a unique pointer for zero byte requests.
+        return std::malloc((size == 0) ? 1 : size);
+    }
+
+
+    AllocationCounter::AllocationCounter()
+    {
+        g_allocationCount = 0;
+        g_isCounting = true;
+    }
+
+
+    AllocationCounter::~AllocationCounter()
+    {
+        g_isCounting = false;
+    }
+
+
+    size_t AllocationCounter::GetCount() const
+    {
+        return g_allocationCount;
+    }
+}
+
+
+//*****************************************************************************
+//
+// Global operator new and delete replacements.
+//
+//*****************************************************************************
+void* operator new(size_t size)
+{
+    void* block = BitFunnel::CountedAllocate(size);
+    if (block == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+
+void* operator new(size_t size, std::nothrow_t const &) noexcept
+{
+    return BitFunnel::CountedAllocate(size);
+}
+
+
+void* operator new[](size_t size, std::nothrow_t const &) noexcept
+{
+    return BitFunnel::CountedAllocate(size);
+}
+
+
+void operator delete(void* block) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete[](void* block) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete(void* block, size_t) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete[](void* block, size_t) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete(void* block, std::nothrow_t const &) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete[](void* block, std::nothrow_t const &) noexcept
+{
+    std::free(block);
+}
@@ -77,10 +77,50 @@ namespace BitFunnel
             m_rowOffsets.data(),
             nullptr,
             instrumentation,
+            nullptr,
+            1,
+            0,
+            QueryDeadline(),
             nullptr);
 
-        interpreter.Run();
+        EXPECT_FALSE(interpreter.Run());
 
         CheckResults(results);
+
+        // Running iterations side by side, with prefetching, must produce
+        // the same results in the same order.
+        QueryInstrumentation laneInstrumentation;
+        ResultsBuffer laneResults(m_index.GetIngestor().GetDocumentCount());
+        ByteCodeInterpreter laneInterpreter(
+            code,
+            laneResults,
+            m_slices.size(),
+            m_slices.data(),
+            GetIterationsPerSlice(),
+            m_initialRank,
+            m_rowOffsets.data(),
+            nullptr,
+            laneInstrumentation,
+            nullptr,
+            ByteCodeInterpreter::c_maxLaneCount,
+            1,
+            QueryDeadline(),
+            nullptr);
+
+        EXPECT_FALSE(laneInterpreter.Run());
+
+        // Every slice but the first is prefetched once.
+        EXPECT_EQ(instrumentation.GetData().GetPrefetchCount(), 0u);
+        EXPECT_EQ(laneInstrumentation.GetData().GetPrefetchCount(),
+                  (m_slices.size() - 1) * code.GetRowCount());
+
+        ASSERT_EQ(results.size(), laneResults.size());
+        auto expected = results.begin();
+        for (auto observed : laneResults)
+        {
+            EXPECT_EQ((*expected).m_slice, observed.m_slice);
+            EXPECT_EQ((*expected).m_index, observed.m_index);
+            ++expected;
+        }
     }
 }
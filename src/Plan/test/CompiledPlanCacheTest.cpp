@@ -0,0 +1,151 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Plan/QueryInstrumentation.h"
+#include "BitFunnel/Utilities/Allocator.h"
+#include "CompileNode.h"
+#include "CompiledPlanCache.h"
+#include "NativeJIT/CodeGen/ExecutionBuffer.h"
+#include "QueryDeadline.h"
+#include "RegisterAllocator.h"
+#include "ResultsBuffer.h"
+#include "TextObjectParser.h"
+#include "Temporary/Allocator.h"
+
+
+namespace BitFunnel
+{
+    namespace CompiledPlanCacheUnitTest
+    {
+        char const * c_planA =
+            "LoadRowJz {"
+            "  Row: Row(0, 0, 0, false),"
+            "  Child: AndRowJz {"
+            "    Row: Row(1, 0, 0, false),"
+            "    Child: Report {"
+            "      Child: "
+            "    }"
+            "  }"
+            "}";
+
+        char const * c_planB =
+            "LoadRowJz {"
+            "  Row: Row(0, 0, 0, false),"
+            "  Child: AndRowJz {"
+            "    Row: Row(1, 0, 0, true),"
+            "    Child: Report {"
+            "      Child: "
+            "    }"
+            "  }"
+            "}";
+
+
+        CompileNode const & Parse(char const * text, IAllocator & allocator)
+        {
+            std::stringstream input(text);
+            TextObjectParser parser(input, allocator, &CompileNode::GetType);
+            return CompileNode::Parse(parser);
+        }
+
+
+        std::shared_ptr<CompiledPlanCache::Entry>
+            Compile(CompileNode const & tree, IAllocator & allocator)
+        {
+            NativeJIT::Allocator treeAllocator(8192);
+            RegisterAllocator registers(tree, 2, 8, 7, allocator);
+            return std::make_shared<CompiledPlanCache::Entry>(treeAllocator,
+                                                              8192,
+                                                              tree,
+                                                              registers,
+                                                              0);
+        }
+
+
+        TEST(CompiledPlanCache, Key)
+        {
+            BitFunnel::Allocator allocator(4096);
+
+            CompileNode const & a1 = Parse(c_planA, allocator);
+            CompileNode const & a2 = Parse(c_planA, allocator);
+            CompileNode const & b = Parse(c_planB, allocator);
+
+            EXPECT_EQ(CompiledPlanCache::CreateKey(a1, 0, 2),
+                      CompiledPlanCache::CreateKey(a2, 0, 2));
+            EXPECT_NE(CompiledPlanCache::CreateKey(a1, 0, 2),
+                      CompiledPlanCache::CreateKey(b, 0, 2));
+            EXPECT_NE(CompiledPlanCache::CreateKey(a1, 0, 2),
+                      CompiledPlanCache::CreateKey(a1, 1, 2));
+            EXPECT_NE(CompiledPlanCache::CreateKey(a1, 0, 2),
+                      CompiledPlanCache::CreateKey(a1, 0, 3));
+        }
+
+
+        TEST(CompiledPlanCache, HitMissAndEviction)
+        {
+            BitFunnel::Allocator allocator(4096);
+            CompiledPlanCache cache(1, 8192);
+
+            CompileNode const & a = Parse(c_planA, allocator);
+            CompileNode const & b = Parse(c_planB, allocator);
+            const std::string keyA = CompiledPlanCache::CreateKey(a, 0, 2);
+            const std::string keyB = CompiledPlanCache::CreateKey(b, 0, 2);
+
+            EXPECT_EQ(cache.Find(keyA), nullptr);
+            auto entryA = cache.Add(keyA, Compile(a, allocator));
+            EXPECT_EQ(cache.Find(keyA), entryA);
+            EXPECT_EQ(cache.GetHitCount(), 1u);
+            EXPECT_EQ(cache.GetMissCount(), 1u);
+
+            // Adding a duplicate key returns the original entry.
+            EXPECT_EQ(cache.Add(keyA, Compile(a, allocator)), entryA);
+            EXPECT_EQ(cache.GetEntryCount(), 1u);
+
+            // Adding B evicts A, but our reference to A remains usable.
+            auto entryB = cache.Add(keyB, Compile(b, allocator));
+            EXPECT_EQ(cache.GetEntryCount(), 1u);
+            EXPECT_EQ(cache.Find(keyA), nullptr);
+            EXPECT_EQ(cache.Find(keyB), entryB);
+
+            // Run the evicted matcher against an empty slice list.
+            ptrdiff_t rowOffsets[2] = { 0, 0 };
+            ResultsBuffer results(64);
+            QueryInstrumentation instrumentation;
+            const bool timedOut =
+                entryA->GetCompiler().Run(0,
+                                          nullptr,
+                                          0,
+                                          rowOffsets,
+                                          2,
+                                          1,
+                                          QueryDeadline(),
+                                          results,
+                                          instrumentation);
+            EXPECT_FALSE(timedOut);
+            EXPECT_EQ(instrumentation.GetData().GetQuadwordCount(), 0u);
+            EXPECT_EQ(instrumentation.GetData().GetPrefetchCount(), 0u);
+            EXPECT_EQ(results.size(), 0u);
+        }
+    }
+}
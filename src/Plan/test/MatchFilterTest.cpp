@@ -0,0 +1,329 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IFileSystem.h"
+#include "BitFunnel/Configuration/IStreamConfiguration.h"
+#include "BitFunnel/IDiagnosticStream.h"
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/IDocument.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Index/ISliceBufferAllocator.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/ITermTableCollection.h"
+#include "BitFunnel/Mocks/Factories.h"
+#include "BitFunnel/Plan/Factories.h"
+#include "BitFunnel/Plan/QueryInstrumentation.h"
+#include "BitFunnel/Plan/QueryParser.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/IBlockAllocator.h"
+#include "BitFunnel/Utilities/Primes.h"
+#include "BitFunnel/Utilities/Random.h"
+#include "MatchFilter.h"
+#include "QueryResources.h"
+#include "ResultsBuffer.h"
+
+
+namespace BitFunnel
+{
+    namespace MatchFilterTest
+    {
+        static const Term::StreamId c_streamId = 0;
+        static const DocId c_maxDocId = 1000;
+
+
+        // Creates a PrimeFactors index with a ForwardIndex, whose TermTable
+        // maps the terms "2" and "3" to the same row. The bit sliced
+        // signature of "2" therefore also matches the odd multiples of 3.
+        static std::unique_ptr<ISimpleIndex> CreateIndex(IFileSystem & fileSystem)
+        {
+            const Rank rank = 0;
+            const RowIndex adhocRowCount = 1;
+            RowIndex explicitRowCount = ITermTable::SystemTerm::Count;
+
+            auto termTable = Factories::CreateTermTable();
+
+            termTable->OpenTerm();
+            termTable->AddRowId(RowId(rank, explicitRowCount++));
+            termTable->CloseTerm(Term::ComputeRawHash("0"));
+
+            const RowIndex sharedRow = explicitRowCount++;
+            for (size_t i = 0; Primes::c_primesBelow10000[i] <= c_maxDocId; ++i)
+            {
+                const size_t p = Primes::c_primesBelow10000[i];
+                termTable->OpenTerm();
+                termTable->AddRowId(
+                    RowId(rank, (p == 2 || p == 3) ? sharedRow : explicitRowCount++));
+                termTable->CloseTerm(
+                    Term::ComputeRawHash(Primes::c_primesBelow10000Text[i].c_str()));
+            }
+
+            termTable->SetRowCounts(rank, explicitRowCount, adhocRowCount);
+            termTable->Seal();
+
+            auto termTables = Factories::CreateTermTableCollection();
+            termTables->AddTermTable(std::move(termTable));
+
+            auto index = Factories::CreateSimpleIndex(fileSystem);
+            index->SetTermTableCollection(std::move(termTables));
+            index->SetSliceBufferAllocator(
+                Factories::CreateSliceBufferAllocator(20000,
+                                                      512,
+                                                      PageSize::Default,
+                                                      1));
+            index->EnableForwardIndex();
+            index->ConfigureAsMock(1, false);
+            index->StartIndex();
+
+            for (DocId docId = 0; docId <= c_maxDocId; ++docId)
+            {
+                auto document =
+                    Factories::CreatePrimeFactorsDocument(
+                        index->GetConfiguration(),
+                        docId,
+                        c_maxDocId,
+                        c_streamId);
+                index->GetIngestor().Add(docId, *document);
+            }
+
+            return index;
+        }
+
+
+        // Runs query and returns the sorted DocIds of its matches along with
+        // the number of false positives removed.
+        static std::vector<DocId> RunQuery(ISimpleIndex const & index,
+                                           char const * query,
+                                           bool useNativeCode,
+                                           bool filter,
+                                           size_t & falsePositiveCount)
+        {
+            QueryResources resources;
+            if (filter)
+            {
+                resources.EnableMatchFiltering(index);
+            }
+
+            auto config = Factories::CreateStreamConfiguration();
+            QueryParser parser(query, *config, resources.GetMatchTreeAllocator());
+            auto tree = parser.Parse();
+            EXPECT_NE(tree, nullptr);
+
+            auto diagnosticStream = Factories::CreateDiagnosticStream(std::cout);
+            QueryInstrumentation instrumentation;
+            ResultsBuffer results(index.GetIngestor().GetDocumentCount());
+
+            Factories::RunQueryPlanner(*tree,
+                                       index,
+                                       resources,
+                                       *diagnosticStream,
+                                       instrumentation,
+                                       results,
+                                       useNativeCode);
+
+            std::vector<DocId> ids;
+            for (auto result : results)
+            {
+                ids.push_back(result.GetHandle().GetDocId());
+            }
+            std::sort(ids.begin(), ids.end());
+
+            auto data = instrumentation.GetData();
+            EXPECT_EQ(data.GetMatchCount(), ids.size());
+            falsePositiveCount = data.GetFalsePositiveCount();
+
+            return ids;
+        }
+
+
+        // Compares MatchFilter::Intersect() with std::binary_search() on
+        // random hashes, including hashes on both sides of the sign bit.
+        TEST(MatchFilter, Intersect)
+        {
+            RandomInt<uint64_t> random(1234, 0, (std::numeric_limits<uint64_t>::max)());
+            RandomInt<uint64_t> small(5678, 0, 64);
+
+            for (size_t hashCount = 0; hashCount < 70; hashCount += 3)
+            {
+                for (size_t probeCount = 1; probeCount < 12; probeCount += 2)
+                {
+                    std::vector<Term::Hash> hashes;
+                    for (size_t i = 0; i < hashCount; ++i)
+                    {
+                        hashes.push_back((i & 1) ? random() : small());
+                    }
+                    std::sort(hashes.begin(), hashes.end());
+                    hashes.erase(std::unique(hashes.begin(), hashes.end()),
+                                 hashes.end());
+
+                    // Draw half of the probes from hashes.
+                    std::vector<Term::Hash> probes;
+                    for (size_t i = 0; i < probeCount; ++i)
+                    {
+                        if ((i & 1) && !hashes.empty())
+                        {
+                            probes.push_back(hashes[random() % hashes.size()]);
+                        }
+                        else
+                        {
+                            probes.push_back((i & 2) ? random() : small());
+                        }
+                    }
+                    std::sort(probes.begin(), probes.end());
+                    probes.erase(std::unique(probes.begin(), probes.end()),
+                                 probes.end());
+
+                    std::vector<char> found(probes.size(), 2);
+                    MatchFilter::Intersect(hashes.data(),
+                                           hashes.size(),
+                                           probes.data(),
+                                           probes.size(),
+                                           found.data());
+
+                    for (size_t i = 0; i < probes.size(); ++i)
+                    {
+                        const char expected =
+                            std::binary_search(hashes.begin(),
+                                               hashes.end(),
+                                               probes[i]) ? 1 : 0;
+                        EXPECT_EQ(found[i], expected);
+                    }
+                }
+            }
+        }
+
+
+        // Verifies documents against queries with each kind of operator.
+        TEST(MatchFilter, Verify)
+        {
+            auto fileSystem = Factories::CreateFileSystem();
+            auto index = CreateIndex(*fileSystem);
+
+            MatchFilter filter(*index->GetForwardIndex(),
+                               index->GetConfiguration());
+            auto config = Factories::CreateStreamConfiguration();
+            auto allocator = Factories::CreateAllocator(4096);
+
+            char const * queries[] = { "2", "2 -3", "2|5", "3 (5|7)", "\"2 3\"" };
+            for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); ++q)
+            {
+                char const * query = queries[q];
+                allocator->Reset();
+                QueryParser parser(query, *config, *allocator);
+                auto tree = parser.Parse();
+                ASSERT_NE(tree, nullptr);
+                filter.SetQuery(*tree);
+
+                for (DocId docId = 1; docId <= c_maxDocId; ++docId)
+                {
+                    bool expected = false;
+                    switch (q)
+                    {
+                    case 0:
+                        expected = (docId % 2) == 0;
+                        break;
+                    case 1:
+                        expected = ((docId % 2) == 0) && ((docId % 3) != 0);
+                        break;
+                    case 2:
+                        expected = ((docId % 2) == 0) || ((docId % 5) == 0);
+                        break;
+                    case 3:
+                        expected = ((docId % 3) == 0) &&
+                            (((docId % 5) == 0) || ((docId % 7) == 0));
+                        break;
+                    case 4:
+                        expected = (docId % 6) == 0;
+                        break;
+                    }
+                    EXPECT_EQ(filter.Verify(index->GetIngestor().GetHandle(docId)),
+                              expected)
+                        << "query " << query << ", docId " << docId;
+                }
+            }
+        }
+
+
+        // Runs queries whose bit sliced signatures report false positives
+        // and verifies that the filter removes exactly those.
+        TEST(MatchFilter, QueryPlanner)
+        {
+            auto fileSystem = Factories::CreateFileSystem();
+            auto index = CreateIndex(*fileSystem);
+
+            std::vector<DocId> evens;
+            std::vector<DocId> multiples;
+            for (DocId docId = 1; docId <= c_maxDocId; ++docId)
+            {
+                if ((docId % 2) == 0)
+                {
+                    evens.push_back(docId);
+                }
+                if ((docId % 2) == 0 || (docId % 3) == 0)
+                {
+                    multiples.push_back(docId);
+                }
+            }
+
+            for (bool useNativeCode : { false, true })
+            {
+                size_t falsePositiveCount = 0;
+                auto unfiltered = RunQuery(*index,
+                                           "2",
+                                           useNativeCode,
+                                           false,
+                                           falsePositiveCount);
+                EXPECT_EQ(unfiltered, multiples);
+                EXPECT_EQ(falsePositiveCount, 0u);
+
+                auto filtered = RunQuery(*index,
+                                         "2",
+                                         useNativeCode,
+                                         true,
+                                         falsePositiveCount);
+                EXPECT_EQ(filtered, evens);
+                EXPECT_EQ(falsePositiveCount, multiples.size() - evens.size());
+            }
+        }
+
+
+        TEST(MatchFilter, RequiresForwardIndex)
+        {
+            auto fileSystem = Factories::CreateFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            100,
+                                                            c_streamId,
+                                                            1);
+
+            QueryResources resources;
+            EXPECT_ANY_THROW(resources.EnableMatchFiltering(*index));
+            EXPECT_EQ(resources.GetMatchFilter(), nullptr);
+        }
+    }
+}
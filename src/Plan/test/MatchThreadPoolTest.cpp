@@ -0,0 +1,134 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Utilities/Numa.h"
+#include "MatchThreadPool.h"
+
+
+namespace BitFunnel
+{
+    namespace MatchThreadPoolUnitTest
+    {
+        // Records taskId + 1 matches for each task, each with the task's id
+        // as its index. Throws from task m_throwTask.
+        class RecordingWork : public MatchThreadPool::IWork
+        {
+        public:
+            RecordingWork(size_t taskCount, size_t throwTask)
+              : m_threadIds(taskCount),
+                m_throwTask(throwTask)
+            {
+            }
+
+            virtual void ProcessTask(size_t taskId,
+                                     MatchThreadPool::ThreadState & state) override
+            {
+                if (taskId == m_throwTask)
+                {
+                    throw std::runtime_error("RecordingWork: task failed.");
+                }
+
+                for (size_t i = 0; i <= taskId; ++i)
+                {
+                    state.m_results->push_back(nullptr, taskId);
+                }
+                state.m_matches.insert(state.m_matches.end(),
+                                       state.m_results->m_buffer,
+                                       state.m_results->m_buffer + state.m_results->size());
+                m_threadIds[taskId] = state.m_threadId;
+            }
+
+            std::vector<size_t> m_threadIds;
+
+        private:
+            size_t m_throwTask;
+        };
+
+
+        TEST(MatchThreadPool, RunsEveryTask)
+        {
+            const size_t c_taskCount = 20;
+            MatchThreadPool pool({ c_anyNumaNode }, 4);
+            EXPECT_EQ(pool.GetThreadCount(), 4u);
+
+            // Run twice to check that the kept matches are emptied between
+            // runs.
+            for (unsigned run = 0; run < 2; ++run)
+            {
+                RecordingWork work(c_taskCount, c_taskCount);
+                std::vector<unsigned> nodes(c_taskCount, c_anyNumaNode);
+                pool.Run(work, nodes.data(), nodes.size(), c_taskCount);
+
+                std::vector<size_t> counts(c_taskCount, 0);
+                for (size_t thread = 0; thread < pool.GetThreadCount(); ++thread)
+                {
+                    for (auto match : pool.GetMatches(thread))
+                    {
+                        ASSERT_LT(match.m_index, c_taskCount);
+                        EXPECT_EQ(work.m_threadIds[match.m_index], thread);
+                        ++counts[match.m_index];
+                    }
+                }
+
+                for (size_t task = 0; task < c_taskCount; ++task)
+                {
+                    EXPECT_EQ(counts[task], task + 1);
+                }
+            }
+        }
+
+
+        TEST(MatchThreadPool, RethrowsTaskException)
+        {
+            const size_t c_taskCount = 10;
+            MatchThreadPool pool({ c_anyNumaNode }, 3);
+            std::vector<unsigned> nodes(c_taskCount, c_anyNumaNode);
+
+            RecordingWork failing(c_taskCount, 5);
+            EXPECT_THROW(pool.Run(failing, nodes.data(), nodes.size(), c_taskCount), std::runtime_error);
+
+            // The pool is still usable after a failed run.
+            RecordingWork work(c_taskCount, c_taskCount);
+            pool.Run(work, nodes.data(), nodes.size(), c_taskCount);
+            size_t matchCount = 0;
+            for (size_t thread = 0; thread < pool.GetThreadCount(); ++thread)
+            {
+                matchCount += pool.GetMatches(thread).size();
+            }
+            EXPECT_EQ(matchCount, c_taskCount * (c_taskCount + 1) / 2);
+        }
+
+
+        TEST(MatchThreadPool, UnknownNode)
+        {
+            MatchThreadPool pool({ c_anyNumaNode }, 2);
+            RecordingWork work(1, 1);
+            std::vector<unsigned> nodes(1, 0);
+            EXPECT_THROW(pool.Run(work, nodes.data(), nodes.size(), 1), RecoverableError);
+        }
+    }
+}
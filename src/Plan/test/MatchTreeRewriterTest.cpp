@@ -1012,5 +1012,56 @@ namespace BitFunnel
                 VerifyCase(c_rewriteCases[i]);
             }
         }
+
+
+        TEST(MatchTreeRewriter, Densities)
+        {
+            // Row 2 is inverted, so its density in the plan is 1 - 0.8.
+            const double densities[] = { 0.5, 0.1, 0.8, 0.4, 0.3 };
+
+            std::stringstream input(
+                "And {"
+                "  Children: ["
+                "    Row(0, 0, 0, false),"
+                "    Row(1, 0, 0, false),"
+                "    Row(2, 0, 0, true),"
+                "    Row(3, 3, 0, false),"
+                "    Row(4, 3, 0, false)"
+                "  ]"
+                "}");
+
+            // Rows remain in descending rank order, and the rows of each
+            // rank are ordered from sparsest to densest.
+            char const * expected =
+                "And {"
+                "  Children: ["
+                "    Row(4, 3, 0, false),"
+                "    Row(3, 3, 0, false),"
+                "    Row(1, 0, 0, false),"
+                "    Row(2, 0, 0, true),"
+                "    Row(0, 0, 0, false),"
+                "    Report {"
+                "      Child:"
+                "    }"
+                "  ]"
+                "}";
+
+            Allocator allocator(1024*4);
+            TextObjectParser parser(input, allocator, &RowPlanBase::GetType);
+            RowMatchNode const & root = RowMatchNode::Parse(parser);
+
+            RowMatchNode const & converted = MatchTreeRewriter::Rewrite(root,
+                                                                        4,
+                                                                        0,
+                                                                        allocator,
+                                                                        densities);
+
+            std::stringstream output;
+            TextObjectFormatter formatter(output);
+            converted.Format(formatter);
+
+            EXPECT_TRUE(SameExceptForWhitespace(output.str().c_str(), expected))
+                << output.str();
+        }
     }
 }
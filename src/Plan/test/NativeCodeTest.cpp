@@ -422,6 +422,45 @@ namespace BitFunnel
     }
 
 
+    //
+    // LoadRowJz nested in LoadRowJz. Row 0 is zero in some quadwords and not
+    // in their neighbors, so the inner LoadRowJz runs with some lanes masked
+    // off when iterations are matched side by side.
+    //
+    TEST(NativeCode, LoadRowJzNested)
+    {
+        ShardId c_numShards = 1;
+        char const * text =
+            "LoadRowJz {"
+            "  Row: Row(0, 0, 0, false),"
+            "  Child: LoadRowJz {"
+            "    Row: Row(1, 0, 0, false),"
+            "    Child: Report {"
+            "      Child: "
+            "    }"
+            "  }"
+            "}";
+
+        const Rank initialRank = 0;
+        NativeCodeVerifier verifier(GetIndex(c_numShards), initialRank);
+
+        verifier.DeclareRow("127");
+        verifier.DeclareRow("2");
+
+        for (auto iteration : verifier.GetIterations())
+        {
+            const size_t slice = verifier.GetSliceNumber(iteration);
+            const size_t offset = verifier.GetOffset(iteration);
+
+            const uint64_t row0 = verifier.GetRowData(0, offset, slice);
+            const uint64_t row1 = verifier.GetRowData(1, offset, slice);
+            verifier.ExpectResult((row0 == 0) ? 0 : row1, offset, slice);
+        }
+
+        verifier.Verify(text);
+    }
+
+
     //*************************************************************************
     //
     // LoadRow test cases
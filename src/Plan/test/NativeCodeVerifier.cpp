@@ -35,6 +35,7 @@
 #include "MatchTreeCompiler.h"
 #include "NativeCodeVerifier.h"
 #include "NativeJIT/CodeGen/ExecutionBuffer.h"
+#include "QueryDeadline.h"
 #include "QueryResources.h"
 #include "RegisterAllocator.h"
 #include "RowMatchNode.h"
@@ -70,21 +71,58 @@ namespace BitFunnel
                                     7,
                                     allocator);
 
-        QueryResources resources;
-
-        MatchTreeCompiler compiler(resources,
-                                   compileNodeTree,
-                                   registers,
-                                   m_initialRank);
-
-        ResultsBuffer results(m_index.GetIngestor().GetDocumentCount());
-
-        compiler.Run(m_slices.size(),
-                     m_slices.data(),
-                     GetIterationsPerSlice(),
-                     m_rowOffsets.data(),
-                     results);
-
-        CheckResults(results);
+        // Match with a single lane, and then with iterations side by side.
+        // Both must produce the same results in the same order.
+        ResultsBuffer singleLaneResults(m_index.GetIngestor().GetDocumentCount());
+        const size_t laneCounts[] = { 1, NativeCodeGenerator::c_maxLaneCount };
+        for (auto laneCount : laneCounts)
+        {
+            QueryResources resources;
+
+            MatchTreeCompiler compiler(resources,
+                                       compileNodeTree,
+                                       registers,
+                                       m_initialRank,
+                                       laneCount);
+
+            ResultsBuffer results(m_index.GetIngestor().GetDocumentCount());
+            QueryInstrumentation instrumentation;
+
+            const bool timedOut = compiler.Run(m_slices.size(),
+                                               m_slices.data(),
+                                               GetIterationsPerSlice(),
+                                               m_rowOffsets.data(),
+                                               m_rowOffsets.size(),
+                                               1,
+                                               QueryDeadline(),
+                                               results,
+                                               instrumentation);
+            EXPECT_FALSE(timedOut);
+
+            CheckResults(results);
+
+            // Every slice but the first is prefetched once.
+            EXPECT_EQ(instrumentation.GetData().GetPrefetchCount(),
+                      (m_slices.size() - 1) * m_rowOffsets.size());
+
+            if (laneCount == 1)
+            {
+                for (auto result : results)
+                {
+                    singleLaneResults.push_back(result.m_slice, result.m_index);
+                }
+            }
+            else
+            {
+                ASSERT_EQ(singleLaneResults.size(), results.size());
+                auto expected = singleLaneResults.begin();
+                for (auto observed : results)
+                {
+                    EXPECT_EQ((*expected).m_slice, observed.m_slice);
+                    EXPECT_EQ((*expected).m_index, observed.m_index);
+                    ++expected;
+                }
+            }
+        }
     }
 }
@@ -0,0 +1,758 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IFileSystem.h"
+#include "BitFunnel/Configuration/IStreamConfiguration.h"
+#include "BitFunnel/IDiagnosticStream.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Index/IShard.h"
+#include "BitFunnel/Mocks/Factories.h"
+#include "BitFunnel/Plan/Factories.h"
+#include "BitFunnel/Plan/QueryInstrumentation.h"
+#include "BitFunnel/Plan/QueryParser.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "AllocationCounter.h"
+#include "MatchThreadPool.h"
+#include "QueryBatch.h"
+#include "QueryResources.h"
+#include "ResultsBuffer.h"
+#include "RowDensityTable.h"
+#include "TopKResults.h"
+
+
+namespace BitFunnel
+{
+    namespace QueryPlannerTest
+    {
+        static const Term::StreamId c_streamId = 0;
+
+        // Enough documents to fill several slices in each shard.
+        static const DocId c_maxDocId = 1664;
+
+
+        // Runs query on the index with matchThreadCount matching threads,
+        // using the prefetch distance and budgets configured in resources.
+        // Returns the sorted DocIds of the matches along with the query's
+        // instrumentation.
+        static std::vector<DocId> RunQuery(ISimpleIndex const & index,
+                                           char const * query,
+                                           bool useNativeCode,
+                                           size_t matchThreadCount,
+                                           QueryResources & resources,
+                                           QueryInstrumentation::Data & data)
+        {
+            auto config = Factories::CreateStreamConfiguration();
+            QueryParser parser(query, *config, resources.GetMatchTreeAllocator());
+            auto tree = parser.Parse();
+            EXPECT_NE(tree, nullptr);
+
+            auto diagnosticStream = Factories::CreateDiagnosticStream(std::cout);
+            QueryInstrumentation instrumentation;
+            ResultsBuffer results(index.GetIngestor().GetDocumentCount());
+
+            Factories::RunQueryPlanner(*tree,
+                                       index,
+                                       resources,
+                                       *diagnosticStream,
+                                       instrumentation,
+                                       results,
+                                       useNativeCode,
+                                       nullptr,
+                                       matchThreadCount);
+
+            std::vector<DocId> ids;
+            for (auto result : results)
+            {
+                ids.push_back(result.GetHandle().GetDocId());
+            }
+            std::sort(ids.begin(), ids.end());
+
+            data = instrumentation.GetData();
+            EXPECT_EQ(data.GetMatchCount(), ids.size());
+
+            return ids;
+        }
+
+
+        // Runs query on the index with matchThreadCount matching threads and
+        // the specified prefetch distance. Returns the sorted DocIds of the
+        // matches along with the quadword and prefetch counts.
+        static std::vector<DocId> RunQuery(ISimpleIndex const & index,
+                                           char const * query,
+                                           bool useNativeCode,
+                                           size_t matchThreadCount,
+                                           size_t prefetchDistance,
+                                           size_t & quadwordCount,
+                                           size_t & prefetchCount)
+        {
+            QueryResources resources;
+            resources.SetPrefetchDistance(prefetchDistance);
+
+            QueryInstrumentation::Data data;
+            auto ids = RunQuery(index,
+                                query,
+                                useNativeCode,
+                                matchThreadCount,
+                                resources,
+                                data);
+
+            quadwordCount = data.GetQuadwordCount();
+            prefetchCount = data.GetPrefetchCount();
+            EXPECT_FALSE(data.GetTimedOut());
+
+            return ids;
+        }
+
+
+        TEST(QueryPlanner, ParallelMatchesSerial)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            const ShardId c_shardCount = 2;
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId,
+                                                            c_shardCount);
+
+            size_t sliceCount = 0;
+            for (ShardId shard = 0; shard < c_shardCount; ++shard)
+            {
+                sliceCount +=
+                    index->GetIngestor().GetShard(shard).GetSliceBuffers().size();
+            }
+            ASSERT_GT(sliceCount, c_shardCount);
+
+            char const * queries[] = { "2", "3 5", "2 3 7", "11|13" };
+
+            for (auto useNativeCode : { false, true })
+            {
+                for (auto query : queries)
+                {
+                    size_t serialQuadwords = 0;
+                    size_t prefetches = 0;
+                    auto expected = RunQuery(*index,
+                                             query,
+                                             useNativeCode,
+                                             1,
+                                             1,
+                                             serialQuadwords,
+                                             prefetches);
+                    EXPECT_GT(expected.size(), 0u) << query;
+
+                    for (size_t threadCount : { 2, 3, 8 })
+                    {
+                        size_t parallelQuadwords = 0;
+                        auto observed = RunQuery(*index,
+                                                 query,
+                                                 useNativeCode,
+                                                 threadCount,
+                                                 1,
+                                                 parallelQuadwords,
+                                                 prefetches);
+                        EXPECT_EQ(expected, observed)
+                            << query << " with " << threadCount << " threads";
+                        EXPECT_EQ(serialQuadwords, parallelQuadwords);
+                    }
+                }
+            }
+        }
+
+
+        // The matching threads, and their ResultsBuffers, are kept in the
+        // QueryResources from one query to the next.
+        TEST(QueryPlanner, ParallelReusesThreadPool)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            const ShardId c_shardCount = 2;
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId,
+                                                            c_shardCount);
+
+            const size_t c_threadCount = 3;
+            char const * queries[] = { "2", "3 5", "2 3 7", "11|13", "2" };
+
+            QueryResources resources;
+            MatchThreadPool const * pool = nullptr;
+            for (auto query : queries)
+            {
+                QueryInstrumentation::Data data;
+                auto expected = RunQuery(*index, query, false, 1, resources, data);
+                auto observed = RunQuery(*index,
+                                         query,
+                                         false,
+                                         c_threadCount,
+                                         resources,
+                                         data);
+                EXPECT_EQ(expected, observed) << query;
+
+                MatchThreadPool & current =
+                    resources.GetMatchThreadPool(*index, c_threadCount);
+                EXPECT_EQ(current.GetThreadCount(), c_threadCount);
+                if (pool != nullptr)
+                {
+                    EXPECT_EQ(pool, &current) << query;
+                }
+                pool = &current;
+            }
+
+            // A different thread count replaces the pool.
+            EXPECT_EQ(resources.GetMatchThreadPool(*index, 2).GetThreadCount(), 2u);
+        }
+
+
+        // Query threads can share a single MatchThreadPool.
+        TEST(QueryPlanner, ParallelSharedThreadPool)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            const ShardId c_shardCount = 2;
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId,
+                                                            c_shardCount);
+
+            const size_t c_threadCount = 3;
+            const size_t c_queryThreadCount = 4;
+            char const * queries[] = { "2", "3 5", "2 3 7", "11|13" };
+
+            std::vector<std::vector<DocId>> expected;
+            {
+                QueryResources resources;
+                for (auto query : queries)
+                {
+                    QueryInstrumentation::Data data;
+                    expected.push_back(RunQuery(*index, query, false, 1, resources, data));
+                }
+            }
+
+            auto pool = QueryResources::CreateMatchThreadPool(*index, c_threadCount);
+
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < c_queryThreadCount; ++t)
+            {
+                threads.push_back(std::thread([&]()
+                {
+                    QueryResources resources;
+                    resources.SetMatchThreadPool(pool.get());
+                    EXPECT_EQ(&resources.GetMatchThreadPool(*index, c_threadCount),
+                              pool.get());
+
+                    for (size_t round = 0; round < 10; ++round)
+                    {
+                        for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); ++q)
+                        {
+                            resources.Reset();
+                            QueryInstrumentation::Data data;
+                            auto observed = RunQuery(*index,
+                                                     queries[q],
+                                                     false,
+                                                     c_threadCount,
+                                                     resources,
+                                                     data);
+                            EXPECT_EQ(expected[q], observed) << queries[q];
+                        }
+                    }
+                }));
+            }
+
+            for (auto & thread : threads)
+            {
+                thread.join();
+            }
+
+            EXPECT_EQ(pool->GetThreadCount(), c_threadCount);
+        }
+
+
+        TEST(QueryPlanner, PrefetchMatchesNoPrefetch)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId,
+                                                            1);
+
+            const size_t sliceCount =
+                index->GetIngestor().GetShard(0).GetSliceBuffers().size();
+            ASSERT_GT(sliceCount, 2u);
+
+            char const * queries[] = { "2", "3 5", "11|13" };
+
+            for (auto useNativeCode : { false, true })
+            {
+                for (auto query : queries)
+                {
+                    size_t quadwords = 0;
+                    size_t prefetches = 0;
+                    auto expected = RunQuery(*index,
+                                             query,
+                                             useNativeCode,
+                                             1,
+                                             0,
+                                             quadwords,
+                                             prefetches);
+                    EXPECT_EQ(prefetches, 0u);
+
+                    // Each slice after the first distance slices has the
+                    // first line of each of its rows prefetched once.
+                    size_t previousPrefetches = 0;
+                    for (size_t distance = 1; distance < sliceCount; ++distance)
+                    {
+                        auto observed = RunQuery(*index,
+                                                 query,
+                                                 useNativeCode,
+                                                 1,
+                                                 distance,
+                                                 quadwords,
+                                                 prefetches);
+                        EXPECT_EQ(expected, observed)
+                            << query << " at distance " << distance;
+                        EXPECT_GT(prefetches, 0u);
+                        if (distance > 1)
+                        {
+                            EXPECT_LT(prefetches, previousPrefetches);
+                        }
+                        previousPrefetches = prefetches;
+                    }
+
+                    auto observed = RunQuery(*index,
+                                             query,
+                                             useNativeCode,
+                                             1,
+                                             sliceCount,
+                                             quadwords,
+                                             prefetches);
+                    EXPECT_EQ(expected, observed);
+                    EXPECT_EQ(prefetches, 0u);
+                }
+            }
+        }
+
+
+        TEST(QueryPlanner, Budgets)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            const ShardId c_shardCount = 2;
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId,
+                                                            c_shardCount);
+
+            char const * query = "2";
+
+            for (auto useNativeCode : { false, true })
+            {
+                for (size_t threadCount : { 1, 4 })
+                {
+                    QueryInstrumentation::Data data;
+
+                    QueryResources unlimited;
+                    auto all = RunQuery(*index,
+                                        query,
+                                        useNativeCode,
+                                        threadCount,
+                                        unlimited,
+                                        data);
+                    EXPECT_FALSE(data.GetTimedOut());
+
+                    // A budget of one quadword admits only the first slice.
+                    QueryResources quadwordBudget;
+                    quadwordBudget.SetQuadwordBudget(1);
+                    auto partial = RunQuery(*index,
+                                            query,
+                                            useNativeCode,
+                                            threadCount,
+                                            quadwordBudget,
+                                            data);
+                    EXPECT_TRUE(data.GetTimedOut());
+                    EXPECT_GT(partial.size(), 0u);
+                    EXPECT_LT(partial.size(), all.size());
+                    EXPECT_TRUE(std::includes(all.begin(), all.end(),
+                                              partial.begin(), partial.end()));
+
+                    // A time budget that has expired before matching starts
+                    // admits no slices.
+                    QueryResources timeBudget;
+                    timeBudget.SetTimeBudget(1e-12);
+                    auto none = RunQuery(*index,
+                                         query,
+                                         useNativeCode,
+                                         threadCount,
+                                         timeBudget,
+                                         data);
+                    EXPECT_TRUE(data.GetTimedOut());
+                    EXPECT_EQ(none.size(), 0u);
+
+                    // A generous time budget changes nothing.
+                    QueryResources generous;
+                    generous.SetTimeBudget(1000.0);
+                    auto observed = RunQuery(*index,
+                                             query,
+                                             useNativeCode,
+                                             threadCount,
+                                             generous,
+                                             data);
+                    EXPECT_FALSE(data.GetTimedOut());
+                    EXPECT_EQ(all, observed);
+                }
+            }
+        }
+
+
+        TEST(QueryPlanner, ParallelTopK)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId,
+                                                            1);
+
+            QueryResources resources;
+            auto config = Factories::CreateStreamConfiguration();
+            QueryParser parser("3", *config, resources.GetMatchTreeAllocator());
+            auto tree = parser.Parse();
+            ASSERT_NE(tree, nullptr);
+
+            auto diagnosticStream = Factories::CreateDiagnosticStream(std::cout);
+            QueryInstrumentation instrumentation;
+            ResultsBuffer results(index->GetIngestor().GetDocumentCount());
+
+            const size_t c_topK = 10;
+            TopKResults topK(c_topK);
+
+            Factories::RunQueryPlanner(*tree,
+                                       *index,
+                                       resources,
+                                       *diagnosticStream,
+                                       instrumentation,
+                                       results,
+                                       false,
+                                       &topK,
+                                       4);
+
+            EXPECT_EQ(instrumentation.GetData().GetMatchCount(),
+                      topK.GetMatchCount());
+            EXPECT_GE(topK.GetMatchCount(), c_topK);
+            EXPECT_EQ(topK.size(), c_topK);
+            EXPECT_EQ(instrumentation.GetData().GetRetainedCount(), c_topK);
+        }
+
+
+        TEST(QueryPlanner, BatchMatchesSerial)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId,
+                                                            2);
+
+            // The queries share rows, which the batch prefetches once.
+            char const * queries[] = { "2 3", "3", "3 5", "7 | 11", "2 3 5 7", "1601" };
+            const size_t c_queryCount = sizeof(queries) / sizeof(queries[0]);
+
+            auto config = Factories::CreateStreamConfiguration();
+            auto diagnosticStream = Factories::CreateDiagnosticStream(std::cout);
+
+            QueryBatch batch(*index, QueryResources::c_defaultPrefetchDistance);
+            std::vector<std::unique_ptr<QueryResources>> resources;
+            std::vector<std::unique_ptr<ResultsBuffer>> results;
+            for (size_t i = 0; i < c_queryCount; ++i)
+            {
+                // Batched plans run as byte code, so the slots need no
+                // code buffers.
+                resources.emplace_back(new QueryResources(1ull << 16, 0));
+                results.emplace_back(
+                    new ResultsBuffer(index->GetIngestor().GetDocumentCount()));
+            }
+
+            // The second round checks that a batch can be reused.
+            for (size_t round = 0; round < 2; ++round)
+            {
+                std::vector<QueryInstrumentation> instrumentation(c_queryCount);
+
+                batch.Reset();
+                for (size_t i = 0; i < c_queryCount; ++i)
+                {
+                    resources[i]->Reset();
+                    QueryParser parser(queries[i],
+                                       *config,
+                                       resources[i]->GetMatchTreeAllocator());
+                    auto tree = parser.Parse();
+                    ASSERT_NE(tree, nullptr);
+
+                    Factories::RunQueryPlanner(*tree,
+                                               *index,
+                                               *resources[i],
+                                               *diagnosticStream,
+                                               instrumentation[i],
+                                               *results[i],
+                                               false,
+                                               nullptr,
+                                               1,
+                                               &batch);
+                }
+                EXPECT_EQ(batch.GetPlanCount(), c_queryCount);
+
+                batch.Run();
+
+                for (size_t i = 0; i < c_queryCount; ++i)
+                {
+                    std::vector<DocId> ids;
+                    for (auto result : *results[i])
+                    {
+                        ids.push_back(result.GetHandle().GetDocId());
+                    }
+                    std::sort(ids.begin(), ids.end());
+
+                    size_t quadwordCount = 0;
+                    size_t prefetchCount = 0;
+                    auto expected = RunQuery(*index,
+                                             queries[i],
+                                             false,
+                                             1,
+                                             0,
+                                             quadwordCount,
+                                             prefetchCount);
+
+                    auto & data = instrumentation[i].GetData();
+                    EXPECT_FALSE(expected.empty()) << queries[i];
+                    EXPECT_EQ(ids, expected) << queries[i];
+                    EXPECT_EQ(data.GetMatchCount(), ids.size());
+                    EXPECT_EQ(data.GetQuadwordCount(), quadwordCount);
+                    EXPECT_FALSE(data.GetTimedOut());
+                }
+            }
+        }
+
+
+        TEST(QueryPlanner, DensityOrdering)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+
+            for (ShardId shardCount : { 1, 2 })
+            {
+                auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                                c_maxDocId,
+                                                                c_streamId,
+                                                                shardCount);
+                RowDensityTable table(*index);
+
+                // Ordering by density intersects the row for 97 first,
+                // whatever the order of the terms in the query, and skips
+                // the row for 2 in quadwords with no multiples of 97.
+                size_t rankOnly[2] = { 0, 0 };
+                size_t ordered[2] = { 0, 0 };
+                std::vector<DocId> expected;
+                char const * queries[] = { "2 97", "97 2" };
+                for (size_t i = 0; i < 2; ++i)
+                {
+                    QueryInstrumentation::Data data;
+                    QueryResources resources;
+                    auto ids = RunQuery(*index, queries[i], false, 1, resources, data);
+                    rankOnly[i] = data.GetQuadwordCount();
+                    EXPECT_GT(ids.size(), 0u);
+
+                    QueryResources densityResources;
+                    densityResources.SetDensityTable(&table);
+                    auto observed = RunQuery(*index,
+                                             queries[i],
+                                             false,
+                                             1,
+                                             densityResources,
+                                             data);
+                    ordered[i] = data.GetQuadwordCount();
+                    EXPECT_EQ(ids, observed) << queries[i];
+
+                    if (i > 0)
+                    {
+                        EXPECT_EQ(expected, ids);
+                    }
+                    expected = ids;
+                }
+
+                EXPECT_EQ(ordered[0], ordered[1]);
+                EXPECT_LT(ordered[0], (std::min)(rankOnly[0], rankOnly[1]));
+
+                // The other matchers share a single plan ordered by the
+                // average density, and find the same matches. The compiled
+                // matcher does not count quadwords.
+                for (auto useNativeCode : { false, true })
+                {
+                    for (size_t threadCount : { 1, 3 })
+                    {
+                        if (!useNativeCode && threadCount == 1)
+                        {
+                            continue;
+                        }
+                        QueryInstrumentation::Data data;
+                        QueryResources resources;
+                        resources.SetDensityTable(&table);
+                        auto observed = RunQuery(*index,
+                                                 "2 97",
+                                                 useNativeCode,
+                                                 threadCount,
+                                                 resources,
+                                                 data);
+                        EXPECT_EQ(expected, observed);
+                        if (!useNativeCode)
+                        {
+                            EXPECT_EQ(ordered[0], data.GetQuadwordCount());
+                        }
+                    }
+                }
+            }
+        }
+
+
+        TEST(QueryPlanner, SlicePruning)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+
+            for (ShardId shardCount : { 1, 2 })
+            {
+                auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                                c_maxDocId,
+                                                                c_streamId,
+                                                                shardCount);
+
+                // The large primes have one or two multiples, so the rows
+                // for these terms are empty in most slices. Multiples of 2
+                // are in every slice, so that query cannot prune.
+                char const * queries[] = { "1601", "2 829", "1021 | 1601", "2" };
+                for (auto query : queries)
+                {
+                    QueryInstrumentation::Data data;
+                    QueryResources unpruned;
+                    unpruned.SetSlicePruning(false);
+                    auto expected = RunQuery(*index, query, false, 1, unpruned, data);
+                    const size_t fullScanQuadwords = data.GetQuadwordCount();
+                    EXPECT_GT(expected.size(), 0u) << query;
+
+                    size_t prunedQuadwords = 0;
+                    for (auto useNativeCode : { false, true })
+                    {
+                        for (size_t threadCount : { 1, 3 })
+                        {
+                            QueryResources resources;
+                            auto observed = RunQuery(*index,
+                                                     query,
+                                                     useNativeCode,
+                                                     threadCount,
+                                                     resources,
+                                                     data);
+                            EXPECT_EQ(expected, observed) << query;
+
+                            // The compiled matcher does not count quadwords.
+                            if (!useNativeCode)
+                            {
+                                if (threadCount > 1)
+                                {
+                                    EXPECT_EQ(prunedQuadwords, data.GetQuadwordCount());
+                                }
+                                prunedQuadwords = data.GetQuadwordCount();
+                            }
+                        }
+                    }
+
+                    if (strcmp(query, "2") == 0)
+                    {
+                        EXPECT_EQ(prunedQuadwords, fullScanQuadwords);
+                    }
+                    else
+                    {
+                        EXPECT_LT(prunedQuadwords, fullScanQuadwords) << query;
+                    }
+                }
+            }
+        }
+
+
+        TEST(QueryPlanner, NoAllocationsAfterWarmUp)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId,
+                                                            2);
+
+            auto config = Factories::CreateStreamConfiguration();
+            auto diagnosticStream = Factories::CreateDiagnosticStream(std::cout);
+            QueryResources resources;
+            ResultsBuffer results(index->GetIngestor().GetDocumentCount());
+
+            // The first query of each shape sizes the arenas, code vectors,
+            // and interpreter stacks. After that, a query should not touch
+            // the heap. Native code is not covered because NativeJIT builds
+            // its expression trees with heap allocated containers. In
+            // parallel mode, only the allocations of the query thread are
+            // counted.
+            for (size_t threadCount : { 1u, 3u })
+            {
+                for (auto query : { "2 3 5", "7 | 11", "2 | 3 5" })
+                {
+                    for (size_t i = 0; i < 3; ++i)
+                    {
+                        size_t allocationCount = 0;
+                        size_t matchCount = 0;
+                        {
+                            AllocationCounter counter;
+
+                            resources.Reset();
+                            QueryInstrumentation instrumentation;
+                            QueryParser parser(query,
+                                               *config,
+                                               resources.GetMatchTreeAllocator());
+                            auto tree = parser.Parse();
+
+                            Factories::RunQueryPlanner(*tree,
+                                                       *index,
+                                                       resources,
+                                                       *diagnosticStream,
+                                                       instrumentation,
+                                                       results,
+                                                       false,
+                                                       nullptr,
+                                                       threadCount);
+
+                            matchCount = instrumentation.GetData().GetMatchCount();
+                            allocationCount = counter.GetCount();
+                        }
+
+                        EXPECT_GT(matchCount, 0u);
+                        if (i > 0)
+                        {
+                            EXPECT_EQ(allocationCount, 0u) << query << " " << threadCount;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
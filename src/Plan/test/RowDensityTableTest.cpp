@@ -0,0 +1,103 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IFileSystem.h"
+#include "BitFunnel/Index/IDocument.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/IShard.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/RowIdSequence.h"
+#include "BitFunnel/Mocks/Factories.h"
+#include "RowDensityTable.h"
+
+
+namespace BitFunnel
+{
+    namespace RowDensityTableTest
+    {
+        static const Term::StreamId c_streamId = 0;
+        static const DocId c_maxDocId = 1664;
+
+
+        static RowId GetRow(ISimpleIndex const & index, char const * text)
+        {
+            Term term(text, c_streamId, index.GetConfiguration());
+            RowIdSequence rows(term, index.GetTermTable(0));
+            return *rows.begin();
+        }
+
+
+        TEST(RowDensityTable, Estimates)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId,
+                                                            1);
+
+            RowDensityTable table(*index);
+
+            // In the PrimeFactors index, a prime's row is set for roughly
+            // one document in prime.
+            const double density2 = table.GetDensity(0, GetRow(*index, "2"));
+            const double density3 = table.GetDensity(0, GetRow(*index, "3"));
+            const double density97 = table.GetDensity(0, GetRow(*index, "97"));
+            EXPECT_GT(density2, density3);
+            EXPECT_GT(density3, density97);
+            EXPECT_GT(density97, 0.0);
+            EXPECT_LT(density2, 0.5);
+            EXPECT_EQ(table.GetEstimateCount(), 3u);
+
+            // Estimates are cached while the shard's slice count is stable.
+            EXPECT_EQ(table.GetDensity(0, GetRow(*index, "2")), density2);
+            EXPECT_EQ(table.GetEstimateCount(), 3u);
+
+            // Ingesting the documents a second time roughly doubles the
+            // slice count, so the next lookup refreshes the estimate.
+            IShard const & shard = index->GetIngestor().GetShard(0);
+            const size_t sliceCount = shard.GetSliceBuffers().size();
+            for (DocId docId = 0; docId <= c_maxDocId; ++docId)
+            {
+                auto document =
+                    Factories::CreatePrimeFactorsDocument(
+                        index->GetConfiguration(),
+                        docId,
+                        c_maxDocId,
+                        c_streamId);
+                index->GetIngestor().Add(docId + c_maxDocId + 1, *document);
+            }
+            ASSERT_GT(shard.GetSliceBuffers().size(),
+                      sliceCount + sliceCount / RowDensityTable::c_refreshDivisor);
+
+            const double refreshed = table.GetDensity(0, GetRow(*index, "2"));
+            EXPECT_EQ(table.GetEstimateCount(), 4u);
+            EXPECT_GT(refreshed, density3);
+
+            table.GetDensity(0, GetRow(*index, "2"));
+            EXPECT_EQ(table.GetEstimateCount(), 4u);
+        }
+    }
+}
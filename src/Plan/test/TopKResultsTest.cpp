@@ -0,0 +1,77 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include "gtest/gtest.h"
+
+#include "TopKResults.h"
+
+
+namespace BitFunnel
+{
+    namespace TopKResultsUnitTest
+    {
+        TEST(TopKResults, RetainsHighestScores)
+        {
+            TopKResults topK(3, TopKResults::c_noScoreBlob, 100.0f);
+
+            const float scores[] = { 5.0f, 1.0f, 9.0f, 3.0f, 7.0f, 2.0f };
+            for (DocIndex i = 0; i < 6; ++i)
+            {
+                topK.Add(nullptr, i, scores[i]);
+            }
+
+            EXPECT_EQ(topK.GetMatchCount(), 6u);
+            EXPECT_EQ(topK.size(), 3u);
+            EXPECT_EQ(topK.GetThreshold(), 5.0f);
+            EXPECT_FALSE(topK.CanTerminate());
+
+            auto const & sorted = topK.Sort();
+            ASSERT_EQ(sorted.size(), 3u);
+            EXPECT_EQ(sorted[0].m_index, 2u);
+            EXPECT_EQ(sorted[1].m_index, 4u);
+            EXPECT_EQ(sorted[2].m_index, 0u);
+
+            topK.Reset();
+            EXPECT_EQ(topK.size(), 0u);
+            EXPECT_EQ(topK.GetMatchCount(), 0u);
+        }
+
+
+        TEST(TopKResults, EarlyTermination)
+        {
+            // Without a score blob, all scores are zero and the first k
+            // matches are retained.
+            TopKResults topK(2);
+
+            EXPECT_TRUE(topK.GetThreshold() < 0.0f);
+            topK.Add(nullptr, 10, 0.0f);
+            EXPECT_FALSE(topK.CanTerminate());
+            topK.Add(nullptr, 11, 0.0f);
+            EXPECT_TRUE(topK.CanTerminate());
+
+            // Ties with the threshold are rejected.
+            topK.Add(nullptr, 12, 0.0f);
+            auto const & sorted = topK.Sort();
+            EXPECT_NE(sorted[0].m_index, 12u);
+            EXPECT_NE(sorted[1].m_index, 12u);
+        }
+    }
+}
@@ -0,0 +1,79 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <iostream>
+
+#include "BatchCommand.h"
+#include "Environment.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // BatchCommand
+    //
+    //*************************************************************************
+    BatchCommand::BatchCommand(Environment & environment,
+                               Id id,
+                               char const * parameters)
+        : TaskBase(environment, id, Type::Synchronous)
+    {
+        auto token = TaskFactory::GetNextToken(parameters);
+        m_batchSize = stoull(token);
+    }
+
+
+    void BatchCommand::Execute()
+    {
+        GetEnvironment().SetBatchSize(m_batchSize);
+        if (m_batchSize <= 1)
+        {
+            std::cout
+                << "Query logs are matched one query at a time.";
+        }
+        else
+        {
+            std::cout
+                << "Query logs are matched "
+                << m_batchSize
+                << " queries per pass over the index.";
+        }
+        std::cout
+            << std::endl
+            << std::endl;
+    }
+
+
+    ICommand::Documentation BatchCommand::GetDocumentation()
+    {
+        return Documentation(
+            "batch",
+            "Set the number of queries matched per pass over the index.",
+            "batch <size>\n"
+            "  When processing a query log, each thread matches <size>\n"
+            "  queries together, running all of them against a slice\n"
+            "  while its rows are in cache. Requires interpreter mode.\n"
+            "  A size of 0 or 1 matches one query at a time, the default."
+        );
+    }
+}
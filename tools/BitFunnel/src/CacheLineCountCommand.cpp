@@ -49,7 +49,9 @@ namespace BitFunnel
         if (env.GetCacheLineCountMode())
         {
             std::cout
-                << "Counting cache lines.";
+                << "Counting cache lines. Prefetch distance is "
+                << env.GetPrefetchDistance()
+                << " slices.";
         }
         else
         {
@@ -68,7 +70,10 @@ namespace BitFunnel
             "cachelines",
             "Toggles counting of row cachelines accessed.",
             "cachelines\n"
-            "  Toggles counting of row cachelines accessed during query processing."
+            "  Toggles counting of row cachelines accessed during query processing.\n"
+            "  Compare the cachelines column with the quadwords column to see how\n"
+            "  many quadwords each line serves, and with the prefetches column to\n"
+            "  see how many lines were prefetched ahead of use (see 'prefetch')."
         );
     }
 }
@@ -0,0 +1,77 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <iostream>
+
+#include "BitFunnel/Index/IIngestor.h"
+#include "CompactCommand.h"
+#include "Environment.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // CompactCommand
+    //
+    //*************************************************************************
+    CompactCommand::CompactCommand(Environment & environment,
+                                   Id id,
+                                   char const * parameters)
+        : TaskBase(environment, id, Type::Synchronous),
+          m_maxLiveFraction(0.5)
+    {
+        auto token = TaskFactory::GetNextToken(parameters);
+        if (token.size() > 0)
+        {
+            m_maxLiveFraction = stod(token);
+        }
+    }
+
+
+    void CompactCommand::Execute()
+    {
+        auto & ingestor = GetEnvironment().GetIngestor();
+        const size_t movedCount = ingestor.CompactSlices(m_maxLiveFraction);
+        std::cout
+            << "Moved "
+            << movedCount
+            << " document"
+            << ((movedCount == 1) ? "" : "s")
+            << " out of sparse slices."
+            << std::endl
+            << std::endl;
+    }
+
+
+    ICommand::Documentation CompactCommand::GetDocumentation()
+    {
+        return Documentation(
+            "compact",
+            "Reclaims slices held by deleted documents.",
+            "compact [fraction]\n"
+            "  Moves the documents of slices in which at most <fraction>\n"
+            "  of the columns are live into new slices, then recycles the\n"
+            "  sparse slices. The default fraction is 0.5."
+        );
+    }
+}
@@ -0,0 +1,98 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <iostream>
+
+#include "DeadlineCommand.h"
+#include "Environment.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // DeadlineCommand
+    //
+    //*************************************************************************
+    DeadlineCommand::DeadlineCommand(Environment & environment,
+                                     Id id,
+                                     char const * parameters)
+        : TaskBase(environment, id, Type::Synchronous),
+          m_quadwordBudget(0)
+    {
+        auto token = TaskFactory::GetNextToken(parameters);
+        m_timeBudget = stod(token) / 1000.0;
+
+        token = TaskFactory::GetNextToken(parameters);
+        if (token.size() > 0)
+        {
+            m_quadwordBudget = stoull(token);
+        }
+    }
+
+
+    void DeadlineCommand::Execute()
+    {
+        GetEnvironment().SetTimeBudget(m_timeBudget);
+        GetEnvironment().SetQuadwordBudget(m_quadwordBudget);
+
+        std::cout << "Time budget: ";
+        if (m_timeBudget > 0.0)
+        {
+            std::cout << m_timeBudget * 1000.0 << "ms";
+        }
+        else
+        {
+            std::cout << "unlimited";
+        }
+        std::cout << std::endl;
+
+        std::cout << "Quadword budget: ";
+        if (m_quadwordBudget > 0)
+        {
+            std::cout << m_quadwordBudget;
+        }
+        else
+        {
+            std::cout << "unlimited";
+        }
+
+        std::cout
+            << std::endl
+            << std::endl;
+    }
+
+
+    ICommand::Documentation DeadlineCommand::GetDocumentation()
+    {
+        return Documentation(
+            "deadline",
+            "Set per-query time and quadword budgets.",
+            "deadline <milliseconds> [quadwords]\n"
+            "  Stop matching a query before the first slice that starts after\n"
+            "  <milliseconds> since the query began, or after [quadwords]\n"
+            "  quadwords at the plan's initial rank have been scanned. Such\n"
+            "  queries report partial results and are counted as timed out.\n"
+            "  A budget of 0 is unlimited. The default is no budgets."
+        );
+    }
+}
@@ -0,0 +1,77 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <iostream>
+
+#include "DensitiesCommand.h"
+#include "Environment.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // DensitiesCommand
+    //
+    //*************************************************************************
+    DensitiesCommand::DensitiesCommand(Environment & environment,
+                                       Id id,
+                                       char const * /*parameters*/)
+        : TaskBase(environment, id, Type::Synchronous)
+    {
+    }
+
+
+    void DensitiesCommand::Execute()
+    {
+        auto & env = GetEnvironment();
+        env.SetDensityOrdering(!env.GetDensityOrdering());
+
+        if (env.GetDensityOrdering())
+        {
+            std::cout
+                << "Query plans now intersect the sparsest rows of each rank first.";
+        }
+        else
+        {
+            std::cout
+                << "Query plans now order rows by rank alone.";
+        }
+        std::cout
+            << std::endl
+            << std::endl;
+    }
+
+
+    ICommand::Documentation DensitiesCommand::GetDocumentation()
+    {
+        return Documentation(
+            "densities",
+            "Toggles ordering of plan rows by bit density.",
+            "densities\n"
+            "  Toggles ordering of the rows of each rank from sparsest to densest\n"
+            "  using bit density estimates sampled from the index. Compare the\n"
+            "  quadwords column with and without density ordering to see the\n"
+            "  effect on a query."
+        );
+    }
+}
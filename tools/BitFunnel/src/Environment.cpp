@@ -23,23 +23,31 @@
 #include "BitFunnel/Index/Factories.h"
 #include "BitFunnel/Index/IRecycler.h"
 #include "AnalyzeCommand.h"
+#include "BatchCommand.h"
 #include "CacheLineCountCommand.h"
 #include "CdCommand.h"
+#include "CompactCommand.h"
 #include "CompilerCommand.h"
 #include "CorrelateCommand.h"
+#include "DeadlineCommand.h"
+#include "DensitiesCommand.h"
 #include "Environment.h"
 #include "ExitCommand.h"
 #include "FailOnExceptionCommand.h"
 #include "HelpCommand.h"
 #include "IngestCommands.h"
 #include "InterpreterCommand.h"
+#include "ParallelCommand.h"
+#include "PrefetchCommand.h"
 #include "QueryCommand.h"
+#include "ReadSlicesCommand.h"
 #include "ScriptCommand.h"
 #include "ShowCommand.h"
 #include "StatusCommand.h"
 #include "TaskFactory.h"
 #include "TaskPool.h"
 #include "ThreadsCommand.h"
+#include "TopKCommand.h"
 #include "VerifyCommand.h"
 #include "WriteSlicesCommand.h"
 
@@ -51,7 +59,10 @@ namespace BitFunnel
                              char const * directory,
                              size_t gramSize,
                              size_t threadCount,
-                             size_t memory)
+                             size_t memory,
+                             PageSize pageSize,
+                             unsigned numaNodeCount,
+                             bool forwardIndex)
       // TODO: Don't like passing *this to TaskFactory.
       // What if TaskFactory calls back before Environment is fully initialized?
       : m_fileSystem(fileSystem),
@@ -61,9 +72,19 @@ namespace BitFunnel
         m_index(Factories::CreateSimpleIndex(fileSystem)),
         m_cacheLineCountMode(false),
         m_compilerMode(true),
+        m_densityOrdering(false),
         m_failOnException(false),
         m_threadCount(threadCount),
+        m_topK(0),
+        m_matchThreadCount(1),
+        m_prefetchDistance(1),
+        m_timeBudget(0.0),
+        m_quadwordBudget(0),
+        m_batchSize(1),
         m_memory(memory),
+        m_pageSize(pageSize),
+        m_numaNodeCount(numaNodeCount),
+        m_forwardIndex(forwardIndex),
         m_directory(directory),
         m_gramSize(gramSize),
         m_output(output)
@@ -75,21 +96,29 @@ namespace BitFunnel
     void Environment::RegisterCommands()
     {
         m_taskFactory->RegisterCommand<Analyze>();
+        m_taskFactory->RegisterCommand<BatchCommand>();
         m_taskFactory->RegisterCommand<Cache>();
         m_taskFactory->RegisterCommand<CacheLineCountCommand>();
         m_taskFactory->RegisterCommand<Cd>();
+        m_taskFactory->RegisterCommand<CompactCommand>();
         m_taskFactory->RegisterCommand<CompilerCommand>();
         m_taskFactory->RegisterCommand<Correlate>();
+        m_taskFactory->RegisterCommand<DeadlineCommand>();
+        m_taskFactory->RegisterCommand<DensitiesCommand>();
         m_taskFactory->RegisterCommand<Exit>();
         m_taskFactory->RegisterCommand<FailOnException>();
         m_taskFactory->RegisterCommand<Help>();
         m_taskFactory->RegisterCommand<InterpreterCommand>();
         m_taskFactory->RegisterCommand<Load>();
+        m_taskFactory->RegisterCommand<ParallelCommand>();
+        m_taskFactory->RegisterCommand<PrefetchCommand>();
         m_taskFactory->RegisterCommand<Query>();
+        m_taskFactory->RegisterCommand<ReadSlicesCommand>();
         m_taskFactory->RegisterCommand<Script>();
         m_taskFactory->RegisterCommand<Show>();
         m_taskFactory->RegisterCommand<Status>();
         m_taskFactory->RegisterCommand<ThreadsCommand>();
+        m_taskFactory->RegisterCommand<TopKCommand>();
         m_taskFactory->RegisterCommand<Verify>();
         m_taskFactory->RegisterCommand<WriteSlicesCommand>();
     }
@@ -98,6 +127,11 @@ namespace BitFunnel
     void Environment::StartIndex()
     {
         m_index->SetBlockAllocatorBufferSize(m_memory);
+        m_index->SetSliceBufferPlacement(m_pageSize, m_numaNodeCount);
+        if (m_forwardIndex)
+        {
+            m_index->EnableForwardIndex();
+        }
         m_index->ConfigureForServing(m_directory.c_str(), m_gramSize, false);
         m_index->StartIndex();
     }
@@ -151,6 +185,18 @@ namespace BitFunnel
     }
 
 
+    bool Environment::GetDensityOrdering() const
+    {
+        return m_densityOrdering;
+    }
+
+
+    void Environment::SetDensityOrdering(bool mode)
+    {
+        m_densityOrdering = mode;
+    }
+
+
     std::string const & Environment::GetOutputDir() const
     {
         return m_outputDir;
@@ -181,6 +227,78 @@ namespace BitFunnel
     }
 
 
+    size_t Environment::GetTopK() const
+    {
+        return m_topK;
+    }
+
+
+    void Environment::SetTopK(size_t topK)
+    {
+        m_topK = topK;
+    }
+
+
+    size_t Environment::GetMatchThreadCount() const
+    {
+        return m_matchThreadCount;
+    }
+
+
+    void Environment::SetMatchThreadCount(size_t matchThreadCount)
+    {
+        m_matchThreadCount = matchThreadCount;
+    }
+
+
+    size_t Environment::GetPrefetchDistance() const
+    {
+        return m_prefetchDistance;
+    }
+
+
+    void Environment::SetPrefetchDistance(size_t prefetchDistance)
+    {
+        m_prefetchDistance = prefetchDistance;
+    }
+
+
+    double Environment::GetTimeBudget() const
+    {
+        return m_timeBudget;
+    }
+
+
+    void Environment::SetTimeBudget(double timeBudget)
+    {
+        m_timeBudget = timeBudget;
+    }
+
+
+    size_t Environment::GetQuadwordBudget() const
+    {
+        return m_quadwordBudget;
+    }
+
+
+    void Environment::SetQuadwordBudget(size_t quadwordBudget)
+    {
+        m_quadwordBudget = quadwordBudget;
+    }
+
+
+    size_t Environment::GetBatchSize() const
+    {
+        return m_batchSize;
+    }
+
+
+    void Environment::SetBatchSize(size_t batchSize)
+    {
+        m_batchSize = batchSize;
+    }
+
+
     size_t Environment::GetMemory() const
     {
         return m_memory;
@@ -28,6 +28,7 @@
 #include "BitFunnel/Index/ISimpleIndex.h"   // Parameterizes std::unique_ptr.
 #include "BitFunnel/NonCopyable.h"          // Base class.
 #include "BitFunnel/Term.h"                 // Term::GramSize embedded.
+#include "BitFunnel/Utilities/IBlockAllocator.h"    // PageSize embedded.
 #include "TaskFactory.h"                    // Parameterizes std::unique_ptr.
 #include "TaskPool.h"                       // Parameterizes std::unique_ptr.
 
@@ -46,7 +47,10 @@ namespace BitFunnel
                     char const * directory,
                     size_t gramSize,
                     size_t threadCount,
-                    size_t memory);
+                    size_t memory,
+                    PageSize pageSize,
+                    unsigned numaNodeCount,
+                    bool forwardIndex);
 
         ~Environment();
 
@@ -60,6 +64,9 @@ namespace BitFunnel
         bool GetCompilerMode() const;
         void SetCompilerMode(bool mode);
 
+        bool GetDensityOrdering() const;
+        void SetDensityOrdering(bool mode);
+
         bool GetFailOnException() const;
         void SetFailOnException(bool mode);
 
@@ -71,6 +78,24 @@ namespace BitFunnel
         size_t GetThreadCount() const;
         void SetThreadCount(size_t threadCount);
 
+        size_t GetTopK() const;
+        void SetTopK(size_t topK);
+
+        size_t GetMatchThreadCount() const;
+        void SetMatchThreadCount(size_t matchThreadCount);
+
+        size_t GetPrefetchDistance() const;
+        void SetPrefetchDistance(size_t prefetchDistance);
+
+        double GetTimeBudget() const;
+        void SetTimeBudget(double timeBudget);
+
+        size_t GetQuadwordBudget() const;
+        void SetQuadwordBudget(size_t quadwordBudget);
+
+        size_t GetBatchSize() const;
+        void SetBatchSize(size_t batchSize);
+
         size_t GetMemory() const;
 
         TaskFactory & GetTaskFactory() const;
@@ -91,9 +116,19 @@ namespace BitFunnel
 
         bool m_cacheLineCountMode;
         bool m_compilerMode;
+        bool m_densityOrdering;
         bool m_failOnException;
         size_t m_threadCount;
+        size_t m_topK;
+        size_t m_matchThreadCount;
+        size_t m_prefetchDistance;
+        double m_timeBudget;
+        size_t m_quadwordBudget;
+        size_t m_batchSize;
         size_t m_memory;
+        PageSize m_pageSize;
+        unsigned m_numaNodeCount;
+        bool m_forwardIndex;
         std::string m_directory;
         size_t m_gramSize;
         std::string m_outputDir;
@@ -79,7 +79,15 @@ namespace BitFunnel
                 QueryRunner::Run(m_query.c_str(),
                                  GetEnvironment().GetSimpleIndex(),
                                  GetEnvironment().GetCompilerMode(),
-                                 GetEnvironment().GetCacheLineCountMode());
+                                 GetEnvironment().GetCacheLineCountMode(),
+                                 GetEnvironment().GetTopK(),
+                                 QueryRunner::c_noScoreBlob,
+                                 0.0f,
+                                 GetEnvironment().GetMatchThreadCount(),
+                                 GetEnvironment().GetPrefetchDistance(),
+                                 GetEnvironment().GetTimeBudget(),
+                                 GetEnvironment().GetQuadwordBudget(),
+                                 GetEnvironment().GetDensityOrdering());
 
             output << "Results:" << std::endl;
             CsvTsv::CsvTableFormatter formatter(output);
@@ -110,7 +118,16 @@ namespace BitFunnel
                                  queries,
                                  c_iterations,
                                  GetEnvironment().GetCompilerMode(),
-                                 GetEnvironment().GetCacheLineCountMode());
+                                 GetEnvironment().GetCacheLineCountMode(),
+                                 GetEnvironment().GetTopK(),
+                                 QueryRunner::c_noScoreBlob,
+                                 0.0f,
+                                 GetEnvironment().GetMatchThreadCount(),
+                                 GetEnvironment().GetPrefetchDistance(),
+                                 GetEnvironment().GetTimeBudget(),
+                                 GetEnvironment().GetQuadwordBudget(),
+                                 GetEnvironment().GetBatchSize(),
+                                 GetEnvironment().GetDensityOrdering());
             output << "Results:" << std::endl;
             statistics.Print(output);
 
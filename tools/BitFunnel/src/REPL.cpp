@@ -23,6 +23,7 @@
 #include <iostream>
 
 #include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Utilities/Numa.h"
 #include "BitFunnel/Utilities/ReadLines.h"
 #include "CmdLineParser/CmdLineParser.h"
 #include "Environment.h"
@@ -76,6 +77,31 @@ namespace BitFunnel
             1000000u,
             CmdLine::GreaterThan(0));
 
+        // TODO: This parameter should be unsigned, but it doesn't seem to work
+        // with CmdLineParser.
+        CmdLine::OptionalParameter<int> hugePages(
+            "hugepages",
+            "Back Slice buffers with huge pages of the given size in MiB "
+            "(2 or 1024), falling back to default pages when the system has "
+            "none available. Zero selects default pages.",
+            0u,
+            CmdLine::GreaterThanOrEqual(0));
+
+        // TODO: This parameter should be unsigned, but it doesn't seem to work
+        // with CmdLineParser.
+        CmdLine::OptionalParameter<int> numa(
+            "numa",
+            "Give each of the given number of NUMA nodes its own pool of Slice "
+            "buffers, binding shards and query threads to the nodes. Zero "
+            "selects all nodes.",
+            1u,
+            CmdLine::GreaterThanOrEqual(0));
+
+        CmdLine::OptionalParameterList forwardIndex(
+            "forwardindex",
+            "Record the terms of each document in a forward index and remove "
+            "the false positives from query results.");
+
         CmdLine::OptionalParameter<char const *> scriptFile(
             "script",
             "File with commands to execute.",
@@ -85,6 +111,9 @@ namespace BitFunnel
         parser.AddParameter(gramSize);
         parser.AddParameter(threadCount);
         parser.AddParameter(memory);
+        parser.AddParameter(hugePages);
+        parser.AddParameter(numa);
+        parser.AddParameter(forwardIndex);
         parser.AddParameter(scriptFile);
 
         int returnCode = 1;
@@ -93,6 +122,25 @@ namespace BitFunnel
         {
             try
             {
+                PageSize pageSize = PageSize::Default;
+                if (hugePages == 2)
+                {
+                    pageSize = PageSize::Huge2MB;
+                }
+                else if (hugePages == 1024)
+                {
+                    pageSize = PageSize::Huge1GB;
+                }
+                else if (hugePages != 0)
+                {
+                    RecoverableError error("Huge page size must be 2 or 1024 MiB.");
+                    throw error;
+                }
+
+                const unsigned numaNodeCount = (numa == 0) ?
+                    GetNumaNodeCount() :
+                    static_cast<unsigned>(numa);
+
                 // TODO: these casts can be removed when gramSize and
                 // threadCount are fixed to be unsigned.
                 Go(input,
@@ -101,6 +149,9 @@ namespace BitFunnel
                    static_cast<size_t>(gramSize),
                    static_cast<size_t>(threadCount),
                    static_cast<size_t>(memory) * 1024ull,
+                   pageSize,
+                   numaNodeCount,
+                   forwardIndex.IsActivated(),
                    scriptFile);
                 returnCode = 0;
             }
@@ -158,6 +209,9 @@ namespace BitFunnel
                   size_t gramSize,
                   size_t threadCount,
                   size_t memory,
+                  PageSize pageSize,
+                  unsigned numaNodeCount,
+                  bool forwardIndex,
                   char const * scriptFile) const
     {
         output
@@ -168,6 +222,8 @@ namespace BitFunnel
             << std::endl
             << "directory = \"" << directory << "\"" << std::endl
             << "gram size = " << gramSize << std::endl
+            << "NUMA nodes = " << numaNodeCount << std::endl
+            << "forward index = " << (forwardIndex ? "on" : "off") << std::endl
             << std::endl;
 
         Environment environment(m_fileSystem,
@@ -175,7 +231,10 @@ namespace BitFunnel
                                 directory,
                                 gramSize,
                                 threadCount,
-                                memory);
+                                memory,
+                                pageSize,
+                                numaNodeCount,
+                                forwardIndex);
 
         output
             << "Starting index ..."
@@ -22,7 +22,8 @@
 
 #pragma once
 
-#include "BitFunnel/IExecutable.h"  // Base class.
+#include "BitFunnel/IExecutable.h"                  // Base class.
+#include "BitFunnel/Utilities/IBlockAllocator.h"    // PageSize parameter.
 
 
 namespace BitFunnel
@@ -55,6 +56,9 @@ namespace BitFunnel
                 size_t gramSize,
                 size_t threadCount,
                 size_t memory,
+                PageSize pageSize,
+                unsigned numaNodeCount,
+                bool forwardIndex,
                 char const * scriptFile) const;
 
         void Loop(Environment& environment,
@@ -0,0 +1,84 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include <iostream>
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "Environment.h"
+#include "ReadSlicesCommand.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // ReadSlicesCommand
+    //
+    //*************************************************************************
+    ReadSlicesCommand::ReadSlicesCommand(Environment & environment,
+                                         Id id,
+                                         char const * parameters)
+        : TaskBase(environment, id, Type::Synchronous),
+          m_memoryMap(false)
+    {
+        auto token = TaskFactory::GetNextToken(parameters);
+        if (token.compare("map") == 0)
+        {
+            m_memoryMap = true;
+        }
+        else if (token.size() > 0)
+        {
+            RecoverableError error("Read expects no parameters or \"map\".");
+            throw error;
+        }
+    }
+
+
+    void ReadSlicesCommand::Execute()
+    {
+        std::cout
+            << (m_memoryMap ? "Mapping" : "Reading")
+            << " slices . . ."
+            << std::endl;
+        auto & fileManager = GetEnvironment().GetSimpleIndex().GetFileManager();
+        auto & ingestor = GetEnvironment().GetIngestor();
+        ingestor.TemporaryReadAllSlices(fileManager, m_memoryMap);
+        std::cout
+            << "Document count: "
+            << ingestor.GetDocumentCount()
+            << std::endl
+            << std::endl;
+    }
+
+
+    ICommand::Documentation ReadSlicesCommand::GetDocumentation()
+    {
+        return Documentation(
+            "read",
+            "Read all slices written by the write command.",
+            "read [map]\n"
+            "  Read all slices previously written to disk by the\n"
+            "  write command. With the map option, slice buffers are\n"
+            "  memory mapped from their files instead of being copied."
+        );
+    }
+}
@@ -78,10 +78,18 @@ namespace BitFunnel
             1u,
             CmdLine::GreaterThan(0));
 
+        CmdLine::OptionalParameter<int> approximate(
+            "approximate",
+            "Count term frequencies approximately, using about this much "
+            "memory (in KiB) per shard.",
+            65536u,
+            CmdLine::GreaterThan(0));
+
         parser.AddParameter(manifestFileName);
         parser.AddParameter(outputPath);
         parser.AddParameter(termToText);
         parser.AddParameter(gramSize);
+        parser.AddParameter(approximate);
 
         int returnCode = 1;
 
@@ -94,7 +102,10 @@ namespace BitFunnel
                                        manifestFileName,
                                        gramSize,
                                        true,
-                                       termToText.IsActivated());
+                                       termToText.IsActivated(),
+                                       approximate.IsActivated() ?
+                                           static_cast<size_t>(approximate) * 1024ull :
+                                           0);
                 returnCode = 0;
             }
             catch (RecoverableError e)
@@ -118,13 +129,15 @@ namespace BitFunnel
         // TODO: gramSize should be unsigned once CmdLineParser supports unsigned.
         int gramSize,
         bool generateStatistics,
-        bool generateTermToText) const
+        bool generateTermToText,
+        size_t statisticsBytes) const
     {
         // TODO: cast of gramSize can be removed when it's fixed to be unsigned.
         auto index = Factories::CreateSimpleIndex(m_fileSystem);
         index->ConfigureForStatistics(intermediateDirectory,
                                       static_cast<size_t>(gramSize),
                                       generateTermToText);
+        index->SetStatisticsMemory(statisticsBytes);
         index->StartIndex();
 
 
@@ -48,7 +48,8 @@ namespace BitFunnel
             char const * chunkListFileName,
             int gramSize,
             bool generateStatistics,
-            bool generateTermToText) const;
+            bool generateTermToText,
+            size_t statisticsBytes) const;
 
         IFileSystem& m_fileSystem;
     };
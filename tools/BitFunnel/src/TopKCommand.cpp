@@ -0,0 +1,82 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include <iostream>
+
+#include "Environment.h"
+#include "TopKCommand.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // TopKCommand
+    //
+    //*************************************************************************
+    TopKCommand::TopKCommand(Environment & environment,
+                             Id id,
+                             char const * parameters)
+        : TaskBase(environment, id, Type::Synchronous)
+    {
+        auto token = TaskFactory::GetNextToken(parameters);
+        m_topK = stoull(token);
+    }
+
+
+    void TopKCommand::Execute()
+    {
+        GetEnvironment().SetTopK(m_topK);
+        if (m_topK == 0)
+        {
+            std::cout
+                << "Queries now retain all matches.";
+        }
+        else
+        {
+            std::cout
+                << "Queries now stop after their first "
+                << m_topK
+                << " match"
+                << ((m_topK == 1) ? "" : "es")
+                << ".";
+        }
+        std::cout
+            << std::endl
+            << std::endl;
+    }
+
+
+    ICommand::Documentation TopKCommand::GetDocumentation()
+    {
+        return Documentation(
+            "topk",
+            "Stop each query after a number of matches.",
+            "topk <count>\n"
+            "  Retain only the first <count> matches for each query and\n"
+            "  then stop matching, using per-thread memory that does not\n"
+            "  grow with the corpus. Documents in this index have no score,\n"
+            "  so matches are not ranked. The reported match count covers\n"
+            "  only the matches found before the query stopped.\n"
+            "  A count of 0 retains all matches."
+        );
+    }
+}